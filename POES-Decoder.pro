@@ -6,19 +6,35 @@ TEMPLATE = app
 SOURCES += main.cpp \
     mainwindow.cpp \
     decoder/hrptblock.cpp \
+    decoder/framesync.cpp \
+    decoder/imagewriter.cpp \
+    decoder/passdecoder.cpp \
+    decoder/geolocation.cpp \
+    decoder/projection.cpp \
+    decoder/reproject.cpp \
+    decoder/mosaic.cpp \
+    decoder/passquality.cpp \
+    decoder/overlay.cpp \
+    decoder/avhrrcal.cpp \
     satellite/station/stationdialog.cpp \
     satellite/station/station.cpp \
     utils/plist.cpp \
     satellite/kepler/tledialog.cpp \
+    satellite/kepler/tleloader.cpp \
+    satellite/kepler/tlearchive.cpp \
     satellite/predict/Satellite.cpp \
     settings.cpp \
     utils/utils.cpp \
+    utils/tickscheduler.cpp \
+    utils/jobmanager.cpp \
     satellite/satutil.cpp \
+    satellite/satcatalog.cpp \
     satellite/orbitdata/orbitdialog.cpp \
     satellite/predict/satpassdialog.cpp \
     satellite/trackthread.cpp \
     satellite/track/trackwidget.cpp \
     imagewidget.cpp \
+    imageview.cpp \
     satellite/active/activesatdialog.cpp \
     rig/rigdialog.cpp \
     rig/rig.cpp \
@@ -33,6 +49,13 @@ SOURCES += main.cpp \
     decoder/mn1hrptblock.cpp \
     rig/rotorpindialog.cpp \
     rig/rotor.cpp \
+    rig/netrotor.cpp \
+    rig/rotorexecutor.cpp \
+    rig/rotorplanner.cpp \
+    rig/rotorsim.cpp \
+    rig/rotorreplay.cpp \
+    rig/signalmonitor.cpp \
+    rig/conicalscan.cpp \
     rig/stepper.cpp \
     rig/gs232b.cpp \
     rig/alphaspid.cpp \
@@ -43,17 +66,21 @@ SOURCES += main.cpp \
     tools/gauge.cpp \
     tools/gps/gpsdialog.cpp \
     tools/gps/gps.cpp \
+    tools/gps/gpsparser.cpp \
     rig/jrk.cpp \
     rig/jrkconfdialog.cpp \
     decoder/ahrptblock.cpp \
     decoder/cadu.cpp \
+    decoder/cadupipe.cpp \
     utils/azeldialog.cpp \
     tools/cadusplitterdialog.cpp \
+    tools/cadusplitter.cpp \
     rig/monstrum.cpp \
     satellite/property/satprop.cpp \
     satellite/property/satpropdialog.cpp \
     satellite/property/rgbconf.cpp \
     satellite/property/ndvi.cpp \
+    satellite/property/ndvilut.cpp \
     rig/usb/usbdevice.cpp \
     rig/usb/tusb.cpp \
     rig/jrkusb.cpp \
@@ -63,23 +90,39 @@ SOURCES += main.cpp \
     satellite/property/eviconfdialog.cpp
 HEADERS += mainwindow.h \
     decoder/hrptblock.h \
+    decoder/framesync.h \
+    decoder/imagewriter.h \
+    decoder/passdecoder.h \
+    decoder/geolocation.h \
+    decoder/projection.h \
+    decoder/reproject.h \
+    decoder/mosaic.h \
+    decoder/passquality.h \
+    decoder/overlay.h \
+    decoder/avhrrcal.h \
     version.h \
     os.h \
     satellite/station/stationdialog.h \
     satellite/station/station.h \
     utils/plist.h \
     satellite/kepler/tledialog.h \
+    satellite/kepler/tleloader.h \
+    satellite/kepler/tlearchive.h \
     satellite/predict/Satellite.h \
     satellite/predict/satcalc.h \
     settings.h \
     utils/utils.h \
+    utils/tickscheduler.h \
+    utils/jobmanager.h \
     config.h \
     satellite/satutil.h \
+    satellite/satcatalog.h \
     satellite/orbitdata/orbitdialog.h \
     satellite/predict/satpassdialog.h \
     satellite/trackthread.h \
     satellite/track/trackwidget.h \
     imagewidget.h \
+    imageview.h \
     satellite/active/activesatdialog.h \
     rig/rigdialog.h \
     rig/rig.h \
@@ -95,6 +138,13 @@ HEADERS += mainwindow.h \
     decoder/mn1hrptblock.h \
     rig/rotorpindialog.h \
     rig/rotor.h \
+    rig/netrotor.h \
+    rig/rotorexecutor.h \
+    rig/rotorplanner.h \
+    rig/rotorsim.h \
+    rig/rotorreplay.h \
+    rig/signalmonitor.h \
+    rig/conicalscan.h \
     rig/stepper.h \
     rig/gs232b.h \
     rig/alphaspid.h \
@@ -105,17 +155,21 @@ HEADERS += mainwindow.h \
     tools/gauge.h \
     tools/gps/gpsdialog.h \
     tools/gps/gps.h \
+    tools/gps/gpsparser.h \
     rig/jrk.h \
     rig/jrkconfdialog.h \
     decoder/ahrptblock.h \
     decoder/cadu.h \
+    decoder/cadupipe.h \
     utils/azeldialog.h \
     tools/cadusplitterdialog.h \
+    tools/cadusplitter.h \
     rig/monstrum.h \
     satellite/property/satprop.h \
     satellite/property/satpropdialog.h \
     satellite/property/rgbconf.h \
     satellite/property/ndvi.h \
+    satellite/property/ndvilut.h \
     rig/usb/usbdevice.h \
     rig/usb/tusb.h \
     rig/jrkusb.h \
@@ -197,6 +251,10 @@ unix {
     INCLUDEPATH += /usr/include
     LIBS += -lusb
 
+    # zlib, compressed PNG output, without it PNG's are stored uncompressed
+    DEFINES += HAVE_ZLIB
+    LIBS += -lz
+
     # DSP and FEC Library, http://www.ka9q.net/code/fec/
     # see conf/README-libfec.txt
     #DEFINES += HAVE_LIBFEC
@@ -27,11 +27,15 @@
 #define PATH_CONF           "conf"
 #define PATH_TLE            "tle"
 #define PATH_TLE_ARC        "tle/archive"
+#define PATH_MAPS           "conf/maps"
 
 // settings files
 #define FILE_SAT_INI        "satellites.ini"
 #define FILE_STATIONS_INI   "stations.ini"
 #define FILE_GPS_INI        "gps.ini"
+#define FILE_AVHRR_CAL_INI  "avhrr-calibration.ini"
+#define FILE_JOBS_INI       "jobs.ini"
+#define FILE_MOSAIC_INI     "mosaic.ini"
 
 
 //---------------------------------------------------------------------------
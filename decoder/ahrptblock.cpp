@@ -51,6 +51,7 @@ const int AHRPT_NUM_CHANNELS = 5;
 const int AHRPT_SCAN_WIDTH   = 2048;   // 10 bit, one image scan
 const int AHRPT_SCAN_SIZE    = 10240;  // 10 bit, width * channels
 const int AHRPT_IMAGE_START  = 88;     // CCSDS bytes + 6 bits (20 + 68 bytes + 550 bits)
+const int AHRPT_TIME_END     = 14;     // primary and secondary header bytes
 
 //---------------------------------------------------------------------------
 //#define DEBUG_FRAME
@@ -63,6 +64,8 @@ TAHRPT::TAHRPT(TBlock *_block)
 
   scanLine = NULL;
   fp = NULL;
+  nextFrame = -1;
+  lastFrame = -1;
 }
 
 //---------------------------------------------------------------------------
@@ -123,7 +126,7 @@ int TAHRPT::countFrames(void)
 long TAHRPT::count_AVHRR_HR_frames(void)
 {
     quint16 hdr_ptr, apid;
-    quint8  vcid, find_vcid;
+    quint8  vcid, find_vcid, *pkt;
     long    frames = 0;
 
     find_vcid = 0x09; // MetOp
@@ -136,6 +139,9 @@ long TAHRPT::count_AVHRR_HR_frames(void)
     cadu->outfp = fopen("/home/poes-weather/Downloads/metop-a-derand.cadu", "wb");
 #endif
 
+    frameAddr.clear();
+    nextFrame = lastFrame = -1;
+
     fseek(fp, 0, SEEK_SET);
 
     while(cadu->findsync()) {
@@ -153,13 +159,19 @@ long TAHRPT::count_AVHRR_HR_frames(void)
             continue;
 
         if(cadu->first_hdr_ptr(&hdr_ptr)) {
-            apid = cadu->apid(cadu->get_mpdu_packet(hdr_ptr));
+            pkt = cadu->get_mpdu_packet(hdr_ptr);
+            apid = cadu->apid(pkt);
 
             // 0x047f fy3a guess
             if(apid == 103 || apid == 104 /*|| apid == 0x047f*/) {
                 if(frames == 0)
                     block->setFirstFrameSyncPos(cadu->getpacketaddress());
 
+                // secondary header time, the whole header must be in this CADU
+                if(hdr_ptr + AHRPT_TIME_END <= 882)
+                    block->setLineTime(frames, packetTime(pkt + 6));
+
+                frameAddr.append(cadu->getpacketaddress());
                 frames++;
             }
 
@@ -195,6 +207,24 @@ long TAHRPT::count_AVHRR_HR_frames(void)
 }
 
 
+//---------------------------------------------------------------------------
+// CCSDS day segmented time of the packet secondary header, 16 bit days
+// from 2000-01-01, 32 bit milliseconds of the day and 16 bit microseconds
+double TAHRPT::packetTime(const quint8 *hdr)
+{
+    quint32 day, msec, usec;
+
+    day  = (hdr[0] << 8) | hdr[1];
+    msec = (hdr[2] << 24) | (hdr[3] << 16) | (hdr[4] << 8) | hdr[5];
+    usec = (hdr[6] << 8) | hdr[7];
+
+    if(msec >= 86400000 || usec >= 1000)
+        return 0;
+
+    // daynum of 2000-01-01 is 7306
+    return 7306.0 + day + (msec + usec / 1000.0) / 86400000.0;
+}
+
 //---------------------------------------------------------------------------
 int TAHRPT::getWidth(void)
 {
@@ -218,6 +248,7 @@ bool TAHRPT::readFrameScanLine(int frame_nr)
     int     scan_index, read_size, scan_pos;
     int     i, index;
     bool    error;
+    TCADUStats stats;
 
 
 #ifdef DEBUG_FRAME
@@ -231,17 +262,25 @@ bool TAHRPT::readFrameScanLine(int frame_nr)
     // missed pixels will be shown as black line
     memset(scanLine, 0, AHRPT_SCAN_SIZE << 1);
 
-    // file pointer MUST be set at firstFrameSyncPos using fseek
-    // when started, frame_nr = 0
+    if(frame_nr < 0 || frame_nr >= frameAddr.size())
+        return false;
 
+    // link statistics of the packets read for this line
     if(frame_nr == 0)
-        vcdu = cadu->getpayload(); // read the whole CADU
-    else {
-        if(frame_nr >= block->getFrames())
-            return false;
+        cadu->resetStats();
+
+    // the previous line ends with the CADU of this one, else seek to it,
+    // the packets are decoded ahead only when reading forward
+    if(frame_nr == nextFrame)
+        vcdu = cadu->getpayload_buffer();
+    else if(cadu->seek(frameAddr[frame_nr], frame_nr > lastFrame))
+        vcdu = cadu->getpayload();
+    else
+        vcdu = NULL;
 
-        vcdu = cadu->getpayload_buffer(); // CADU is already in buffer
-    }
+    stats = cadu->getStats();
+    nextFrame = -1;
+    lastFrame = frame_nr;
 
     if(vcdu == NULL)
         return false;
@@ -337,7 +376,7 @@ bool TAHRPT::readFrameScanLine(int frame_nr)
         }
 
         if(scan_index >= AHRPT_SCAN_SIZE)
-            return true;
+            break;
 
         read_size = 884 - scan_pos;
 
@@ -428,8 +467,10 @@ bool TAHRPT::readFrameScanLine(int frame_nr)
             qDebug("last byte 0x%02x shift: %d\n", last_byte, shift);
         }
 #endif
-        if(cadu_flags & 4)
+        if(cadu_flags & 4) {
+            nextFrame = frame_nr + 1;
             break; // done with this scanline
+        }
 
     }
 
@@ -444,6 +485,8 @@ bool TAHRPT::readFrameScanLine(int frame_nr)
 
 #endif
 
+    block->quality->setLine(frame_nr, stats, cadu->getStats(), scan_index < AHRPT_SCAN_SIZE);
+
     return true;
 }
 
@@ -541,11 +584,11 @@ bool TAHRPT::toImage(QImage *image)
   if(!check(1))
      return false;
 
-  fseek(fp, block->getFirstFrameSyncPos() + CADU_SYNC_SIZE, SEEK_SET);
+  cadu->seek(block->getFirstFrameSyncPos());
   frames = block->getFrames();
 
   for(y=0; y<frames; y++) {
-     if(!frameToImage(y, image))
+     if(!frameToImage(y, image) || !block->frameDone(y))
         break;
   }
 
@@ -31,6 +31,7 @@
 //
 //---------------------------------------------------------------------------
 #include <QtGlobal>
+#include <QVector>
 #include <stdio.h>
 
 //---------------------------------------------------------------------------
@@ -71,6 +72,7 @@ class TAHRPT
     bool check(int flags=0);
     bool findFrameSync(void);
     long count_AVHRR_HR_frames(void);
+    static double packetTime(const quint8 *hdr);
 
 #if 0
     const char *spacecraftname(quint8 scid);
@@ -84,6 +86,10 @@ class TAHRPT
 
     TCADU   *cadu;
     quint16 *scanLine;
+
+    QVector<long> frameAddr;    // CADU with the first packet of each frame
+    int     nextFrame;          // its CADU is in the buffer, -1 = none
+    int     lastFrame;          // last read, a lower frame is read backwards
 };
 
 //---------------------------------------------------------------------------
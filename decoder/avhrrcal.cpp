@@ -0,0 +1,440 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+
+#include <QSettings>
+#include <QStringList>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "avhrrcal.h"
+
+//---------------------------------------------------------------------------
+// radiation constants, mW/(m2 sr cm-4) and cm K
+#define PLANCK_C1   1.1910427e-5
+#define PLANCK_C2   1.4387752
+
+//---------------------------------------------------------------------------
+TAVHRRCal::TAVHRRCal(void)
+{
+    int i;
+
+    memset(thermal, 0, sizeof(thermal));
+    memset(visible, 0, sizeof(visible));
+    memset(prt_coeff, 0, sizeof(prt_coeff));
+    loaded = false;
+
+    lines = NULL;
+    num_lines = max_lines = 0;
+
+    for(i=0; i<3; i++)
+        gain[i] = offset[i] = NULL;
+
+    lut_channel = lut_line = -1;
+}
+
+//---------------------------------------------------------------------------
+TAVHRRCal::~TAVHRRCal(void)
+{
+    reset();
+
+    if(lines)
+        free(lines);
+}
+
+//---------------------------------------------------------------------------
+void TAVHRRCal::reset(void)
+{
+    for(int i=0; i<3; i++) {
+        if(gain[i])
+            free(gain[i]);
+        if(offset[i])
+            free(offset[i]);
+
+        gain[i] = offset[i] = NULL;
+    }
+
+    num_lines = 0;
+    lut_channel = lut_line = -1;
+}
+
+//---------------------------------------------------------------------------
+// values are space separated, commas would make QSettings return a list
+bool TAVHRRCal::parseValues(const QString& str, double *values, int count)
+{
+    QStringList list = str.simplified().split(' ', QString::SkipEmptyParts);
+    bool ok = list.count() >= count;
+
+    for(int i=0; i<count && ok; i++)
+        values[i] = list.at(i).toDouble(&ok);
+
+    return ok;
+}
+
+//---------------------------------------------------------------------------
+// satname is the TLE name, the ini group is NOAA-19 for NOAA 19
+bool TAVHRRCal::load(const QString& inifile, const QString& satname)
+{
+    QSettings reg(inifile, QSettings::IniFormat);
+    QString   group = satname.simplified().toUpper().replace(' ', '-');
+    QString   key;
+    double    v[7];
+    int       i;
+
+    memset(thermal, 0, sizeof(thermal));
+    memset(visible, 0, sizeof(visible));
+    memset(prt_coeff, 0, sizeof(prt_coeff));
+    loaded = false;
+    lut_channel = lut_line = -1;
+
+    if(!reg.childGroups().contains(group)) {
+        qDebug("No AVHRR calibration for %s in %s", group.toStdString().c_str(), inifile.toStdString().c_str());
+        return false;
+    }
+
+    reg.beginGroup(group);
+
+    loaded = true;
+    for(i=0; i<CAL_NUM_PRT; i++) {
+        key.sprintf("PRT%d", i + 1);
+        loaded &= parseValues(reg.value(key, "").toString(), prt_coeff[i], 5);
+    }
+
+    const char *thermal_keys[3] = { "Ch3b", "Ch4", "Ch5" };
+    const char *visible_keys[3] = { "Ch1", "Ch2", "Ch3a" };
+
+    for(i=0; i<3; i++) {
+        if(parseValues(reg.value(thermal_keys[i], "").toString(), v, 7)) {
+            thermal[i].nu = v[0];
+            thermal[i].A  = v[1];
+            thermal[i].B  = v[2];
+            thermal[i].Ns = v[3];
+            thermal[i].b0 = v[4];
+            thermal[i].b1 = v[5];
+            thermal[i].b2 = v[6];
+            thermal[i].valid = v[0] > 0 && v[2] != 0;
+        }
+
+        if(parseValues(reg.value(visible_keys[i], "").toString(), v, 5)) {
+            visible[i].s1 = v[0];
+            visible[i].i1 = v[1];
+            visible[i].s2 = v[2];
+            visible[i].i2 = v[3];
+            visible[i].c_break = v[4];
+            visible[i].valid = true;
+        }
+    }
+
+    reg.endGroup();
+
+    if(!loaded)
+        qDebug("Invalid PRT coefficients for %s in %s", group.toStdString().c_str(), inifile.toStdString().c_str());
+
+    return loaded;
+}
+
+//---------------------------------------------------------------------------
+// frame is the start of an HRPT minor frame, at least CAL_FRAME_WORDS
+// NULL = lost frame
+bool TAVHRRCal::addLine(const quint16 *frame)
+{
+    TAVHRRCalLine *p;
+    int i, j;
+
+    if(num_lines >= max_lines) {
+        p = (TAVHRRCalLine *) realloc(lines, (max_lines + 1024) * sizeof(TAVHRRCalLine));
+        if(p == NULL)
+            return false;
+
+        lines = p;
+        max_lines += 1024;
+    }
+
+    p = &lines[num_lines++];
+    memset(p, 0, sizeof(TAVHRRCalLine));
+
+    if(frame == NULL)
+        return true;
+
+    p->prt = (float) ((frame[CAL_PRT_WORD] & 0x03ff) +
+                      (frame[CAL_PRT_WORD + 1] & 0x03ff) +
+                      (frame[CAL_PRT_WORD + 2] & 0x03ff)) / 3.0f;
+
+    for(i=0; i<CAL_SAMPLES; i++) {
+        for(j=0; j<3; j++)
+            p->bb[j] += frame[CAL_BB_WORD + i*3 + j] & 0x03ff;
+
+        for(j=0; j<CAL_NUM_CHANNELS; j++)
+            p->space[j] += frame[CAL_SPACE_WORD + i*CAL_NUM_CHANNELS + j] & 0x03ff;
+    }
+
+    for(j=0; j<3; j++)
+        p->bb[j] /= CAL_SAMPLES;
+
+    for(j=0; j<CAL_NUM_CHANNELS; j++)
+        p->space[j] /= CAL_SAMPLES;
+
+    p->valid = true;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// solves the linear thermal calibration for every line
+bool TAVHRRCal::calibrate(void)
+{
+    double *sum, *s, tbb, t, nbb, cs, cbb, count, n;
+    int    *prt_id, i, j, k, l, first, last, cols, valid;
+
+    if(!loaded || num_lines <= 0)
+        return false;
+
+    for(i=0; i<3; i++) {
+        if(gain[i])
+            free(gain[i]);
+        if(offset[i])
+            free(offset[i]);
+
+        gain[i] = (float *) calloc(num_lines, sizeof(float));
+        offset[i] = (float *) calloc(num_lines, sizeof(float));
+    }
+
+    // PRT sequence, a reference line (near zero) is followed by PRT 1-4
+    prt_id = (int *) malloc(num_lines * sizeof(int));
+
+    // prefix sums: valid lines, bb 3, space 5, prt 4 sums and 4 counts
+    cols = 1 + 3 + CAL_NUM_CHANNELS + CAL_NUM_PRT * 2;
+    sum = (double *) calloc((num_lines + 1) * cols, sizeof(double));
+
+    if(prt_id == NULL || sum == NULL || gain[2] == NULL || offset[2] == NULL) {
+        if(prt_id)
+            free(prt_id);
+        if(sum)
+            free(sum);
+        reset();
+
+        return false;
+    }
+
+    k = -1;
+    for(l=0; l<num_lines; l++) {
+        if(!lines[l].valid)
+            k = -1;
+        else if(lines[l].prt < CAL_PRT_REF)
+            k = 0;
+        else if(k >= 0 && k < CAL_NUM_PRT)
+            k++;
+        else
+            k = -1;
+
+        prt_id[l] = k;
+    }
+
+    for(l=0; l<num_lines; l++) {
+        s = sum + (l + 1) * cols;
+        memcpy(s, s - cols, cols * sizeof(double));
+
+        if(!lines[l].valid)
+            continue;
+
+        s[0] += 1;
+        for(j=0; j<3; j++)
+            s[1 + j] += lines[l].bb[j];
+        for(j=0; j<CAL_NUM_CHANNELS; j++)
+            s[4 + j] += lines[l].space[j];
+
+        if(prt_id[l] > 0) {
+            k = 4 + CAL_NUM_CHANNELS + (prt_id[l] - 1) * 2;
+            s[k] += lines[l].prt;
+            s[k + 1] += 1;
+        }
+    }
+
+    // sum of a column over the window [first, last)
+#define WSUM(col) (sum[last * cols + (col)] - sum[first * cols + (col)])
+
+    for(l=0; l<num_lines; l++) {
+        first = qMax(0, l - CAL_WINDOW);
+        last  = qMin(num_lines, l + CAL_WINDOW + 1);
+
+        count = WSUM(0);
+        if(count < 1)
+            continue;
+
+        // internal target temperature, mean of the PRT's
+        tbb = 0;
+        valid = 0;
+        for(i=0; i<CAL_NUM_PRT; i++) {
+            k = 4 + CAL_NUM_CHANNELS + i * 2;
+            n = WSUM(k + 1);
+            if(n < 1)
+                continue;
+
+            cs = WSUM(k) / n;
+            t = prt_coeff[i][0] + cs*(prt_coeff[i][1] + cs*(prt_coeff[i][2] + cs*(prt_coeff[i][3] + cs*prt_coeff[i][4])));
+
+            tbb += t;
+            valid++;
+        }
+
+        if(valid == 0)
+            continue;
+
+        tbb /= valid;
+
+        for(j=0; j<3; j++) {
+            if(!thermal[j].valid)
+                continue;
+
+            cbb = WSUM(1 + j) / count;
+            cs  = WSUM(4 + 2 + j) / count; // space ch 3b, 4, 5
+            if(fabs(cs - cbb) < 1)
+                continue;
+
+            nbb = planck(thermal[j].nu, thermal[j].A + thermal[j].B * tbb);
+
+            gain[j][l] = (float) ((nbb - thermal[j].Ns) / (cbb - cs));
+            offset[j][l] = (float) (thermal[j].Ns - gain[j][l] * cs);
+        }
+
+        // keep the smoothed ch 3 space count for the 3a/3b test
+        lines[l].space[2] = (float) (WSUM(4 + 2) / count);
+    }
+
+#undef WSUM
+
+    free(prt_id);
+    free(sum);
+
+    lut_channel = lut_line = -1;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// channel 3 is 3a at daytime, the space view of 3b is near full scale
+bool TAVHRRCal::isThermal(int channel, int line)
+{
+    if(channel >= 3)
+        return true;
+    if(channel < 2 || line < 0 || line >= num_lines)
+        return false;
+
+    return lines[line].space[2] > 500;
+}
+
+//---------------------------------------------------------------------------
+bool TAVHRRCal::buildLUT(int channel, int line)
+{
+    double n, ne, t;
+    int    c, k;
+
+    lut_channel = channel;
+    lut_line = line;
+
+    if(isThermal(channel, line)) {
+        k = channel - 2;
+        if(gain[k] == NULL || !thermal[k].valid || gain[k][line] == 0) {
+            memset(lut, 0, sizeof(lut));
+            return false;
+        }
+
+        TAVHRRThermal *th = &thermal[k];
+
+        for(c=0; c<1024; c++) {
+            n  = gain[k][line] * c + offset[k][line];
+            ne = th->b0 + (1 + th->b1) * n + th->b2 * n * n;
+
+            if(ne <= 0)
+                t = 0;
+            else
+                t = (brightnessTemp(th->nu, ne) - th->A) / th->B;
+
+            lut[c] = (float) t;
+        }
+    }
+    else {
+        k = channel;
+        if(!visible[k].valid) {
+            memset(lut, 0, sizeof(lut));
+            return false;
+        }
+
+        TAVHRRVisible *vis = &visible[k];
+
+        for(c=0; c<1024; c++) {
+            if(c <= vis->c_break)
+                t = vis->s1 * (c - vis->i1);
+            else
+                t = vis->s2 * (c - vis->i2);
+
+            lut[c] = (float) (t < 0 ? 0:t);
+        }
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// counts to brightness temperature (K) or albedo (%)
+// channel is zero based, counts are read with stride
+bool TAVHRRCal::toPhysical(int channel, int line, const quint16 *counts, int stride, float *out, int n)
+{
+    bool rc = true;
+    int  i;
+
+    if(channel < 0 || channel >= CAL_NUM_CHANNELS || line < 0 || line >= num_lines ||
+       !lines[line].valid)
+    {
+        memset(out, 0, n * sizeof(float));
+        return false;
+    }
+
+    // one table per line and channel, then a plain lookup
+    if(channel != lut_channel || line != lut_line)
+        rc = buildLUT(channel, line);
+
+    for(i=0; i<n; i++)
+        out[i] = lut[counts[i * stride] & 0x03ff];
+
+    return rc;
+}
+
+//---------------------------------------------------------------------------
+// radiance mW/(m2 sr cm-1) of a black body at temperature t (K)
+double TAVHRRCal::planck(double nu, double t)
+{
+    if(t <= 0)
+        return 0;
+
+    return PLANCK_C1 * nu * nu * nu / (exp(PLANCK_C2 * nu / t) - 1);
+}
+
+//---------------------------------------------------------------------------
+// inverse of planck
+double TAVHRRCal::brightnessTemp(double nu, double n)
+{
+    if(n <= 0)
+        return 0;
+
+    return PLANCK_C2 * nu / log(1 + PLANCK_C1 * nu * nu * nu / n);
+}
@@ -0,0 +1,132 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+
+#ifndef avhrrcalH
+#define avhrrcalH
+
+//---------------------------------------------------------------------------
+//
+//                      include's
+//
+//---------------------------------------------------------------------------
+#include <QtGlobal>
+#include <QString>
+
+//---------------------------------------------------------------------------
+//
+//                      define's
+//
+//---------------------------------------------------------------------------
+#define CAL_FRAME_WORDS     102 // frame words used, sync to the end of space data
+#define CAL_NUM_PRT         4
+#define CAL_NUM_CHANNELS    5
+#define CAL_SAMPLES         10  // internal target and space samples per channel
+#define CAL_WINDOW          25  // running mean, lines on each side
+#define CAL_PRT_REF         50  // PRT counts below this mark the reference line
+
+// HRPT minor frame word offsets from the frame sync, zero based
+#define CAL_PRT_WORD        17  // 3 readings of the same PRT
+#define CAL_BB_WORD         22  // internal target, ch 3b, 4, 5 interleaved
+#define CAL_SPACE_WORD      52  // space view, ch 1-5 interleaved
+
+//---------------------------------------------------------------------------
+//
+//                      typedef's
+//
+//---------------------------------------------------------------------------
+typedef struct TAVHRRCalLine_t
+{
+    float prt;                      // PRT count
+    float bb[3];                    // mean internal target counts, ch 3b, 4, 5
+    float space[CAL_NUM_CHANNELS];  // mean space counts
+    bool  valid;
+} TAVHRRCalLine;
+
+typedef struct TAVHRRThermal_t
+{
+    double nu, A, B;    // central wave number (cm-1) and band correction
+    double Ns;          // space radiance
+    double b0, b1, b2;  // non-linear correction
+    bool   valid;
+} TAVHRRThermal;
+
+typedef struct TAVHRRVisible_t
+{
+    double s1, i1;      // low gain slope and intercept
+    double s2, i2;      // high gain slope and intercept
+    double c_break;     // dual gain switch count
+    bool   valid;
+} TAVHRRVisible;
+
+//---------------------------------------------------------------------------
+/*
+  NOAA KLM AVHRR/3 calibration from the HRPT telemetry, see
+  http://www.ncdc.noaa.gov/oa/pod-guide/ncdc/docs/klm/html/c7/sec7-1.htm
+
+  Thermal channels (3b, 4, 5) are converted to brightness temperature in
+  Kelvin, the reflective channels (1, 2, 3a) to albedo in percent.
+  The internal target and space counts are running means over
+  2 * CAL_WINDOW + 1 lines, the gain is solved for every line.
+  Coefficients are read from conf/avhrr-calibration.ini
+*/
+class TAVHRRCal
+{
+public:
+    TAVHRRCal(void);
+    ~TAVHRRCal(void);
+
+    bool load(const QString& inifile, const QString& satname);
+    bool isLoaded(void) { return loaded; }
+
+    void reset(void);
+    bool addLine(const quint16 *frame);
+    bool calibrate(void);
+    int  getLines(void) { return num_lines; }
+
+    bool isThermal(int channel, int line);
+    bool toPhysical(int channel, int line, const quint16 *counts, int stride, float *out, int n);
+
+    static double planck(double nu, double t);
+    static double brightnessTemp(double nu, double n);
+
+protected:
+    bool buildLUT(int channel, int line);
+    bool parseValues(const QString& str, double *values, int count);
+
+private:
+    TAVHRRThermal thermal[3];
+    TAVHRRVisible visible[3];
+    double        prt_coeff[CAL_NUM_PRT][5];
+    bool          loaded;
+
+    TAVHRRCalLine *lines;
+    int           num_lines, max_lines;
+
+    // per line linear radiance, N = gain * C + offset
+    float *gain[3], *offset[3];
+
+    float lut[1024];
+    int   lut_channel, lut_line;
+};
+
+//---------------------------------------------------------------------------
+#endif
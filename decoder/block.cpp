@@ -20,6 +20,8 @@
 */
 //---------------------------------------------------------------------------
 #include <QString>
+#include <QCoreApplication>
+#include <QDate>
 #include "block.h"
 #include "hrptblock.h"
 #include "ahrptblock.h"
@@ -28,6 +30,10 @@
 #include "mn1hrptblock.h"
 #include "fy1hrptblock.h"
 #include "lritblock.h"
+#include "ndvilut.h"
+#include "imagewriter.h"
+#include "avhrrcal.h"
+#include "config.h"
 #include "plist.h"
 
 static const char *SUPPORTED_BLOCKS[NUM_SUPPORTED_BLOCKS] =
@@ -52,13 +58,23 @@ TBlock::TBlock(void)
 
    frames = 0;
    firstFrameSyncPos = -1;
+   aostime = 0;
 
    blocktype = Undefined_BlockType;
    imagetype = Channel_ImageType;
    imageChannel = 0; // zero based
 
+   rgbconf = NULL;
+   ndvi = NULL;
+   ndvilut = NULL;
+   avhrrcal = NULL;
+
    cadu = new TCADU;
    satprop = new TSatProp;
+   quality = new TPassQuality;
+
+   sink = NULL;
+   sink_first = 0;
 }
 
 //---------------------------------------------------------------------------
@@ -67,8 +83,14 @@ TBlock::~TBlock(void)
     close();
     freeBlock();
 
+    TNDVILUT::release(ndvilut);
+
+    if(avhrrcal)
+       delete avhrrcal;
+
     delete cadu;
     delete satprop;
+    delete quality;
 }
 
 //---------------------------------------------------------------------------
@@ -234,6 +256,8 @@ bool TBlock::open(const char *filename)
        return false;
 
    close();
+   quality->clear();
+   linetime.clear();
 
    fp = fopen(filename, "rb");
    if(fp == NULL)
@@ -344,6 +368,97 @@ int TBlock::getHeight(void)
    }
 }
 
+//---------------------------------------------------------------------------
+// seconds from the start of the recording (AOS) to the first frame sync,
+// the byte rates are of the recorded files
+double TBlock::getSyncTime(void)
+{
+ double rate;
+
+   if(firstFrameSyncPos <= 0)
+      return 0;
+
+   switch(blocktype) {
+       case HRPT_BlockType:
+          if(((THRPT *) block)->datatype == PACKED10BIT)
+             rate = 665400.0 / 8.0;
+          else
+             rate = 665400.0 / 10.0 * 2.0;  // 10 bit words as 16 bit
+       break;
+
+       case FY1HRPT_BlockType:
+          rate = 1330800.0 / 10.0 * 2.0;
+       break;
+
+       case MN1HRPT_BlockType:
+          rate = 665400.0 / 8.0;
+       break;
+
+       case AHRPT_BlockType:
+          rate = 3500000.0 / 8.0;           // CADUs
+       break;
+
+       case FYAHRPT_BlockType:
+          rate = 4200000.0 / 8.0;
+       break;
+
+       default:
+          return 0;
+   }
+
+  return firstFrameSyncPos / rate;
+}
+
+//---------------------------------------------------------------------------
+void TBlock::setLineTime(int frame_nr, double daynum)
+{
+ int size;
+
+   if(frame_nr < 0)
+      return;
+
+   size = linetime.size();
+   if(frame_nr >= size) {
+      linetime.resize(frame_nr + 1);
+      for(; size<=frame_nr; size++)
+         linetime[size] = 0;
+   }
+
+   linetime[frame_nr] = daynum;
+}
+
+//---------------------------------------------------------------------------
+// day_of_year is one based, the year is the one of the AOS or the one next to
+// it if the pass crosses the new year
+bool TBlock::setLineTime(int frame_nr, int day_of_year, double msec)
+{
+ QDate date, jan1(1980, 1, 1); // daynum 1
+ int   days;
+
+   if(aostime <= 0 || day_of_year < 1 || day_of_year > 366 || msec < 0 || msec >= 86400000.0)
+      return false;
+
+   date = jan1.addDays((int) aostime - 1);
+   if(day_of_year + 180 < date.dayOfYear())
+      date = date.addYears(1);
+   else if(day_of_year > date.dayOfYear() + 180)
+      date = date.addYears(-1);
+
+   if(day_of_year > date.daysInYear())
+      return false;
+
+   days = jan1.daysTo(QDate(date.year(), 1, 1));
+   setLineTime(frame_nr, days + day_of_year + msec / 86400000.0);
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+double TBlock::getLineTime(int frame_nr) const
+{
+   return frame_nr >= 0 && frame_nr < linetime.size() ? linetime.at(frame_nr):0;
+}
+
 //---------------------------------------------------------------------------
 long int TBlock::countCADUFrames(long int block_size)
 {
@@ -552,6 +667,9 @@ void TBlock::setImageType(int index)
    rgbconf = NULL;
    ndvi = NULL;
 
+   TNDVILUT::release(ndvilut);
+   ndvilut = NULL;
+
    if(index > 0) {
        // RGB image
        if(index <= satprop->rgblist->Count) {
@@ -565,6 +683,7 @@ void TBlock::setImageType(int index)
            if(ndvi) {
                type = NDVI_ImageType;
                rgbconf = satprop->get_rgb(ndvi->rgbName());
+               ndvilut = TNDVILUT::get(ndvi);
                setImageChannel(ndvi->nir_ch());
            }
        }
@@ -579,6 +698,8 @@ bool TBlock::toImage(QImage *image)
    if(!block || !image)
       return false;
 
+   sink_first = 0;
+
    switch(blocktype) {
       case HRPT_BlockType:
          return ((THRPT *) block)->toImage(image);
@@ -613,4 +734,244 @@ bool TBlock::toImage(QImage *image)
          return false;
    }
 }
+
+//---------------------------------------------------------------------------
+// called by the decoders for every frame of toImage, the sink gets
+// the rows of BLOCK_SINK_ROWS frames at a time, false stops toImage.
+// A frame is one image row except for LRIT, where it holds
+// getHeight()/frames rows
+bool TBlock::frameDone(int frame_nr)
+{
+ int first, last, height, frame_rows;
+
+   if(sink == NULL || frames <= 0)
+      return true;
+
+   height = getHeight();
+   frame_rows = height / frames;
+   if(frame_rows < 1)
+      frame_rows = 1;
+
+   if((frame_nr + 1) % BLOCK_SINK_ROWS && frame_nr + 1 < frames)
+      return true;
+
+   first = sink_first;
+   last = (frame_nr + 1) * frame_rows - 1;
+   if(last >= height)
+      last = height - 1;
+   sink_first = last + 1;
+
+   if(first > last)
+      return true;
+
+   // the decoders fill northbound images from the bottom
+   if(isNorthBound())
+      return sink->imageRows(height - last - 1, height - first - 1);
+
+   return sink->imageRows(first, last);
+}
+
+//---------------------------------------------------------------------------
+// true if the block can give one 10 bit scan line per frame
+bool TBlock::hasScanLines(void)
+{
+   if(!block)
+      return false;
+
+   switch(blocktype) {
+      case HRPT_BlockType:
+      case AHRPT_BlockType:
+      case FYAHRPT_BlockType:
+      case FY1HRPT_BlockType:
+         return true;
+
+      default:
+         return false;
+   }
+}
+
+//---------------------------------------------------------------------------
+// frame_nr is zero based
+bool TBlock::readScanLine(int frame_nr)
+{
+   if(!block)
+      return false;
+
+   switch(blocktype) {
+      case HRPT_BlockType:
+         return ((THRPT *) block)->readFrameScanLine(frame_nr);
+      break;
+
+      case AHRPT_BlockType:
+         return ((TAHRPT *) block)->readFrameScanLine(frame_nr);
+      break;
+
+      case FYAHRPT_BlockType:
+         return ((TFYAHRPT *) block)->readFrameScanLine(frame_nr);
+      break;
+
+      case FY1HRPT_BlockType:
+         return ((TFY1HRPT *) block)->readFrameScanLine(frame_nr);
+      break;
+
+      default:
+         return false;
+   }
+}
+
+//---------------------------------------------------------------------------
+// pixel of the last read scan line, channel and sample are zero based
+quint16 TBlock::getPixel_16(int channel, int sample)
+{
+   if(!block)
+      return 0;
+
+   switch(blocktype) {
+      case HRPT_BlockType:
+         return ((THRPT *) block)->getPixel_16(channel, sample);
+      break;
+
+      case AHRPT_BlockType:
+         return ((TAHRPT *) block)->getPixel_16(channel, sample);
+      break;
+
+      case FYAHRPT_BlockType:
+         return ((TFYAHRPT *) block)->getPixel_16(channel, sample);
+      break;
+
+      case FY1HRPT_BlockType:
+         return ((TFY1HRPT *) block)->getPixel_16(channel, sample);
+      break;
+
+      default:
+         return 0;
+   }
+}
+
+//---------------------------------------------------------------------------
+// streams the 10 bit samples row by row to the writer, no QImage is needed
+// flags&1 = all channels, otherwise the RGB channels or the image channel
+// flags&2 = calibrated, see calibrate. Float writers get albedo (%) and
+//           brightness temperature (K), 16 bit writers the same in 0.01 units
+bool TBlock::toWriter(TImageWriter *writer, int flags)
+{
+   quint16 *row;
+   float *frow, *cal;
+   int *ch, *rgb, channels, width, height, frame, x, y, i;
+   bool rc, calibrated, useFloat;
+
+   if(!writer || !hasScanLines())
+      return false;
+
+   calibrated = (flags & 2) != 0;
+   if(calibrated && (avhrrcal == NULL || avhrrcal->getLines() == 0))
+      return false;
+
+   useFloat = calibrated && writer->supportsFormat(IW_FLOAT32);
+   if(!writer->setSampleFormat(calibrated ? (useFloat ? IW_FLOAT32:IW_UINT16):IW_COUNTS))
+      return false;
+
+   width = getWidth();
+   height = getHeight();
+   channels = getNumChannels();
+
+   ch = (int *) malloc(qMax(channels, 3) * sizeof(int));
+   if(ch == NULL)
+      return false;
+
+   if(flags & 1) {
+      for(i=0; i<channels; i++)
+         ch[i] = i;
+   }
+   else if(imagetype == RGB_ImageType && rgbconf) {
+      rgb = rgbconf->rgb_ch();
+      for(i=0; i<3; i++)
+         ch[i] = rgb[i] - 1;
+      channels = 3;
+   }
+   else {
+      ch[0] = imageChannel;
+      channels = 1;
+   }
+
+   if(!writer->start(width, height, channels)) {
+      free(ch);
+      return false;
+   }
+
+   row = (quint16 *) malloc(width * channels * sizeof(quint16));
+   frow = calibrated ? (float *) malloc(width * channels * sizeof(float)):NULL;
+   cal = calibrated ? (float *) malloc(width * sizeof(float)):NULL;
+   rc = row != NULL && (!calibrated || (frow != NULL && cal != NULL));
+
+   for(y=0; y<height && rc; y++) {
+      // same orientation as toImage, northbound passes are read backwards,
+      // the CADU readers seek to the recorded address of the frame
+      frame = isNorthBound() ? height - y - 1:y;
+
+      if(readScanLine(frame)) {
+         for(x=0; x<width; x++)
+            for(i=0; i<channels; i++)
+               row[x*channels + i] = getPixel_16(ch[i], x);
+      }
+      else
+         memset(row, 0, width * channels * sizeof(quint16));
+
+      if(!calibrated) {
+         rc = writer->writeRow(row);
+         continue;
+      }
+
+      // the calibration lines are numbered as the frames
+      for(i=0; i<channels; i++) {
+         avhrrcal->toPhysical(ch[i], frame, row + i, channels, cal, width);
+         for(x=0; x<width; x++)
+            frow[x*channels + i] = cal[x];
+      }
+
+      if(useFloat)
+         rc = writer->writeFloatRow(frow);
+      else {
+         for(x=0; x<width*channels; x++)
+            row[x] = (quint16) qBound(0.0f, frow[x] * 100.0f + 0.5f, 65535.0f);
+         rc = writer->writeRow(row);
+      }
+   }
+
+   if(!writer->finish())
+      rc = false;
+
+   if(row)
+      free(row);
+   if(frow)
+      free(frow);
+   if(cal)
+      free(cal);
+   free(ch);
+
+   return rc;
+}
+//---------------------------------------------------------------------------
+
+// loads the calibration coefficients of the satellite and solves the
+// per line calibration from the frame telemetry, HRPT only
+bool TBlock::calibrate(const QString& satname)
+{
+   QString inifile;
+
+   if(blocktype != HRPT_BlockType || !block)
+      return false;
+
+   if(avhrrcal == NULL)
+      avhrrcal = new TAVHRRCal;
+
+   inifile = QCoreApplication::applicationDirPath() + "/" + PATH_CONF + "/" + FILE_AVHRR_CAL_INI;
+
+   if(!avhrrcal->load(inifile, satname)) {
+      qDebug("no calibration for %s in %s", satname.toLatin1().constData(), inifile.toLatin1().constData());
+      return false;
+   }
+
+   return ((THRPT *) block)->readCalibration(avhrrcal);
+}
 //---------------------------------------------------------------------------
@@ -24,10 +24,12 @@
 
 #include <QtGlobal>
 #include <QStringList>
+#include <QVector>
 #include <stdio.h>
 
 #include "satprop.h"
 #include "cadu.h"
+#include "passquality.h"
 
 //---------------------------------------------------------------------------
 #define B_BYTESWAP          1   // little endian data
@@ -84,6 +86,22 @@ class TCADU;
 class TSatProp;
 class TRGBConf;
 class TNDVI;
+class TNDVILUT;
+class TImageWriter;
+class TAVHRRCal;
+
+#define BLOCK_SINK_ROWS 64  // frames between TImageSink updates
+
+//---------------------------------------------------------------------------
+// gets the image rows of toImage as they are decoded, a viewer filling progressively
+class TImageSink
+{
+ public:
+    virtual ~TImageSink(void) {}
+
+    // image rows first..last are done, false stops toImage
+    virtual bool imageRows(int first, int last) = 0;
+};
 
 //---------------------------------------------------------------------------
 class TBlock
@@ -120,6 +138,16 @@ class TBlock
 
     void setFirstFrameSyncPos(long int count=-1) { firstFrameSyncPos = count; }
     int  getFirstFrameSyncPos(void) { return firstFrameSyncPos; }
+    double getSyncTime(void);
+
+    // time codes of the frames as daynum, zero if unknown
+    // the AOS resolves the year of a day of year time code, set it before open
+    void   setAOSTime(double daynum) { aostime = daynum; }
+    double getAOSTime(void) const { return aostime; }
+    void   setLineTime(int frame_nr, double daynum);
+    bool   setLineTime(int frame_nr, int day_of_year, double msec);
+    double getLineTime(int frame_nr) const;
+    bool   hasLineTimes(void) const { return !linetime.isEmpty(); }
     
     //void setImageType(Block_ImageType type);
     void setImageType(int index);
@@ -137,12 +165,23 @@ class TBlock
     int  getWidth(void);
     int  getHeight(void);
     bool toImage(QImage *image);
+    void setImageSink(TImageSink *sink_) { sink = sink_; }
+    bool frameDone(int frame_nr);
+
+    bool    hasScanLines(void);
+    bool    readScanLine(int frame_nr);
+    quint16 getPixel_16(int channel, int sample);
+    bool    toWriter(TImageWriter *writer, int flags=0);
+    bool    calibrate(const QString& satname);
 
     int  Modes;
 
     TSatProp *satprop;
     TRGBConf *rgbconf;
     TNDVI    *ndvi;
+    TNDVILUT *ndvilut;
+    TAVHRRCal *avhrrcal;
+    TPassQuality *quality;
 
  protected:
     bool init(void);
@@ -154,12 +193,17 @@ class TBlock
     FILE *fp;
     int  imageChannel;
     long int frames, firstFrameSyncPos;
+    double   aostime;
+    QVector<double> linetime;
 
     Block_Type      blocktype;
     Block_ImageType imagetype;
 
     void *block; // pointer to hrpt, lrpt, lrit, etc
     TCADU *cadu;
+
+    TImageSink *sink;
+    int        sink_first;
 };
 
 #endif // BLOCK_H
@@ -30,8 +30,10 @@ extern "C" {
 }
 #endif
 
+#include <QThread>
 #include <memory.h>
 #include "cadu.h"
+#include "cadupipe.h"
 
 //#define DEBUG_RS
 
@@ -49,19 +51,49 @@ TCADU::TCADU(void)
     payload_buf = NULL;
     derand_buf = NULL;
     rs_buf = NULL;
+
+    pipe = NULL;
+    pending = false;
+
+    resetStats();
+}
+
+//---------------------------------------------------------------------------
+// call after seeking, the next packet starts a new sequence
+void TCADU::resetStats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+
+    for(int i=0; i<CADU_NUM_VCID; i++)
+        vcdu_counter[i] = -1;
+
+    next_address = -1;
 }
 
 //---------------------------------------------------------------------------
 bool TCADU::init(FILE *fp_, size_t payload_size_, FILE *outfp_)
 {
+    if(pipe)
+        pipe->stop();
+
     outfp = outfp_;
     fp = fp_;
 
     if(fp == NULL)
         return false;
 
+    return init_buffers(payload_size_);
+}
+
+//---------------------------------------------------------------------------
+// allocates the packet, derandomizer and RS buffers without a file
+bool TCADU::init_buffers(size_t payload_size_)
+{
     payload_size = payload_size_;
 
+    if(payload_buf)
+        free(payload_buf);
+
     payload_buf = (unsigned char *) malloc(payload_size); // CVCDU, 4 byte sync is NOT included
     if(payload_buf == NULL)
         return false;
@@ -88,11 +120,17 @@ bool TCADU::init(FILE *fp_, size_t payload_size_, FILE *outfp_)
 TCADU::~TCADU(void)
 {
     reset();
+
+    if(pipe)
+        delete pipe;
 }
 
 //---------------------------------------------------------------------------
 void TCADU::reset(void)
 {
+    if(pipe)
+        pipe->stop();
+
     if(payload_buf)
         free(payload_buf);
     payload_buf = NULL;
@@ -211,38 +249,90 @@ bool TCADU::init_derandomizer(void)
 //---------------------------------------------------------------------------
 void TCADU::randomize(void)
 {
-    if(derandomize()) {
+    derandomize_buffer(payload_buf);
+}
+
+//---------------------------------------------------------------------------
+void TCADU::derandomize_buffer(unsigned char *buf)
+{
+    if(derandomize() && derand_buf) {
         for(size_t i=0; i<payload_size; i++)
-            payload_buf[i] ^= derand_buf[i];
+            buf[i] ^= derand_buf[i];
     }
 }
 
 //---------------------------------------------------------------------------
-bool TCADU::rsdecode(void)
+// returns number of corrected symbols or -1 if the packet is uncorrectable
+// interleave depth is 4, 4 * 255 = 1020 bytes
+int TCADU::rsdecode_buffer(unsigned char *buf)
 {
     if(!reed_solomon())
-        return true;
+        return 0;
 
 #ifdef HAVE_LIBFEC
 
+    unsigned char block[255];
     int i, j, rc, errors = 0;
 
     for(i=0; i<4; i++) {
         for(j=0; j<255; j++)
-            rs_buf[j] = payload_buf[i + j*4];
+            block[j] = buf[i + j*4];
 
-        rc = decode_rs_ccsds(rs_buf, NULL, 0, 0);
-        if(rc == -1) {
-            qDebug("Reed Solomon failed @ address 0x%08X %s:%d", (unsigned int)packet_address, __FILE__, __LINE__);
-            return false;
-        }
+        rc = decode_rs_ccsds(block, NULL, 0, 0);
+        if(rc == -1)
+            return -1;
 
         errors += rc;
 
         for(j=0; j<255; j++)
-            payload_buf[i + j*4] = rs_buf[j];
+            buf[i + j*4] = block[j];
     }
 
+    return errors;
+
+#else
+
+    Q_UNUSED(buf);
+    return 0;
+
+#endif // #ifdef HAVE_LIBFEC
+}
+
+//---------------------------------------------------------------------------
+// derandomize and error correct a packet
+bool TCADU::decode_buffer(unsigned char *buf, int *rs_errors)
+{
+    int rc;
+
+    derandomize_buffer(buf);
+    rc = rsdecode_buffer(buf);
+
+    if(rs_errors)
+        *rs_errors = rc;
+
+    return rc >= 0;
+}
+
+//---------------------------------------------------------------------------
+bool TCADU::rsdecode(void)
+{
+    if(!reed_solomon())
+        return true;
+
+#ifdef HAVE_LIBFEC
+
+    int errors = rsdecode_buffer(payload_buf);
+
+    if(errors == -1) {
+        stats.rs_failed++;
+#ifdef DEBUG_RS
+        qDebug("Reed Solomon failed @ address 0x%08X %s:%d", (unsigned int)packet_address, __FILE__, __LINE__);
+#endif
+        return false;
+    }
+
+    stats.rs_corrected += errors;
+
 #ifdef DEBUG_RS
     if(errors == 0) {
         qDebug("Reed Solomon succeded @ address 0x%08X %s:%d", (unsigned int)packet_address, __FILE__, __LINE__);
@@ -257,12 +347,75 @@ bool TCADU::rsdecode(void)
     return true;
 }
 
+//---------------------------------------------------------------------------
+// positions at the sync at address, getpayload() returns its packet next.
+// With derandomizing or RS decoding the packets are read ahead and decoded
+// on all cores by TCADUPipe, findsync() and getpayload() then take them in
+// file order until init() or reset(). Without readahead the packets are
+// decoded one at a time, for a few packets at a random address.
+bool TCADU::seek(long address, bool readahead)
+{
+    int i;
+
+    pending = false;
+
+    // a jump is neither a slip nor lost packets
+    for(i=0; i<CADU_NUM_VCID; i++)
+        vcdu_counter[i] = -1;
+
+    next_address = -1;
+
+    if(readahead && (derandomize() || reed_solomon()) && QThread::idealThreadCount() > 1) {
+        if(pipe == NULL)
+            pipe = new TCADUPipe(this);
+
+        return pipe->start(fp, address);
+    }
+
+    if(pipe)
+        pipe->stop();
+
+    return fseek(fp, address + CADU_SYNC_SIZE, SEEK_SET) == 0;
+}
+
+//---------------------------------------------------------------------------
+// takes the next decoded packet of the pipe
+bool TCADU::nextPacket(void)
+{
+    int rs_errors;
+
+    if(!pipe->next(payload_buf, &packet_address, &rs_errors))
+        return false;
+
+    packets++;
+
+    if(next_address >= 0 && packet_address > next_address) {
+        stats.slips++;
+        stats.skipped += packet_address - next_address;
+    }
+
+    if(rs_errors < 0)
+        stats.rs_failed++;
+    else {
+        stats.rs_corrected += rs_errors;
+        countVCDU();
+    }
+
+    stats.packets++;
+    next_address = packet_address + CADU_SYNC_SIZE + payload_size;
+
+    return true;
+}
+
 //---------------------------------------------------------------------------
 bool TCADU::findsync(const unsigned char *sync, int sync_size)
 {
     unsigned char ch;
     int i = 0;
 
+    if(pipe && pipe->isActive())
+        return (pending = nextPacket());
+
     while(fread(&ch, 1, 1, fp) == 1) {
         if(ch == sync[i])
             i++;
@@ -273,6 +426,11 @@ bool TCADU::findsync(const unsigned char *sync, int sync_size)
             packet_address = ftell(fp) - sync_size;
             packets++;
 
+            if(next_address >= 0 && packet_address > next_address) {
+                stats.slips++;
+                stats.skipped += packet_address - next_address;
+            }
+
             return true;
         }
     }
@@ -283,15 +441,49 @@ bool TCADU::findsync(const unsigned char *sync, int sync_size)
 //---------------------------------------------------------------------------
 unsigned char *TCADU::getpayload(void)
 {
+    if(pipe && pipe->isActive()) {
+        if(!pending && !nextPacket())
+            return NULL;
+
+        pending = false;
+
+        return payload_buf;
+    }
+
     if(fread(payload_buf, payload_size, 1, fp) != 1)
         return NULL;
 
     randomize();
-    rsdecode();
+    if(rsdecode())
+        countVCDU();
+
+    stats.packets++;
+    next_address = ftell(fp);
 
     return payload_buf;
 }
 
+//---------------------------------------------------------------------------
+// the 24 bit VCDU counter increments by one per packet of a virtual channel
+void TCADU::countVCDU(void)
+{
+    qint32 counter, lost;
+    quint8 id = vcid();
+
+    if(id == CADU_FILL_VCID)
+        return;
+
+    counter = (payload_buf[2] << 16) | (payload_buf[3] << 8) | payload_buf[4];
+
+    if(vcdu_counter[id] >= 0) {
+        lost = (counter - vcdu_counter[id] - 1) & 0xffffff;
+        if(lost < 0x800000) // else a counter going back, a new recording
+            stats.missing += lost;
+    }
+
+    vcdu_counter[id] = counter;
+}
+
 //---------------------------------------------------------------------------
 void TCADU::writepacket(bool include_sync)
 {
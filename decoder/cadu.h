@@ -41,6 +41,24 @@ static const unsigned char CADU_SYNC[CADU_SYNC_SIZE] = {
   0x1A, 0xCF, 0xFC, 0x1D,
 };
 
+#define CADU_NUM_VCID       64
+#define CADU_FILL_VCID      63
+
+//---------------------------------------------------------------------------
+// link statistics of getpayload(), a decoder takes the difference of two
+// snapshots for the packets of one scan line
+typedef struct
+{
+    long packets;
+    long slips;         // syncs found after skipping bytes
+    long skipped;       // bytes skipped between packets
+    long rs_corrected;  // symbols
+    long rs_failed;     // uncorrectable packets
+    long missing;       // packets lost, from the VCDU counter
+} TCADUStats;
+
+class TCADUPipe;
+
 //---------------------------------------------------------------------------
 class TCADU
 {
@@ -49,6 +67,7 @@ public:
     ~TCADU(void);
 
     bool init(FILE *fp_, size_t payload_size_, FILE *oufp_= NULL);
+    bool init_buffers(size_t payload_size_);
     void reset(void);
 
     void lrit_cadu(bool enable);
@@ -76,6 +95,14 @@ public:
     bool derandomize(void) { return flags & CADU_DERANDOMIZE ? true:false; }
     void derandomize(bool enable);
 
+    // thread safe, buf is payload_size bytes owned by the caller
+    void derandomize_buffer(unsigned char *buf);
+    int  rsdecode_buffer(unsigned char *buf);
+    bool decode_buffer(unsigned char *buf, int *rs_errors = NULL);
+
+    size_t getpayloadsize(void) { return payload_size; }
+
+    bool           seek(long address, bool readahead = true);
     bool           findsync(const unsigned char *sync = CADU_SYNC, int sync_size = CADU_SYNC_SIZE);
     unsigned char *getpayload(void);
     unsigned char *getpayload_buffer(void) { return payload_buf; }
@@ -83,6 +110,9 @@ public:
     long getpacketaddress(void) { return packet_address; }
     long getpackets(void) { return packets; }
 
+    const TCADUStats &getStats(void) const { return stats; }
+    void resetStats(void);
+
     void writepacket(bool include_sync);
     void writeVCDU(void);
 
@@ -93,6 +123,8 @@ protected:
     bool init_derandomizer(void);
     bool init_reed_solomon(void);
     void randomize(void);
+    void countVCDU(void);
+    bool nextPacket(void);
 
 private:
     FILE *fp;
@@ -106,6 +138,13 @@ private:
 
     long packets, packet_address;
 
+    TCADUStats stats;
+    qint32     vcdu_counter[CADU_NUM_VCID]; // last counter per VCID, -1 = none
+    long       next_address;                // expected address of the next sync
+
+    TCADUPipe *pipe;    // parallel decoding after seek()
+    bool      pending;  // packet of findsync() not taken by getpayload() yet
+
     int flags;
 };
 
@@ -0,0 +1,270 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <QThread>
+#include <QRunnable>
+#include <QMutexLocker>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cadupipe.h"
+#include "cadu.h"
+
+//---------------------------------------------------------------------------
+// derandomizes and RS decodes the packets [first, last) of the pipe
+class TCADUPipeJob : public QRunnable
+{
+public:
+    TCADUPipeJob(TCADUPipe *pipe_, qint64 first_, qint64 last_)
+    {
+        pipe = pipe_;
+        first = first_;
+        last = last_;
+    }
+
+    void run()
+    {
+        pipe->decode(first, last);
+    }
+
+private:
+    TCADUPipe *pipe;
+    qint64    first, last;
+};
+
+//---------------------------------------------------------------------------
+TCADUPipe::TCADUPipe(TCADU *cadu_)
+{
+    cadu = cadu_;
+    fp = NULL;
+    payload_size = 0;
+
+    data = NULL;
+    address = NULL;
+    rs_errors = NULL;
+    rbuf = NULL;
+
+    read_seq = next_seq = 0;
+    rpos = rlen = 0;
+    rbase = 0;
+    eof = true;
+
+    memset(done_seq, 0, sizeof(done_seq));
+
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+//---------------------------------------------------------------------------
+TCADUPipe::~TCADUPipe(void)
+{
+    stop();
+
+    if(data)
+        free(data);
+    if(address)
+        free(address);
+    if(rs_errors)
+        free(rs_errors);
+    if(rbuf)
+        free(rbuf);
+}
+
+//---------------------------------------------------------------------------
+bool TCADUPipe::alloc(void)
+{
+    if(data && payload_size == cadu->getpayloadsize())
+        return true;
+
+    payload_size = cadu->getpayloadsize();
+
+    if(data)
+        free(data);
+    data = (unsigned char *) malloc(CP_SLOTS * payload_size);
+
+    if(address == NULL)
+        address = (long *) malloc(CP_SLOTS * sizeof(long));
+    if(rs_errors == NULL)
+        rs_errors = (int *) malloc(CP_SLOTS * sizeof(int));
+    if(rbuf == NULL)
+        rbuf = (unsigned char *) malloc(CP_READ_SIZE);
+
+    if(data == NULL || address == NULL || rs_errors == NULL || rbuf == NULL) {
+        qDebug("TCADUPipe: out of memory");
+        return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// the first packet is the one with its sync at address
+bool TCADUPipe::start(FILE *fp_, long address_)
+{
+    stop();
+
+    if(fp_ == NULL || !alloc() || fseek(fp_, address_, SEEK_SET) != 0)
+        return false;
+
+    fp = fp_;
+    rbase = address_;
+    rpos = rlen = 0;
+    read_seq = next_seq = 0;
+    eof = false;
+
+    memset(done_seq, 0, sizeof(done_seq));
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// waits for the decode jobs, the reorder buffer may be reused after this
+void TCADUPipe::stop(void)
+{
+    pool.waitForDone();
+
+    fp = NULL;
+    eof = true;
+}
+
+//---------------------------------------------------------------------------
+// the next packet in file order, false at the end of the data
+bool TCADUPipe::next(unsigned char *payload, long *address_, int *rs_errors_)
+{
+    int b, slot;
+
+    if(fp == NULL)
+        return false;
+
+    // read ahead while there are free slots for a whole batch
+    while(!eof && read_seq + CP_BATCH <= next_seq + CP_SLOTS)
+        submit();
+
+    if(next_seq >= read_seq)
+        return false;
+
+    // the batch of the packet is done once its end seq is stored in its batch slot
+    b = (int) ((next_seq / CP_BATCH) % CP_BATCHES);
+
+    mutex.lock();
+    while(done_seq[b] <= next_seq)
+        decoded.wait(&mutex);
+    mutex.unlock();
+
+    slot = (int) (next_seq % CP_SLOTS);
+
+    memcpy(payload, data + slot * payload_size, payload_size);
+    *address_ = address[slot];
+    *rs_errors_ = rs_errors[slot];
+
+    next_seq++;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// reads up to CP_BATCH packets to the slots after read_seq and starts their job
+void TCADUPipe::submit(void)
+{
+    qint64 first = read_seq;
+    int    n, slot;
+
+    for(n=0; n<CP_BATCH; n++) {
+        slot = (int) (read_seq % CP_SLOTS);
+
+        if(!readCADU(data + slot * payload_size, &address[slot])) {
+            eof = true;
+            break;
+        }
+
+        read_seq++;
+    }
+
+    if(read_seq > first)
+        pool.start(new TCADUPipeJob(this, first, read_seq));
+}
+
+//---------------------------------------------------------------------------
+void TCADUPipe::decode(qint64 first, qint64 last)
+{
+    qint64 seq;
+    int    slot;
+
+    for(seq=first; seq<last; seq++) {
+        slot = (int) (seq % CP_SLOTS);
+        cadu->decode_buffer(data + slot * payload_size, &rs_errors[slot]);
+    }
+
+    QMutexLocker locker(&mutex);
+
+    done_seq[(first / CP_BATCH) % CP_BATCHES] = last;
+    decoded.wakeAll();
+}
+
+//---------------------------------------------------------------------------
+// makes sure there are at least bytes unread bytes in the read buffer
+bool TCADUPipe::fill(size_t bytes)
+{
+    size_t len;
+
+    if(rlen - rpos >= bytes)
+        return true;
+
+    len = rlen - rpos;
+    if(len > 0)
+        memmove(rbuf, rbuf + rpos, len);
+
+    rbase += rpos;
+    rpos = 0;
+    rlen = len + fread(rbuf + len, 1, CP_READ_SIZE - len, fp);
+
+    return rlen >= bytes;
+}
+
+//---------------------------------------------------------------------------
+// reads the next CADU as TCADU::findsync(), the address is the one of the sync
+bool TCADUPipe::readCADU(unsigned char *payload, long *address_)
+{
+    const size_t cadu_size = CADU_SYNC_SIZE + payload_size;
+    unsigned char *p, *end;
+
+    while(fill(cadu_size)) {
+        p = rbuf + rpos;
+        if(memcmp(p, CADU_SYNC, CADU_SYNC_SIZE) == 0) {
+            memcpy(payload, p + CADU_SYNC_SIZE, payload_size);
+            *address_ = rbase + rpos;
+            rpos += cadu_size;
+
+            return true;
+        }
+
+        // search the next candidate in the buffered data
+        end = rbuf + rlen - CADU_SYNC_SIZE + 1;
+        p = (unsigned char *) memchr(p + 1, CADU_SYNC[0], end - p - 1);
+        if(p == NULL)
+            rpos = rlen - CADU_SYNC_SIZE + 1;
+        else
+            rpos = p - rbuf;
+    }
+
+    return false;
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,90 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef CADUPIPE_H
+#define CADUPIPE_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <stdio.h>
+
+#define CP_SLOTS        4096        // packets in the reorder buffer, ~4 MB
+#define CP_BATCH        256         // packets per decode job
+#define CP_BATCHES      (CP_SLOTS / CP_BATCH)
+#define CP_READ_SIZE    (1 << 20)   // input chunk size in bytes
+
+class TCADU;
+
+//---------------------------------------------------------------------------
+/*
+  Parallel CADU stage of the AHRPT decoders.
+  The packets are read ahead in batches of CP_BATCH, each batch is
+  derandomized and RS decoded by a job on the thread pool and next()
+  hands the packets out in file order. Packet seq is kept in slot
+  seq % CP_SLOTS of the reorder buffer, a batch is released to the
+  reader when its job is done so the jobs may finish in any order.
+  The reading is done by the caller of next(), it stays ahead by up to
+  CP_SLOTS packets.
+*/
+class TCADUPipe
+{
+public:
+    TCADUPipe(TCADU *cadu_);
+    ~TCADUPipe(void);
+
+    bool start(FILE *fp_, long address);
+    void stop(void);
+    bool isActive(void) const { return fp != NULL; }
+
+    bool next(unsigned char *payload, long *address_, int *rs_errors_);
+
+    // called by the decode jobs
+    void decode(qint64 first, qint64 last);
+
+protected:
+    bool alloc(void);
+    bool fill(size_t bytes);
+    bool readCADU(unsigned char *payload, long *address_);
+    void submit(void);
+
+private:
+    TCADU  *cadu;
+    FILE   *fp;
+    size_t payload_size;
+
+    unsigned char *data;
+    long   *address;
+    int    *rs_errors;
+    qint64 read_seq, next_seq;  // packets read, next packet to hand out
+    bool   eof;
+
+    QMutex         mutex;
+    QWaitCondition decoded;
+    qint64         done_seq[CP_BATCHES]; // end seq of the last decoded batch per batch slot
+    QThreadPool    pool;
+
+    unsigned char *rbuf;
+    size_t rpos, rlen;
+    long   rbase;
+};
+
+#endif // CADUPIPE_H
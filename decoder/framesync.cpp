@@ -0,0 +1,414 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+#include "framesync.h"
+
+//---------------------------------------------------------------------------
+// number of set bits, parallel adds within the 64 bit word
+static inline int bitcount64(quint64 x)
+{
+    x = x - ((x >> 1) & Q_UINT64_C(0x5555555555555555));
+    x = (x & Q_UINT64_C(0x3333333333333333)) + ((x >> 2) & Q_UINT64_C(0x3333333333333333));
+    x = (x + (x >> 4)) & Q_UINT64_C(0x0f0f0f0f0f0f0f0f);
+
+    return (int) ((x * Q_UINT64_C(0x0101010101010101)) >> 56);
+}
+
+//---------------------------------------------------------------------------
+TFrameSync::TFrameSync(const quint16 *sync_, int sync_size_, int frame_size_)
+{
+    int i;
+
+    sync_size = qMin(sync_size_, FS_MAX_SYNC_SIZE);
+    sync_len = sync_size * 10;
+    frame_bits = (qint64) frame_size_ * 10;
+
+    sync_bits = 0;
+    for(i=0; i<sync_size; i++)
+        sync_bits = (sync_bits << 10) | (sync_[i] & 0x03ff);
+    sync_mask = (Q_UINT64_C(1) << sync_len) - 1;
+
+    max_search_errors = 3;
+    max_lock_errors = 10;
+    check_frames = 2;
+    flywheel_frames = 4;
+    slip_window = 3;
+
+    fp = NULL;
+    little_endian = true;
+    packed = false;
+    total_words = 0;
+
+    info = NULL;
+    info_size = 0;
+
+    buf = (unsigned char *) malloc(FS_BUF_SIZE);
+
+    reset();
+}
+
+//---------------------------------------------------------------------------
+TFrameSync::~TFrameSync(void)
+{
+    if(info)
+        free(info);
+
+    if(buf)
+        free(buf);
+}
+
+//---------------------------------------------------------------------------
+void TFrameSync::setSource(FILE *fp_, bool little_endian_, bool packed_)
+{
+    long size;
+
+    fp = fp_;
+    little_endian = little_endian_;
+    packed = packed_;
+
+    total_words = 0;
+    if(fp && fseek(fp, 0L, SEEK_END) == 0) {
+        size = ftell(fp);
+        total_words = packed ? ((qint64) size << 3) / 10:size >> 1;
+    }
+
+    reset();
+}
+
+//---------------------------------------------------------------------------
+void TFrameSync::reset(void)
+{
+    frames = 0;
+    buf_start = 0;
+    buf_len = 0;
+
+    corrected = slips = flywheels = fills = 0;
+}
+
+//---------------------------------------------------------------------------
+// reads the file so that 2 bytes from offset are in the buffer
+bool TFrameSync::fill(qint64 offset)
+{
+    if(fp == NULL || buf == NULL)
+        return false;
+
+    // keep some data before the offset, slip search goes backwards
+    buf_start = qMax((qint64) 0, offset - 64);
+    buf_len = 0;
+
+    if(fseek(fp, (long) buf_start, SEEK_SET) != 0)
+        return false;
+
+    buf_len = (long) fread(buf, 1, FS_BUF_SIZE, fp);
+
+    return offset + 2 <= buf_start + buf_len;
+}
+
+//---------------------------------------------------------------------------
+// 10 bit word, index is the word number from file start
+quint16 TFrameSync::word(qint64 index)
+{
+    unsigned char *p;
+    qint64 offset;
+    int shift;
+
+    if(index < 0 || index >= total_words)
+        return 0;
+
+    if(packed) {
+        offset = (index * 10) >> 3;
+        shift = 6 - (int) ((index * 10) & 7);
+    }
+    else {
+        offset = index << 1;
+        shift = 0;
+    }
+
+    if(offset < buf_start || offset + 2 > buf_start + buf_len)
+        if(!fill(offset))
+            return 0;
+
+    p = buf + (offset - buf_start);
+
+    if(packed)
+        return (((p[0] << 8) | p[1]) >> shift) & 0x03ff;
+    else if(little_endian)
+        return ((p[1] << 8) | p[0]) & 0x03ff;
+    else
+        return ((p[0] << 8) | p[1]) & 0x03ff;
+}
+
+//---------------------------------------------------------------------------
+// 10 bit word starting at any bit
+quint16 TFrameSync::wordAt(qint64 bitpos)
+{
+    qint64 index = bitpos / 10;
+    int    s = (int) (bitpos % 10);
+
+    if(s == 0)
+        return word(index);
+
+    return ((word(index) << s) | (word(index + 1) >> (10 - s))) & 0x03ff;
+}
+
+//---------------------------------------------------------------------------
+// number of bits that differ from the sync pattern at bitpos
+int TFrameSync::syncErrors(qint64 bitpos)
+{
+    quint64 bits = 0;
+    int i;
+
+    for(i=0; i<sync_size; i++)
+        bits = (bits << 10) | wordAt(bitpos + i*10);
+
+    return bitcount64(bits ^ sync_bits);
+}
+
+//---------------------------------------------------------------------------
+// bit by bit correlation of the sync pattern between from and to
+// best = return the position with least errors instead of the first one
+qint64 TFrameSync::search(qint64 from, qint64 to, int max_errors, bool best, int *errors)
+{
+    quint64 reg = 0;
+    qint64  i, last, start, found = -1;
+    int     b, nbits = 0, e, min_errors = sync_len + 1;
+    quint16 w;
+    bool    stop = false;
+
+    from = qMax((qint64) 0, from);
+    last = qMin(total_words - 1, (to + sync_len) / 10 + 1);
+
+    for(i=from/10; i<=last && !stop; i++) {
+        w = word(i);
+
+        for(b=9; b>=0; b--) {
+            reg = ((reg << 1) | ((w >> b) & 1)) & sync_mask;
+            if(++nbits < sync_len)
+                continue;
+
+            start = i*10 + (10 - b) - sync_len;
+            if(start < from)
+                continue;
+            if(start > to) {
+                stop = true;
+                break;
+            }
+
+            e = bitcount64(reg ^ sync_bits);
+            if(e > max_errors || e >= min_errors)
+                continue;
+
+            min_errors = e;
+            found = start;
+
+            if(!best || e == 0) {
+                stop = true;
+                break;
+            }
+        }
+    }
+
+    if(errors)
+        *errors = found < 0 ? -1:min_errors;
+
+    return found;
+}
+
+//---------------------------------------------------------------------------
+bool TFrameSync::addFrame(qint64 bitpos, quint8 flags)
+{
+    TFrameInfo *p;
+
+    if(frames >= info_size) {
+        p = (TFrameInfo *) realloc(info, (info_size + 4096) * sizeof(TFrameInfo));
+        if(p == NULL)
+            return false;
+
+        info = p;
+        info_size += 4096;
+    }
+
+    info[frames].bitpos = bitpos;
+    info[frames].flags = flags;
+    frames++;
+
+    if(flags & FS_SYNC_CORRECTED) corrected++;
+    if(flags & FS_SLIP)           slips++;
+    if(flags & FS_FLYWHEEL)       flywheels++;
+    if(flags & FS_FILL)           fills++;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// builds the frame table, returns number of frames including fill frames
+// sync_check = false, frames are one frame size apart from file start
+int TFrameSync::scan(bool sync_check)
+{
+    qint64 pos, next, found, end, last_pos = -1;
+    int    i, n, errors, misses;
+    quint8 flags;
+    bool   ok;
+
+    reset();
+
+    // last complete frame, plus one word for bit re-alignment
+    end = total_words * 10 - frame_bits - 10;
+
+    if(!sync_check) {
+        for(pos=0; pos<=end; pos+=frame_bits)
+            if(!addFrame(pos, 0))
+                break;
+
+        return frames;
+    }
+
+    pos = 0;
+    while(pos <= end) {
+        // search
+        found = search(pos, end, max_search_errors, false, &errors);
+        if(found < 0)
+            break;
+
+        // check, the following syncs must be in place too
+        ok = true;
+        for(i=1; i<=check_frames; i++) {
+            next = found + i*frame_bits;
+            if(next > end)
+                break; // accept near the end of file
+
+            if(syncErrors(next) > max_lock_errors) {
+                ok = false;
+                break;
+            }
+        }
+
+        if(!ok) {
+            pos = found + 1;
+            continue;
+        }
+
+        // keep the line timing, fill the frames lost since the last lock
+        if(last_pos >= 0) {
+            n = (int) ((found - last_pos + frame_bits/2) / frame_bits) - 1;
+            for(i=0; i<n && i<FS_MAX_FILL; i++)
+                addFrame(-1, FS_FILL);
+        }
+
+        // lock and flywheel
+        flags = errors ? FS_SYNC_CORRECTED:0;
+        misses = 0;
+        next = found;
+
+        while(next <= end) {
+            if(!addFrame(next, flags))
+                return frames;
+
+            last_pos = next;
+
+            pos = next + frame_bits;
+            if(pos > end)
+                break;
+
+            errors = syncErrors(pos);
+            if(errors <= max_lock_errors) {
+                flags = errors ? FS_SYNC_CORRECTED:0;
+                misses = 0;
+                next = pos;
+                continue;
+            }
+
+            found = search(pos - slip_window*10, pos + slip_window*10, max_lock_errors, true, &errors);
+            if(found >= 0) {
+                flags = FS_SLIP | (errors ? FS_SYNC_CORRECTED:0);
+                misses = 0;
+                next = found;
+                continue;
+            }
+
+            if(++misses > flywheel_frames)
+                break; // lost lock, search from the predicted position
+
+            flags = FS_FLYWHEEL;
+            next = pos;
+        }
+    }
+
+    return frames;
+}
+
+//---------------------------------------------------------------------------
+TFrameInfo *TFrameSync::getFrame(int frame_nr)
+{
+    if(frame_nr < 0 || frame_nr >= frames)
+        return NULL;
+
+    return &info[frame_nr];
+}
+
+//---------------------------------------------------------------------------
+// file offset of the byte containing the bit
+long TFrameSync::getBytePos(qint64 bitpos)
+{
+    if(bitpos < 0)
+        return -1;
+
+    if(packed)
+        return (long) (bitpos >> 3);
+    else
+        return (long) ((bitpos / 10) << 1);
+}
+
+//---------------------------------------------------------------------------
+// reads count re-aligned words starting offset words from the frame sync
+// fill frames are zeroed
+bool TFrameSync::readWords(int frame_nr, int offset, int count, quint16 *dst)
+{
+    TFrameInfo *fi = getFrame(frame_nr);
+    qint64 bitpos, index;
+    int i, s;
+
+    if(fi == NULL || dst == NULL)
+        return false;
+
+    if(fi->bitpos < 0) {
+        memset(dst, 0, count * sizeof(quint16));
+        return true;
+    }
+
+    bitpos = fi->bitpos + (qint64) offset * 10;
+    index = bitpos / 10;
+    s = (int) (bitpos % 10);
+
+    if(s == 0) {
+        for(i=0; i<count; i++)
+            dst[i] = word(index + i);
+    }
+    else {
+        for(i=0; i<count; i++)
+            dst[i] = ((word(index + i) << s) | (word(index + i + 1) >> (10 - s))) & 0x03ff;
+    }
+
+    return true;
+}
@@ -0,0 +1,120 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+
+#ifndef framesyncH
+#define framesyncH
+
+//---------------------------------------------------------------------------
+//
+//                      include's
+//
+//---------------------------------------------------------------------------
+#include <QtGlobal>
+#include <stdio.h>
+
+//---------------------------------------------------------------------------
+//
+//                      define's
+//
+//---------------------------------------------------------------------------
+// frame flags
+#define FS_SYNC_CORRECTED   1   // sync found with bit errors
+#define FS_SLIP             2   // re-aligned after a bit or word slip
+#define FS_FLYWHEEL         4   // sync missing, position predicted
+#define FS_FILL             8   // frame lost, no data
+
+#define FS_MAX_SYNC_SIZE    6   // words, 60 bits
+#define FS_MAX_FILL         600 // max fill frames inserted in one gap
+#define FS_BUF_SIZE         (1 << 18) // read buffer in bytes
+
+//---------------------------------------------------------------------------
+//
+//                      typedef's
+//
+//---------------------------------------------------------------------------
+typedef struct TFrameInfo_t
+{
+    qint64 bitpos;  // first sync bit in the 10 bit word stream, -1 = fill
+    quint8 flags;
+} TFrameInfo;
+
+//---------------------------------------------------------------------------
+/*
+  Frame synchronizer for 10 bit word streams.
+  The file is handled as a continuous bit stream so bit and word slips can
+  be followed, frame positions are in bits from the file start.
+
+  search   - correlate bit by bit until a sync with max_search_errors
+  check    - the next check_frames syncs must be found one frame apart
+  lock     - expect a sync every frame, allow max_lock_errors bit errors
+             and search slip_window words around it on a miss
+  flywheel - keep predicting up to flywheel_frames missing syncs, then search
+*/
+class TFrameSync
+{
+public:
+    TFrameSync(const quint16 *sync_, int sync_size_, int frame_size_);
+    ~TFrameSync(void);
+
+    void setSource(FILE *fp_, bool little_endian_, bool packed_);
+    void reset(void);
+    int  scan(bool sync_check = true);
+
+    int         getFrames(void) { return frames; }
+    TFrameInfo *getFrame(int frame_nr);
+    long        getBytePos(qint64 bitpos);
+
+    bool readWords(int frame_nr, int offset, int count, quint16 *dst);
+
+    // tolerances
+    int max_search_errors, max_lock_errors;
+    int check_frames, flywheel_frames, slip_window;
+
+    // statistics
+    int corrected, slips, flywheels, fills;
+
+protected:
+    quint16 word(qint64 index);
+    quint16 wordAt(qint64 bitpos);
+    int     syncErrors(qint64 bitpos);
+    qint64  search(qint64 from, qint64 to, int max_errors, bool best, int *errors);
+    bool    addFrame(qint64 bitpos, quint8 flags);
+    bool    fill(qint64 offset);
+
+private:
+    FILE    *fp;
+    bool    little_endian, packed;
+
+    quint64 sync_bits, sync_mask;
+    int     sync_size, sync_len;
+    qint64  frame_bits, total_words;
+
+    TFrameInfo *info;
+    int     frames, info_size;
+
+    unsigned char *buf;
+    qint64  buf_start;
+    long    buf_len;
+};
+
+//---------------------------------------------------------------------------
+#endif
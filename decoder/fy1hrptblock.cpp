@@ -349,7 +349,7 @@ bool TFY1HRPT::toImage(QImage *image)
   frames = block->getFrames();
 
   for(y=0; y<frames; y++) {
-     if(!frameToImage(y, image))
+     if(!frameToImage(y, image) || !block->frameDone(y))
         break;
   }
 
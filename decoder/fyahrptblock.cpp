@@ -88,6 +88,8 @@ TFYAHRPT::TFYAHRPT(TBlock *_block)
 
   scanLine = NULL;
   fp = NULL;
+  nextFrame = -1;
+  lastFrame = -1;
 }
 
 //---------------------------------------------------------------------------
@@ -148,15 +150,18 @@ int TFYAHRPT::countFrames(void)
 //---------------------------------------------------------------------------
 long TFYAHRPT::count_AVHRR_HR_frames(void)
 {
+    quint16 hdr_ptr;
     quint8  vcid;
     long    frames = 0;
 
 #ifdef DEBUG_AHRPT
-    quint16 hdr_ptr;
 
     //cadu->outfp = fopen("/home/patrik/tmp/fy3a-derand.cadu", "wb");
 #endif
 
+    frameAddr.clear();
+    nextFrame = lastFrame = -1;
+
     fseek(fp, 0, SEEK_SET);
 
     while(cadu->findsync()) {
@@ -184,9 +189,14 @@ long TFYAHRPT::count_AVHRR_HR_frames(void)
         if(!(vcid == 0x05 || vcid == 0x09)) // TODO: check if it is encrypted...
             continue;
 
+        // a scan line starts in a packet with a header, see readFrameScanLine
+        if(!cadu->first_hdr_ptr(&hdr_ptr))
+            continue;
+
         if(frames == 0)
             block->setFirstFrameSyncPos(cadu->getpacketaddress());
 
+        frameAddr.append(cadu->getpacketaddress());
         frames++;
     }
 
@@ -225,22 +235,31 @@ bool TFYAHRPT::readFrameScanLine(int frame_nr)
     int     scan_index, read_size, scan_pos;
     int     i, index;
     bool    error;
+    TCADUStats stats;
 
 
     // missed pixels will be shown as black line
     memset(scanLine, 0, FY_AHRPT_SCAN_SIZE << 1);
 
-    // file pointer MUST be set at firstFrameSyncPos using fseek
-    // when started, frame_nr = 0
+    if(frame_nr < 0 || frame_nr >= frameAddr.size())
+        return false;
 
+    // link statistics of the packets read for this line
     if(frame_nr == 0)
-        vcdu = cadu->getpayload(); // read the whole CADU
-    else {
-        if(frame_nr >= block->getFrames())
-            return false;
+        cadu->resetStats();
+
+    // the previous line ends with the CADU of this one, else seek to it,
+    // the packets are decoded ahead only when reading forward
+    if(frame_nr == nextFrame)
+        vcdu = cadu->getpayload_buffer();
+    else if(cadu->seek(frameAddr[frame_nr], frame_nr > lastFrame))
+        vcdu = cadu->getpayload();
+    else
+        vcdu = NULL;
 
-        vcdu = cadu->getpayload_buffer(); // CADU is already in buffer
-    }
+    stats = cadu->getStats();
+    nextFrame = -1;
+    lastFrame = frame_nr;
 
     if(vcdu == NULL)
         return false;
@@ -330,7 +349,7 @@ bool TFYAHRPT::readFrameScanLine(int frame_nr)
         }
 
         if(scan_index >= FY_AHRPT_SCAN_SIZE)
-            return true;
+            break;
 
         read_size = 884 - scan_pos;
 
@@ -421,8 +440,10 @@ bool TFYAHRPT::readFrameScanLine(int frame_nr)
             qDebug("last byte 0x%02x shift: %d\n", last_byte, shift);
         }
 #endif
-        if(cadu_flags & 4)
+        if(cadu_flags & 4) {
+            nextFrame = frame_nr + 1;
             break; // done with this scanline
+        }
 
     }
 
@@ -437,6 +458,8 @@ bool TFYAHRPT::readFrameScanLine(int frame_nr)
 
 #endif
 
+    block->quality->setLine(frame_nr, stats, cadu->getStats(), scan_index < FY_AHRPT_SCAN_SIZE);
+
     return true;
 }
 
@@ -534,11 +557,11 @@ bool TFYAHRPT::toImage(QImage *image)
   if(!check(1))
      return false;
 
-  fseek(fp, block->getFirstFrameSyncPos() + CADU_SYNC_SIZE, SEEK_SET);
+  cadu->seek(block->getFirstFrameSyncPos());
   frames = block->getFrames();
 
   for(y=0; y<frames; y++) {
-     if(!frameToImage(y, image))
+     if(!frameToImage(y, image) || !block->frameDone(y))
         break;
   }
 
@@ -31,6 +31,7 @@
 //
 //---------------------------------------------------------------------------
 #include <QtGlobal>
+#include <QVector>
 #include <stdio.h>
 
 //---------------------------------------------------------------------------
@@ -84,6 +85,10 @@ class TFYAHRPT
 
     TCADU   *cadu;
     quint16 *scanLine;
+
+    QVector<long> frameAddr;    // CADU with the first packet of each frame
+    int     nextFrame;          // its CADU is in the buffer, -1 = none
+    int     lastFrame;          // last read, a lower frame is read backwards
 };
 
 //---------------------------------------------------------------------------
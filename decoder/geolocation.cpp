@@ -0,0 +1,493 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "geolocation.h"
+#include "Satellite.h"
+
+#define GEO_WGS84_A   6378.137              // km
+#define GEO_WGS84_F   (1.0/298.257223563)
+#define GEO_DEG2RAD   (M_PI/180.0)
+#define GEO_RAD2DEG   (180.0/M_PI)
+#define GEO_SECDAY    86400.0
+
+//---------------------------------------------------------------------------
+// interpolates longitudes across the date line
+static inline double lerp_lon(double a, double b, double u)
+{
+ double d = b - a;
+
+    if(d > 180.0)
+        d -= 360.0;
+    else if(d < -180.0)
+        d += 360.0;
+
+ return a + u * d;
+}
+
+//---------------------------------------------------------------------------
+static inline double fix_lon(double lon)
+{
+    if(lon >= 180.0)
+        return lon - 360.0;
+    else if(lon < -180.0)
+        return lon + 360.0;
+
+ return lon;
+}
+
+//---------------------------------------------------------------------------
+TGeoLocation::TGeoLocation(void)
+{
+    memset(&geo, 0, sizeof(geo));
+    start = time_offset = 0;
+    lines = 0;
+    northbound = false;
+
+    linetime = NULL;
+    tie_lat = tie_lon = NULL;
+    tie_rows = tie_cols = 0;
+}
+
+//---------------------------------------------------------------------------
+TGeoLocation::~TGeoLocation(void)
+{
+    clear();
+}
+
+//---------------------------------------------------------------------------
+void TGeoLocation::clear(void)
+{
+    if(tie_lat)
+        free(tie_lat);
+    if(tie_lon)
+        free(tie_lon);
+    if(linetime)
+        free(linetime);
+
+    linetime = NULL;
+    tie_lat = tie_lon = NULL;
+    tie_rows = tie_cols = 0;
+    lines = 0;
+}
+
+//---------------------------------------------------------------------------
+bool TGeoLocation::scanGeometry(Block_Type type, TScanGeometry *g)
+{
+    switch(type) {
+    case HRPT_BlockType:        // AVHRR/3
+    case AHRPT_BlockType:
+    case FY1HRPT_BlockType:     // VIRR
+    case FYAHRPT_BlockType:
+        g->width = 2048;
+        g->half_angle = 55.4;
+        g->line_rate = 6.0;
+        break;
+
+    case MN1HRPT_BlockType:     // MSU-MR
+        g->width = 1540;
+        g->half_angle = 54.0;
+        g->line_rate = 6.0;
+        break;
+
+    case MN1LRPT_BlockType:
+        g->width = 1536;
+        g->half_angle = 54.0;
+        g->line_rate = 6.0;
+        break;
+
+    default:
+        return false;
+    }
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// the lines are timed from the AOS of the recording, block gives the time
+// offset of the first frame sync and the time codes of the frames
+bool TGeoLocation::init(TSat *sat, Block_Type type, int lines_, bool northbound_, TBlock *block)
+{
+    clear();
+
+    if(sat == NULL || lines_ < 1 || !scanGeometry(type, &geo))
+        return false;
+
+    start = sat->rec_aostime;
+    if(start <= 0)
+        return false;
+
+    lines = lines_;
+    northbound = northbound_;
+
+    if(block) {
+        time_offset = block->getSyncTime();
+
+        if(block->hasLineTimes() && !setLineTimes(block))
+            qDebug("geolocation: invalid time codes, lines are timed from the frame sync");
+    }
+
+    if(!calcTiePoints(sat)) {
+        clear();
+        return false;
+    }
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// an opened block, sat has the TLE and AOS of the recording
+bool TGeoLocation::init(TSat *sat, TBlock *block, bool northbound_)
+{
+    if(block == NULL)
+        return false;
+
+ return init(sat, block->getBlockType(), block->getHeight(), northbound_, block);
+}
+
+//---------------------------------------------------------------------------
+// a time code is valid if it is near the AOS and one line period from the
+// time code of a neighbour line, the lines in between are timed from the
+// previous valid line at the line rate
+bool TGeoLocation::setLineTimes(TBlock *block)
+{
+ double dt, tol, win, t;
+ char   *good;
+ int    i, first, valid;
+
+    linetime = (double *) malloc(lines * sizeof(double));
+    good = (char *) malloc(lines);
+
+    if(linetime == NULL || good == NULL) {
+        if(good)
+            free(good);
+
+        return false;
+    }
+
+    dt  = 1.0 / geo.line_rate / GEO_SECDAY;
+    tol = GEO_TIME_TOL / GEO_SECDAY;
+    win = GEO_TIME_WINDOW / GEO_SECDAY;
+
+    for(i=0; i<lines; i++)
+        linetime[i] = block->getLineTime(i);
+
+    valid = 0;
+    first = -1;
+    for(i=0; i<lines; i++) {
+        t = linetime[i];
+
+        good[i] = fabs(t - start) < win &&
+                  ((i > 0 && fabs(t - linetime[i-1] - dt) < tol) ||
+                   (i < lines - 1 && fabs(linetime[i+1] - t - dt) < tol));
+
+        if(good[i]) {
+            if(first < 0)
+                first = i;
+            valid++;
+        }
+    }
+
+    // most of the lines must have a time code
+    if(valid * 2 < lines) {
+        free(good);
+        free(linetime);
+        linetime = NULL;
+
+        return false;
+    }
+
+    for(i=first-1; i>=0; i--)
+        linetime[i] = linetime[i+1] - dt;
+
+    for(i=first+1; i<lines; i++)
+        if(!good[i])
+            linetime[i] = linetime[i-1] + dt;
+
+    // keep the lines before a valid one in order
+    for(i=lines-2; i>first; i--)
+        if(!good[i] && linetime[i] > linetime[i+1] - dt)
+            linetime[i] = linetime[i+1] - dt;
+
+    free(good);
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// daynum of a frame line
+double TGeoLocation::frameTime(int line) const
+{
+    if(linetime && line >= 0 && line < lines)
+        return linetime[line];
+
+ return start + (time_offset + line / geo.line_rate) / GEO_SECDAY;
+}
+
+//---------------------------------------------------------------------------
+// position of line between the tie lines l0 and l1, by time as lines may be lost
+double TGeoLocation::lineFraction(int line, int l0, int l1) const
+{
+ double t0, t1;
+
+    if(l1 <= l0)
+        return 0;
+
+    if(linetime) {
+        t0 = linetime[l0];
+        t1 = linetime[l1];
+
+        if(t1 > t0)
+            return (linetime[line] - t0) / (t1 - t0);
+    }
+
+ return (double) (line - l0) / (l1 - l0);
+}
+
+//---------------------------------------------------------------------------
+bool TGeoLocation::calcTiePoints(TSat *src)
+{
+ TSat   sat(src); // SGP4 keeps state, don't touch the callers satellite
+ double *ca, *sa, p[3], v[3], n[3], r[3], pe[3], ne[3], re[3], d[3];
+ double gmst, c, s, len, step, angle, ab, e2, qa, qb, qc, disc, t, x, y, z;
+ int    row, col, sample, line, i;
+
+    tie_cols = (geo.width - 2) / GEO_TIE_SAMPLES + 2;
+    tie_rows = lines > 1 ? (lines - 2) / GEO_TIE_LINES + 2:1;
+
+    tie_lat = (float *) malloc(tie_rows * tie_cols * sizeof(float));
+    tie_lon = (float *) malloc(tie_rows * tie_cols * sizeof(float));
+    ca = (double *) malloc(tie_cols * sizeof(double));
+    sa = (double *) malloc(tie_cols * sizeof(double));
+
+    if(tie_lat == NULL || tie_lon == NULL || ca == NULL || sa == NULL) {
+        if(ca)
+            free(ca);
+        if(sa)
+            free(sa);
+
+        return false;
+    }
+
+    // scan angles, positive to the right of the flight direction where sample 0 is
+    step = 2.0 * geo.half_angle / (geo.width - 1);
+    for(col=0; col<tie_cols; col++) {
+        sample = col * GEO_TIE_SAMPLES;
+        if(sample > geo.width - 1)
+            sample = geo.width - 1;
+
+        angle = ((geo.width - 1) / 2.0 - sample) * step * GEO_DEG2RAD;
+        ca[col] = cos(angle);
+        sa[col] = sin(angle);
+    }
+
+    ab = 1.0 / (1.0 - GEO_WGS84_F); // a/b, scales the ellipsoid to a sphere
+    e2 = GEO_WGS84_F * (2.0 - GEO_WGS84_F);
+
+    for(row=0; row<tie_rows; row++) {
+        line = row * GEO_TIE_LINES;
+        if(line > lines - 1)
+            line = lines - 1;
+
+        sat.CalcECI(frameTime(line), p, v, &gmst);
+
+        // nadir and the cross track (right) unit vectors in ECI
+        len = sqrt(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+        for(i=0; i<3; i++)
+            n[i] = -p[i] / len;
+
+        r[0] = n[1]*v[2] - n[2]*v[1];
+        r[1] = n[2]*v[0] - n[0]*v[2];
+        r[2] = n[0]*v[1] - n[1]*v[0];
+        len = sqrt(r[0]*r[0] + r[1]*r[1] + r[2]*r[2]);
+        for(i=0; i<3; i++)
+            r[i] /= len;
+
+        // ECI to ECEF
+        c = cos(gmst);
+        s = sin(gmst);
+        pe[0] =  c*p[0] + s*p[1]; pe[1] = -s*p[0] + c*p[1]; pe[2] = p[2];
+        ne[0] =  c*n[0] + s*n[1]; ne[1] = -s*n[0] + c*n[1]; ne[2] = n[2];
+        re[0] =  c*r[0] + s*r[1]; re[1] = -s*r[0] + c*r[1]; re[2] = r[2];
+
+        qc = pe[0]*pe[0] + pe[1]*pe[1] + pe[2]*pe[2]*ab*ab - GEO_WGS84_A*GEO_WGS84_A;
+
+        for(col=0; col<tie_cols; col++) {
+            for(i=0; i<3; i++)
+                d[i] = ca[col]*ne[i] + sa[col]*re[i];
+
+            qa = d[0]*d[0] + d[1]*d[1] + d[2]*d[2]*ab*ab;
+            qb = pe[0]*d[0] + pe[1]*d[1] + pe[2]*d[2]*ab*ab;
+            disc = qb*qb - qa*qc;
+
+            // a look vector past the limb ends at the closest point
+            t = disc < 0 ? -qb/qa:(-qb - sqrt(disc))/qa;
+
+            x = pe[0] + t*d[0];
+            y = pe[1] + t*d[1];
+            z = pe[2] + t*d[2];
+
+            i = row * tie_cols + col;
+            tie_lat[i] = (float) (atan2(z, (1.0 - e2) * sqrt(x*x + y*y)) * GEO_RAD2DEG);
+            tie_lon[i] = (float) (atan2(y, x) * GEO_RAD2DEG);
+        }
+    }
+
+    free(ca);
+    free(sa);
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+void TGeoLocation::toFrame(int x, int y, int *sample, int *line) const
+{
+    if(northbound) {
+        *sample = geo.width - x - 1;
+        *line = lines - y - 1;
+    }
+    else {
+        *sample = x;
+        *line = y;
+    }
+}
+
+//---------------------------------------------------------------------------
+// image coordinates, lat and lon in degrees, east and north positive
+bool TGeoLocation::latLon(int x, int y, double *lat, double *lon) const
+{
+ double u, v, lon0, lon1;
+ int    sample, line, r, c, s0, s1, l0, l1, i00, i01, i10, i11;
+
+    if(!isValid() || x < 0 || x >= geo.width || y < 0 || y >= lines)
+        return false;
+
+    toFrame(x, y, &sample, &line);
+
+    c = sample / GEO_TIE_SAMPLES;
+    if(c > tie_cols - 2)
+        c = tie_cols - 2;
+    s0 = c * GEO_TIE_SAMPLES;
+    s1 = s0 + GEO_TIE_SAMPLES < geo.width ? s0 + GEO_TIE_SAMPLES:geo.width - 1;
+    u = (double) (sample - s0) / (s1 - s0);
+
+    r = tie_rows > 1 ? line / GEO_TIE_LINES:0;
+    if(tie_rows > 1 && r > tie_rows - 2)
+        r = tie_rows - 2;
+    l0 = r * GEO_TIE_LINES;
+    l1 = l0 + GEO_TIE_LINES < lines ? l0 + GEO_TIE_LINES:lines - 1;
+    v = lineFraction(line, l0, l1);
+
+    i00 = r * tie_cols + c;
+    i01 = i00 + 1;
+    i10 = tie_rows > 1 ? i00 + tie_cols:i00;
+    i11 = i10 + 1;
+
+    *lat = (1.0 - v) * (tie_lat[i00] + u * (tie_lat[i01] - tie_lat[i00])) +
+                  v  * (tie_lat[i10] + u * (tie_lat[i11] - tie_lat[i10]));
+
+    lon0 = lerp_lon(tie_lon[i00], tie_lon[i01], u);
+    lon1 = lerp_lon(tie_lon[i10], tie_lon[i11], u);
+    *lon = fix_lon(lerp_lon(lon0, lon1, v));
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// fills a whole image row, lat and lon hold width() values
+bool TGeoLocation::rowLatLon(int y, float *lat, float *lon) const
+{
+ double v, u, lat0, lat1, lon0, lon1, dlon;
+ int    sample, line, r, c, s, s0, s1, l0, l1, i0, i1, x;
+
+    if(!isValid() || y < 0 || y >= lines || lat == NULL || lon == NULL)
+        return false;
+
+    toFrame(0, y, &sample, &line);
+
+    r = tie_rows > 1 ? line / GEO_TIE_LINES:0;
+    if(tie_rows > 1 && r > tie_rows - 2)
+        r = tie_rows - 2;
+    l0 = r * GEO_TIE_LINES;
+    l1 = l0 + GEO_TIE_LINES < lines ? l0 + GEO_TIE_LINES:lines - 1;
+    v = lineFraction(line, l0, l1);
+
+    i0 = r * tie_cols;
+    i1 = tie_rows > 1 ? i0 + tie_cols:i0;
+
+    // interpolate the tie row, then linearly along every tie cell
+    lat1 = (1.0 - v) * tie_lat[i0] + v * tie_lat[i1];
+    lon1 = lerp_lon(tie_lon[i0], tie_lon[i1], v);
+
+    for(c=0; c<tie_cols-1; c++) {
+        lat0 = lat1;
+        lon0 = lon1;
+        lat1 = (1.0 - v) * tie_lat[i0 + c + 1] + v * tie_lat[i1 + c + 1];
+        lon1 = lerp_lon(tie_lon[i0 + c + 1], tie_lon[i1 + c + 1], v);
+
+        s0 = c * GEO_TIE_SAMPLES;
+        s1 = s0 + GEO_TIE_SAMPLES < geo.width ? s0 + GEO_TIE_SAMPLES:geo.width - 1;
+
+        dlon = lon1 - lon0;
+        if(dlon > 180.0)
+            dlon -= 360.0;
+        else if(dlon < -180.0)
+            dlon += 360.0;
+
+        for(s=s0; s<s1 || (s == s1 && c == tie_cols - 2); s++) {
+            u = (double) (s - s0) / (s1 - s0);
+            x = northbound ? geo.width - s - 1:s;
+
+            lat[x] = (float) (lat0 + u * (lat1 - lat0));
+            lon[x] = (float) fix_lon(lon0 + u * dlon);
+        }
+    }
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// daynum of an image row
+double TGeoLocation::lineTime(int y) const
+{
+ int sample, line;
+
+    toFrame(0, y, &sample, &line);
+
+ return frameTime(line);
+}
+
+//---------------------------------------------------------------------------
+// degrees from nadir of an image column, positive to the right of the flight direction
+double TGeoLocation::scanAngle(int x) const
+{
+ int sample, line;
+
+    if(geo.width < 2)
+        return 0;
+
+    toFrame(x, 0, &sample, &line);
+
+ return ((geo.width - 1) / 2.0 - sample) * 2.0 * geo.half_angle / (geo.width - 1);
+}
@@ -0,0 +1,106 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef GEOLOCATION_H
+#define GEOLOCATION_H
+
+#include <QString>
+
+#include "block.h"
+
+#define GEO_TIE_SAMPLES  32     // tie point spacing along a scan line
+#define GEO_TIE_LINES    8      // tie point spacing between scan lines
+#define GEO_TIME_WINDOW  3600   // seconds, time codes this far from the AOS are bogus
+#define GEO_TIME_TOL     0.02   // seconds, time code step from one line to the next
+
+class TSat;
+
+//---------------------------------------------------------------------------
+// scan geometry of an imager, sample 0 is the first sample of a frame
+typedef struct
+{
+    int    width;           // samples per scan line
+    double half_angle;      // degrees from nadir to the first and last sample
+    double line_rate;       // scan lines per second
+} TScanGeometry;
+
+//---------------------------------------------------------------------------
+/*
+  Latitude and longitude of every pixel of a decoded pass.
+  The satellite is propagated with SGP4/SDP4 from the passinfo TLE to
+  every GEO_TIE_LINES scan line, the scan geometry of the imager gives a
+  look vector for every GEO_TIE_SAMPLES sample which is intersected with
+  the WGS84 ellipsoid. Pixels in between are interpolated bilinearly.
+  Coordinates are image coordinates as displayed, northbound passes are
+  rotated 180 degrees as in the decoders.
+  The scan lines are timed from the frame time codes of the block when they
+  are valid, lost lines then only move the tie points. Without time codes
+  the first line is at the first frame sync and the lines follow at the
+  line rate.
+*/
+class TGeoLocation
+{
+public:
+    TGeoLocation(void);
+    ~TGeoLocation(void);
+
+    bool init(TSat *sat, Block_Type type, int lines, bool northbound, TBlock *block = NULL);
+    bool init(TSat *sat, TBlock *block, bool northbound);
+    void clear(void);
+
+    static bool scanGeometry(Block_Type type, TScanGeometry *geo);
+
+    // seconds from the recording start (AOS) to the first scan line,
+    // init sets it from the first frame sync of the block
+    void   setTimeOffset(double seconds) { time_offset = seconds; }
+    double timeOffset(void) const { return time_offset; }
+
+    bool isValid(void) const { return tie_lat != NULL; }
+    bool isNorthbound(void) const { return northbound; }
+    void setNorthbound(bool on) { northbound = on; }
+    int  width(void) const { return geo.width; }
+    int  height(void) const { return lines; }
+
+    bool   hasLineTimes(void) const { return linetime != NULL; }
+    bool   latLon(int x, int y, double *lat, double *lon) const;
+    bool   rowLatLon(int y, float *lat, float *lon) const;
+    double lineTime(int y) const;
+    double scanAngle(int x) const;
+
+protected:
+    bool   calcTiePoints(TSat *sat);
+    bool   setLineTimes(TBlock *block);
+    double frameTime(int line) const;
+    double lineFraction(int line, int l0, int l1) const;
+    void   toFrame(int x, int y, int *sample, int *line) const;
+
+private:
+    TScanGeometry geo;
+    double start, time_offset;
+    int    lines;
+    bool   northbound;
+
+    double *linetime;           // daynum of every frame line, NULL if timed by the line rate
+    float  *tie_lat, *tie_lon;  // tie_rows x tie_cols, frame coordinates
+    int    tie_rows, tie_cols;
+};
+
+#endif // GEOLOCATION_H
@@ -24,6 +24,9 @@
 #include <stdlib.h>
 #include "hrptblock.h"
 #include "block.h"
+#include "ndvilut.h"
+#include "framesync.h"
+#include "avhrrcal.h"
 
 //---------------------------------------------------------------------------
 /*
@@ -49,6 +52,7 @@ const int HRPT_NUM_CHANNELS = 5;
 const int HRPT_SCAN_WIDTH   = 2048;  // words, one image scan
 const int HRPT_SCAN_SIZE    = 10240; // words, width * channels
 const int HRPT_IMAGE_START  = 750;   // offset words from frame sync
+const int HRPT_TIME_CODE    = 8;     // offset words from frame sync, 4 words
 
 #define HRPT_SYNC_SIZE 6
 static const quint16 HRPT_SYNC[HRPT_SYNC_SIZE] = {
@@ -66,6 +70,8 @@ THRPT::THRPT(TBlock *_block)
   datatype = UNPACKED16BIT;
   scanLine = NULL;
   fp = NULL;
+
+  framesync = new TFrameSync(HRPT_SYNC, HRPT_SYNC_SIZE, HRPT_BLOCK_SIZE);
 }
 
 //---------------------------------------------------------------------------
@@ -73,6 +79,8 @@ THRPT::~THRPT(void)
 {
   if(scanLine)
      free(scanLine);
+
+  delete framesync;
 }
 
 //---------------------------------------------------------------------------
@@ -89,12 +97,22 @@ bool THRPT::init(void)
      scanLine = (quint16 *) malloc(HRPT_SCAN_SIZE << 1); // 20480 bytes
 
   fp = block->getHandle();
+  datatype = UNPACKED16BIT;
   if(countFrames() <= 0) {
      // retry using different endian
      block->setLittleEndian(!block->isLittleEndian());
      countFrames();
   }
 
+  if(!check(1)) {
+     // 10 bit words packed without padding, MSB first, e.g. from a bit recorder
+     datatype = PACKED10BIT;
+     countFrames();
+
+     if(!check(1))
+        datatype = UNPACKED16BIT;
+  }
+
   return check(1);
 }
 
@@ -116,10 +134,13 @@ bool THRPT::check(int flags)
 }
 
 //---------------------------------------------------------------------------
+// the frame synchronizer follows bit and word slips and inserts fill
+// frames for lost lines, see framesync.h
 int THRPT::countFrames(void)
 {
- long int syncSize, firstFrameSyncPos;
- int frames;
+ long int firstFrameSyncPos;
+ quint16 tc[4];
+ int frames, i;
 
   if(!check())
      return 0; // fatal error
@@ -127,71 +148,47 @@ int THRPT::countFrames(void)
   if(check(1)) // already done
      return block->getFrames();
 
-  block->gotoStart();
-
-  syncSize = HRPT_SYNC_SIZE << 1; // 12 bytes
   firstFrameSyncPos = -1;
   block->syncFound(false);
-  frames = 0;
 
-  while(findFrameSync()) {
-     // we just read 6 words, HRPT_SYNC_SIZE
-     if(frames == 0)
-        firstFrameSyncPos = ftell(fp) - syncSize;
+  framesync->setSource(fp, block->isLittleEndian(), datatype == PACKED10BIT);
+  frames = framesync->scan(block->satprop->syncCheck());
 
-     ++frames;
-
-     // hop to next frame
-     if(fseek(fp, (HRPT_BLOCK_SIZE << 1) - syncSize, SEEK_CUR) != 0)
+  for(i=0; i<frames; i++) {
+     firstFrameSyncPos = framesync->getBytePos(framesync->getFrame(i)->bitpos);
+     if(firstFrameSyncPos >= 0)
         break;
+  }
 
+  if(frames > 0) {
      block->syncFound(true);
+
+     if(framesync->slips || framesync->fills)
+        qDebug("HRPT frame sync: %d frames, %d corrected, %d slips, %d flywheel, %d fill",
+               frames, framesync->corrected, framesync->slips, framesync->flywheels, framesync->fills);
+  }
+
+  // the frame flags are the line quality, PQ_* has the same bits
+  for(i=0; i<frames; i++)
+     block->quality->setLine(i, framesync->getFrame(i)->flags);
+
+  // time code of the minor frame, day of year in bits 1-9 of word 9 and
+  // the milliseconds of the day in the 27 low bits of words 10-12
+  for(i=0; i<frames; i++) {
+     if(framesync->getFrame(i)->bitpos < 0 ||
+        !framesync->readWords(i, HRPT_TIME_CODE, 4, tc))
+        continue;
+
+     block->setLineTime(i, tc[0] >> 1, ((tc[1] & 0x7f) << 20) | (tc[2] << 10) | tc[3]);
   }
 
+  block->gotoStart();
   block->setFrames(frames);
   block->setFirstFrameSyncPos(firstFrameSyncPos);
 
  return frames;
 }
 
-//---------------------------------------------------------------------------
-bool THRPT::findFrameSync(void)
-{
-    quint8  ch[2];
-    quint16 w;
-    int i;
-
-    if(block->satprop->syncCheck()) {
-        i = 0;
-        while(fread(ch, sizeof(ch), 1, fp) == 1) {
-           if(block->isLittleEndian())
-              w = (ch[1] << 8) | ch[0];
-           else
-              w = (ch[0] << 8) | ch[1];
-
-           if(w == HRPT_SYNC[i])
-              i++;
-           else
-              i = 0;
-
-           if(i == HRPT_SYNC_SIZE)
-              return true;
-        }
-    }
-    else {
-        // no sync check, flush the sync
-        i = 0;
-        while(fread(ch, sizeof(ch), 1, fp) == 1) {
-            i++;
-
-            if(i == HRPT_SYNC_SIZE)
-               return true;
-        }
-    }
-
- return false;
-}
-
 //---------------------------------------------------------------------------
 int THRPT::getWidth(void)
 {
@@ -206,36 +203,41 @@ int THRPT::getNumChannels(void)
 
 //---------------------------------------------------------------------------
 // frame_nr is zero based (0, 1, 2, ... frames - 1)
+// fill frames are returned as zero lines
 bool THRPT::readFrameScanLine(int frame_nr)
 {
- long int pos, scanPos;
- int x;
-
   if(!check(1))
      return false;
 
-  pos = ftell(fp);
-  if(pos < 0)
+  // words are re-aligned to the frame sync and unpacked to host endian
+ return framesync->readWords(frame_nr, HRPT_IMAGE_START, HRPT_SCAN_SIZE, scanLine);
+}
+
+//---------------------------------------------------------------------------
+// feeds the telemetry of every frame to the calibration, frame numbers
+// stay the same as the scan lines (fill frames are added as lost lines)
+bool THRPT::readCalibration(TAVHRRCal *cal)
+{
+  quint16 buf[CAL_FRAME_WORDS];
+  TFrameInfo *info;
+  int i, frames;
+
+  if(!cal || !check(1))
      return false;
 
-  scanPos = block->getFirstFrameSyncPos() + ((HRPT_IMAGE_START + frame_nr*HRPT_BLOCK_SIZE) << 1);
+  cal->reset();
+  frames = framesync->getFrames();
 
-  if(pos != scanPos) {
-     if(pos > scanPos)
-        fseek(fp, scanPos, SEEK_SET);
+  for(i=0; i<frames; i++) {
+     info = framesync->getFrame(i);
+
+     if(info == NULL || info->bitpos < 0 || !framesync->readWords(i, 0, CAL_FRAME_WORDS, buf))
+        cal->addLine(NULL);
      else
-        fseek(fp, scanPos - pos, SEEK_CUR);
+        cal->addLine(buf);
   }
 
-  // todo: implement different packing features
-  if(fread(scanLine, HRPT_SCAN_SIZE << 1, 1, fp) != 1)
-     return false;
-
-  if(!block->isLittleEndian())
-     for(x=0; x < (HRPT_SCAN_WIDTH * HRPT_NUM_CHANNELS); x++)
-        SWAP16PTR(&scanLine[x]);
-
- return true;
+  return cal->calibrate();
 }
 
 //---------------------------------------------------------------------------
@@ -272,9 +274,9 @@ quint8 THRPT::getPixel_8(int channel, int sample)
 bool THRPT::frameToImage(int frame_nr, QImage *image)
 {
     Block_ImageType it;
+    TNDVILUT *lut;
     uchar *imagescan, r, g, b;
-    quint16 r2, g2, b2;
-    double vi;
+    quint32 rgb;
     int x, y, *ch_rgb;
 
     if(!check(1) || image == NULL)
@@ -313,6 +315,8 @@ bool THRPT::frameToImage(int frame_nr, QImage *image)
         it = Channel_ImageType;
     }
 
+    lut = block->getImageType() == NDVI_ImageType ? block->ndvilut:NULL;
+
     for(x=0; x<HRPT_SCAN_WIDTH; x++) {
         switch(it) {
         case Channel_ImageType:
@@ -331,30 +335,19 @@ bool THRPT::frameToImage(int frame_nr, QImage *image)
             return false;
         }
 
-        if(block->getImageType() == NDVI_ImageType) {
-            // use all 10 bits
-            r2 = getPixel_16(block->ndvi->nir_ch() - 1, x);
-            b2 = getPixel_16(block->ndvi->vis_ch() - 1, x);
-            vi = block->ndvi->ndvi(r2, b2);
-
-            if(block->ndvi->isValid(vi)) {
-                g2 = block->ndvi->toColor_16(vi);
-
-                switch(it) {
-                case Channel_ImageType:
-                    g = SCALE16TO8(g2);
-                    break;
+        if(lut) {
+            // use all 10 bits, zero alpha = NDVI out of range
+            rgb = lut->lookup(getPixel_16(block->ndvi->nir_ch() - 1, x),
+                              getPixel_16(block->ndvi->vis_ch() - 1, x));
 
-                case RGB_ImageType:
-                    r = SCALE16TO8(r2);
-                    g = SCALE16TO8(g2);
-                    b = SCALE16TO8(b2);
-                    break;
-
-                default:
-                    return false;
+            if(qAlpha(rgb)) {
+                if(it == RGB_ImageType || lut->hasPalette()) {
+                    r = qRed(rgb);
+                    g = qGreen(rgb);
+                    b = qBlue(rgb);
                 }
-
+                else
+                    g = qGreen(rgb);
             }
         }
 
@@ -378,7 +371,7 @@ bool THRPT::toImage(QImage *image)
   frames = block->getFrames();
 
   for(y=0; y<frames; y++) {
-     if(!frameToImage(y, image))
+     if(!frameToImage(y, image) || !block->frameDone(y))
         break;
   }
 
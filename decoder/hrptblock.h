@@ -47,6 +47,8 @@ typedef enum HRPT_DataType_t
 
 class QImage;
 class TBlock;
+class TFrameSync;
+class TAVHRRCal;
 
 //---------------------------------------------------------------------------
 class THRPT
@@ -68,16 +70,18 @@ class THRPT
     quint16 getPixel_16(int channel, int sample);
     quint8  getPixel_8(int channel, int sample);
 
+    bool readCalibration(TAVHRRCal *cal);
+
     HRPT_DataType datatype;
     int Modes;
 
  protected:
     bool check(int flags=0);
-    bool findFrameSync(void);
 
  private:
-    TBlock  *block;
-    FILE    *fp;
+    TBlock     *block;
+    TFrameSync *framesync;
+    FILE       *fp;
 
     quint16 *scanLine;
 };
@@ -0,0 +1,787 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+
+#include <QFileInfo>
+#include <QRunnable>
+#include <QThread>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "imagewriter.h"
+
+//---------------------------------------------------------------------------
+// 10 bit count to full 16 bit range
+#define SCALE10TO16(x) \
+  ((quint16)                            \
+   (((((quint16) x) & 0x03ff) << 6) | ((((quint16) x) & 0x03ff) >> 4)))
+
+//---------------------------------------------------------------------------
+static void putLE16(unsigned char *p, quint16 v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+//---------------------------------------------------------------------------
+static void putLE32(unsigned char *p, quint32 v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = v >> 24;
+}
+
+//---------------------------------------------------------------------------
+static void putBE32(unsigned char *p, quint32 v)
+{
+    p[0] = v >> 24;
+    p[1] = (v >> 16) & 0xff;
+    p[2] = (v >> 8) & 0xff;
+    p[3] = v & 0xff;
+}
+
+//---------------------------------------------------------------------------
+// the table is built at startup, the writers run in the decoder threads
+static struct TCRCTable
+{
+    quint32 entry[256];
+
+    TCRCTable(void)
+    {
+        quint32 c;
+        int n, k;
+
+        for(n=0; n<256; n++) {
+            c = (quint32) n;
+            for(k=0; k<8; k++)
+                c = c & 1 ? 0xedb88320L ^ (c >> 1):c >> 1;
+            entry[n] = c;
+        }
+    }
+} crc_table;
+
+//---------------------------------------------------------------------------
+static quint32 crc32_update(quint32 crc, const unsigned char *buf, int len)
+{
+    quint32 c;
+    int n;
+
+    c = crc ^ 0xffffffffL;
+    for(n=0; n<len; n++)
+        c = crc_table.entry[(c ^ buf[n]) & 0xff] ^ (c >> 8);
+
+    return c ^ 0xffffffffL;
+}
+
+//---------------------------------------------------------------------------
+static quint32 adler32_update(quint32 adler, const unsigned char *buf, int len)
+{
+    quint32 a = adler & 0xffff, b = adler >> 16;
+    int n;
+
+    while(len > 0) {
+        // largest n such that b does not overflow
+        n = len < 5552 ? len:5552;
+        len -= n;
+
+        while(n--) {
+            a += *buf++;
+            b += a;
+        }
+
+        a %= 65521;
+        b %= 65521;
+    }
+
+    return (b << 16) | a;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+class TImageStrip
+{
+public:
+    QByteArray raw, data;
+    bool       last;
+};
+
+//---------------------------------------------------------------------------
+class TImageStripJob : public QRunnable
+{
+public:
+    TImageStripJob(TImageWriter *writer_, TImageStrip *strip_)
+    {
+        writer = writer_;
+        strip = strip_;
+    }
+
+    void run()
+    {
+        strip->data = writer->compressStrip(strip->raw, strip->last);
+        strip->raw.clear();
+    }
+
+private:
+    TImageWriter *writer;
+    TImageStrip  *strip;
+};
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TImageWriter::TImageWriter(const QString& filename_)
+{
+    filename = filename_;
+    fp = NULL;
+    format = IW_COUNTS;
+
+    width = height = channels = rows = 0;
+    rows_per_strip = 1;
+    ok = false;
+
+    num_strips = 0;
+    strip_rows = 0;
+}
+
+//---------------------------------------------------------------------------
+TImageWriter::~TImageWriter(void)
+{
+    pool.waitForDone();
+
+    for(int i=0; i<num_strips; i++)
+        delete strips[i];
+
+    if(fp)
+        fclose(fp);
+}
+
+//---------------------------------------------------------------------------
+// returns NULL if the file type has no streaming writer
+TImageWriter *TImageWriter::create(const QString& filename)
+{
+    QString suffix = QFileInfo(filename).suffix().toLower();
+
+    if(suffix == "tif" || suffix == "tiff")
+        return new TTIFFWriter(filename);
+    else if(suffix == "png")
+        return new TPNGWriter(filename);
+    else if(suffix == "bin" || suffix == "raw")
+        return new TRawWriter(filename);
+    else
+        return NULL;
+}
+
+//---------------------------------------------------------------------------
+bool TImageWriter::isSupported(const QString& filename)
+{
+    TImageWriter *writer = create(filename);
+    bool rc = writer != NULL;
+
+    if(writer)
+        delete writer;
+
+    return rc;
+}
+
+//---------------------------------------------------------------------------
+// must be set before start
+bool TImageWriter::setSampleFormat(int format_)
+{
+    if(fp || !supportsFormat(format_))
+        return false;
+
+    format = format_;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool TImageWriter::start(int width_, int height_, int channels_)
+{
+    if(fp || width_ <= 0 || height_ <= 0 || !supportsChannels(channels_))
+        return false;
+
+    width = width_;
+    height = height_;
+    channels = channels_;
+    rows = 0;
+
+    rows_per_strip = IW_STRIP_SIZE / (width * channels * (format == IW_FLOAT32 ? 4:2));
+    if(rows_per_strip < 1)
+        rows_per_strip = 1;
+
+    fp = fopen(filename.toStdString().c_str(), "wb");
+    if(fp == NULL) {
+        qDebug("Error: Failed to create file %s", filename.toStdString().c_str());
+        return false;
+    }
+
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+
+    ok = writeHeader();
+
+    return ok;
+}
+
+//---------------------------------------------------------------------------
+bool TImageWriter::writeRow(const quint16 *row)
+{
+    if(fp == NULL || !ok)
+        return false;
+
+    ok = writeRowData(row);
+    rows++;
+
+    return ok;
+}
+
+//---------------------------------------------------------------------------
+bool TImageWriter::writeFloatRow(const float *row)
+{
+    if(fp == NULL || !ok || format != IW_FLOAT32)
+        return false;
+
+    ok = writeFloatRowData(row);
+    rows++;
+
+    return ok;
+}
+
+//---------------------------------------------------------------------------
+bool TImageWriter::finish(void)
+{
+    if(fp == NULL)
+        return false;
+
+    if(ok)
+        ok = writeTrailer();
+
+    pool.waitForDone();
+
+    fclose(fp);
+    fp = NULL;
+
+    return ok;
+}
+
+//---------------------------------------------------------------------------
+QByteArray TImageWriter::compressStrip(const QByteArray& raw, bool /*last*/) const
+{
+    return raw;
+}
+
+//---------------------------------------------------------------------------
+bool TImageWriter::writeStrip(const QByteArray& data)
+{
+    return write(data.constData(), data.size());
+}
+
+//---------------------------------------------------------------------------
+// appends a row to the current strip, the strip is handed to the pool
+// when it is full
+bool TImageWriter::addStripData(const void *data, int size)
+{
+    strip_buf.append((const char *) data, size);
+
+    if(++strip_rows >= rows_per_strip)
+        return submitStrip();
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool TImageWriter::submitStrip(bool last)
+{
+    TImageStrip *strip;
+
+    if(strip_buf.isEmpty() && !last)
+        return true;
+
+    if(num_strips >= IW_MAX_STRIPS)
+        if(!flushStrips())
+            return false;
+
+    strip = new TImageStrip;
+    strip->raw = strip_buf;
+    strip->last = last;
+
+    strip_buf.clear();
+    strip_rows = 0;
+
+    strips[num_strips++] = strip;
+    pool.start(new TImageStripJob(this, strip));
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// waits for the pool and writes the strips in order
+bool TImageWriter::flushStrips(void)
+{
+    pool.waitForDone();
+
+    for(int i=0; i<num_strips; i++) {
+        if(ok)
+            ok = writeStrip(strips[i]->data);
+
+        delete strips[i];
+    }
+
+    num_strips = 0;
+
+    return ok;
+}
+
+//---------------------------------------------------------------------------
+bool TImageWriter::write(const void *data, size_t size)
+{
+    if(fp == NULL)
+        return false;
+
+    return fwrite(data, 1, size, fp) == size;
+}
+
+//---------------------------------------------------------------------------
+quint16 TImageWriter::sample16(quint16 value) const
+{
+    return format == IW_COUNTS ? SCALE10TO16(value):value;
+}
+
+//---------------------------------------------------------------------------
+bool TImageWriter::writeBE32(quint32 value)
+{
+    unsigned char buf[4];
+
+    putBE32(buf, value);
+
+    return write(buf, 4);
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TTIFFWriter::TTIFFWriter(const QString& filename_) :
+    TImageWriter(filename_)
+{
+    offsets = counts = NULL;
+    num_offsets = max_offsets = 0;
+}
+
+//---------------------------------------------------------------------------
+TTIFFWriter::~TTIFFWriter(void)
+{
+    if(offsets)
+        free(offsets);
+    if(counts)
+        free(counts);
+}
+
+//---------------------------------------------------------------------------
+bool TTIFFWriter::writeHeader(void)
+{
+    unsigned char hdr[8] = { 'I', 'I', 42, 0, 0, 0, 0, 0 }; // IFD offset is written last
+
+    rowbuf.resize(width * channels * 2);
+    num_offsets = 0;
+
+    return write(hdr, sizeof(hdr));
+}
+
+//---------------------------------------------------------------------------
+bool TTIFFWriter::writeRowData(const quint16 *row)
+{
+    unsigned char *p = (unsigned char *) rowbuf.data();
+    int i, n = width * channels;
+
+    for(i=0; i<n; i++, p+=2)
+        putLE16(p, sample16(row[i]));
+
+    return addStripData(rowbuf.constData(), rowbuf.size());
+}
+
+//---------------------------------------------------------------------------
+// TIFF deflate is a zlib stream, qCompress prepends a 4 byte size
+QByteArray TTIFFWriter::compressStrip(const QByteArray& raw, bool /*last*/) const
+{
+    return qCompress(raw, 6).mid(4);
+}
+
+//---------------------------------------------------------------------------
+bool TTIFFWriter::writeStrip(const QByteArray& data)
+{
+    quint32 *p;
+
+    if(num_offsets >= max_offsets) {
+        max_offsets += 1024;
+
+        p = (quint32 *) realloc(offsets, max_offsets * sizeof(quint32));
+        if(p == NULL)
+            return false;
+        offsets = p;
+
+        p = (quint32 *) realloc(counts, max_offsets * sizeof(quint32));
+        if(p == NULL)
+            return false;
+        counts = p;
+    }
+
+    offsets[num_offsets] = (quint32) ftell(fp);
+    counts[num_offsets] = (quint32) data.size();
+    num_offsets++;
+
+    return TImageWriter::writeStrip(data);
+}
+
+//---------------------------------------------------------------------------
+bool TTIFFWriter::writeTrailer(void)
+{
+    QByteArray     ifd;
+    unsigned char  *p, buf[4];
+    quint32        pos, offsets_pos, counts_pos, bps_pos;
+    int            i, entries;
+
+    if(!submitStrip() || !flushStrips() || num_offsets == 0)
+        return false;
+
+    pos = (quint32) ftell(fp);
+    if(pos & 1) {
+        write("", 1);
+        pos++;
+    }
+
+    // arrays that do not fit in the 4 byte IFD value
+    offsets_pos = counts_pos = bps_pos = 0;
+
+    if(num_offsets > 1) {
+        offsets_pos = pos;
+        for(i=0; i<num_offsets; i++) {
+            putLE32(buf, offsets[i]);
+            write(buf, 4);
+        }
+
+        counts_pos = pos + num_offsets * 4;
+        for(i=0; i<num_offsets; i++) {
+            putLE32(buf, counts[i]);
+            write(buf, 4);
+        }
+
+        pos += num_offsets * 8;
+    }
+
+    if(channels > 2) {
+        bps_pos = pos;
+        for(i=0; i<channels; i++) {
+            putLE16(buf, 16);
+            write(buf, 2);
+        }
+
+        pos += channels * 2;
+    }
+
+    // tags in ascending order
+    entries = 10;
+    ifd.resize(2 + entries * 12 + 4);
+    p = (unsigned char *) ifd.data();
+    memset(p, 0, ifd.size());
+
+    putLE16(p, entries);
+    p += 2;
+
+#define TIFF_ENTRY(tag, type, count, value) \
+    putLE16(p, tag); putLE16(p + 2, type); putLE32(p + 4, count); \
+    if(type == 3 && count == 1) putLE16(p + 8, value); else putLE32(p + 8, value); \
+    p += 12;
+
+    TIFF_ENTRY(256, 4, 1, width);                                      // ImageWidth
+    TIFF_ENTRY(257, 4, 1, rows);                                       // ImageLength
+    TIFF_ENTRY(258, 3, channels, channels > 2 ? bps_pos:16);           // BitsPerSample
+    TIFF_ENTRY(259, 3, 1, 8);                                          // Compression, deflate
+    TIFF_ENTRY(262, 3, 1, channels == 3 ? 2:1);                        // Photometric, RGB or min is black
+    TIFF_ENTRY(273, 4, num_offsets, num_offsets > 1 ? offsets_pos:offsets[0]); // StripOffsets
+    TIFF_ENTRY(277, 3, 1, channels);                                   // SamplesPerPixel
+    TIFF_ENTRY(278, 4, 1, rows_per_strip);                             // RowsPerStrip
+    TIFF_ENTRY(279, 4, num_offsets, num_offsets > 1 ? counts_pos:counts[0]); // StripByteCounts
+    TIFF_ENTRY(284, 3, 1, 1);                                          // PlanarConfiguration, chunky
+
+#undef TIFF_ENTRY
+
+    // next IFD offset is zero
+    if(!write(ifd.constData(), ifd.size()))
+        return false;
+
+    // first IFD offset to the header
+    putLE32(buf, pos);
+    if(fseek(fp, 4, SEEK_SET) != 0)
+        return false;
+
+    return write(buf, 4);
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TPNGWriter::TPNGWriter(const QString& filename_) :
+    TImageWriter(filename_)
+{
+    adler = 1;
+}
+
+//---------------------------------------------------------------------------
+bool TPNGWriter::writeHeader(void)
+{
+    const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    const char zlib_hdr[2] = { 0x78, 0x01 };
+    unsigned char ihdr[13];
+
+    putBE32(ihdr, width);
+    putBE32(ihdr + 4, height);
+    ihdr[8]  = 16;                  // bit depth
+    ihdr[9]  = channels == 3 ? 2:0; // RGB or grayscale
+    ihdr[10] = 0;                   // deflate
+    ihdr[11] = 0;                   // adaptive filtering
+    ihdr[12] = 0;                   // no interlace
+
+    rowbuf.resize(1 + width * channels * 2);
+    adler = 1;
+
+    return write(signature, sizeof(signature)) &&
+           writeChunk("IHDR", (const char *) ihdr, sizeof(ihdr)) &&
+           writeChunk("IDAT", zlib_hdr, sizeof(zlib_hdr));
+}
+
+//---------------------------------------------------------------------------
+bool TPNGWriter::writeRowData(const quint16 *row)
+{
+    unsigned char *p = (unsigned char *) rowbuf.data();
+    quint16 v;
+    int i, n = width * channels;
+
+    *p++ = 0; // filter type none
+
+    for(i=0; i<n; i++) {
+        v = sample16(row[i]);
+        *p++ = v >> 8;
+        *p++ = v & 0xff;
+    }
+
+    adler = adler32_update(adler, (const unsigned char *) rowbuf.constData(), rowbuf.size());
+
+    return addStripData(rowbuf.constData(), rowbuf.size());
+}
+
+//---------------------------------------------------------------------------
+// raw deflate of one strip, only the last strip has the final block bit set
+QByteArray TPNGWriter::compressStrip(const QByteArray& raw, bool last) const
+{
+    QByteArray out;
+
+#ifdef HAVE_ZLIB
+
+    z_stream zs;
+    int rc;
+
+    memset(&zs, 0, sizeof(zs));
+    if(deflateInit2(&zs, 6, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return out;
+
+    out.resize(deflateBound(&zs, raw.size()) + 16);
+
+    zs.next_in = (Bytef *) raw.constData();
+    zs.avail_in = raw.size();
+    zs.next_out = (Bytef *) out.data();
+    zs.avail_out = out.size();
+
+    // sync flush ends the strip at a byte boundary
+    rc = deflate(&zs, last ? Z_FINISH:Z_SYNC_FLUSH);
+    if(rc == Z_STREAM_ERROR)
+        out.clear();
+    else
+        out.resize(out.size() - zs.avail_out);
+
+    deflateEnd(&zs);
+
+#else
+
+    // no zlib, use stored blocks
+    const unsigned char *p = (const unsigned char *) raw.constData();
+    unsigned char hdr[5];
+    int len, left = raw.size();
+
+    do {
+        len = left > 0xffff ? 0xffff:left;
+        left -= len;
+
+        hdr[0] = last && left == 0 ? 1:0;
+        putLE16(hdr + 1, len);
+        putLE16(hdr + 3, ~len);
+
+        out.append((const char *) hdr, 5);
+        out.append((const char *) p, len);
+        p += len;
+    } while(left > 0);
+
+#endif // #ifdef HAVE_ZLIB
+
+    return out;
+}
+
+//---------------------------------------------------------------------------
+bool TPNGWriter::writeStrip(const QByteArray& data)
+{
+    if(data.isEmpty())
+        return false;
+
+    return writeChunk("IDAT", data.constData(), data.size());
+}
+
+//---------------------------------------------------------------------------
+bool TPNGWriter::writeTrailer(void)
+{
+    unsigned char buf[4];
+
+    if(rows != height) {
+        qDebug("Error: PNG %s has %d rows of %d", filename.toStdString().c_str(), rows, height);
+        return false;
+    }
+
+    // pending rows and an empty final block
+    if(!submitStrip() || !submitStrip(true) || !flushStrips())
+        return false;
+
+    putBE32(buf, adler);
+
+    return writeChunk("IDAT", (const char *) buf, 4) &&
+           writeChunk("IEND", NULL, 0);
+}
+
+//---------------------------------------------------------------------------
+bool TPNGWriter::writeChunk(const char *type, const char *data, int size)
+{
+    quint32 crc;
+
+    crc = crc32_update(0, (const unsigned char *) type, 4);
+    if(size > 0)
+        crc = crc32_update(crc, (const unsigned char *) data, size);
+
+    return writeBE32(size) &&
+           write(type, 4) &&
+           (size == 0 || write(data, size)) &&
+           writeBE32(crc);
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TRawWriter::TRawWriter(const QString& filename_) :
+    TImageWriter(filename_)
+{
+}
+
+//---------------------------------------------------------------------------
+bool TRawWriter::writeHeader(void)
+{
+    QFileInfo fi(filename);
+    QString   hdrname = fi.absolutePath() + "/" + fi.completeBaseName() + ".hdr";
+    FILE      *hdrfp;
+
+    rowbuf.resize(width * (format == IW_FLOAT32 ? 4:2));
+
+    hdrfp = fopen(hdrname.toStdString().c_str(), "w");
+    if(hdrfp == NULL) {
+        qDebug("Error: Failed to create file %s", hdrname.toStdString().c_str());
+        return false;
+    }
+
+    fprintf(hdrfp, "ENVI\n");
+    if(format == IW_FLOAT32)
+        fprintf(hdrfp, "description = {POES-Decoder calibrated, albedo %% or brightness temperature K}\n");
+    else if(format == IW_COUNTS)
+        fprintf(hdrfp, "description = {POES-Decoder raw counts, 10 bits}\n");
+    else
+        fprintf(hdrfp, "description = {POES-Decoder 16 bit}\n");
+
+    fprintf(hdrfp, "samples = %d\n", width);
+    fprintf(hdrfp, "lines = %d\n", height);
+    fprintf(hdrfp, "bands = %d\n", channels);
+    fprintf(hdrfp, "header offset = 0\n");
+    fprintf(hdrfp, "file type = ENVI Standard\n");
+    fprintf(hdrfp, "data type = %d\n", format == IW_FLOAT32 ? 4:12);
+    fprintf(hdrfp, "interleave = bil\n");
+    fprintf(hdrfp, "byte order = 0\n");
+
+    fclose(hdrfp);
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// the channels of the row one after the other, the file is written in order
+bool TRawWriter::writeRowData(const quint16 *row)
+{
+    unsigned char *p;
+    quint16 mask = format == IW_COUNTS ? 0x03ff:0xffff;
+    int c, x;
+
+    if(rows >= height)
+        return false;
+
+    for(c=0; c<channels; c++) {
+        p = (unsigned char *) rowbuf.data();
+        for(x=0; x<width; x++, p+=2)
+            putLE16(p, row[x * channels + c] & mask);
+
+        if(!write(rowbuf.constData(), rowbuf.size()))
+            return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool TRawWriter::writeFloatRowData(const float *row)
+{
+    unsigned char *p;
+    quint32 u;
+    int c, x;
+
+    if(rows >= height)
+        return false;
+
+    for(c=0; c<channels; c++) {
+        p = (unsigned char *) rowbuf.data();
+        for(x=0; x<width; x++, p+=4) {
+            memcpy(&u, &row[x * channels + c], 4);
+            putLE32(p, u);
+        }
+
+        if(!write(rowbuf.constData(), rowbuf.size()))
+            return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool TRawWriter::writeTrailer(void)
+{
+    return true;
+}
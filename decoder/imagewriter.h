@@ -0,0 +1,187 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+
+#ifndef imagewriterH
+#define imagewriterH
+
+//---------------------------------------------------------------------------
+//
+//                      include's
+//
+//---------------------------------------------------------------------------
+#include <QtGlobal>
+#include <QString>
+#include <QByteArray>
+#include <QThreadPool>
+#include <stdio.h>
+
+//---------------------------------------------------------------------------
+//
+//                      define's
+//
+//---------------------------------------------------------------------------
+#define IW_STRIP_SIZE       (256 * 1024) // uncompressed bytes per strip
+#define IW_MAX_STRIPS       64           // max strips in flight
+
+// sample formats
+#define IW_COUNTS           0   // 10 bit counts, scaled to 16 bits
+#define IW_UINT16           1   // 16 bit values written as is
+#define IW_FLOAT32          2   // float rows, raw writer only
+
+//---------------------------------------------------------------------------
+class TImageStrip;
+
+//---------------------------------------------------------------------------
+/*
+  Streaming image writer, rows are written as they are decoded so the
+  whole pass is never in memory. A row is width * channels interleaved
+  10 bit samples.
+  Strips are compressed on the worker pool and written in order,
+  memory use is IW_MAX_STRIPS * IW_STRIP_SIZE at most.
+*/
+class TImageWriter
+{
+public:
+    TImageWriter(const QString& filename_);
+    virtual ~TImageWriter(void);
+
+    static TImageWriter *create(const QString& filename);
+    static bool isSupported(const QString& filename);
+
+    virtual bool supportsChannels(int channels_) { return channels_ == 1 || channels_ == 3; }
+    virtual bool supportsFormat(int format_) { return format_ == IW_COUNTS || format_ == IW_UINT16; }
+
+    bool setSampleFormat(int format_);
+    int  sampleFormat(void) { return format; }
+
+    bool start(int width_, int height_, int channels_);
+    bool writeRow(const quint16 *row);
+    bool writeFloatRow(const float *row);
+    bool finish(void);
+
+    QString fileName(void) const { return filename; }
+
+protected:
+    virtual bool writeHeader(void) = 0;
+    virtual bool writeRowData(const quint16 *row) = 0;
+    virtual bool writeFloatRowData(const float * /*row*/) { return false; }
+    virtual bool writeTrailer(void) = 0;
+
+    // thread safe, called from the worker pool
+    virtual QByteArray compressStrip(const QByteArray& raw, bool last) const;
+    virtual bool       writeStrip(const QByteArray& data);
+
+    bool addStripData(const void *data, int size);
+    bool submitStrip(bool last = false);
+    bool flushStrips(void);
+
+    bool write(const void *data, size_t size);
+    bool writeBE32(quint32 value);
+
+    quint16 sample16(quint16 value) const;
+
+    QString filename;
+    FILE    *fp;
+    int     format;
+    int     width, height, channels, rows;
+    int     rows_per_strip;
+    bool    ok;
+
+private:
+    friend class TImageStripJob;
+
+    QThreadPool  pool;
+    TImageStrip *strips[IW_MAX_STRIPS];
+    int          num_strips;
+    QByteArray   strip_buf;
+    int          strip_rows;
+};
+
+//---------------------------------------------------------------------------
+// baseline TIFF, 16 bit gray or RGB, deflate compressed strips
+class TTIFFWriter : public TImageWriter
+{
+public:
+    TTIFFWriter(const QString& filename_);
+    ~TTIFFWriter(void);
+
+protected:
+    bool writeHeader(void);
+    bool writeRowData(const quint16 *row);
+    bool writeTrailer(void);
+
+    QByteArray compressStrip(const QByteArray& raw, bool last) const;
+    bool       writeStrip(const QByteArray& data);
+
+private:
+    QByteArray rowbuf;
+    quint32    *offsets, *counts;
+    int        num_offsets, max_offsets;
+};
+
+//---------------------------------------------------------------------------
+// PNG, 16 bit gray or RGB
+// one zlib stream, strips are deflated independently and flushed
+// to a byte boundary so they can be concatenated
+class TPNGWriter : public TImageWriter
+{
+public:
+    TPNGWriter(const QString& filename_);
+
+protected:
+    bool writeHeader(void);
+    bool writeRowData(const quint16 *row);
+    bool writeTrailer(void);
+
+    QByteArray compressStrip(const QByteArray& raw, bool last) const;
+    bool       writeStrip(const QByteArray& data);
+
+    bool writeChunk(const char *type, const char *data, int size);
+
+private:
+    QByteArray rowbuf;
+    quint32    adler;
+};
+
+//---------------------------------------------------------------------------
+// raw band interleaved by line 16 bit counts or 32 bit float, little
+// endian, with an ENVI compatible .hdr text header
+class TRawWriter : public TImageWriter
+{
+public:
+    TRawWriter(const QString& filename_);
+
+    bool supportsChannels(int channels_) { return channels_ > 0; }
+    bool supportsFormat(int /*format_*/) { return true; }
+
+protected:
+    bool writeHeader(void);
+    bool writeRowData(const quint16 *row);
+    bool writeFloatRowData(const float *row);
+    bool writeTrailer(void);
+
+private:
+    QByteArray rowbuf;
+};
+
+//---------------------------------------------------------------------------
+#endif
@@ -481,7 +481,7 @@ bool TLRIT::toImage(QImage *image)
   frames = block->getFrames();
 
   for(y=0; y<frames; y++) {
-     if(!frameToImage(y, image))
+     if(!frameToImage(y, image) || !block->frameDone(y))
         break;
   }
 
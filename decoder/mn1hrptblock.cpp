@@ -390,7 +390,7 @@ bool TMN1HRPT::toImage(QImage *image)
   frames = block->getFrames();
 
   for(y=0; y<frames; y++) {
-     if(!scanToImage(y, image))
+     if(!scanToImage(y, image) || !block->frameDone(y))
         break;
   }
 
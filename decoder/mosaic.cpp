@@ -0,0 +1,670 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <QImage>
+#include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QSettings>
+#include <QVector>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mosaic.h"
+#include "reproject.h"
+#include "geolocation.h"
+#include "imagewriter.h"
+
+#define MS_DEG2RAD  (M_PI / 180.0)
+
+//---------------------------------------------------------------------------
+// higher is better, col and row are grid pixels, sx and sy the swath position
+static float pixelScore(const TGrid &grid, const TMosaicPass *pass, int col, int row,
+                        float sx, float sy, const uchar *rgb)
+{
+ double lat, lon, t, sun_lon, cosz;
+ float  score;
+
+    switch(pass->rule) {
+    case SunElevation_Rule:
+        if(!grid.proj.inverse(grid.x0 + (col + 0.5) * grid.res, grid.y0 - (row + 0.5) * grid.res, &lat, &lon))
+            return MS_EMPTY_SCORE;
+
+        // the subsolar point moves west 360 degrees a day
+        t = pass->geo->lineTime((int) (sy + 0.5f));
+        sun_lon = pass->sun_lon - 360.0 * (t - pass->mid_time);
+
+        lat *= MS_DEG2RAD;
+        cosz = sin(lat) * sin(pass->sun_lat * MS_DEG2RAD) +
+               cos(lat) * cos(pass->sun_lat * MS_DEG2RAD) * cos((lon - sun_lon) * MS_DEG2RAD);
+
+        return (float) (asin(cosz < -1 ? -1:(cosz > 1 ? 1:cosz)) / MS_DEG2RAD);
+
+    case Recent_Rule:
+        // seconds from the first pass, a float daynum is not accurate enough
+        return (float) ((pass->geo->lineTime((int) (sy + 0.5f)) - pass->epoch) * 86400.0);
+
+    case CloudFree_Rule:
+        score = -fabs(pass->geo->scanAngle((int) (sx + 0.5f)));
+        if(rgb[pass->cloud_channel] >= pass->cloud_threshold)
+            score -= MS_CLOUD_PENALTY;
+
+        return score;
+
+    default:
+        return -fabs(pass->geo->scanAngle((int) (sx + 0.5f)));
+    }
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+class TMosaicTileJob : public QRunnable
+{
+public:
+    TMosaicTileJob(const TReprojector *rp_, const TGrid &grid_, const QVector<int> &cells_,
+                   int col0_, int row0_, TMosaicTile *tile_, const TMosaicPass *pass_)
+    {
+        rp = rp_;
+        grid = grid_;
+        cells = cells_;
+        col0 = col0_;
+        row0 = row0_;
+        tile = tile_;
+        pass = pass_;
+    }
+
+    void run()
+    {
+        float *sx, *sy, score;
+        uchar rgb[3];
+        int   w, h, x, y, i, j;
+
+        w = qMin(MS_TILE_SIZE, grid.width - col0);
+        h = qMin(MS_TILE_SIZE, grid.height - row0);
+
+        sx = (float *) malloc(w * h * sizeof(float));
+        sy = (float *) malloc(w * h * sizeof(float));
+
+        if(sx && sy && rp->mapTile(grid, cells, col0, row0, w, h, sx, sy))
+        for(y=0; y<h; y++)
+            for(x=0; x<w; x++) {
+                i = y * w + x;
+                if(sx[i] < 0)
+                    continue;
+
+                rp->sample(sx[i], sy[i], rgb);
+                score = pixelScore(grid, pass, col0 + x, row0 + y, sx[i], sy[i], rgb);
+
+                j = y * MS_TILE_SIZE + x;
+                if(score > tile->score[j]) {
+                    tile->score[j] = score;
+                    memcpy(&tile->rgb[j * 3], rgb, 3);
+                }
+            }
+
+        if(sx)
+            free(sx);
+        if(sy)
+            free(sy);
+    }
+
+private:
+    const TReprojector *rp;
+    const TMosaicPass  *pass;
+    TGrid        grid;
+    QVector<int> cells;
+    TMosaicTile  *tile;
+    int          col0, row0;
+};
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TMosaic::TMosaic(const TGrid &grid_, Mosaic_Rule rule_)
+{
+    grid = grid_;
+    rule = rule_;
+
+    tiles_x = (grid.width + MS_TILE_SIZE - 1) / MS_TILE_SIZE;
+    num_passes = 0;
+    epoch = 0;
+
+    cloud_channel = 0;
+    cloud_threshold = 256; // off
+
+    rp = NULL;
+    band_first = band_rows = next_line = 0;
+}
+
+//---------------------------------------------------------------------------
+TMosaic::~TMosaic(void)
+{
+    if(rp)
+        delete rp;
+
+    clear();
+}
+
+//---------------------------------------------------------------------------
+void TMosaic::clear(void)
+{
+    QHash<int, TMosaicTile *>::iterator it;
+
+    for(it=tiles.begin(); it!=tiles.end(); ++it) {
+        free(it.value()->rgb);
+        free(it.value()->score);
+        delete it.value();
+    }
+
+    tiles.clear();
+    num_passes = 0;
+}
+
+//---------------------------------------------------------------------------
+QString TMosaic::getRuleStr(int rule_)
+{
+    switch(rule_) {
+    case SunElevation_Rule: return QString("Highest sun elevation");
+    case Nadir_Rule:        return QString("Closest to nadir");
+    case Recent_Rule:       return QString("Most recent");
+    case CloudFree_Rule:    return QString("Cloud free");
+    default:                return QString("Unknown");
+    }
+}
+
+//---------------------------------------------------------------------------
+void TMosaic::setCloudThreshold(int channel, int value)
+{
+    cloud_channel = channel < 0 ? 0:(channel > 2 ? 2:channel);
+    cloud_threshold = value;
+}
+
+//---------------------------------------------------------------------------
+// subsolar point in degrees, the NOAA low precision formulas
+void TMosaic::subSolarPoint(double daynum, double *lat, double *lon)
+{
+ double n, L, g, lambda, eps, ra, gmst;
+
+    n = daynum + 2444238.5 - 2451545.0;  // days from J2000
+
+    L = 280.460 + 0.9856474 * n;
+    g = (357.528 + 0.9856003 * n) * MS_DEG2RAD;
+    lambda = (L + 1.915 * sin(g) + 0.020 * sin(2.0 * g)) * MS_DEG2RAD;
+    eps = (23.439 - 0.0000004 * n) * MS_DEG2RAD;
+
+    ra = atan2(cos(eps) * sin(lambda), cos(lambda)) / MS_DEG2RAD;
+    gmst = 280.46061837 + 360.98564736629 * n;
+
+    *lat = asin(sin(eps) * sin(lambda)) / MS_DEG2RAD;
+    *lon = fmod(ra - gmst, 360.0);
+    if(*lon < -180.0)
+        *lon += 360.0;
+    else if(*lon > 180.0)
+        *lon -= 360.0;
+}
+
+//---------------------------------------------------------------------------
+TMosaicTile *TMosaic::tile(int key)
+{
+    TMosaicTile *t = tiles.value(key, NULL);
+    int i;
+
+    if(t)
+        return t;
+
+    t = new TMosaicTile;
+    t->rgb = (uchar *) calloc(MS_TILE_SIZE * MS_TILE_SIZE * 3, 1);
+    t->score = (float *) malloc(MS_TILE_SIZE * MS_TILE_SIZE * sizeof(float));
+
+    if(t->rgb == NULL || t->score == NULL) {
+        if(t->rgb)
+            free(t->rgb);
+        if(t->score)
+            free(t->score);
+        delete t;
+
+        return NULL;
+    }
+
+    for(i=0; i<MS_TILE_SIZE * MS_TILE_SIZE; i++)
+        t->score[i] = MS_EMPTY_SCORE;
+
+    tiles.insert(key, t);
+
+    return t;
+}
+
+//---------------------------------------------------------------------------
+// the scan lines of the pass follow with addRow, geo is the geolocation of
+// the pass as displayed and must stay valid until endPass
+bool TMosaic::beginPass(const TGeoLocation *geo)
+{
+    if(geo == NULL || !geo->isValid())
+        return false;
+
+    if(rp)
+        delete rp;
+
+    // a band holds the lines of the cells blended at a time and the kernel margins
+    rp = new TReprojector(NULL, geo);
+    band = QImage(geo->width(), MS_BAND_LINES + RP_MESH_STEP + 4, QImage::Format_RGB888);
+    band_first = band_rows = next_line = 0;
+
+    if(band.isNull()) {
+        qDebug("Mosaic: out of memory");
+        delete rp;
+        rp = NULL;
+
+        return false;
+    }
+
+    pass.geo = geo;
+    pass.rule = rule;
+    pass.cloud_channel = cloud_channel;
+    pass.cloud_threshold = cloud_threshold;
+    pass.mid_time = geo->lineTime(geo->height() / 2);
+    subSolarPoint(pass.mid_time, &pass.sun_lat, &pass.sun_lon);
+
+    if(num_passes == 0)
+        epoch = pass.mid_time;
+    pass.epoch = epoch;
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// line y of the pass, the lines are added in order 0...height - 1
+bool TMosaic::addRow(int y, const uchar *rgb)
+{
+    if(rp == NULL || rgb == NULL || y != band_first + band_rows)
+        return false;
+
+    memcpy(band.scanLine(band_rows), rgb, band.width() * 3);
+    band_rows++;
+
+ return band_rows < band.height() ? true:blendBand(false);
+}
+
+//---------------------------------------------------------------------------
+// blends the rest of the pass, false if it was not complete
+bool TMosaic::endPass(void)
+{
+ bool rc = false;
+
+    if(rp == NULL)
+        return false;
+
+    if(band_first + band_rows == pass.geo->height())
+        rc = blendBand(true);
+    else
+        qDebug("Mosaic: %d of %d lines of the pass", band_first + band_rows, pass.geo->height());
+
+    delete rp;
+    rp = NULL;
+    band = QImage();
+
+    if(rc)
+        num_passes++;
+
+ return rc;
+}
+
+//---------------------------------------------------------------------------
+// blends the mesh cells which have all their lines in the band and keeps
+// the lines of the next cells
+bool TMosaic::blendBand(bool last)
+{
+ QHash<int, QVector<int> > buckets;
+ QHash<int, QVector<int> >::const_iterator it;
+ QThreadPool pool;
+ QImage      rows;
+ int         last_line, keep, tx, ty;
+
+    // a cell needs the lines to its end and the margin of the kernel
+    last_line = last ? -1:band_first + band_rows - RP_MESH_STEP - 3;
+
+    rows = band.copy(0, 0, band.width(), band_rows);
+    if(!rp->setRows(&rows, band_first) ||
+       !rp->tileCells(grid, MS_TILE_SIZE, &buckets, next_line, last_line)) {
+        qDebug("Mosaic: the pass does not match its geolocation");
+        return false;
+    }
+
+    // the tiles are allocated before the jobs start, a job only touches its own tile
+    for(it=buckets.constBegin(); it!=buckets.constEnd(); ++it)
+        if(tile(it.key()) == NULL) {
+            qDebug("Mosaic: out of memory");
+            return false;
+        }
+
+    for(it=buckets.constBegin(); it!=buckets.constEnd(); ++it) {
+        tx = it.key() % tiles_x;
+        ty = it.key() / tiles_x;
+
+        pool.start(new TMosaicTileJob(rp, grid, it.value(), tx * MS_TILE_SIZE, ty * MS_TILE_SIZE,
+                                      tiles.value(it.key()), &pass));
+    }
+
+    pool.waitForDone();
+
+    if(last)
+        return true;
+
+    next_line = last_line + 1;
+    keep = (next_line + RP_MESH_STEP - 1) / RP_MESH_STEP * RP_MESH_STEP - 2;
+    keep = qMax(keep, band_first);
+
+    memmove(band.bits(), band.scanLine(keep - band_first),
+            (band_first + band_rows - keep) * band.bytesPerLine());
+
+    band_rows -= keep - band_first;
+    band_first = keep;
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// <image>.mosaic next to the image
+QString TMosaic::stateFile(const QString &imagefile)
+{
+    QFileInfo fi(imagefile);
+
+ return fi.absolutePath() + "/" + fi.completeBaseName() + ".mosaic";
+}
+
+//---------------------------------------------------------------------------
+// the tiles and their scores, written to a temporary file and renamed
+bool TMosaic::saveState(const QString &filename) const
+{
+ QHash<int, TMosaicTile *>::const_iterator it;
+ TMosaicStateHeader hdr;
+ QString tmpfile = filename + ".tmp";
+ qint64  rgb_size, score_size;
+ qint32  key;
+ bool    rc;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = MS_STATE_MAGIC;
+    hdr.version = MS_STATE_VERSION;
+    hdr.projection = grid.proj.getType();
+    hdr.rule = rule;
+    hdr.lon0 = grid.proj.centralMeridian();
+    hdr.x0 = grid.x0;
+    hdr.y0 = grid.y0;
+    hdr.res = grid.res;
+    hdr.width = grid.width;
+    hdr.height = grid.height;
+    hdr.tile_size = MS_TILE_SIZE;
+    hdr.passes = num_passes;
+    hdr.epoch = epoch;
+    hdr.tiles = tiles.size();
+
+    rgb_size = MS_TILE_SIZE * MS_TILE_SIZE * 3;
+    score_size = MS_TILE_SIZE * MS_TILE_SIZE * sizeof(float);
+
+    QFile file(tmpfile);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    rc = file.write((const char *) &hdr, sizeof(hdr)) == (qint64) sizeof(hdr);
+
+    for(it=tiles.constBegin(); it!=tiles.constEnd() && rc; ++it) {
+        key = it.key();
+        rc = file.write((const char *) &key, sizeof(key)) == (qint64) sizeof(key) &&
+             file.write((const char *) it.value()->rgb, rgb_size) == rgb_size &&
+             file.write((const char *) it.value()->score, score_size) == score_size;
+    }
+
+    file.close();
+
+    if(!rc) {
+        qDebug("Mosaic: failed to write %s", tmpfile.toStdString().c_str());
+        QFile::remove(tmpfile);
+
+        return false;
+    }
+
+    QFile::remove(filename);
+
+ return QFile::rename(tmpfile, filename);
+}
+
+//---------------------------------------------------------------------------
+// false if there is no state file or it is of another grid or rule
+bool TMosaic::loadState(const QString &filename)
+{
+ TMosaicStateHeader hdr;
+ TMosaicTile *t;
+ qint64  rgb_size, score_size;
+ qint32  key;
+ quint32 i;
+ int     tiles_y;
+
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    if(file.read((char *) &hdr, sizeof(hdr)) != (qint64) sizeof(hdr) ||
+       hdr.magic != MS_STATE_MAGIC || hdr.version != MS_STATE_VERSION)
+        return false;
+
+    if(hdr.projection != grid.proj.getType() || hdr.rule != rule ||
+       hdr.lon0 != grid.proj.centralMeridian() || hdr.x0 != grid.x0 || hdr.y0 != grid.y0 ||
+       hdr.res != grid.res || hdr.width != grid.width || hdr.height != grid.height ||
+       hdr.tile_size != MS_TILE_SIZE)
+        return false;
+
+    clear();
+
+    rgb_size = MS_TILE_SIZE * MS_TILE_SIZE * 3;
+    score_size = MS_TILE_SIZE * MS_TILE_SIZE * sizeof(float);
+    tiles_y = (grid.height + MS_TILE_SIZE - 1) / MS_TILE_SIZE;
+
+    for(i=0; i<hdr.tiles; i++) {
+        if(file.read((char *) &key, sizeof(key)) != (qint64) sizeof(key) ||
+           key < 0 || key >= tiles_x * tiles_y || tiles.contains(key) || (t = tile(key)) == NULL ||
+           file.read((char *) t->rgb, rgb_size) != rgb_size ||
+           file.read((char *) t->score, score_size) != score_size) {
+            qDebug("Mosaic: %s is corrupt", filename.toStdString().c_str());
+            clear();
+
+            return false;
+        }
+    }
+
+    num_passes = hdr.passes;
+    epoch = hdr.epoch;
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// 16 bit image of the whole grid and a world file, pixels without a pass are black
+bool TMosaic::save(const QString &filename) const
+{
+ const TMosaicTile *t;
+ TImageWriter *writer;
+ const uchar  *src;
+ quint16      *row;
+ int          x, y, tx, col0, w;
+ bool         rc;
+
+    writer = TImageWriter::create(filename);
+    if(writer == NULL)
+        return false;
+
+    row = (quint16 *) malloc(grid.width * 3 * sizeof(quint16));
+
+    rc = row != NULL && writer->setSampleFormat(IW_UINT16) && writer->start(grid.width, grid.height, 3);
+
+    for(y=0; y<grid.height && rc; y++) {
+        memset(row, 0, grid.width * 3 * sizeof(quint16));
+
+        for(tx=0; tx<tiles_x; tx++) {
+            t = tiles.value((y / MS_TILE_SIZE) * tiles_x + tx, NULL);
+            if(t == NULL)
+                continue;
+
+            col0 = tx * MS_TILE_SIZE;
+            w = qMin(MS_TILE_SIZE, grid.width - col0);
+            src = t->rgb + (y % MS_TILE_SIZE) * MS_TILE_SIZE * 3;
+
+            for(x=0; x<w*3; x++)
+                row[col0 * 3 + x] = src[x] * 257;
+        }
+
+        rc = writer->writeRow(row);
+    }
+
+    if(rc)
+        rc = writer->finish();
+
+    delete writer;
+
+    if(row)
+        free(row);
+
+    if(rc)
+        TReprojector::writeWorldFile(filename, grid, 0, 0);
+    else
+        qDebug("Mosaic: failed to write %s", filename.toStdString().c_str());
+
+ return rc;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TMosaicConf::TMosaicConf(void)
+{
+    enabled = false;
+    projection = Equirectangular_Projection;
+    lat_min = 50.0;
+    lat_max = 75.0;
+    lon_min = -10.0;
+    lon_max = 40.0;
+    resolution = RP_RESOLUTION;
+    rule = Nadir_Rule;
+    cloud_channel = 0;
+    cloud_threshold = 200;
+}
+
+//---------------------------------------------------------------------------
+void TMosaicConf::readSettings(QSettings *reg)
+{
+    reg->beginGroup("Mosaic");
+
+      enabled         = reg->value("Enabled", false).toBool();
+      product         = reg->value("Product", "").toString();
+      path            = reg->value("Path", "").toString();
+      projection      = reg->value("Projection", Equirectangular_Projection).toInt();
+      lat_min         = reg->value("LatMin", 50.0).toDouble();
+      lat_max         = reg->value("LatMax", 75.0).toDouble();
+      lon_min         = reg->value("LonMin", -10.0).toDouble();
+      lon_max         = reg->value("LonMax", 40.0).toDouble();
+      resolution      = reg->value("Resolution", RP_RESOLUTION).toDouble();   // metres
+      rule            = reg->value("Rule", Nadir_Rule).toInt();
+      cloud_channel   = reg->value("CloudChannel", 0).toInt();                // 0..2, red green blue
+      cloud_threshold = reg->value("CloudThreshold", 200).toInt();            // 8 bit
+
+    reg->endGroup();
+
+    if(rule < 0 || rule >= NUM_MOSAIC_RULES)
+        rule = Nadir_Rule;
+}
+
+//---------------------------------------------------------------------------
+void TMosaicConf::writeSettings(QSettings *reg)
+{
+    reg->beginGroup("Mosaic");
+
+      reg->setValue("Enabled",        enabled);
+      reg->setValue("Product",        product);
+      reg->setValue("Path",           path);
+      reg->setValue("Projection",     projection);
+      reg->setValue("LatMin",         lat_min);
+      reg->setValue("LatMax",         lat_max);
+      reg->setValue("LonMin",         lon_min);
+      reg->setValue("LonMax",         lon_max);
+      reg->setValue("Resolution",     resolution);
+      reg->setValue("Rule",           rule);
+      reg->setValue("CloudChannel",   cloud_channel);
+      reg->setValue("CloudThreshold", cloud_threshold);
+
+    reg->endGroup();
+}
+
+//---------------------------------------------------------------------------
+// the grid covering the region, centered on its middle meridian
+// lon_max < lon_min is a region across the date line
+bool TMosaicConf::grid(TGrid *grid_) const
+{
+ double lon1, lon0, lat, lon, x, y, minx, maxx, miny, maxy;
+ int    i, j;
+ bool   found = false;
+
+    lon1 = lon_max < lon_min ? lon_max + 360.0:lon_max;
+
+    if(projection < 0 || projection >= NUM_PROJECTIONS || resolution <= 0 ||
+       lat_max <= lat_min || lon1 <= lon_min)
+        return false;
+
+    lon0 = (lon_min + lon1) / 2.0;
+    if(lon0 > 180.0)
+        lon0 -= 360.0;
+
+    TProjection proj((Projection_Type) projection, lon0);
+
+    minx = maxx = miny = maxy = 0;
+
+    // the edges are curved in the polar projections, a lattice covers the pole too
+    for(j=0; j<=32; j++)
+        for(i=0; i<=32; i++) {
+            lat = lat_min + (lat_max - lat_min) * j / 32.0;
+            lon = lon_min + (lon1 - lon_min) * i / 32.0;
+
+            if(!proj.forward(lat, lon, &x, &y))
+                continue;
+
+            if(!found) {
+                minx = maxx = x;
+                miny = maxy = y;
+                found = true;
+            }
+
+            minx = x < minx ? x:minx;
+            maxx = x > maxx ? x:maxx;
+            miny = y < miny ? y:miny;
+            maxy = y > maxy ? y:maxy;
+        }
+
+    if(!found)
+        return false;
+
+    grid_->proj = proj;
+    grid_->res = resolution / proj.metresPerUnit();
+    grid_->x0 = floor(minx / grid_->res) * grid_->res;
+    grid_->y0 = ceil(maxy / grid_->res) * grid_->res;
+    grid_->width = (int) ceil((maxx - grid_->x0) / grid_->res);
+    grid_->height = (int) ceil((grid_->y0 - miny) / grid_->res);
+
+ return grid_->width > 0 && grid_->height > 0 && grid_->width <= 65536 && grid_->height <= 65536;
+}
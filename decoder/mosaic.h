@@ -0,0 +1,172 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef MOSAIC_H
+#define MOSAIC_H
+
+#include <QString>
+#include <QHash>
+#include <QImage>
+
+#include "projection.h"
+
+#define MS_TILE_SIZE        256     // accumulator tiles, allocated when a pass covers them
+#define MS_EMPTY_SCORE      -1.0e30f
+#define MS_CLOUD_PENALTY    100.0f  // more than any scan angle
+#define MS_BAND_LINES       256     // scan lines of a pass blended at a time
+#define MS_STATE_MAGIC      0x4c54534d  // "MSTL"
+#define MS_STATE_VERSION    1
+
+class QSettings;
+class TGeoLocation;
+class TReprojector;
+
+//---------------------------------------------------------------------------
+// which pass wins a map pixel, the pass with the highest score
+typedef enum Mosaic_Rule_t
+{
+    SunElevation_Rule = 0,  // highest sun
+    Nadir_Rule,             // smallest scan angle
+    Recent_Rule,            // latest scan line
+    CloudFree_Rule          // below the cloud threshold, then the smallest scan angle
+} Mosaic_Rule;
+
+#define NUM_MOSAIC_RULES (CloudFree_Rule + 1)
+
+//---------------------------------------------------------------------------
+// one accumulator tile, 8 bit RGB and the score of the pass it came from
+typedef struct
+{
+    uchar *rgb;
+    float *score;
+} TMosaicTile;
+
+//---------------------------------------------------------------------------
+// header of the state file, followed by the tiles as a qint32 key,
+// the RGB and the scores
+typedef struct
+{
+    quint32 magic;
+    quint32 version;
+    qint32  projection, rule;
+    double  lon0, x0, y0, res;
+    qint32  width, height, tile_size, passes;
+    double  epoch;
+    quint32 tiles;
+    quint32 reserved;
+} TMosaicStateHeader;
+
+//---------------------------------------------------------------------------
+// context of a pass while it is blended, read only in the tile jobs
+typedef struct
+{
+    const TGeoLocation *geo;
+    Mosaic_Rule rule;
+    int    cloud_channel, cloud_threshold;
+    double mid_time, epoch;             // daynum of the middle scan line and of the first pass
+    double sun_lat, sun_lon;            // subsolar point at mid_time, degrees
+} TMosaicPass;
+
+//---------------------------------------------------------------------------
+/*
+  Blends geolocated passes to one image on a common map grid.
+  Every pass is resampled with the inverse mapping tables of TReprojector
+  tile by tile on a thread pool, a map pixel keeps the sample of the pass
+  with the best score of the rule. A tile is blended by one job at a time
+  so no locking is needed.
+  Only the tiles covered by a pass are allocated and the result is
+  streamed to a 16 bit image by TImageWriter, row by row.
+  A pass is fed scan line by scan line as it is decoded and blended every
+  MS_BAND_LINES lines, so only a band of the pass is in memory.
+  The tiles and their scores are saved to a state file next to the image,
+  the mosaic of a day continues from it after a restart.
+*/
+class TMosaic
+{
+public:
+    TMosaic(const TGrid &grid_, Mosaic_Rule rule_ = Nadir_Rule);
+    ~TMosaic(void);
+
+    static QString getRuleStr(int rule_);
+
+    // channel is the red, green or blue plane (0..2) of the pass images, clouds are bright
+    void setCloudThreshold(int channel, int value);
+
+    const TGrid &getGrid(void) const { return grid; }
+    Mosaic_Rule  getRule(void) const { return rule; }
+    int          passes(void) const { return num_passes; }
+
+    // rgb is a RGB888 scan line of the pass as displayed, lines in order
+    bool beginPass(const TGeoLocation *geo);
+    bool addRow(int y, const uchar *rgb);
+    bool endPass(void);
+
+    bool save(const QString &filename) const;
+    bool saveState(const QString &filename) const;
+    bool loadState(const QString &filename);
+    void clear(void);
+
+    static QString stateFile(const QString &imagefile);
+
+    static void subSolarPoint(double daynum, double *lat, double *lon);
+
+protected:
+    TMosaicTile *tile(int key);
+    bool blendBand(bool last);
+
+private:
+    QHash<int, TMosaicTile *> tiles;
+    TGrid       grid;
+    Mosaic_Rule rule;
+    int         cloud_channel, cloud_threshold;
+    int         tiles_x, num_passes;
+    double      epoch;
+
+    // the pass being blended
+    TReprojector *rp;
+    TMosaicPass pass;
+    QImage      band;           // scan lines band_first...
+    int         band_first, band_rows, next_line;
+};
+
+//---------------------------------------------------------------------------
+// conf/mosaic.ini, the daily composite of the pass decoder
+class TMosaicConf
+{
+public:
+    TMosaicConf(void);
+
+    void readSettings(QSettings *reg);
+    void writeSettings(QSettings *reg);
+
+    bool grid(TGrid *grid_) const;
+
+    bool        enabled;
+    QString     product;        // name of the RGB or NDVI product to blend
+    QString     path;           // empty, next to the frames file
+    int         projection;
+    double      lat_min, lat_max, lon_min, lon_max;
+    double      resolution;     // metres
+    int         rule;
+    int         cloud_channel, cloud_threshold;
+};
+
+#endif // MOSAIC_H
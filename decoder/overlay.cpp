@@ -0,0 +1,594 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <QCoreApplication>
+#include <QImage>
+#include <QPainter>
+#include <QPolygonF>
+#include <QFile>
+#include <QSettings>
+#include <QTime>
+#include <QtEndian>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "overlay.h"
+#include "geolocation.h"
+#include "config.h"
+
+// shapefile shape types with lines, plain, Z and M
+#define SHP_FILE_CODE   9994
+#define SHP_HEADER_SIZE 100
+
+//---------------------------------------------------------------------------
+static inline double le_double(const uchar *p)
+{
+ quint64 v = qFromLittleEndian<quint64>(p);
+ double  d;
+
+    memcpy(&d, &v, sizeof(double));
+
+ return d;
+}
+
+//---------------------------------------------------------------------------
+static inline bool isLineShape(int type)
+{
+    switch(type) {
+    case 3: case 5:     // polyline, polygon
+    case 13: case 15:   // Z
+    case 23: case 25:   // M
+        return true;
+    default:
+        return false;
+    }
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TSwathLocator::TSwathLocator(const TGeoLocation *geo)
+{
+ double lat, lon, px[4], py[4], minx, maxx, miny, maxy;
+ int    i, j, x, y, n, c[4], cell, cells, bx, by;
+ bool   valid;
+
+    mesh_x = mesh_y = NULL;
+    mesh_cols = mesh_rows = 0;
+    last_cell = -1;
+
+    width = geo ? geo->width():0;
+    height = geo ? geo->height():0;
+
+    if(geo == NULL || !geo->isValid() || width < 2 || height < 2)
+        return;
+
+    // the hemisphere of the pass, valid to 30 degrees across the equator
+    if(!geo->latLon(width / 2, height / 2, &lat, &lon))
+        return;
+
+    proj = TProjection(lat >= 0 ? PolarNorth_Projection:PolarSouth_Projection, 0);
+
+    mesh_cols = (width - 2) / OV_MESH_STEP + 2;
+    mesh_rows = (height - 2) / OV_MESH_STEP + 2;
+
+    mesh_x = (double *) malloc(mesh_cols * mesh_rows * sizeof(double));
+    mesh_y = (double *) malloc(mesh_cols * mesh_rows * sizeof(double));
+    if(mesh_x == NULL || mesh_y == NULL) {
+        if(mesh_x)
+            free(mesh_x);
+        if(mesh_y)
+            free(mesh_y);
+        mesh_x = mesh_y = NULL;
+
+        return;
+    }
+
+    for(j=0; j<mesh_rows; j++) {
+        y = qMin(j * OV_MESH_STEP, height - 1);
+
+        for(i=0; i<mesh_cols; i++) {
+            x = qMin(i * OV_MESH_STEP, width - 1);
+            n = j * mesh_cols + i;
+
+            if(!geo->latLon(x, y, &lat, &lon) || !proj.forward(lat, lon, &mesh_x[n], &mesh_y[n]))
+                mesh_x[n] = mesh_y[n] = NAN;
+        }
+    }
+
+    // cells by the buckets their bounding box overlaps
+    cells = (mesh_cols - 1) * (mesh_rows - 1);
+    for(cell=0; cell<cells; cell++) {
+        i = cell % (mesh_cols - 1);
+        j = cell / (mesh_cols - 1);
+
+        c[0] = j * mesh_cols + i;
+        c[1] = c[0] + 1;
+        c[2] = c[1] + mesh_cols;
+        c[3] = c[0] + mesh_cols;
+
+        valid = true;
+        for(n=0; n<4 && valid; n++) {
+            px[n] = mesh_x[c[n]];
+            py[n] = mesh_y[c[n]];
+            valid = !isnan(px[n]);
+        }
+
+        if(!valid)
+            continue;
+
+        minx = qMin(qMin(px[0], px[1]), qMin(px[2], px[3]));
+        maxx = qMax(qMax(px[0], px[1]), qMax(px[2], px[3]));
+        miny = qMin(qMin(py[0], py[1]), qMin(py[2], py[3]));
+        maxy = qMax(qMax(py[0], py[1]), qMax(py[2], py[3]));
+
+        for(by=(int) floor(miny / OV_BUCKET_SIZE); by<=(int) floor(maxy / OV_BUCKET_SIZE); by++)
+            for(bx=(int) floor(minx / OV_BUCKET_SIZE); bx<=(int) floor(maxx / OV_BUCKET_SIZE); bx++)
+                buckets[(by + 2048) * 4096 + bx + 2048].append(cell);
+    }
+}
+
+//---------------------------------------------------------------------------
+TSwathLocator::~TSwathLocator(void)
+{
+    if(mesh_x)
+        free(mesh_x);
+    if(mesh_y)
+        free(mesh_y);
+}
+
+//---------------------------------------------------------------------------
+int TSwathLocator::bucketKey(double px, double py) const
+{
+    return ((int) floor(py / OV_BUCKET_SIZE) + 2048) * 4096 + (int) floor(px / OV_BUCKET_SIZE) + 2048;
+}
+
+//---------------------------------------------------------------------------
+bool TSwathLocator::cellLocate(int cell, double px, double py, double *x, double *y) const
+{
+ double qx[4], qy[4], u, v, x0, x1, y0, y1;
+ int    i, j, n;
+
+    i = cell % (mesh_cols - 1);
+    j = cell / (mesh_cols - 1);
+    n = j * mesh_cols + i;
+
+    qx[0] = mesh_x[n];                  qy[0] = mesh_y[n];
+    qx[1] = mesh_x[n + 1];              qy[1] = mesh_y[n + 1];
+    qx[2] = mesh_x[n + mesh_cols + 1];  qy[2] = mesh_y[n + mesh_cols + 1];
+    qx[3] = mesh_x[n + mesh_cols];      qy[3] = mesh_y[n + mesh_cols];
+
+    if(!inverse_bilinear(qx, qy, px, py, &u, &v))
+        return false;
+
+    x0 = qMin(i * OV_MESH_STEP, width - 1);
+    x1 = qMin((i + 1) * OV_MESH_STEP, width - 1);
+    y0 = qMin(j * OV_MESH_STEP, height - 1);
+    y1 = qMin((j + 1) * OV_MESH_STEP, height - 1);
+
+    *x = x0 + u * (x1 - x0);
+    *y = y0 + v * (y1 - y0);
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// x, y are image pixels, pixel centers at integer positions
+bool TSwathLocator::locate(double lat, double lon, double *x, double *y) const
+{
+ QHash<int, QVector<int> >::const_iterator it;
+ double px, py;
+ int    i;
+
+    if(!isValid() || !proj.forward(lat, lon, &px, &py))
+        return false;
+
+    if(last_cell >= 0 && cellLocate(last_cell, px, py, x, y))
+        return true;
+
+    it = buckets.constFind(bucketKey(px, py));
+    if(it == buckets.constEnd())
+        return false;
+
+    for(i=0; i<it.value().size(); i++)
+        if(cellLocate(it.value().at(i), px, py, x, y)) {
+            last_cell = it.value().at(i);
+            return true;
+        }
+
+ return false;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TMapOverlay::TMapOverlay(void)
+{
+    QString path = QCoreApplication::applicationDirPath() + "/" + PATH_MAPS + "/";
+
+    files[Coastline_Layer] = path + "GSHHS_i_L1.shp";
+    files[Border_Layer] = path + "WDBII_border_i_L1.shp";
+
+    colors[Coastline_Layer] = QColor(255, 255, 0);
+    colors[Border_Layer] = QColor(255, 128, 0);
+    colors[Graticule_Layer] = QColor(160, 160, 160);
+
+    graticule = 10.0;
+    enabled = false;
+    loaded = false;
+}
+
+//---------------------------------------------------------------------------
+TMapOverlay::~TMapOverlay(void)
+{
+}
+
+//---------------------------------------------------------------------------
+void TMapOverlay::readSettings(QSettings *reg)
+{
+ QString str;
+ int     i;
+
+    reg->beginGroup("MapOverlay");
+
+      enabled   = reg->value("Enabled", false).toBool();
+      graticule = reg->value("Graticule", 10.0).toDouble();   // degrees, 0 is off
+
+      str = reg->value("Coastlines", files[Coastline_Layer]).toString();
+      if(str != files[Coastline_Layer])
+          loaded = false;
+      files[Coastline_Layer] = str;
+
+      str = reg->value("Borders", files[Border_Layer]).toString();
+      if(str != files[Border_Layer])
+          loaded = false;
+      files[Border_Layer] = str;
+
+      for(i=0; i<NUM_OVERLAY_LAYERS; i++)
+          colors[i] = QColor(reg->value(QString("Color_%1").arg(i), colors[i].name()).toString());
+
+    reg->endGroup();
+}
+
+//---------------------------------------------------------------------------
+void TMapOverlay::writeSettings(QSettings *reg)
+{
+ int i;
+
+    reg->beginGroup("MapOverlay");
+
+      reg->setValue("Enabled",    enabled);
+      reg->setValue("Graticule",  graticule);
+      reg->setValue("Coastlines", files[Coastline_Layer]);
+      reg->setValue("Borders",    files[Border_Layer]);
+
+      for(i=0; i<NUM_OVERLAY_LAYERS; i++)
+          reg->setValue(QString("Color_%1").arg(i), colors[i].name());
+
+    reg->endGroup();
+}
+
+//---------------------------------------------------------------------------
+void TMapOverlay::clear(void)
+{
+    coords.clear();
+    pieces.clear();
+    index.clear();
+
+    loaded = false;
+}
+
+//---------------------------------------------------------------------------
+// the shapefiles of the settings, once, missing files are skipped
+bool TMapOverlay::load(void)
+{
+ QTime t;
+ int   i;
+
+    if(loaded)
+        return pieces.size() > 0;
+
+    clear();
+    t.start();
+
+    for(i=0; i<Graticule_Layer; i++)
+        if(!files[i].isEmpty() && QFile::exists(files[i]))
+            loadShapefile(files[i], i);
+
+    loaded = true;
+
+    qDebug("Overlay: %d points, %d pieces in %d cells, %d ms",
+           points(), pieces.size(), index.size(), t.elapsed());
+
+ return pieces.size() > 0;
+}
+
+//---------------------------------------------------------------------------
+int TMapOverlay::cellKey(double lat, double lon)
+{
+ int row, col;
+
+    col = (int) floor((lon + 180.0) / OV_INDEX_CELL);
+    row = (int) floor((lat + 90.0) / OV_INDEX_CELL);
+
+    col = col < 0 ? col + OV_INDEX_COLS:(col >= OV_INDEX_COLS ? col - OV_INDEX_COLS:col);
+    row = row < 0 ? 0:(row >= OV_INDEX_ROWS ? OV_INDEX_ROWS - 1:row);
+
+ return row * OV_INDEX_COLS + col;
+}
+
+//---------------------------------------------------------------------------
+// ESRI shapefile of polylines or polygons in geographic coordinates
+bool TMapOverlay::loadShapefile(const QString &filename, int layer)
+{
+ QFile file(filename);
+ const uchar *data, *rec, *content, *end, *xy;
+ qint64 size;
+ int    len, parts, count, first, last, p;
+
+    if(!file.open(QIODevice::ReadOnly)) {
+        qDebug("Overlay: failed to open %s", filename.toStdString().c_str());
+        return false;
+    }
+
+    size = file.size();
+    data = size > SHP_HEADER_SIZE ? file.map(0, size):NULL;
+
+    if(data == NULL || qFromBigEndian<qint32>(data) != SHP_FILE_CODE) {
+        qDebug("Overlay: %s is not a shapefile", filename.toStdString().c_str());
+        return false;
+    }
+
+    end = data + size;
+    rec = data + SHP_HEADER_SIZE;
+
+    // record number and content length in 16 bit words, big endian, the content is little endian
+    while(rec + 8 <= end) {
+        len = qFromBigEndian<qint32>(rec + 4) * 2;
+        content = rec + 8;
+
+        if(len < 4 || len > end - content)
+            break;
+
+        if(isLineShape(qFromLittleEndian<qint32>(content)) && len >= 44) {
+            parts = qFromLittleEndian<qint32>(content + 36);
+            count = qFromLittleEndian<qint32>(content + 40);
+
+            if(parts > 0 && count > 0 && 44 + (qint64) parts * 4 + (qint64) count * 16 <= len) {
+                xy = content + 44 + parts * 4;
+
+                for(p=0; p<parts; p++) {
+                    first = qFromLittleEndian<qint32>(content + 44 + p * 4);
+                    last = p + 1 < parts ? qFromLittleEndian<qint32>(content + 48 + p * 4):count;
+
+                    if(first >= 0 && last <= count && last - first > 1)
+                        addLine(xy + first * 16, last - first, layer);
+                }
+            }
+        }
+
+        rec = content + len;
+    }
+
+    file.unmap((uchar *) data);
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// xy is count x, y doubles (longitude, latitude)
+void TMapOverlay::addLine(const uchar *xy, int count, int layer)
+{
+ TOverlayPiece piece;
+ QVector<int>  keys;
+ double        lon;
+ int           start, i, k, key;
+
+    start = coords.size() / 2;
+
+    for(i=0; i<count; i++) {
+        lon = le_double(xy + i * 16);
+        if(lon >= 180.0)
+            lon -= 360.0;
+
+        coords.append((float) le_double(xy + i * 16 + 8));
+        coords.append((float) lon);
+    }
+
+    piece.layer = layer;
+
+    for(k=0; k<count - 1; k+=OV_PIECE_POINTS - 1) {
+        piece.first = start + k;
+        piece.count = qMin(OV_PIECE_POINTS, count - k);
+
+        // the cells of the points of the piece
+        keys.clear();
+        for(i=piece.first; i<piece.first + piece.count; i++) {
+            key = cellKey(coords.at(i * 2), coords.at(i * 2 + 1));
+            if(!keys.contains(key))
+                keys.append(key);
+        }
+
+        for(i=0; i<keys.size(); i++)
+            index[keys.at(i)].append(pieces.size());
+
+        pieces.append(piece);
+    }
+}
+
+//---------------------------------------------------------------------------
+// index cells of the swath and their neighbours, the latitude range of the swath
+void TMapOverlay::footprint(const TGeoLocation *geo, QSet<int> *cells, double *lat_min, double *lat_max) const
+{
+ double lat, lon;
+ int    x, y, dx, dy, key, row, col;
+ bool   first = true;
+
+    cells->clear();
+    *lat_min = *lat_max = 0;
+
+    for(y=0; y<geo->height(); y+=GEO_TIE_SAMPLES)
+        for(x=0; x<geo->width(); x+=GEO_TIE_SAMPLES) {
+            if(!geo->latLon(x, y, &lat, &lon))
+                continue;
+
+            if(first) {
+                *lat_min = *lat_max = lat;
+                first = false;
+            }
+
+            *lat_min = qMin(*lat_min, lat);
+            *lat_max = qMax(*lat_max, lat);
+
+            key = cellKey(lat, lon);
+            if(cells->contains(key))
+                continue;
+
+            row = key / OV_INDEX_COLS;
+            col = key % OV_INDEX_COLS;
+
+            for(dy=-1; dy<=1; dy++)
+                for(dx=-1; dx<=1; dx++)
+                    if(row + dy >= 0 && row + dy < OV_INDEX_ROWS)
+                        cells->insert((row + dy) * OV_INDEX_COLS + (col + dx + OV_INDEX_COLS) % OV_INDEX_COLS);
+        }
+}
+
+//---------------------------------------------------------------------------
+void TMapOverlay::flush(QPainter *painter, QPolygonF *line) const
+{
+    if(line->size() > 1)
+        painter->drawPolyline(*line);
+
+    line->clear();
+}
+
+//---------------------------------------------------------------------------
+// appends a point to the line, the line is drawn where it leaves the swath
+void TMapOverlay::addPoint(QPainter *painter, QPolygonF *line, const TSwathLocator &loc,
+                           const QSet<int> *cells, double lat, double lon) const
+{
+ QPointF pt;
+ double  x, y;
+
+    if((cells && !cells->contains(cellKey(lat, lon))) || !loc.locate(lat, lon, &x, &y)) {
+        flush(painter, line);
+        return;
+    }
+
+    // pixel centers are at .5 in the painter
+    pt = QPointF(x + 0.5, y + 0.5);
+
+    if(!line->isEmpty()) {
+        x = pt.x() - line->last().x();
+        y = pt.y() - line->last().y();
+
+        if(x*x + y*y > OV_MAX_JUMP * OV_MAX_JUMP)
+            flush(painter, line);
+    }
+
+    line->append(pt);
+}
+
+//---------------------------------------------------------------------------
+// image is the pass as displayed, the same size as the geolocation
+bool TMapOverlay::render(QImage *image, const TGeoLocation *geo)
+{
+ QSet<int>  cells, visible;
+ QSet<int>::const_iterator it;
+ QHash<int, QVector<int> >::const_iterator ci;
+ QPolygonF  line;
+ QTime      t;
+ double     lat_min, lat_max, lat, lon;
+ int        i, k, layer, drawn = 0;
+
+    if(!enabled || image == NULL || image->isNull() || geo == NULL || !geo->isValid() ||
+       image->width() != geo->width() || image->height() != geo->height())
+        return false;
+
+    t.start();
+
+    load();
+
+    TSwathLocator loc(geo);
+    if(!loc.isValid())
+        return false;
+
+    footprint(geo, &cells, &lat_min, &lat_max);
+
+    // the pieces of the footprint, a piece may be in several cells
+    for(it=cells.constBegin(); it!=cells.constEnd(); ++it) {
+        ci = index.constFind(*it);
+        if(ci == index.constEnd())
+            continue;
+
+        for(i=0; i<ci.value().size(); i++)
+            visible.insert(ci.value().at(i));
+    }
+
+    if(image->format() == QImage::Format_Indexed8 || image->format() == QImage::Format_Mono ||
+       image->format() == QImage::Format_MonoLSB)
+        *image = image->convertToFormat(QImage::Format_RGB32);
+
+    QPainter painter(image);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    // graticule below the lines, its points outside the footprint are not located
+    if(graticule > 0) {
+        painter.setPen(QPen(colors[Graticule_Layer], 1));
+
+        for(lon=-180.0; lon<180.0; lon+=graticule) {
+            for(lat=floor(lat_min); lat<=ceil(lat_max); lat+=OV_GRATICULE_RES)
+                addPoint(&painter, &line, loc, &cells, lat, lon);
+
+            flush(&painter, &line);
+        }
+
+        for(lat=ceil(lat_min / graticule) * graticule; lat<=lat_max; lat+=graticule) {
+            for(lon=-180.0; lon<=180.0; lon+=OV_GRATICULE_RES)
+                addPoint(&painter, &line, loc, &cells, lat, lon);
+
+            flush(&painter, &line);
+        }
+    }
+
+    for(layer=Graticule_Layer - 1; layer>=0; layer--) {
+        painter.setPen(QPen(colors[layer], 1));
+
+        for(it=visible.constBegin(); it!=visible.constEnd(); ++it) {
+            const TOverlayPiece &piece = pieces.at(*it);
+
+            if(piece.layer != layer)
+                continue;
+
+            for(k=piece.first; k<piece.first + piece.count; k++)
+                addPoint(&painter, &line, loc, NULL, coords.at(k * 2), coords.at(k * 2 + 1));
+
+            flush(&painter, &line);
+            drawn++;
+        }
+    }
+
+    painter.end();
+
+    qDebug("Overlay: %d of %d pieces in %d cells, %d ms", drawn, pieces.size(), cells.size(), t.elapsed());
+
+ return true;
+}
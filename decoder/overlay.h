@@ -0,0 +1,140 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QColor>
+
+#include "projection.h"
+
+#define OV_INDEX_CELL       5.0         // degrees, cells of the spatial index
+#define OV_INDEX_COLS       72
+#define OV_INDEX_ROWS       36
+#define OV_PIECE_POINTS     64          // points of an indexed piece of a line
+#define OV_MESH_STEP        16          // swath pixels between the locator mesh points
+#define OV_BUCKET_SIZE      100000.0    // metres, locator buckets
+#define OV_MAX_JUMP         100.0       // pixels, longer segments leave the swath
+#define OV_GRATICULE_RES    0.25        // degrees between the points of a graticule line
+
+class QImage;
+class QPainter;
+class QPolygonF;
+class QSettings;
+class TGeoLocation;
+
+//---------------------------------------------------------------------------
+typedef enum Overlay_Layer_t
+{
+    Coastline_Layer = 0,
+    Border_Layer,
+    Graticule_Layer
+} Overlay_Layer;
+
+#define NUM_OVERLAY_LAYERS (Graticule_Layer + 1)
+
+//---------------------------------------------------------------------------
+// consecutive points of a line, the pieces of a line share their end points
+typedef struct
+{
+    int first, count, layer;
+} TOverlayPiece;
+
+//---------------------------------------------------------------------------
+/*
+  Latitude and longitude to image coordinates of a geolocated pass.
+  The geolocation is sampled every OV_MESH_STEP pixels and projected to
+  a polar stereographic plane, the mesh cells are bucketed on the plane
+  and a point is located by inverting the bilinear mapping of its cell.
+*/
+class TSwathLocator
+{
+public:
+    TSwathLocator(const TGeoLocation *geo);
+    ~TSwathLocator(void);
+
+    bool isValid(void) const { return mesh_x != NULL; }
+    bool locate(double lat, double lon, double *x, double *y) const;
+
+protected:
+    bool cellLocate(int cell, double px, double py, double *x, double *y) const;
+    int  bucketKey(double px, double py) const;
+
+private:
+    TProjection proj;
+    QHash<int, QVector<int> > buckets;
+    double      *mesh_x, *mesh_y;
+    int         width, height, mesh_cols, mesh_rows;
+    mutable int last_cell;  // consecutive points are usually in the same cell
+};
+
+//---------------------------------------------------------------------------
+/*
+  Coastlines, borders and a graticule drawn on a decoded image.
+  Lines are read from ESRI shapefiles (GSHHG), split to pieces of
+  OV_PIECE_POINTS points and indexed by OV_INDEX_CELL degree cells.
+  Only the pieces in the cells of the swath footprint are located and
+  drawn, the cost follows the visible geometry and not the dataset.
+*/
+class TMapOverlay
+{
+public:
+    TMapOverlay(void);
+    ~TMapOverlay(void);
+
+    void readSettings(QSettings *reg);
+    void writeSettings(QSettings *reg);
+
+    bool isEnabled(void) const { return enabled; }
+    void setEnabled(bool on) { enabled = on; }
+
+    bool load(void);
+    bool loadShapefile(const QString &filename, int layer);
+    void clear(void);
+    int  points(void) const { return coords.size() / 2; }
+
+    bool render(QImage *image, const TGeoLocation *geo);
+
+    static int cellKey(double lat, double lon);
+
+protected:
+    void addLine(const uchar *xy, int count, int layer);
+    void footprint(const TGeoLocation *geo, QSet<int> *cells, double *lat_min, double *lat_max) const;
+    void addPoint(QPainter *painter, QPolygonF *line, const TSwathLocator &loc,
+                  const QSet<int> *cells, double lat, double lon) const;
+    void flush(QPainter *painter, QPolygonF *line) const;
+
+private:
+    QVector<float>         coords;  // lat, lon
+    QVector<TOverlayPiece> pieces;
+    QHash<int, QVector<int> > index;
+
+    QString files[Graticule_Layer];
+    QColor  colors[NUM_OVERLAY_LAYERS];
+    double  graticule;              // degrees, 0 is off
+    bool    enabled, loaded;
+};
+
+#endif // OVERLAY_H
@@ -0,0 +1,555 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QFile>
+#include <QColor>
+#include <QTime>
+#include <QDateTime>
+#include <QImage>
+#include <QSettings>
+#include <QMutexLocker>
+#include <stdlib.h>
+#include <string.h>
+
+#include "passdecoder.h"
+#include "imagewriter.h"
+#include "geolocation.h"
+#include "mosaic.h"
+#include "config.h"
+#include "jobmanager.h"
+#include "Satellite.h"
+#include "satscript.h"
+#include "satprop.h"
+#include "rgbconf.h"
+#include "ndvi.h"
+#include "ndvilut.h"
+#include "plist.h"
+
+//---------------------------------------------------------------------------
+TPassProduct::TPassProduct(void)
+{
+    rgb = NULL;
+    ndvi = NULL;
+    lut = NULL;
+    writer = NULL;
+    ch[0] = ch[1] = ch[2] = 0;
+}
+
+//---------------------------------------------------------------------------
+TPassProduct::~TPassProduct(void)
+{
+    if(writer)
+        delete writer;
+
+    TNDVILUT::release(lut);
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TPassDecode::TPassDecode(void)
+{
+    northbound = false;
+    rx_job = 0;
+    props = new TSatProp;
+}
+
+//---------------------------------------------------------------------------
+TPassDecode::~TPassDecode(void)
+{
+    delete props;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TPassDecoder::TPassDecoder(TJobManager *jobs_, QObject *parent) :
+    QThread(parent)
+{
+    jobs = jobs_;
+    busy = false;
+    abort = false;
+}
+
+//---------------------------------------------------------------------------
+TPassDecoder::~TPassDecoder(void)
+{
+    stop();
+}
+
+//---------------------------------------------------------------------------
+// any thread, the frames file is complete when the rx job has exited
+bool TPassDecoder::add(TSat *sat, int rx_job)
+{
+    QMutexLocker locker(&mutex);
+    TPassDecode *pass;
+    QString frames;
+
+    frames = sat->sat_scripts->frames_filename();
+    if(frames.isEmpty()) {
+        qDebug("Decode: no frames file for %s", sat->name);
+        return false;
+    }
+
+    if(blockTypeFor(sat->name) == Undefined_BlockType) {
+        qDebug("Decode: unknown downlink format of %s", sat->name);
+        return false;
+    }
+
+    pass = new TPassDecode;
+    pass->satname = sat->name;
+    pass->frames = frames;
+    pass->northbound = sat->isNorthbound();
+    pass->rx_job = rx_job;
+    *pass->props = *sat->sat_props;
+
+    queue.append(pass);
+    abort = false;
+
+    if(!busy) {
+        // the last run has released the mutex and is about to return
+        wait();
+
+        busy = true;
+        start(QThread::LowPriority);
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void TPassDecoder::stop(void)
+{
+    mutex.lock();
+
+    abort = true;
+
+    while(!queue.isEmpty())
+        delete queue.takeFirst();
+
+    mutex.unlock();
+
+    wait();
+}
+
+//---------------------------------------------------------------------------
+int TPassDecoder::pending(void)
+{
+    QMutexLocker locker(&mutex);
+
+    return queue.count() + (busy ? 1:0);
+}
+
+//---------------------------------------------------------------------------
+// the frame format is not in the pass info, it follows from the satellite
+Block_Type TPassDecoder::blockTypeFor(const QString &satname)
+{
+    QString name = satname.toUpper();
+
+    if(name.startsWith("NOAA"))
+        return HRPT_BlockType;
+    if(name.startsWith("METOP"))
+        return AHRPT_BlockType;
+    if(name.startsWith("METEOR"))
+        return MN1HRPT_BlockType;
+    if(name.startsWith("FENGYUN 1") || name.startsWith("FENGYUN-1") || name.startsWith("FY-1"))
+        return FY1HRPT_BlockType;
+    if(name.startsWith("FENGYUN 3") || name.startsWith("FENGYUN-3") || name.startsWith("FY-3"))
+        return FYAHRPT_BlockType;
+
+    return Undefined_BlockType;
+}
+
+//---------------------------------------------------------------------------
+void TPassDecoder::run(void)
+{
+    TPassDecode *pass;
+
+    for(;;) {
+        mutex.lock();
+
+        if(abort || queue.isEmpty()) {
+            busy = false;
+            mutex.unlock();
+
+            break;
+        }
+
+        pass = queue.takeFirst();
+
+        mutex.unlock();
+
+        decode(pass);
+
+        delete pass;
+    }
+}
+
+//---------------------------------------------------------------------------
+bool TPassDecoder::waitForRX(int rx_job)
+{
+    int i;
+
+    if(rx_job <= 0 || jobs == NULL)
+        return true;
+
+    for(i=0; i<PD_WAIT_RX * 10 && !abort && jobs->isActive(rx_job); i++)
+        msleep(100);
+
+    return !jobs->isActive(rx_job);
+}
+
+//---------------------------------------------------------------------------
+static QString productFileName(const QString &base, const QString &name)
+{
+    QString str = name.trimmed().toLower();
+    int i;
+
+    for(i=0; i<str.length(); i++)
+        if(!str.at(i).isLetterOrNumber())
+            str[i] = '-';
+
+    return base + "-" + str + "." + PD_IMAGE_EXT;
+}
+
+//---------------------------------------------------------------------------
+bool TPassDecoder::decode(TPassDecode *pass)
+{
+    QList<TPassProduct *> products;
+    TPassProduct *product;
+    TBlock  block;
+    TSat    sat;
+    TGeoLocation geo;
+    TMosaic *mosaic;
+    QTime   t;
+    quint16 *row;
+    uchar   *mosaic_row;
+    QString base, mosaic_file;
+    int     width, height, frame, y, x, i, lines, mosaic_index;
+    bool    rc;
+
+    if(!waitForRX(pass->rx_job))
+        qDebug("Decode: the rx job of %s is still running", pass->satname.toStdString().c_str());
+
+    if(abort)
+        return false;
+
+    t.start();
+
+    if(!block.setBlockType(blockTypeFor(pass->satname)))
+        return false;
+
+    *block.satprop = *pass->props;
+    block.setNorthBound(pass->northbound);
+
+    // TLE and AOS of the recording for the geolocation
+    if(!sat.ReadPassinfo(pass->frames))
+        sat.rec_aostime = 0;
+    block.setAOSTime(sat.rec_aostime);
+
+    if(!block.open(pass->frames.toStdString().c_str())) {
+        qDebug("Decode: no frames found in %s", pass->frames.toStdString().c_str());
+        block.close();
+
+        return false;
+    }
+
+    if(!block.hasScanLines()) {
+        qDebug("Decode: %s has no scan lines", block.getBlockTypeStr(block.getBlockType()).toStdString().c_str());
+        block.close();
+
+        return false;
+    }
+
+    QFileInfo fi(pass->frames);
+    base = fi.absolutePath() + "/" + fi.baseName();
+
+    width = block.getWidth();
+    height = block.getHeight();
+
+    rc = addProducts(&block, base, &products);
+
+    if(sat.rec_aostime <= 0 || !geo.init(&sat, &block, pass->northbound))
+        geo.clear();
+
+    // the mosaic product is blended while it is decoded
+    mosaic_index = -1;
+    mosaic = rc ? beginMosaic(pass, &geo, products, &mosaic_index, &mosaic_file):NULL;
+
+    row = (quint16 *) malloc(width * 3 * sizeof(quint16));
+    mosaic_row = (uchar *) malloc(width * 3);
+    if(row == NULL || mosaic_row == NULL)
+        rc = false;
+
+    for(i=0; i<products.count() && rc; i++)
+        rc = products.at(i)->writer->start(width, height, 3);
+
+    // one read of every scan line for all the products
+    lines = 0;
+    for(y=0; y<height && rc && !abort; y++) {
+        // same orientation as toImage
+        frame = block.isNorthBound() ? height - y - 1:y;
+
+        if(block.readScanLine(frame)) {
+            lines++;
+
+            for(i=0; i<products.count() && rc; i++) {
+                rc = writeRow(&block, products.at(i), row, width);
+
+                // 10 bit counts, the NDVI colors are 16 bit
+                if(i == mosaic_index)
+                    for(x=0; x<width*3; x++)
+                        mosaic_row[x] = products.at(i)->ndvi ? row[x] >> 8:SCALE16TO8(row[x]);
+            }
+        }
+        else {
+            memset(row, 0, width * 3 * sizeof(quint16));
+            memset(mosaic_row, 0, width * 3);
+
+            for(i=0; i<products.count() && rc; i++)
+                rc = products.at(i)->writer->writeRow(row);
+        }
+
+        if(mosaic && rc && !mosaic->addRow(y, mosaic_row)) {
+            delete mosaic;
+            mosaic = NULL;
+        }
+    }
+
+    if(abort)
+        rc = false;
+
+    if(rc)
+        block.quality->save(TPassQuality::sidecarFile(pass->frames));
+
+    for(i=0; i<products.count(); i++) {
+        product = products.at(i);
+
+        if(product->writer == NULL || !product->writer->finish())
+            rc = false;
+    }
+
+    qDebug("Decode: %s, %d products, %d/%d lines in %.1f s%s",
+           pass->frames.toStdString().c_str(), products.count(), lines, height,
+           t.elapsed() / 1000.0, rc ? "":", failed");
+
+    while(!products.isEmpty())
+        delete products.takeFirst();
+
+    if(row)
+        free(row);
+    if(mosaic_row)
+        free(mosaic_row);
+
+    block.close();
+
+    if(mosaic) {
+        if(rc && mosaic->endPass() && mosaic->save(mosaic_file) &&
+           mosaic->saveState(TMosaic::stateFile(mosaic_file)))
+            qDebug("Mosaic: %s, %d passes", mosaic_file.toStdString().c_str(), mosaic->passes());
+
+        delete mosaic;
+    }
+
+    return rc;
+}
+
+//---------------------------------------------------------------------------
+// the mosaic of the UTC day of the pass with the passes blended before, also
+// before a restart, conf/mosaic.ini is read every time so changes apply to
+// the next pass. index is the product to blend, filename the mosaic image
+TMosaic *TPassDecoder::beginMosaic(TPassDecode *pass, const TGeoLocation *geo,
+                                   const QList<TPassProduct *> &products, int *index, QString *filename)
+{
+    QSettings    reg(QCoreApplication::applicationDirPath() + "/" + PATH_CONF + "/" + FILE_MOSAIC_INI,
+                     QSettings::IniFormat);
+    TMosaicConf  conf;
+    TMosaic      *mosaic;
+    TGrid        grid;
+    QString      statefile;
+    QDate        day;
+    double       daynum;
+    int          i;
+
+    *index = -1;
+
+    // write the defaults, disabled
+    if(!QFile::exists(reg.fileName())) {
+        conf.writeSettings(&reg);
+        return NULL;
+    }
+
+    conf.readSettings(&reg);
+
+    if(!conf.enabled || conf.product.isEmpty())
+        return NULL;
+
+    if(!conf.grid(&grid)) {
+        qDebug("Mosaic: invalid region in %s", reg.fileName().toStdString().c_str());
+        return NULL;
+    }
+
+    for(i=0; i<products.count() && *index < 0; i++)
+        if(productFileName("", products.at(i)->name) == productFileName("", conf.product))
+            *index = i;
+
+    if(*index < 0) {
+        qDebug("Mosaic: %s is not a product of %s", conf.product.toStdString().c_str(),
+               pass->satname.toStdString().c_str());
+        return NULL;
+    }
+
+    if(!geo->isValid()) {
+        qDebug("Mosaic: no geolocation for %s", pass->frames.toStdString().c_str());
+        return NULL;
+    }
+
+    // daynum is days from 1979-12-31 00:00 UTC
+    daynum = geo->lineTime(geo->height() / 2);
+    day = QDateTime::fromTime_t((uint) ((daynum + 3651.0) * 86400.0)).toUTC().date();
+
+    *filename = (conf.path.isEmpty() ? QFileInfo(pass->frames).absolutePath():conf.path) +
+                "/mosaic-" + day.toString("yyyyMMdd") + productFileName("", conf.product);
+    statefile = TMosaic::stateFile(*filename);
+
+    mosaic = new TMosaic(grid, (Mosaic_Rule) conf.rule);
+    mosaic->setCloudThreshold(conf.cloud_channel, conf.cloud_threshold);
+
+    if(QFile::exists(statefile) && !mosaic->loadState(statefile))
+        qDebug("Mosaic: %s is of other settings, starting over", statefile.toStdString().c_str());
+
+    if(!mosaic->beginPass(geo)) {
+        delete mosaic;
+        return NULL;
+    }
+
+    return mosaic;
+}
+
+//---------------------------------------------------------------------------
+// the RGB composites and the NDVI images of the satellite properties
+bool TPassDecoder::addProducts(TBlock *block, const QString &base, QList<TPassProduct *> *products)
+{
+    TSatProp     *props = block->satprop;
+    TPassProduct *product;
+    TRGBConf     *rgb;
+    TNDVI        *ndvi;
+    int          i, j, *ch;
+
+    for(i=0; i<props->rgblist->Count; i++) {
+        rgb = (TRGBConf *) props->rgblist->ItemAt(i);
+
+        product = new TPassProduct;
+        product->name = rgb->name();
+        product->rgb = rgb;
+
+        ch = rgb->rgb_ch();
+        for(j=0; j<3; j++)
+            product->ch[j] = ch[j] - 1;
+
+        products->append(product);
+    }
+
+    for(i=0; i<props->ndvilist->Count; i++) {
+        ndvi = (TNDVI *) props->ndvilist->ItemAt(i);
+
+        product = new TPassProduct;
+        product->name = ndvi->name();
+        product->ndvi = ndvi;
+        product->rgb = props->get_rgb(ndvi->rgbName());
+        product->lut = TNDVILUT::get(ndvi);
+
+        if(product->rgb) {
+            ch = product->rgb->rgb_ch();
+            for(j=0; j<3; j++)
+                product->ch[j] = ch[j] - 1;
+        }
+        else
+            product->ch[0] = product->ch[1] = product->ch[2] = ndvi->nir_ch() - 1;
+
+        if(product->lut == NULL) {
+            qDebug("Decode: no lookup table for NDVI %s", ndvi->name().toStdString().c_str());
+
+            delete product;
+            continue;
+        }
+
+        products->append(product);
+    }
+
+    for(i=0; i<products->count(); i++) {
+        product = products->at(i);
+
+        product->writer = TImageWriter::create(productFileName(base, product->name));
+
+        // 10 bit counts, the NDVI colors are 8 bit
+        if(product->writer == NULL ||
+           !product->writer->setSampleFormat(product->ndvi ? IW_UINT16:IW_COUNTS))
+            return false;
+    }
+
+    return products->count() > 0;
+}
+
+//---------------------------------------------------------------------------
+// the same pixels as toImage, the NDVI colors over the RGB or NIR image
+bool TPassDecoder::writeRow(TBlock *block, TPassProduct *product, quint16 *row, int width)
+{
+    quint32 rgb;
+    quint8  r, g, b;
+    int     x;
+
+    if(product->ndvi == NULL) {
+        for(x=0; x<width; x++) {
+            row[x*3]     = block->getPixel_16(product->ch[0], x);
+            row[x*3 + 1] = block->getPixel_16(product->ch[1], x);
+            row[x*3 + 2] = block->getPixel_16(product->ch[2], x);
+        }
+
+        return product->writer->writeRow(row);
+    }
+
+    for(x=0; x<width; x++) {
+        r = SCALE16TO8(block->getPixel_16(product->ch[0], x));
+        g = SCALE16TO8(block->getPixel_16(product->ch[1], x));
+        b = SCALE16TO8(block->getPixel_16(product->ch[2], x));
+
+        // zero alpha = NDVI out of range
+        rgb = product->lut->lookup(block->getPixel_16(product->ndvi->nir_ch() - 1, x),
+                                   block->getPixel_16(product->ndvi->vis_ch() - 1, x));
+
+        if(qAlpha(rgb)) {
+            if(product->rgb || product->lut->hasPalette()) {
+                r = qRed(rgb);
+                g = qGreen(rgb);
+                b = qBlue(rgb);
+            }
+            else
+                g = qGreen(rgb);
+        }
+
+        row[x*3]     = r * 257;
+        row[x*3 + 1] = g * 257;
+        row[x*3 + 2] = b * 257;
+    }
+
+    return product->writer->writeRow(row);
+}
@@ -0,0 +1,115 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef PASSDECODER_H
+#define PASSDECODER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QList>
+#include <QString>
+
+#include "block.h"
+
+#define PD_WAIT_RX          30      // seconds to wait for the rx job to exit
+#define PD_IMAGE_EXT        "png"   // 16 bit, streamed by TImageWriter
+
+class TSat;
+class TSatProp;
+class TRGBConf;
+class TNDVI;
+class TNDVILUT;
+class TImageWriter;
+class TJobManager;
+class TMosaic;
+class TGeoLocation;
+
+//---------------------------------------------------------------------------
+// one image written while decoding
+class TPassProduct
+{
+public:
+    TPassProduct(void);
+    ~TPassProduct(void);
+
+    QString      name;
+    TRGBConf     *rgb;      // composite, or the background of a NDVI image
+    TNDVI        *ndvi;
+    TNDVILUT     *lut;
+    TImageWriter *writer;
+    int          ch[3];     // zero based
+};
+
+//---------------------------------------------------------------------------
+// a recorded pass waiting for the decoder
+class TPassDecode
+{
+public:
+    TPassDecode(void);
+    ~TPassDecode(void);
+
+    QString  satname, frames;
+    bool     northbound;
+    int      rx_job;
+    TSatProp *props;        // copy, the settings may change while queued
+};
+
+//---------------------------------------------------------------------------
+/*
+  Decodes the frames file of a finished pass in process, replacing a
+  post rx script which would open and parse the frames again.
+  The passes are decoded one at a time on a low priority worker thread.
+  Every scan line is read once and fed to all products of the satellite
+  properties, the RGB composites and the NDVI images, which are streamed
+  to <frames>-<product>.png next to the frames file.
+  A product can be blended to a daily mosaic, see conf/mosaic.ini.
+*/
+class TPassDecoder : public QThread
+{
+    Q_OBJECT
+
+public:
+    TPassDecoder(TJobManager *jobs_, QObject *parent = 0);
+    ~TPassDecoder(void);
+
+    bool add(TSat *sat, int rx_job = 0);
+    void stop(void);
+    int  pending(void);
+
+    static Block_Type blockTypeFor(const QString &satname);
+
+protected:
+    void run(void);
+    bool decode(TPassDecode *pass);
+    bool waitForRX(int rx_job);
+    bool addProducts(TBlock *block, const QString &base, QList<TPassProduct *> *products);
+    bool writeRow(TBlock *block, TPassProduct *product, quint16 *row, int width);
+    TMosaic *beginMosaic(TPassDecode *pass, const TGeoLocation *geo,
+                         const QList<TPassProduct *> &products, int *index, QString *filename);
+
+private:
+    QMutex              mutex;
+    QList<TPassDecode *> queue;
+    TJobManager         *jobs;
+    bool                busy, abort;
+};
+
+#endif // PASSDECODER_H
@@ -0,0 +1,256 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <QFileInfo>
+#include <QSettings>
+#include <QStringList>
+#include <string.h>
+
+#include "passquality.h"
+
+#define PQ_FIELD_FLAGS          0
+#define PQ_FIELD_RS_CORRECTED   1
+#define PQ_FIELD_RS_FAILED      2
+#define PQ_FIELD_MISSING        3
+
+//---------------------------------------------------------------------------
+TPassQuality::TPassQuality(void)
+{
+    modified = false;
+}
+
+//---------------------------------------------------------------------------
+void TPassQuality::clear(void)
+{
+    lines.clear();
+    modified = false;
+}
+
+//---------------------------------------------------------------------------
+void TPassQuality::setLine(int line, quint8 flags, long rs_corrected, long rs_failed, long missing)
+{
+ TLineQuality lq;
+ int size;
+
+    if(line < 0)
+        return;
+
+    size = lines.size();
+    if(line >= size) {
+        lines.resize(line + 1);
+        memset(lines.data() + size, 0, (line + 1 - size) * sizeof(TLineQuality));
+    }
+
+    memset(&lq, 0, sizeof(lq));
+    lq.flags        = flags;
+    lq.rs_corrected = (quint16) qMin(rs_corrected, 65535L);
+    lq.rs_failed    = (quint8) qMin(rs_failed, 255L);
+    lq.missing      = (quint8) qMin(missing, 255L);
+
+    if(rs_corrected > 0) lq.flags |= PQ_RS_CORRECTED;
+    if(rs_failed > 0)    lq.flags |= PQ_RS_FAILED;
+    if(missing > 0)      lq.flags |= PQ_GAP;
+
+    if(memcmp(&lq, lines.constData() + line, sizeof(lq))) {
+        lines[line] = lq;
+        modified = true;
+    }
+}
+
+//---------------------------------------------------------------------------
+// a line of a CADU decoder from the link statistics before and after reading it
+void TPassQuality::setLine(int line, const TCADUStats &from, const TCADUStats &to, bool fill)
+{
+ quint8 flags = fill ? PQ_FILL:0;
+
+    if(to.slips > from.slips)
+        flags |= PQ_SLIP;
+
+    setLine(line, flags,
+            to.rs_corrected - from.rs_corrected,
+            to.rs_failed - from.rs_failed,
+            to.missing - from.missing);
+}
+
+//---------------------------------------------------------------------------
+const TLineQuality *TPassQuality::getLine(int line) const
+{
+    if(line < 0 || line >= lines.size())
+        return NULL;
+
+ return lines.constData() + line;
+}
+
+//---------------------------------------------------------------------------
+// number of lines with any of flag
+int TPassQuality::count(quint8 flag) const
+{
+ int i, n = 0;
+
+    for(i=0; i<lines.size(); i++)
+        if(lines.at(i).flags & flag)
+            n++;
+
+ return n;
+}
+
+//---------------------------------------------------------------------------
+long TPassQuality::rsCorrected(void) const
+{
+ long n = 0;
+
+    for(int i=0; i<lines.size(); i++)
+        n += lines.at(i).rs_corrected;
+
+ return n;
+}
+
+//---------------------------------------------------------------------------
+long TPassQuality::rsFailed(void) const
+{
+ long n = 0;
+
+    for(int i=0; i<lines.size(); i++)
+        n += lines.at(i).rs_failed;
+
+ return n;
+}
+
+//---------------------------------------------------------------------------
+long TPassQuality::missingPackets(void) const
+{
+ long n = 0;
+
+    for(int i=0; i<lines.size(); i++)
+        n += lines.at(i).missing;
+
+ return n;
+}
+
+//---------------------------------------------------------------------------
+// percent of lines without fill, flywheel, uncorrectable or lost packets
+double TPassQuality::score(void) const
+{
+    if(lines.isEmpty())
+        return 0;
+
+ return 100.0 * (lines.size() - count(PQ_BAD_LINE)) / lines.size();
+}
+
+//---------------------------------------------------------------------------
+QString TPassQuality::getSummaryStr(void) const
+{
+ QString str;
+
+    str.sprintf("%d lines, %.1f %% good\n"
+                "Sync corrected: %d lines\n"
+                "Slips: %d lines\n"
+                "Flywheel: %d lines\n"
+                "Fill: %d lines\n"
+                "RS corrected: %ld symbols\n"
+                "RS failed: %ld packets\n"
+                "Missing: %ld packets",
+                lines.size(), score(),
+                count(PQ_SYNC_CORRECTED), count(PQ_SLIP),
+                count(PQ_FLYWHEEL), count(PQ_FILL),
+                rsCorrected(), rsFailed(), missingPackets());
+
+ return str;
+}
+
+//---------------------------------------------------------------------------
+int TPassQuality::fieldValue(const TLineQuality &lq, int field)
+{
+    switch(field) {
+    case PQ_FIELD_RS_CORRECTED: return lq.rs_corrected;
+    case PQ_FIELD_RS_FAILED:    return lq.rs_failed;
+    case PQ_FIELD_MISSING:      return lq.missing;
+    default:                    return lq.flags;
+    }
+}
+
+//---------------------------------------------------------------------------
+// "count*value count*value ...", space separated so QSettings keeps a string
+QString TPassQuality::runLength(int field) const
+{
+ QStringList runs;
+ QString str;
+ int i, n, value;
+
+    for(i=0; i<lines.size(); i+=n) {
+        value = fieldValue(lines.at(i), field);
+
+        for(n=1; i+n<lines.size() && fieldValue(lines.at(i+n), field) == value; n++) ;
+
+        runs.append(str.sprintf("%d*%d", n, value));
+    }
+
+ return runs.join(" ");
+}
+
+//---------------------------------------------------------------------------
+bool TPassQuality::save(const QString &filename)
+{
+    QSettings reg(filename, QSettings::IniFormat);
+
+    reg.clear();
+
+    reg.beginGroup("Quality");
+      reg.setValue("Lines", lines.size());
+      reg.setValue("Score", QString::number(score(), 'f', 1));
+      reg.setValue("SyncCorrected", count(PQ_SYNC_CORRECTED));
+      reg.setValue("Slips", count(PQ_SLIP));
+      reg.setValue("Flywheel", count(PQ_FLYWHEEL));
+      reg.setValue("Fill", count(PQ_FILL));
+      reg.setValue("RSCorrected", (qlonglong) rsCorrected());
+      reg.setValue("RSFailed", (qlonglong) rsFailed());
+      reg.setValue("MissingPackets", (qlonglong) missingPackets());
+    reg.endGroup();
+
+    reg.beginGroup("Lines");
+      reg.setValue("Flags", runLength(PQ_FIELD_FLAGS));
+      reg.setValue("RSCorrected", runLength(PQ_FIELD_RS_CORRECTED));
+      reg.setValue("RSFailed", runLength(PQ_FIELD_RS_FAILED));
+      reg.setValue("Missing", runLength(PQ_FIELD_MISSING));
+    reg.endGroup();
+
+    reg.sync();
+
+    if(reg.status() != QSettings::NoError) {
+        qDebug("TPassQuality: failed to write %s", filename.toStdString().c_str());
+        return false;
+    }
+
+    modified = false;
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// next to the passinfo <frames>.ini
+QString TPassQuality::sidecarFile(const QString &framesfile)
+{
+ QFileInfo fi(framesfile);
+
+ return fi.absolutePath() + "/" + fi.baseName() + "-quality.ini";
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,95 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef PASSQUALITY_H
+#define PASSQUALITY_H
+
+#include <QString>
+#include <QVector>
+
+#include "cadu.h"
+
+//---------------------------------------------------------------------------
+// line flags, the first four are the FS_* frame flags of framesync.h
+#define PQ_SYNC_CORRECTED   1   // sync found with bit errors
+#define PQ_SLIP             2   // re-aligned after a bit or word slip
+#define PQ_FLYWHEEL         4   // sync missing, position predicted
+#define PQ_FILL             8   // line (partly) zero filled
+#define PQ_RS_CORRECTED     16  // Reed Solomon corrected symbols
+#define PQ_RS_FAILED        32  // uncorrectable packet
+#define PQ_GAP              64  // packets lost before the line
+
+#define PQ_BAD_LINE         (PQ_FLYWHEEL | PQ_FILL | PQ_RS_FAILED | PQ_GAP)
+
+//---------------------------------------------------------------------------
+typedef struct
+{
+    quint8  flags;
+    quint8  rs_failed;      // packets, saturated at 255
+    quint8  missing;        // packets, saturated at 255
+    quint8  reserved;
+    quint16 rs_corrected;   // symbols, saturated at 65535
+} TLineQuality;
+
+//---------------------------------------------------------------------------
+/*
+  Per line link quality of a pass.
+  The decoders set a line when they read it, setting it again with the
+  same values is cheap so repeated renders of a pass don't count twice,
+  the pass totals are summed from the lines when asked for.
+
+  The sidecar <frames>-quality.ini next to the passinfo .ini has the totals
+  and the lines as run length lists "count*value count*value ...".
+*/
+class TPassQuality
+{
+public:
+    TPassQuality(void);
+
+    void clear(void);
+    void setLine(int line, quint8 flags, long rs_corrected=0, long rs_failed=0, long missing=0);
+    void setLine(int line, const TCADUStats &from, const TCADUStats &to, bool fill);
+
+    int  getLines(void) const { return lines.size(); }
+    const TLineQuality *getLine(int line) const;
+    bool isModified(void) const { return modified; }
+
+    int    count(quint8 flag) const;
+    long   rsCorrected(void) const;
+    long   rsFailed(void) const;
+    long   missingPackets(void) const;
+    double score(void) const;
+    QString getSummaryStr(void) const;
+
+    bool save(const QString &filename);
+
+    static QString sidecarFile(const QString &framesfile);
+
+protected:
+    QString runLength(int field) const;
+    static int fieldValue(const TLineQuality &lq, int field);
+
+private:
+    QVector<TLineQuality> lines;
+    bool modified;
+};
+
+#endif // PASSQUALITY_H
@@ -0,0 +1,277 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <math.h>
+
+#include "projection.h"
+
+#define PROJ_DEG2RAD (M_PI/180.0)
+#define PROJ_RAD2DEG (180.0/M_PI)
+
+//---------------------------------------------------------------------------
+static inline double wrap_lon(double lon)
+{
+    while(lon >= 180.0)
+        lon -= 360.0;
+    while(lon < -180.0)
+        lon += 360.0;
+
+ return lon;
+}
+
+//---------------------------------------------------------------------------
+TProjection::TProjection(Projection_Type type_, double lon0_)
+{
+    type = type_;
+    lon0 = wrap_lon(lon0_);
+
+    // scale factor of a polar stereographic projection true at PROJ_POLAR_TRUE_LAT
+    k0 = (1.0 + sin(PROJ_POLAR_TRUE_LAT * PROJ_DEG2RAD)) / 2.0;
+}
+
+//---------------------------------------------------------------------------
+QString TProjection::getTypeStr(int type_)
+{
+    switch(type_) {
+    case Equirectangular_Projection: return "Equirectangular";
+    case PolarNorth_Projection:      return "Polar Stereographic North";
+    case PolarSouth_Projection:      return "Polar Stereographic South";
+    case Mercator_Projection:        return "Mercator";
+    default:                         return "Unknown";
+    }
+}
+
+//---------------------------------------------------------------------------
+QString TProjection::unitStr(void) const
+{
+    return type == Equirectangular_Projection ? "degree":"metre";
+}
+
+//---------------------------------------------------------------------------
+double TProjection::metresPerUnit(void) const
+{
+    return type == Equirectangular_Projection ? PROJ_EARTH_RADIUS * PROJ_DEG2RAD:1.0;
+}
+
+//---------------------------------------------------------------------------
+// width of the world in projection units, zero if x does not wrap
+double TProjection::worldWidth(void) const
+{
+    switch(type) {
+    case Equirectangular_Projection: return 360.0;
+    case Mercator_Projection:        return 2.0 * M_PI * PROJ_EARTH_RADIUS;
+    default:                         return 0;
+    }
+}
+
+//---------------------------------------------------------------------------
+// x of the central meridian in the same projection centered on Greenwich,
+// added to x to get the absolute coordinates of the cylindrical projections.
+// The polar projections are rotated instead, see wkt().
+double TProjection::meridianX(void) const
+{
+    switch(type) {
+    case Equirectangular_Projection: return lon0;
+    case Mercator_Projection:        return PROJ_EARTH_RADIUS * lon0 * PROJ_DEG2RAD;
+    default:                         return 0;
+    }
+}
+
+//---------------------------------------------------------------------------
+// ESRI WKT of the absolute coordinates for a .prj file. The formulas are
+// spherical, Mercator is the same as Web Mercator.
+QString TProjection::wkt(void) const
+{
+ const char *sphere = "GEOGCS[\"GCS_Sphere\",DATUM[\"D_Sphere\",SPHEROID[\"Sphere\",6378137.0,0.0]],"
+                      "PRIMEM[\"Greenwich\",0.0],UNIT[\"Degree\",0.0174532925199433]]";
+ QString str;
+
+    switch(type) {
+    case Equirectangular_Projection:
+        return "GEOGCS[\"GCS_WGS_1984\",DATUM[\"D_WGS_1984\",SPHEROID[\"WGS_1984\",6378137.0,298.257223563]],"
+               "PRIMEM[\"Greenwich\",0.0],UNIT[\"Degree\",0.0174532925199433]]";
+
+    case Mercator_Projection:
+        return "PROJCS[\"WGS_1984_Web_Mercator_Auxiliary_Sphere\","
+               "GEOGCS[\"GCS_WGS_1984\",DATUM[\"D_WGS_1984\",SPHEROID[\"WGS_1984\",6378137.0,298.257223563]],"
+               "PRIMEM[\"Greenwich\",0.0],UNIT[\"Degree\",0.0174532925199433]],"
+               "PROJECTION[\"Mercator_Auxiliary_Sphere\"],PARAMETER[\"False_Easting\",0.0],"
+               "PARAMETER[\"False_Northing\",0.0],PARAMETER[\"Central_Meridian\",0.0],"
+               "PARAMETER[\"Standard_Parallel_1\",0.0],PARAMETER[\"Auxiliary_Sphere_Type\",0.0],"
+               "UNIT[\"Meter\",1.0]]";
+
+    case PolarNorth_Projection:
+    case PolarSouth_Projection:
+        str.sprintf("PROJCS[\"%s\",%s,PROJECTION[\"%s\"],"
+                    "PARAMETER[\"False_Easting\",0.0],PARAMETER[\"False_Northing\",0.0],"
+                    "PARAMETER[\"Central_Meridian\",%.10g],PARAMETER[\"Standard_Parallel_1\",%.1f],"
+                    "UNIT[\"Meter\",1.0]]",
+                    getTypeStr(type).toAscii().constData(), sphere,
+                    type == PolarNorth_Projection ? "Stereographic_North_Pole":"Stereographic_South_Pole",
+                    lon0,
+                    type == PolarNorth_Projection ? PROJ_POLAR_TRUE_LAT:-PROJ_POLAR_TRUE_LAT);
+        return str;
+
+    default:
+        return "";
+    }
+}
+
+//---------------------------------------------------------------------------
+bool TProjection::forward(double lat, double lon, double *x, double *y) const
+{
+ double dlon, rho;
+
+    dlon = wrap_lon(lon - lon0);
+
+    switch(type) {
+    case Equirectangular_Projection:
+        *x = dlon;
+        *y = lat;
+        break;
+
+    case PolarNorth_Projection:
+        if(lat < -30.0)
+            return false;
+        rho = 2.0 * PROJ_EARTH_RADIUS * k0 * tan(M_PI/4.0 - lat * PROJ_DEG2RAD / 2.0);
+        *x =  rho * sin(dlon * PROJ_DEG2RAD);
+        *y = -rho * cos(dlon * PROJ_DEG2RAD);
+        break;
+
+    case PolarSouth_Projection:
+        if(lat > 30.0)
+            return false;
+        rho = 2.0 * PROJ_EARTH_RADIUS * k0 * tan(M_PI/4.0 + lat * PROJ_DEG2RAD / 2.0);
+        *x = rho * sin(dlon * PROJ_DEG2RAD);
+        *y = rho * cos(dlon * PROJ_DEG2RAD);
+        break;
+
+    case Mercator_Projection:
+        if(fabs(lat) > PROJ_MERCATOR_LAT)
+            return false;
+        *x = PROJ_EARTH_RADIUS * dlon * PROJ_DEG2RAD;
+        *y = PROJ_EARTH_RADIUS * log(tan(M_PI/4.0 + lat * PROJ_DEG2RAD / 2.0));
+        break;
+
+    default:
+        return false;
+    }
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+bool TProjection::inverse(double x, double y, double *lat, double *lon) const
+{
+ double rho;
+
+    switch(type) {
+    case Equirectangular_Projection:
+        if(fabs(y) > 90.0)
+            return false;
+        *lat = y;
+        *lon = wrap_lon(x + lon0);
+        break;
+
+    case PolarNorth_Projection:
+        rho = sqrt(x*x + y*y);
+        *lat = 90.0 - 2.0 * atan(rho / (2.0 * PROJ_EARTH_RADIUS * k0)) * PROJ_RAD2DEG;
+        *lon = wrap_lon(lon0 + atan2(x, -y) * PROJ_RAD2DEG);
+        break;
+
+    case PolarSouth_Projection:
+        rho = sqrt(x*x + y*y);
+        *lat = 2.0 * atan(rho / (2.0 * PROJ_EARTH_RADIUS * k0)) * PROJ_RAD2DEG - 90.0;
+        *lon = wrap_lon(lon0 + atan2(x, y) * PROJ_RAD2DEG);
+        break;
+
+    case Mercator_Projection:
+        *lat = (2.0 * atan(exp(y / PROJ_EARTH_RADIUS)) - M_PI/2.0) * PROJ_RAD2DEG;
+        *lon = wrap_lon(lon0 + x / PROJ_EARTH_RADIUS * PROJ_RAD2DEG);
+        break;
+
+    default:
+        return false;
+    }
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TGrid::TGrid(void)
+{
+    x0 = y0 = 0;
+    res = 1;
+    width = height = 0;
+}
+
+//---------------------------------------------------------------------------
+static inline double cross2(double ax, double ay, double bx, double by)
+{
+ return ax * by - ay * bx;
+}
+
+//---------------------------------------------------------------------------
+// point p in the quad a, b, c, d (b is along u from a, d along v from a)
+// returns the bilinear u, v of the point
+bool inverse_bilinear(const double *qx, const double *qy, double px, double py,
+                      double *u, double *v)
+{
+ double ex, ey, fx, fy, gx, gy, hx, hy, k0, k1, k2, w, den;
+ int    i;
+
+    ex = qx[1] - qx[0];          ey = qy[1] - qy[0];
+    fx = qx[3] - qx[0];          fy = qy[3] - qy[0];
+    gx = qx[0] - qx[1] + qx[2] - qx[3];
+    gy = qy[0] - qy[1] + qy[2] - qy[3];
+    hx = px - qx[0];             hy = py - qy[0];
+
+    k2 = cross2(gx, gy, fx, fy);
+    k1 = cross2(ex, ey, fx, fy) + cross2(hx, hy, gx, gy);
+    k0 = cross2(hx, hy, ex, ey);
+
+    for(i=0; i<2; i++) {
+        if(fabs(k2) < 1e-9) {
+            if(fabs(k1) < 1e-12 || i)
+                return false;
+            *v = -k0 / k1;
+        }
+        else {
+            w = k1*k1 - 4.0*k0*k2;
+            if(w < 0)
+                return false;
+            w = sqrt(w);
+            *v = (i ? -k1 + w:-k1 - w) / (2.0 * k2);
+        }
+
+        den = ex + gx * *v;
+        if(fabs(den) > fabs(ey + gy * *v))
+            *u = (hx - fx * *v) / den;
+        else
+            *u = (hy - fy * *v) / (ey + gy * *v);
+
+        if(*u >= -1e-6 && *u <= 1.0 + 1e-6 && *v >= -1e-6 && *v <= 1.0 + 1e-6)
+            return true;
+    }
+
+ return false;
+}
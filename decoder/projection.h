@@ -0,0 +1,87 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef PROJECTION_H
+#define PROJECTION_H
+
+#include <QString>
+
+#define PROJ_EARTH_RADIUS   6378137.0   // m, spherical as in Web Mercator
+#define PROJ_POLAR_TRUE_LAT 70.0        // standard parallel of the polar stereographic grids
+#define PROJ_MERCATOR_LAT   85.0511287798
+
+//---------------------------------------------------------------------------
+typedef enum Projection_Type_t
+{
+    Equirectangular_Projection = 0,     // degrees
+    PolarNorth_Projection,              // metres
+    PolarSouth_Projection,
+    Mercator_Projection
+} Projection_Type;
+
+#define NUM_PROJECTIONS (Mercator_Projection + 1)
+
+//---------------------------------------------------------------------------
+// map projection on a sphere, x is east and y is north
+class TProjection
+{
+public:
+    TProjection(Projection_Type type_ = Equirectangular_Projection, double lon0_ = 0);
+
+    Projection_Type getType(void) const { return type; }
+    double centralMeridian(void) const { return lon0; }
+
+    static QString getTypeStr(int type_);
+    QString unitStr(void) const;
+    double  metresPerUnit(void) const;
+    double  worldWidth(void) const;
+    double  meridianX(void) const;
+    QString wkt(void) const;
+
+    bool forward(double lat, double lon, double *x, double *y) const;
+    bool inverse(double x, double y, double *lat, double *lon) const;
+
+private:
+    Projection_Type type;
+    double lon0, k0;
+};
+
+//---------------------------------------------------------------------------
+// north up raster in a projection, x0 and y0 is the upper left corner
+class TGrid
+{
+public:
+    TGrid(void);
+
+    double col(double x) const { return (x - x0) / res; }
+    double row(double y) const { return (y0 - y) / res; }
+
+    TProjection proj;
+    double x0, y0, res;
+    int    width, height;
+};
+
+//---------------------------------------------------------------------------
+// u, v of the point px, py in the quad qx, qy (corner 1 is along u and 3 along v from 0)
+bool inverse_bilinear(const double *qx, const double *qy, double px, double py,
+                      double *u, double *v);
+
+#endif // PROJECTION_H
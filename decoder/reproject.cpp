@@ -0,0 +1,635 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <QRunnable>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QTextStream>
+#include <math.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include "reproject.h"
+#include "geolocation.h"
+
+//---------------------------------------------------------------------------
+// Keys cubic convolution, a = -0.5
+static inline void cubic_weights(double t, double *w)
+{
+ double t2 = t*t, t3 = t2*t;
+
+    w[0] = -0.5*t3 + t2 - 0.5*t;
+    w[1] =  1.5*t3 - 2.5*t2 + 1.0;
+    w[2] = -1.5*t3 + 2.0*t2 + 0.5*t;
+    w[3] =  0.5*t3 - 0.5*t2;
+}
+
+//---------------------------------------------------------------------------
+static inline int clamp_int(int value, int min, int max)
+{
+ return value < min ? min:(value > max ? max:value);
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+class TReprojectTileJob : public QRunnable
+{
+public:
+    TReprojectTileJob(const TReprojector *rp_, const TGrid &grid_, const QVector<int> &cells_,
+                      int col0_, int row0_, int width_, int height_,
+                      const QString &filename_, bool worldfile_, QAtomicInt *written_)
+    {
+        rp = rp_;
+        grid = grid_;
+        cells = cells_;
+        col0 = col0_;
+        row0 = row0_;
+        width = width_;
+        height = height_;
+        filename = filename_;
+        worldfile = worldfile_;
+        written = written_;
+    }
+
+    void run()
+    {
+        QImage tile(width, height, QImage::Format_ARGB32);
+
+        tile.fill(0);
+        if(!rp->renderTile(grid, cells, col0, row0, &tile))
+            return;
+
+        QFileInfo fi(filename);
+        QDir().mkpath(fi.absolutePath());
+
+        if(!tile.save(filename)) {
+            qDebug("TReprojector: failed to write %s", filename.toStdString().c_str());
+            return;
+        }
+
+        if(worldfile)
+            TReprojector::writeWorldFile(filename, grid, col0, row0);
+
+        written->ref();
+    }
+
+private:
+    const TReprojector *rp;
+    TGrid        grid;
+    QVector<int> cells;
+    int          col0, row0, width, height;
+    QString      filename;
+    bool         worldfile;
+    QAtomicInt   *written;
+};
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TReprojector::TReprojector(const QImage *image_, const TGeoLocation *geo_)
+{
+    if(image_ && image_->format() != QImage::Format_RGB888)
+        src = image_->convertToFormat(QImage::Format_RGB888);
+    else if(image_)
+        src = *image_;
+
+    src_first = 0;
+    geo = geo_;
+    kernel = Bilinear_Kernel;
+
+    mesh_x = mesh_y = NULL;
+    mesh_cols = mesh_rows = 0;
+    mesh_valid = false;
+}
+
+//---------------------------------------------------------------------------
+TReprojector::~TReprojector(void)
+{
+    if(mesh_x)
+        free(mesh_x);
+    if(mesh_y)
+        free(mesh_y);
+}
+
+//---------------------------------------------------------------------------
+// scan lines first... of the swath, the mesh is kept
+bool TReprojector::setRows(const QImage *rows, int first)
+{
+    if(rows == NULL || rows->isNull() || first < 0)
+        return false;
+
+    if(rows->format() != QImage::Format_RGB888)
+        src = rows->convertToFormat(QImage::Format_RGB888);
+    else
+        src = *rows;
+
+    src_first = first;
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// projects the geolocation mesh, reused while the projection is the same
+bool TReprojector::buildMesh(const TProjection &proj)
+{
+ double lat, lon;
+ int    i, j, x, y, n;
+
+    if(mesh_valid && mesh_proj.getType() == proj.getType() &&
+       mesh_proj.centralMeridian() == proj.centralMeridian())
+        return true;
+
+    mesh_valid = false;
+
+    if(geo == NULL || !geo->isValid() || src.isNull() ||
+       src.width() != geo->width() || src_first + src.height() > geo->height())
+        return false;
+
+    mesh_cols = (geo->width() - 2) / RP_MESH_STEP + 2;
+    mesh_rows = geo->height() > 1 ? (geo->height() - 2) / RP_MESH_STEP + 2:1;
+    if(mesh_rows < 2)
+        return false;
+
+    n = mesh_cols * mesh_rows;
+    mesh_x = (double *) realloc(mesh_x, n * sizeof(double));
+    mesh_y = (double *) realloc(mesh_y, n * sizeof(double));
+    if(mesh_x == NULL || mesh_y == NULL)
+        return false;
+
+    mesh_proj = proj;
+
+    for(j=0; j<mesh_rows; j++) {
+        y = j * RP_MESH_STEP < geo->height() ? j * RP_MESH_STEP:geo->height() - 1;
+
+        for(i=0; i<mesh_cols; i++) {
+            x = i * RP_MESH_STEP < geo->width() ? i * RP_MESH_STEP:geo->width() - 1;
+            n = j * mesh_cols + i;
+
+            if(!geo->latLon(x, y, &lat, &lon) || !proj.forward(lat, lon, &mesh_x[n], &mesh_y[n]))
+                mesh_x[n] = mesh_y[n] = NAN;
+        }
+    }
+
+    mesh_valid = true;
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// corners of a mesh cell in grid pixels, false if undefined or too large.
+// A cell across the antimeridian is unwrapped relative to its first corner,
+// it then reaches past the edge of a cylindrical projection
+bool TReprojector::cellCorners(int cell, const TGrid &grid, double *px, double *py) const
+{
+ double world, min, max, x;
+ int    i, j, n[4];
+
+    i = cell % (mesh_cols - 1);
+    j = cell / (mesh_cols - 1);
+
+    n[0] = j * mesh_cols + i;
+    n[1] = n[0] + 1;
+    n[2] = n[1] + mesh_cols;
+    n[3] = n[0] + mesh_cols;
+
+    world = grid.proj.worldWidth();
+    min = max = mesh_x[n[0]];
+
+    for(i=0; i<4; i++) {
+        x = mesh_x[n[i]];
+        if(isnan(x))
+            return false;
+
+        if(world > 0) {
+            while(x - mesh_x[n[0]] > world / 2.0)
+                x -= world;
+            while(x - mesh_x[n[0]] < -world / 2.0)
+                x += world;
+        }
+
+        if(x < min)
+            min = x;
+        if(x > max)
+            max = x;
+
+        px[i] = grid.col(x);
+        py[i] = grid.row(mesh_y[n[i]]);
+    }
+
+ return world == 0 || max - min < world / 4.0;
+}
+
+//---------------------------------------------------------------------------
+// resolution is in projection units, the grid covers the whole swath
+bool TReprojector::autoGrid(const TProjection &proj, double resolution, TGrid *grid)
+{
+ double px[4], py[4], minx, maxx, miny, maxy;
+ int    cell, cells, i;
+ bool   found = false;
+
+    if(resolution <= 0 || !buildMesh(proj))
+        return false;
+
+    grid->proj = proj;
+    grid->x0 = grid->y0 = 0;
+    grid->res = 1.0;
+
+    minx = maxx = miny = maxy = 0;
+    cells = (mesh_cols - 1) * (mesh_rows - 1);
+
+    // grid pixels of a unit grid at the origin are projection units, y flipped
+    for(cell=0; cell<cells; cell++) {
+        if(!cellCorners(cell, *grid, px, py))
+            continue;
+
+        for(i=0; i<4; i++) {
+            if(!found) {
+                minx = maxx = px[i];
+                miny = maxy = -py[i];
+                found = true;
+            }
+
+            minx = px[i] < minx ? px[i]:minx;
+            maxx = px[i] > maxx ? px[i]:maxx;
+            miny = -py[i] < miny ? -py[i]:miny;
+            maxy = -py[i] > maxy ? -py[i]:maxy;
+        }
+    }
+
+    if(!found)
+        return false;
+
+    grid->res = resolution;
+    grid->x0 = floor(minx / resolution) * resolution;
+    grid->y0 = ceil(maxy / resolution) * resolution;
+    grid->width = (int) ceil((maxx - grid->x0) / resolution);
+    grid->height = (int) ceil((grid->y0 - miny) / resolution);
+
+ return grid->width > 0 && grid->height > 0 && grid->width <= 65536 && grid->height <= 65536;
+}
+
+//---------------------------------------------------------------------------
+// mesh cells by the tiles of the grid they overlap, the key is row * tiles_x + col
+// only the cells starting at scan lines first_line...last_line, -1 is the last line
+bool TReprojector::tileCells(const TGrid &grid, int tilesize, QHash<int, QVector<int> > *buckets,
+                             int first_line, int last_line)
+{
+ double px[4], py[4];
+ int    tiles_x, cell, cells, row0, row1, tx0, tx1, ty0, ty1, tx, ty, i;
+
+    buckets->clear();
+
+    if(tilesize < 16 || grid.width <= 0 || grid.height <= 0 || !buildMesh(grid.proj))
+        return false;
+
+    tiles_x = (grid.width + tilesize - 1) / tilesize;
+
+    // mesh cell rows starting at the lines
+    row0 = first_line > 0 ? (first_line + RP_MESH_STEP - 1) / RP_MESH_STEP:0;
+    row1 = last_line < 0 ? mesh_rows - 2:qMin(last_line / RP_MESH_STEP, mesh_rows - 2);
+
+    cells = (row1 + 1) * (mesh_cols - 1);
+
+    for(cell=row0 * (mesh_cols - 1); cell<cells; cell++) {
+        if(!cellCorners(cell, grid, px, py))
+            continue;
+
+        tx0 = tx1 = (int) floor(px[0]);
+        ty0 = ty1 = (int) floor(py[0]);
+        for(i=1; i<4; i++) {
+            tx0 = qMin(tx0, (int) floor(px[i]));
+            tx1 = qMax(tx1, (int) floor(px[i]));
+            ty0 = qMin(ty0, (int) floor(py[i]));
+            ty1 = qMax(ty1, (int) floor(py[i]));
+        }
+
+        if(tx1 < 0 || ty1 < 0 || tx0 >= grid.width || ty0 >= grid.height)
+            continue;
+
+        tx0 = clamp_int(tx0, 0, grid.width - 1) / tilesize;
+        tx1 = clamp_int(tx1, 0, grid.width - 1) / tilesize;
+        ty0 = clamp_int(ty0, 0, grid.height - 1) / tilesize;
+        ty1 = clamp_int(ty1, 0, grid.height - 1) / tilesize;
+
+        for(ty=ty0; ty<=ty1; ty++)
+            for(tx=tx0; tx<=tx1; tx++)
+                (*buckets)[ty * tiles_x + tx].append(cell);
+    }
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// inverse mapping table of a w x h tile at col0, row0 of the grid
+// sx and sy are the swath position of each pixel, sx is -1 outside the swath
+bool TReprojector::mapTile(const TGrid &grid, const QVector<int> &cells, int col0, int row0,
+                           int w, int h, float *sx, float *sy) const
+{
+ double qx[4], qy[4], u, v, sx0, sy0, sx1, sy1;
+ int    c, i, x, y, x0, x1, y0, y1, mi, mj;
+ bool   rc = false;
+
+    for(i=0; i<w*h; i++)
+        sx[i] = -1;
+
+    if(!mesh_valid)
+        return false;
+
+    for(c=0; c<cells.size(); c++) {
+        if(!cellCorners(cells.at(c), grid, qx, qy))
+            continue;
+
+        x0 = y0 = INT_MAX;
+        x1 = y1 = INT_MIN;
+        for(i=0; i<4; i++) {
+            qx[i] -= col0;
+            qy[i] -= row0;
+
+            x0 = qMin(x0, (int) floor(qx[i]));
+            x1 = qMax(x1, (int) ceil(qx[i]));
+            y0 = qMin(y0, (int) floor(qy[i]));
+            y1 = qMax(y1, (int) ceil(qy[i]));
+        }
+
+        x0 = clamp_int(x0, 0, w - 1);
+        x1 = clamp_int(x1, 0, w - 1);
+        y0 = clamp_int(y0, 0, h - 1);
+        y1 = clamp_int(y1, 0, h - 1);
+
+        mi = cells.at(c) % (mesh_cols - 1);
+        mj = cells.at(c) / (mesh_cols - 1);
+        sx0 = mi * RP_MESH_STEP;
+        sy0 = mj * RP_MESH_STEP;
+        sx1 = qMin((mi + 1) * RP_MESH_STEP, geo->width() - 1);
+        sy1 = qMin((mj + 1) * RP_MESH_STEP, geo->height() - 1);
+
+        for(y=y0; y<=y1; y++)
+            for(x=x0; x<=x1; x++) {
+                if(!inverse_bilinear(qx, qy, x + 0.5, y + 0.5, &u, &v))
+                    continue;
+
+                i = y * w + x;
+                sx[i] = (float) (sx0 + u * (sx1 - sx0));
+                sy[i] = (float) (sy0 + v * (sy1 - sy0));
+                rc = true;
+            }
+    }
+
+ return rc;
+}
+
+//---------------------------------------------------------------------------
+// tile is preallocated ARGB32, returns false if no pixel of the tile is in the swath
+bool TReprojector::renderTile(const TGrid &grid, const QVector<int> &cells,
+                              int col0, int row0, QImage *tile) const
+{
+ float  *sx, *sy;
+ uchar  rgb[3];
+ QRgb   *line;
+ int    w, h, i, x, y;
+ bool   rc = false;
+
+    w = tile->width();
+    h = tile->height();
+
+    sx = (float *) malloc(w * h * sizeof(float));
+    sy = (float *) malloc(w * h * sizeof(float));
+
+    if(sx && sy && mapTile(grid, cells, col0, row0, w, h, sx, sy))
+    for(y=0; y<h; y++) {
+        line = (QRgb *) tile->scanLine(y);
+
+        for(x=0; x<w; x++) {
+            i = y * w + x;
+            if(sx[i] < 0)
+                continue;
+
+            sample(sx[i], sy[i], rgb);
+            line[x] = qRgb(rgb[0], rgb[1], rgb[2]);
+            rc = true;
+        }
+    }
+
+    if(sx)
+        free(sx);
+    if(sy)
+        free(sy);
+
+ return rc;
+}
+
+//---------------------------------------------------------------------------
+// ESRI world file and .prj next to imagefile, pixel size and the center of
+// the upper left pixel in absolute coordinates of the .prj
+bool TReprojector::writeWorldFile(const QString &imagefile, const TGrid &grid, int col0, int row0)
+{
+    QFileInfo fi(imagefile);
+    QString suffix = fi.suffix();
+    QString base = fi.absolutePath() + "/" + fi.completeBaseName();
+
+    QFile file(base + "." + suffix.left(1) + suffix.right(1) + "w");
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+
+    QTextStream ts(&file);
+    ts.setRealNumberPrecision(12);
+    ts << grid.res << "\n0\n0\n" << -grid.res << "\n"
+       << grid.proj.meridianX() + grid.x0 + (col0 + 0.5) * grid.res << "\n"
+       << grid.y0 - (row0 + 0.5) * grid.res << "\n";
+    file.close();
+
+    QFile prj(base + ".prj");
+    if(!prj.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+
+    prj.write(grid.proj.wkt().toAscii());
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// swath pixel centers are at integer positions
+void TReprojector::sample(float sx, float sy, uchar *rgb) const
+{
+ const uchar *bits = src.bits();
+ double wx[4], wy[4], fx, fy, sum;
+ int    bpl, maxx, maxy, x, y, i, j, k, xi[4], yi[4];
+
+    bpl  = src.bytesPerLine();
+    maxx = src.width() - 1;
+    maxy = src.height() - 1;
+    sy  -= src_first;
+
+    switch(kernel) {
+    case Nearest_Kernel:
+        x = clamp_int((int) (sx + 0.5f), 0, maxx);
+        y = clamp_int((int) (sy + 0.5f), 0, maxy);
+        for(k=0; k<3; k++)
+            rgb[k] = bits[y * bpl + x * 3 + k];
+        break;
+
+    case Bilinear_Kernel:
+        x = (int) sx;
+        y = (int) sy;
+        fx = sx - x;
+        fy = sy - y;
+        xi[0] = clamp_int(x, 0, maxx);
+        xi[1] = clamp_int(x + 1, 0, maxx);
+        yi[0] = clamp_int(y, 0, maxy);
+        yi[1] = clamp_int(y + 1, 0, maxy);
+
+        for(k=0; k<3; k++) {
+            sum = (1.0 - fy) * ((1.0 - fx) * bits[yi[0] * bpl + xi[0] * 3 + k] + fx * bits[yi[0] * bpl + xi[1] * 3 + k]) +
+                         fy  * ((1.0 - fx) * bits[yi[1] * bpl + xi[0] * 3 + k] + fx * bits[yi[1] * bpl + xi[1] * 3 + k]);
+            rgb[k] = (uchar) (sum + 0.5);
+        }
+        break;
+
+    default:
+        x = (int) sx;
+        y = (int) sy;
+        cubic_weights(sx - x, wx);
+        cubic_weights(sy - y, wy);
+        for(i=0; i<4; i++) {
+            xi[i] = clamp_int(x + i - 1, 0, maxx) * 3;
+            yi[i] = clamp_int(y + i - 1, 0, maxy) * bpl;
+        }
+
+        for(k=0; k<3; k++) {
+            sum = 0;
+            for(j=0; j<4; j++)
+                for(i=0; i<4; i++)
+                    sum += wy[j] * wx[i] * bits[yi[j] + xi[i] + k];
+
+            rgb[k] = (uchar) clamp_int((int) (sum + 0.5), 0, 255);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+// writes <basename>_<row>_<col>.<format> tiles with world files and a
+// <basename>.ini describing the grid, returns the number of tiles or -1
+int TReprojector::writeTiles(const TGrid &grid, const QString &basename, const QString &format, int tilesize)
+{
+ QHash<int, QVector<int> > buckets;
+ QHash<int, QVector<int> >::const_iterator it;
+ QAtomicInt written(0);
+ QThreadPool pool;
+ QString    filename;
+ int        tiles_x, tiles_y, tx, ty, col0, row0;
+
+    if(!tileCells(grid, tilesize, &buckets))
+        return -1;
+
+    tiles_x = (grid.width + tilesize - 1) / tilesize;
+    tiles_y = (grid.height + tilesize - 1) / tilesize;
+
+    for(it=buckets.constBegin(); it!=buckets.constEnd(); ++it) {
+        tx = it.key() % tiles_x;
+        ty = it.key() / tiles_x;
+        col0 = tx * tilesize;
+        row0 = ty * tilesize;
+
+        filename.sprintf("%s_%03d_%03d.%s", basename.toStdString().c_str(), ty, tx,
+                         format.toStdString().c_str());
+
+        pool.start(new TReprojectTileJob(this, grid, it.value(), col0, row0,
+                                         qMin(tilesize, grid.width - col0),
+                                         qMin(tilesize, grid.height - row0),
+                                         filename, true, &written));
+    }
+
+    pool.waitForDone();
+
+    QSettings reg(basename + ".ini", QSettings::IniFormat);
+    reg.clear();
+    reg.beginGroup("Grid");
+       reg.setValue("Projection",      TProjection::getTypeStr(grid.proj.getType()));
+       reg.setValue("CentralMeridian", grid.proj.centralMeridian());
+       reg.setValue("Units",           grid.proj.unitStr());
+       reg.setValue("Resolution",      grid.res);
+       reg.setValue("X0",              grid.x0);
+       reg.setValue("Y0",              grid.y0);
+       reg.setValue("Width",           grid.width);
+       reg.setValue("Height",          grid.height);
+       reg.setValue("TileSize",        tilesize);
+       reg.setValue("TilesX",          tiles_x);
+       reg.setValue("TilesY",          tiles_y);
+       reg.setValue("Format",          format);
+    reg.endGroup();
+
+ return (int) written;
+}
+
+//---------------------------------------------------------------------------
+// Web Mercator tile pyramid, <dir>/<zoom>/<x>/<y>.png
+// every zoom level is resampled from the swath, returns the number of tiles or -1
+int TReprojector::writeXYZ(const QString &dir, int minzoom, int maxzoom)
+{
+ QHash<int, QVector<int> > buckets;
+ QHash<int, QVector<int> >::const_iterator it;
+ QAtomicInt  written(0);
+ QThreadPool pool;
+ TProjection proj(Mercator_Projection, 0);
+ TGrid       grid;
+ QString     filename;
+ double      world;
+ int         zoom, tiles, tx, ty;
+
+    if(minzoom < 0 || maxzoom > 15 || minzoom > maxzoom || !buildMesh(proj))
+        return -1;
+
+    world = proj.worldWidth();
+
+    for(zoom=minzoom; zoom<=maxzoom; zoom++) {
+        tiles = 1 << zoom;
+
+        grid.proj = proj;
+        grid.res = world / (RP_XYZ_TILE_SIZE * tiles);
+        grid.x0 = -world / 2.0;
+        grid.y0 = world / 2.0;
+        grid.width = grid.height = RP_XYZ_TILE_SIZE * tiles;
+
+        if(!tileCells(grid, RP_XYZ_TILE_SIZE, &buckets))
+            break;
+
+        for(it=buckets.constBegin(); it!=buckets.constEnd(); ++it) {
+            tx = it.key() % tiles;
+            ty = it.key() / tiles;
+
+            filename.sprintf("%s/%d/%d/%d.png", dir.toStdString().c_str(), zoom, tx, ty);
+
+            pool.start(new TReprojectTileJob(this, grid, it.value(),
+                                             tx * RP_XYZ_TILE_SIZE, ty * RP_XYZ_TILE_SIZE,
+                                             RP_XYZ_TILE_SIZE, RP_XYZ_TILE_SIZE,
+                                             filename, false, &written));
+        }
+
+        // one zoom level in flight, the cell lists are copied to the jobs
+        pool.waitForDone();
+    }
+
+ return (int) written;
+}
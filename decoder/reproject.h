@@ -0,0 +1,103 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef REPROJECT_H
+#define REPROJECT_H
+
+#include <QImage>
+#include <QString>
+#include <QVector>
+#include <QHash>
+
+#include "projection.h"
+
+#define RP_TILE_SIZE        512     // GeoTIFF style tiles
+#define RP_XYZ_TILE_SIZE    256     // XYZ (slippy map) tiles
+#define RP_XYZ_MIN_ZOOM     3
+#define RP_XYZ_MAX_ZOOM     8       // 611 m pixels, about half of the AVHRR nadir resolution
+#define RP_MESH_STEP        16      // swath pixels between the inverse mapping mesh points
+#define RP_RESOLUTION       1100.0  // default output pixel size in metres
+
+class TGeoLocation;
+
+//---------------------------------------------------------------------------
+typedef enum Resample_Kernel_t
+{
+    Nearest_Kernel = 0,
+    Bilinear_Kernel,
+    Cubic_Kernel
+} Resample_Kernel;
+
+//---------------------------------------------------------------------------
+/*
+  Resamples a decoded pass to a map projection.
+  The swath is covered by a mesh of geolocated points, every mesh cell is
+  projected to the output grid and inverted bilinearly, which gives the
+  swath position of every output pixel (the inverse mapping table).
+  Output is written tile by tile on a thread pool, each tile is rendered
+  from the mesh cells it overlaps so the full resolution map raster is
+  never in memory. Pixels outside the swath are transparent.
+  A long swath can be fed in bands of scan lines with setRows(), the mesh
+  is of the whole geolocation and tileCells() picks the cells of a band.
+*/
+class TReprojector
+{
+public:
+    TReprojector(const QImage *image_, const TGeoLocation *geo_);
+    ~TReprojector(void);
+
+    bool setRows(const QImage *rows, int first);
+    void setKernel(Resample_Kernel kernel_) { kernel = kernel_; }
+    Resample_Kernel getKernel(void) const { return kernel; }
+
+    bool autoGrid(const TProjection &proj, double resolution, TGrid *grid);
+    int  writeTiles(const TGrid &grid, const QString &basename, const QString &format = "png",
+                    int tilesize = RP_TILE_SIZE);
+    int  writeXYZ(const QString &dir, int minzoom = RP_XYZ_MIN_ZOOM, int maxzoom = RP_XYZ_MAX_ZOOM);
+
+    // building blocks of the tile writers, mapTile() and sample() are thread safe
+    bool tileCells(const TGrid &grid, int tilesize, QHash<int, QVector<int> > *buckets,
+                   int first_line = 0, int last_line = -1);
+    bool mapTile(const TGrid &grid, const QVector<int> &cells, int col0, int row0,
+                 int w, int h, float *sx, float *sy) const;
+    bool renderTile(const TGrid &grid, const QVector<int> &cells, int col0, int row0, QImage *tile) const;
+    void sample(float sx, float sy, uchar *rgb) const;
+
+    static bool writeWorldFile(const QString &imagefile, const TGrid &grid, int col0, int row0);
+
+protected:
+    bool buildMesh(const TProjection &proj);
+    bool cellCorners(int cell, const TGrid &grid, double *px, double *py) const;
+
+private:
+    QImage          src;    // RGB888, scan lines src_first...
+    int             src_first;
+    const TGeoLocation *geo;
+    Resample_Kernel kernel;
+
+    // projected mesh, NaN where the projection is undefined
+    double      *mesh_x, *mesh_y;
+    int         mesh_cols, mesh_rows;
+    TProjection mesh_proj;
+    bool        mesh_valid;
+};
+
+#endif // REPROJECT_H
@@ -0,0 +1,374 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <QCoreApplication>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <QScrollBar>
+#include <math.h>
+
+#include "imageview.h"
+
+//---------------------------------------------------------------------------
+TImageView::TImageView(QWidget *parent) :
+    QAbstractScrollArea(parent)
+{
+    image = NULL;
+    zoom_level = 0;
+    dragging = false;
+
+    pixmaps.setMaxCost(IV_PIXMAP_CACHE);
+    pyramid.setMaxCost(IV_PYRAMID_CACHE);
+
+    setBackgroundRole(QPalette::Dark);
+    viewport()->setBackgroundRole(QPalette::Dark);
+
+    horizontalScrollBar()->setSingleStep(IV_TILE_SIZE / 8);
+    verticalScrollBar()->setSingleStep(IV_TILE_SIZE / 8);
+}
+
+//---------------------------------------------------------------------------
+TImageView::~TImageView(void)
+{
+}
+
+//---------------------------------------------------------------------------
+// image is not owned, NULL clears the view
+void TImageView::setImage(const QImage *image_)
+{
+    image = image_ && !image_->isNull() ? image_:NULL;
+
+    pixmaps.clear();
+    pyramid.clear();
+
+    updateScrollBars();
+    viewport()->update();
+}
+
+//---------------------------------------------------------------------------
+// drops the tiles of the rows on every level
+void TImageView::updateRows(int first, int last)
+{
+ int level, tx, ty, tiles_x;
+
+    if(image == NULL)
+        return;
+
+    first = qMax(first, 0);
+    last = qMin(last, image->height() - 1);
+
+    for(level=0; level<=-IV_MIN_ZOOM; level++) {
+        tiles_x = (levelWidth(level) + IV_TILE_SIZE - 1) / IV_TILE_SIZE;
+
+        for(ty=(first >> level) / IV_TILE_SIZE; ty<=(last >> level) / IV_TILE_SIZE; ty++)
+            for(tx=0; tx<tiles_x; tx++) {
+                pixmaps.remove(tileKey(level, tx, ty));
+                pyramid.remove(tileKey(level, tx, ty));
+            }
+    }
+
+    viewport()->update();
+}
+
+//---------------------------------------------------------------------------
+// TImageSink, the rows are painted while toImage continues
+bool TImageView::imageRows(int first, int last)
+{
+    updateRows(first, last);
+
+    QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+quint64 TImageView::tileKey(int level, int tx, int ty)
+{
+    return ((quint64) level << 48) | ((quint64) ty << 24) | (quint64) tx;
+}
+
+//---------------------------------------------------------------------------
+int TImageView::levelWidth(int level) const
+{
+    return image ? (image->width() + (1 << level) - 1) >> level:0;
+}
+
+//---------------------------------------------------------------------------
+int TImageView::levelHeight(int level) const
+{
+    return image ? (image->height() + (1 << level) - 1) >> level:0;
+}
+
+//---------------------------------------------------------------------------
+// level 0 is cut from the image, a reduced tile is the 2:1 mean of four tiles of the level below
+QImage TImageView::tileImage(int level, int tx, int ty)
+{
+ const uchar *s0, *s1;
+ uchar  *d;
+ QImage *cached, src, dst;
+ int    w, h, i, j, x, y, x1, k, ox, oy;
+
+    w = qMin(IV_TILE_SIZE, levelWidth(level) - tx * IV_TILE_SIZE);
+    h = qMin(IV_TILE_SIZE, levelHeight(level) - ty * IV_TILE_SIZE);
+
+    if(w <= 0 || h <= 0)
+        return QImage();
+
+    if(level == 0) {
+        src = image->copy(tx * IV_TILE_SIZE, ty * IV_TILE_SIZE, w, h);
+
+        return src.format() == QImage::Format_RGB888 ? src:src.convertToFormat(QImage::Format_RGB888);
+    }
+
+    cached = pyramid.object(tileKey(level, tx, ty));
+    if(cached)
+        return *cached;
+
+    dst = QImage(w, h, QImage::Format_RGB888);
+    dst.fill(0);
+
+    for(j=0; j<2; j++)
+        for(i=0; i<2; i++) {
+            src = tileImage(level - 1, tx * 2 + i, ty * 2 + j);
+            if(src.isNull())
+                continue;
+
+            ox = i * IV_TILE_SIZE / 2;
+            oy = j * IV_TILE_SIZE / 2;
+
+            for(y=0; y<src.height() && oy + y / 2 < h; y+=2) {
+                s0 = src.scanLine(y);
+                s1 = src.scanLine(qMin(y + 1, src.height() - 1));
+                d = dst.scanLine(oy + y / 2) + ox * 3;
+
+                for(x=0; x<src.width() && ox + x / 2 < w; x+=2) {
+                    x1 = qMin(x + 1, src.width() - 1);
+
+                    for(k=0; k<3; k++)
+                        d[(x / 2) * 3 + k] = (s0[x * 3 + k] + s0[x1 * 3 + k] +
+                                              s1[x * 3 + k] + s1[x1 * 3 + k] + 2) / 4;
+                }
+            }
+        }
+
+    pyramid.insert(tileKey(level, tx, ty), new QImage(dst), qMax(1, w * h * 3 / 1024));
+
+ return dst;
+}
+
+//---------------------------------------------------------------------------
+QPixmap *TImageView::tilePixmap(int level, int tx, int ty)
+{
+ quint64 key = tileKey(level, tx, ty);
+ QPixmap *pixmap;
+ QImage  tile;
+
+    pixmap = pixmaps.object(key);
+    if(pixmap)
+        return pixmap;
+
+    tile = tileImage(level, tx, ty);
+    if(tile.isNull())
+        return NULL;
+
+    pixmap = new QPixmap(QPixmap::fromImage(tile));
+    if(!pixmaps.insert(key, pixmap, qMax(1, tile.width() * tile.height() * 4 / 1024)))
+        return NULL;
+
+ return pixmaps.object(key);
+}
+
+//---------------------------------------------------------------------------
+// an image smaller than the viewport is centered
+QPoint TImageView::contentOffset(void) const
+{
+ double scale = ldexp(1.0, zoom_level);
+ int    x = 0, y = 0;
+
+    if(image) {
+        x = qMax(0, (viewport()->width() - (int) ceil(image->width() * scale)) / 2);
+        y = qMax(0, (viewport()->height() - (int) ceil(image->height() * scale)) / 2);
+    }
+
+ return QPoint(x, y);
+}
+
+//---------------------------------------------------------------------------
+void TImageView::updateScrollBars(void)
+{
+ double scale = ldexp(1.0, zoom_level);
+ int    w, h;
+
+    w = image ? (int) ceil(image->width() * scale):0;
+    h = image ? (int) ceil(image->height() * scale):0;
+
+    horizontalScrollBar()->setPageStep(viewport()->width());
+    horizontalScrollBar()->setRange(0, qMax(0, w - viewport()->width()));
+    verticalScrollBar()->setPageStep(viewport()->height());
+    verticalScrollBar()->setRange(0, qMax(0, h - viewport()->height()));
+}
+
+//---------------------------------------------------------------------------
+// anchor is the viewport position kept on the same image pixel
+void TImageView::setZoom(int level, const QPoint &anchor)
+{
+ double ix, iy, scale;
+ QPoint offset;
+
+    level = qBound(IV_MIN_ZOOM, level, IV_MAX_ZOOM);
+    if(level == zoom_level || image == NULL)
+        return;
+
+    offset = contentOffset();
+    scale = ldexp(1.0, zoom_level);
+    ix = (horizontalScrollBar()->value() + anchor.x() - offset.x()) / scale;
+    iy = (verticalScrollBar()->value() + anchor.y() - offset.y()) / scale;
+
+    zoom_level = level;
+    updateScrollBars();
+
+    scale = ldexp(1.0, zoom_level);
+    horizontalScrollBar()->setValue((int) (ix * scale) - anchor.x());
+    verticalScrollBar()->setValue((int) (iy * scale) - anchor.y());
+
+    viewport()->update();
+}
+
+//---------------------------------------------------------------------------
+void TImageView::zoomIn(void)
+{
+    setZoom(zoom_level + 1, viewport()->rect().center());
+}
+
+//---------------------------------------------------------------------------
+void TImageView::zoomOut(void)
+{
+    setZoom(zoom_level - 1, viewport()->rect().center());
+}
+
+//---------------------------------------------------------------------------
+void TImageView::paintEvent(QPaintEvent *event)
+{
+ QPainter painter(viewport());
+ QPixmap  *pixmap;
+ QPoint   offset;
+ QRect    r = event->rect();
+ double   scale, step;
+ int      level, tx, ty, tx0, tx1, ty0, ty1, x0, y0;
+
+    painter.fillRect(r, palette().dark());
+
+    if(image == NULL)
+        return;
+
+    // the level with at least one image pixel per screen pixel
+    level = zoom_level < 0 ? -zoom_level:0;
+    scale = ldexp(1.0, zoom_level + level);
+    step = IV_TILE_SIZE * scale;
+
+    offset = contentOffset();
+    x0 = offset.x() - horizontalScrollBar()->value();
+    y0 = offset.y() - verticalScrollBar()->value();
+
+    tx0 = qMax(0, (int) floor((r.left() - x0) / step));
+    ty0 = qMax(0, (int) floor((r.top() - y0) / step));
+    tx1 = qMin((levelWidth(level) - 1) / IV_TILE_SIZE, (int) floor((r.right() - x0) / step));
+    ty1 = qMin((levelHeight(level) - 1) / IV_TILE_SIZE, (int) floor((r.bottom() - y0) / step));
+
+    for(ty=ty0; ty<=ty1; ty++)
+        for(tx=tx0; tx<=tx1; tx++) {
+            pixmap = tilePixmap(level, tx, ty);
+            if(pixmap == NULL)
+                continue;
+
+            painter.drawPixmap(QRectF(x0 + tx * step, y0 + ty * step,
+                                      pixmap->width() * scale, pixmap->height() * scale),
+                               *pixmap, QRectF(pixmap->rect()));
+        }
+}
+
+//---------------------------------------------------------------------------
+void TImageView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+
+    updateScrollBars();
+}
+
+//---------------------------------------------------------------------------
+void TImageView::scrollContentsBy(int /*dx*/, int /*dy*/)
+{
+    viewport()->update();
+}
+
+//---------------------------------------------------------------------------
+// ctrl + wheel zooms at the mouse, the wheel alone scrolls
+void TImageView::wheelEvent(QWheelEvent *event)
+{
+    if(!(event->modifiers() & Qt::ControlModifier)) {
+        QAbstractScrollArea::wheelEvent(event);
+        return;
+    }
+
+    setZoom(zoom_level + (event->delta() > 0 ? 1:-1), event->pos());
+    event->accept();
+}
+
+//---------------------------------------------------------------------------
+void TImageView::mousePressEvent(QMouseEvent *event)
+{
+    if(event->button() != Qt::LeftButton) {
+        QAbstractScrollArea::mousePressEvent(event);
+        return;
+    }
+
+    drag_pos = event->pos();
+    dragging = true;
+    viewport()->setCursor(Qt::ClosedHandCursor);
+}
+
+//---------------------------------------------------------------------------
+void TImageView::mouseMoveEvent(QMouseEvent *event)
+{
+    if(!dragging) {
+        QAbstractScrollArea::mouseMoveEvent(event);
+        return;
+    }
+
+    horizontalScrollBar()->setValue(horizontalScrollBar()->value() - (event->pos().x() - drag_pos.x()));
+    verticalScrollBar()->setValue(verticalScrollBar()->value() - (event->pos().y() - drag_pos.y()));
+    drag_pos = event->pos();
+}
+
+//---------------------------------------------------------------------------
+void TImageView::mouseReleaseEvent(QMouseEvent *event)
+{
+    if(!dragging || event->button() != Qt::LeftButton) {
+        QAbstractScrollArea::mouseReleaseEvent(event);
+        return;
+    }
+
+    dragging = false;
+    viewport()->unsetCursor();
+}
@@ -0,0 +1,96 @@
+/*
+    POES-Decoder, a software for processing POES high resolution weather satellite images.
+    Copyright (C) 2009,2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef IMAGEVIEW_H
+#define IMAGEVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QCache>
+#include <QImage>
+#include <QPixmap>
+#include <QPoint>
+
+#include "block.h"
+
+#define IV_TILE_SIZE        256
+#define IV_MIN_ZOOM         -5              // 1:32, the coarsest level of the pyramid
+#define IV_MAX_ZOOM         3               // 8:1
+#define IV_PIXMAP_CACHE     (48 * 1024)     // kB of tiles on the display
+#define IV_PYRAMID_CACHE    (32 * 1024)     // kB of reduced tiles
+
+//---------------------------------------------------------------------------
+/*
+  Viewer of a decoded pass, replaces one pixmap of the whole image.
+  The image is cut to IV_TILE_SIZE tiles and reduced 2:1 per level to a
+  pyramid, a level is selected by the zoom. Tiles are built and
+  converted to pixmaps when they are painted and kept in bounded caches,
+  so only the visible part of a huge pass is on the display.
+  As a TImageSink the view drops the tiles of decoded rows and repaints
+  while toImage runs.
+*/
+class TImageView : public QAbstractScrollArea, public TImageSink
+{
+    Q_OBJECT
+
+public:
+    TImageView(QWidget *parent = 0);
+    ~TImageView(void);
+
+    void setImage(const QImage *image_);
+    void updateRows(int first, int last);
+    bool imageRows(int first, int last);
+
+    int  zoom(void) const { return zoom_level; }
+    void setZoom(int level, const QPoint &anchor);
+
+public slots:
+    void zoomIn(void);
+    void zoomOut(void);
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void resizeEvent(QResizeEvent *event);
+    void wheelEvent(QWheelEvent *event);
+    void mousePressEvent(QMouseEvent *event);
+    void mouseMoveEvent(QMouseEvent *event);
+    void mouseReleaseEvent(QMouseEvent *event);
+    void scrollContentsBy(int dx, int dy);
+
+    void    updateScrollBars(void);
+    QPoint  contentOffset(void) const;
+    int     levelWidth(int level) const;
+    int     levelHeight(int level) const;
+    QImage  tileImage(int level, int tx, int ty);
+    QPixmap *tilePixmap(int level, int tx, int ty);
+
+    static quint64 tileKey(int level, int tx, int ty);
+
+private:
+    const QImage *image;
+    QCache<quint64, QPixmap> pixmaps;
+    QCache<quint64, QImage>  pyramid;
+
+    int    zoom_level;      // 2^zoom_level screen pixels per image pixel
+    QPoint drag_pos;
+    bool   dragging;
+};
+
+#endif // IMAGEVIEW_H
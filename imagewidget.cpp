@@ -25,6 +25,7 @@
 #include "mainwindow.h"
 #include "block.h"
 #include "plist.h"
+#include "overlay.h"
 
 #define F_NO_EVENTS 256
 //---------------------------------------------------------------------------
@@ -85,6 +86,23 @@ void ImageWidget::setFrames(QString format, long int frames)
   m_ui->framesLabel->setText(str);
 }
 
+//---------------------------------------------------------------------------
+void ImageWidget::setQuality(const TPassQuality *quality)
+{
+ QString str;
+
+  if(quality == NULL || quality->getLines() == 0) {
+     m_ui->qualityLabel->clear();
+     m_ui->qualityLabel->setToolTip("");
+
+     return;
+  }
+
+  str.sprintf("Quality %.1f %%", quality->score());
+  m_ui->qualityLabel->setText(str);
+  m_ui->qualityLabel->setToolTip(quality->getSummaryStr());
+}
+
 //---------------------------------------------------------------------------
 bool ImageWidget::isNorthbound(void)
 {
@@ -100,6 +118,7 @@ void ImageWidget::setProperties(bool northbound)
     flags |= F_NO_EVENTS;
 
     m_ui->NorthboundCb->setChecked(northbound);
+    m_ui->overlayCb->setChecked(mw->getMapOverlay()->isEnabled());
     block->setNorthBound(isNorthbound());
     m_ui->channelSpinBox->setMaximum(block->getNumChannels());
     m_ui->channelSpinBox->setValue(1);
@@ -161,6 +180,17 @@ void ImageWidget::on_NorthboundCb_clicked()
     mw->renderImage();
 }
 
+//---------------------------------------------------------------------------
+// coastlines, borders and graticule, needs the passinfo of the frames
+void ImageWidget::on_overlayCb_clicked()
+{
+    if(flags & F_NO_EVENTS)
+        return;
+
+    mw->getMapOverlay()->setEnabled(m_ui->overlayCb->isChecked());
+    mw->renderImage();
+}
+
 //---------------------------------------------------------------------------
 void ImageWidget::on_enhanceCb_currentIndexChanged(int index)
 {
@@ -30,6 +30,7 @@ namespace Ui {
 
 //---------------------------------------------------------------------------
 class MainWindow;
+class TPassQuality;
 class QSize;
 class QString;
 
@@ -48,6 +49,7 @@ public:
     void  setMaxChannels(int channels);
 
     void setFrames(QString format, long int frames = 0);
+    void setQuality(const TPassQuality *quality);
 
 protected:
     void changeEvent(QEvent *e);
@@ -61,6 +63,7 @@ private:
 private slots:
     void on_enhanceCb_currentIndexChanged(int index);
     void on_NorthboundCb_clicked();
+    void on_overlayCb_clicked();
     void on_channelSpinBox_valueChanged(int value);
 };
 
@@ -32,6 +32,7 @@
 #endif
 
 #include "mainwindow.h"
+#include "rotorsim.h"
 
 int main(int argc, char *argv[])
 {    
@@ -39,6 +40,20 @@ int main(int argc, char *argv[])
 
     QApplication a(argc, argv);
     MainWindow w;
+    double speed;
+    int    i;
+
+    // -rotorsim [speed], fly the next pass against the rotor emulator and quit
+    i = a.arguments().indexOf("-rotorsim");
+    if(i > 0) {
+        speed = a.arguments().value(i + 1).toDouble();
+
+        if(!w.simulatePass(speed > 0 ? speed:RS_SIM_SPEED))
+            return 1;
+
+        return a.exec();
+    }
+
     w.show();
     return a.exec();
 }
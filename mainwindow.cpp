@@ -31,8 +31,10 @@
 
 #include "config.h"
 #include "plist.h"
+#include "satcatalog.h"
 
 #include "block.h"
+#include "imagewriter.h"
 #include "stationdialog.h"
 #include "station.h"
 #include "tledialog.h"
@@ -50,11 +52,20 @@
 #include "utils.h"
 #include "settings.h"
 #include "rig.h"
+#include "jobmanager.h"
+#include "passdecoder.h"
+#include "geolocation.h"
+#include "tlearchive.h"
+#include "reproject.h"
+#include "overlay.h"
+#include "imageview.h"
 
 #include "os.h"
 #include "version.h"
 
 #include "trackthread.h"
+#include "rotorsim.h"
+#include "tickscheduler.h"
 #include "cadusplitterdialog.h"
 
 //---------------------------------------------------------------------------
@@ -65,13 +76,17 @@ MainWindow::MainWindow(QWidget *parent)
 
   blockImage = NULL;
   block      = new TBlock;
+  geoloc     = new TGeoLocation;
+  overlay    = new TMapOverlay;
 
   qth       = new TStation;
-  satList   = new PList;
+  satList   = new TSatCatalog;
   settings  = new TSettings;
   rig       = new TRig;
   gps       = NULL;
   opensat   = new TSat;
+  jobs      = new TJobManager;
+  decoder   = new TPassDecoder(jobs);
 
   QCoreApplication::setOrganizationName("poes-weather");
   QCoreApplication::setOrganizationDomain("poes-weather.com");
@@ -79,26 +94,35 @@ MainWindow::MainWindow(QWidget *parent)
 
   createPaths();
 
+  // post rx jobs interrupted by the last exit are run again
+  jobs->setStateFile(getConfPath() + "/" + FILE_JOBS_INI);
+  jobs->restore();
+
   exitAct = new QAction(tr("E&xit"), this);
   exitAct->setShortcut(tr("Ctrl+Q"));
   exitAct->setStatusTip(tr("Exit USRP-POES-Decoder"));
   connect(exitAct, SIGNAL(triggered()), this, SLOT(close()));
   ui->menuFile->addAction(exitAct);
   ui->actionSave_As->setEnabled(false);
+  ui->actionSave_Calibrated->setEnabled(false);
+  ui->actionSave_Projected->setEnabled(false);
   ui->actionClose->setEnabled(false);
 
   ui->menuView->addAction(ui->mainToolBar->toggleViewAction());
   ui->mainToolBar->setWindowTitle("Toolbar");
 
-  imageLabel = new QLabel;
+  imageView = new TImageView;
+  setCentralWidget(imageView);
 
-  imageLabel->setBackgroundRole(QPalette::Dark);
-  imageLabel->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
-  imageLabel->setScaledContents(false);
+  zoomInAct = new QAction(tr("Zoom &In"), this);
+  zoomInAct->setShortcut(QKeySequence::ZoomIn);
+  connect(zoomInAct, SIGNAL(triggered()), imageView, SLOT(zoomIn()));
+  ui->menuView->addAction(zoomInAct);
 
-  ui->scrollArea->setWidget(imageLabel);
-  ui->scrollArea->setBackgroundRole(QPalette::Dark);
-  setCentralWidget(ui->scrollArea);
+  zoomOutAct = new QAction(tr("Zoom &Out"), this);
+  zoomOutAct->setShortcut(QKeySequence::ZoomOut);
+  connect(zoomOutAct, SIGNAL(triggered()), imageView, SLOT(zoomOut()));
+  ui->menuView->addAction(zoomOutAct);
 
   imageWidget = new ImageWidget(this);
   ui->menuView->addAction(imageWidget->toggleViewAction());
@@ -112,10 +136,16 @@ MainWindow::MainWindow(QWidget *parent)
 //---------------------------------------------------------------------------
 MainWindow::~MainWindow()
 {
+    // the tracker uses the job manager until it has stopped
+    delete trackWidget;
+    delete decoder;
+    delete jobs;
+
     delete ui;
 
     delete block;
-    delete imageLabel;
+    delete geoloc;
+    delete overlay;
 
     if(blockImage)
        delete blockImage;
@@ -271,7 +301,7 @@ void MainWindow::on_actionOpen_triggered()
      rc = renderImage();
 
   if(!rc) {
-     imageLabel->clear();
+     imageView->setImage(NULL);
      if(blockImage)
         delete blockImage;
      blockImage = NULL;
@@ -279,8 +309,11 @@ void MainWindow::on_actionOpen_triggered()
   }
 
   imageWidget->setFrames(block->getBlockTypeStr(index), block->getFrames());
+  imageWidget->setQuality(rc ? block->quality:NULL);
 
   ui->actionSave_As->setEnabled(rc);
+  ui->actionSave_Calibrated->setEnabled(rc && block->getBlockType() == HRPT_BlockType);
+  ui->actionSave_Projected->setEnabled(rc && geoloc->isValid());
   ui->actionClose->setEnabled(rc);
   setCaption(FileName);
 
@@ -325,21 +358,39 @@ bool MainWindow::processData(const char *filename, int blockType)
   }
 
   imageWidget->setProperties(rc ? opensat->isNorthbound():imageWidget->isNorthbound());
+  block->setAOSTime(rc ? opensat->rec_aostime:0);
 
   if(!block->open(filename)) {
      str.sprintf("No frames found in file %s", filename);
      ui->statusBar->showMessage(str);
 
      block->close();
+     geoloc->clear();
 
      return false;
   }
 
+  // reprocessing an old pass, use the archived elements closest to the recording
+  TSat geosat(opensat);
+  TTLERecord tle;
+  TTLEArchive archive(getTLEPath(1));
+
+  if(rc && archive.find(opensat->catnum, opensat->rec_aostime, &tle) &&
+     fabs(TTLELoader::epochDaynum(tle.line1) - opensat->rec_aostime) <
+     fabs(TTLELoader::epochDaynum(opensat->line1) - opensat->rec_aostime) &&
+     geosat.TLEKepCheck(opensat->name, tle.line1, tle.line2))
+     qDebug("geolocation: archived TLE epoch %.8s", tle.line1 + 20);
+
+  if(!rc || !geoloc->init(&geosat, block, opensat->isNorthbound()))
+     geoloc->clear();
+
   if(blockImage)
      delete blockImage;
 
   try {
      blockImage = new QImage(block->getWidth(), block->getHeight(), QImage::Format_RGB888);
+     if(!blockImage->isNull())
+        memset(blockImage->bits(), 0, blockImage->byteCount());
 
      qDebug("width: %d height: %d", block->getWidth(), block->getHeight());
   }
@@ -361,6 +412,8 @@ void MainWindow::on_actionSave_As_triggered()
 {
  QFileDialog dialog(this);
  QString fileName, str;
+ TImageWriter *writer;
+ bool rc, raw;
 
  if(!blockImage || FileName.isEmpty())
      return;
@@ -382,7 +435,24 @@ void MainWindow::on_actionSave_As_triggered()
 
  fileName = dialog.selectedFiles().at(0);
 
- if(blockImage->save(fileName, 0, 75))
+ // 16 bit TIFF/PNG and raw planar (all channels) are streamed from the
+ // decoder, NDVI and the other formats are saved from the rendered image
+ writer = TImageWriter::create(fileName);
+ str = QFileInfo(fileName).suffix().toLower();
+ raw = str == "bin" || str == "raw";
+
+ if(writer && block->hasScanLines() && (raw || block->getImageType() != NDVI_ImageType)) {
+    rc = block->toWriter(writer, raw ? 1:0);
+    delete writer;
+ }
+ else {
+    if(writer)
+       delete writer;
+
+    rc = blockImage->save(fileName, 0, 75);
+ }
+
+ if(rc)
     str.sprintf("Image saved: %s" ,fileName.toStdString().c_str());
  else
     str.sprintf("Failed to save image: %s" ,fileName.toStdString().c_str());
@@ -392,6 +462,120 @@ void MainWindow::on_actionSave_As_triggered()
  QApplication::restoreOverrideCursor();
 }
 
+//---------------------------------------------------------------------------
+// albedo (%) and brightness temperature (K) of the AVHRR channels,
+// 32 bit float for raw planar output, 0.01 units for 16 bit TIFF/PNG
+void MainWindow::on_actionSave_Calibrated_triggered()
+{
+ QFileDialog dialog(this);
+ QString fileName, str;
+ TImageWriter *writer;
+ bool rc, raw;
+
+ if(!blockImage || FileName.isEmpty())
+     return;
+
+ dialog.setAcceptMode(QFileDialog::AcceptSave);
+ dialog.setNameFilter("*.tif *.png *.bin");
+
+ QFileInfo fi(FileName);
+ dialog.setDirectory(fi.absoluteFilePath());
+ fileName.sprintf("%s-cal.bin", fi.baseName().toStdString().c_str());
+ dialog.selectFile(fileName);
+
+ if(!dialog.exec())
+    return;
+
+ QApplication::setOverrideCursor(Qt::WaitCursor);
+
+ fileName = dialog.selectedFiles().at(0);
+ str = QFileInfo(fileName).suffix().toLower();
+ raw = str == "bin" || str == "raw";
+
+ rc = false;
+ writer = TImageWriter::create(fileName);
+
+ if(writer == NULL)
+    str.sprintf("Unsupported format: %s" ,fileName.toStdString().c_str());
+ else if(!block->calibrate(opensat->name))
+    str.sprintf("No calibration for %s, see %s/%s", opensat->name, PATH_CONF, FILE_AVHRR_CAL_INI);
+ else {
+    rc = block->toWriter(writer, raw ? 3:2);
+
+    if(rc)
+       str.sprintf("Calibrated image saved: %s" ,fileName.toStdString().c_str());
+    else
+       str.sprintf("Failed to save image: %s" ,fileName.toStdString().c_str());
+ }
+
+ if(writer)
+    delete writer;
+
+ ui->statusBar->showMessage(str);
+
+ QApplication::restoreOverrideCursor();
+}
+
+//---------------------------------------------------------------------------
+// resamples the displayed image to a map projection, written as tiles
+void MainWindow::on_actionSave_Projected_triggered()
+{
+ static const char *tags[NUM_PROJECTIONS] = { "eqc", "npolar", "spolar", "merc" };
+ QStringList  items;
+ QString      item, dir, base, str;
+ TGeoLocation *geo;
+ TGrid        grid;
+ double       lat, lon;
+ int          i, count;
+ bool         ok;
+
+ geo = getGeoLocation();
+ if(!blockImage || FileName.isEmpty() || !geo->isValid())
+     return;
+
+ for(i=0; i<NUM_PROJECTIONS; i++)
+    items << TProjection::getTypeStr(i);
+ items << "XYZ tiles (Web Mercator)";
+
+ item = QInputDialog::getItem(this, "Save Projected", "Projection", items, 0, false, &ok);
+ if(!ok)
+    return;
+
+ QFileInfo fi(FileName);
+ dir = QFileDialog::getExistingDirectory(this, "Select a directory for the tiles", fi.absolutePath());
+ if(dir.isEmpty())
+    return;
+
+ QApplication::setOverrideCursor(Qt::WaitCursor);
+
+ TReprojector rp(blockImage, geo);
+ base = dir + "/" + fi.baseName();
+ i = items.indexOf(item);
+
+ if(i == NUM_PROJECTIONS)
+    count = rp.writeXYZ(base + "-xyz");
+ else {
+    // cylindrical projections are centered on the pass
+    geo->latLon(geo->width() / 2, geo->height() / 2, &lat, &lon);
+    TProjection proj((Projection_Type) i,
+                     i == Equirectangular_Projection || i == Mercator_Projection ? lon:0);
+
+    if(rp.autoGrid(proj, RP_RESOLUTION / proj.metresPerUnit(), &grid))
+       count = rp.writeTiles(grid, base + "-" + tags[i]);
+    else
+       count = -1;
+ }
+
+ if(count < 0)
+    str.sprintf("Failed to project image: %s", FileName.toStdString().c_str());
+ else
+    str.sprintf("%d %s tiles saved in %s", count, item.toStdString().c_str(), dir.toStdString().c_str());
+
+ ui->statusBar->showMessage(str);
+
+ QApplication::restoreOverrideCursor();
+}
+
 //---------------------------------------------------------------------------
 void MainWindow::on_actionClose_triggered()
 {
@@ -399,13 +583,16 @@ void MainWindow::on_actionClose_triggered()
        delete blockImage;
     blockImage = NULL;
     block->close();
+    geoloc->clear();
 
     ui->statusBar->showMessage("");
     setCaption();
     imageWidget->setVisible(false);
 
-    imageLabel->setPixmap(NULL);
+    imageView->setImage(NULL);
     ui->actionClose->setEnabled(false);
+    ui->actionSave_Calibrated->setEnabled(false);
+    ui->actionSave_Projected->setEnabled(false);
 }
 
 //---------------------------------------------------------------------------
@@ -414,7 +601,7 @@ QString MainWindow::getImageFormats(void)
  QString imFormats, format;
  int i;
 
-  imFormats = "*.png *.bmp";
+  imFormats = "*.png *.bmp *.bin";
   for(i=0; i<QImageWriter::supportedImageFormats().count(); ++i)
   {
       format = QString(QImageWriter::supportedImageFormats().at(i)).toLower();
@@ -440,9 +627,22 @@ bool MainWindow::renderImage(void)
 
   QApplication::setOverrideCursor(Qt::WaitCursor);
 
+  // the view fills while the rows are decoded
+  imageView->setImage(blockImage);
+  block->setImageSink(imageView);
+
   rc = block->toImage(blockImage);
-  if(rc)
-     imageLabel->setPixmap(QPixmap::fromImage(*blockImage));
+
+  block->setImageSink(NULL);
+
+  // the link quality is known once every line has been read
+  if(rc && block->quality->isModified())
+     block->quality->save(TPassQuality::sidecarFile(FileName));
+
+  if(rc && overlay->isEnabled())
+     overlay->render(blockImage, getGeoLocation());
+
+  imageView->updateRows(0, blockImage->height() - 1);
 
   if(!imageWidget->isVisible())
      imageWidget->setVisible(true);
@@ -473,6 +673,8 @@ void MainWindow::readSettings(void)
     qth->readSettings(&reg);
     readSatelliteSettings();
     rig->readSettings(&reg);
+    jobs->readSettings(&reg);
+    overlay->readSettings(&reg);
 
     // window settings
     QDesktopWidget *desktop = QApplication::desktop();
@@ -573,6 +775,8 @@ void MainWindow::writeSettings(void)
     qth->writeSettings(&reg);
     writeSatelliteSettings();
     rig->writeSettings(&reg);
+    jobs->writeSettings(&reg);
+    overlay->writeSettings(&reg);
 }
 
 //---------------------------------------------------------------------------
@@ -621,6 +825,40 @@ void MainWindow::updateQTH(void)
     setCaption(blockImage != NULL ? FileName:"");
 }
 
+//---------------------------------------------------------------------------
+// -rotorsim, flies the next pass through the tracker and the rotor executor
+// against the rotor emulator on a simulated clock, speed times faster than
+// real time. The rig is changed for this run only, the settings are written
+// when the window is closed and it is never shown.
+bool MainWindow::simulatePass(double speed)
+{
+    TSimProto proto;
+    TSat      *sat;
+    double    aos;
+
+    rig->rotor->simulate = true;
+    rig->rotor->enable(true);
+    rig->autorecord(false);
+
+    if(!TRotorSim::protocolFor(rig->rotor, &proto)) {
+        qDebug("Rotor simulation: %s can not be emulated", rig->rotor->getRotorName().toStdString().c_str());
+        return false;
+    }
+
+    if(!(sat = getNextSat())) {
+        qDebug("Rotor simulation: no active satellites");
+        return false;
+    }
+
+    // the tracker finds the same pass, it is still ahead on the simulated clock
+    aos = rig->passthresholds() ? sat->rec_aostime:sat->aostime;
+    TTickScheduler::setSimulation(aos - RS_SIM_LEAD / 86400.0, speed);
+
+    qDebug("Rotor simulation: %s, %.0f times real time", sat->name, speed);
+
+    return trackWidget->startSimulation();
+}
+
 //---------------------------------------------------------------------------
 TSettings *MainWindow::getSettings(void)
 {
@@ -830,7 +1068,16 @@ void MainWindow::on_actionProperties_triggered()
 }
 
 //---------------------------------------------------------------------------
-PList *MainWindow::getSatList(void)
+// latitude and longitude of the open image, invalid without a passinfo file
+TGeoLocation *MainWindow::getGeoLocation(void)
+{
+    geoloc->setNorthbound(block->isNorthBound());
+
+    return geoloc;
+}
+
+//---------------------------------------------------------------------------
+TSatCatalog *MainWindow::getSatList(void)
 {
     return satList;
 }
@@ -34,13 +34,13 @@ namespace Ui
 
 //---------------------------------------------------------------------------
 class QSettings;
-class QLabel;
+class TImageView;
 class QImage;
 
 class THRPT;
 class TBlock;
 
-class PList;
+class TSatCatalog;
 class TStation;
 class TSat;
 class TSettings;
@@ -50,6 +50,10 @@ class ImageWidget;
 class TrackWidget;
 class TrackThread;
 class GPSDialog;
+class TJobManager;
+class TPassDecoder;
+class TGeoLocation;
+class TMapOverlay;
 
 //---------------------------------------------------------------------------
 class MainWindow : public QMainWindow
@@ -74,10 +78,15 @@ public:
     TSat      *getNextSatByName(const QString &name, double daynum_ = 0);
     TSettings *getSettings(void);
     TRig      *getRig(void);
-    PList     *getSatList(void);
+    TJobManager *getJobManager(void) { return jobs; }
+    TPassDecoder *getPassDecoder(void) { return decoder; }
+    TGeoLocation *getGeoLocation(void);
+    TMapOverlay *getMapOverlay(void) { return overlay; }
+    TSatCatalog *getSatList(void);
     TStation  *getQTH(void) { return qth; }
 
     void updateQTH(void);
+    bool simulatePass(double speed);
 
 private slots:
      void on_actionSplit_CADU_to_file_triggered();
@@ -89,6 +98,8 @@ private slots:
      void on_actionKeplerian_elements_triggered();
      void on_actionGroundstation_triggered();
      void on_actionSave_As_triggered();
+     void on_actionSave_Calibrated_triggered();
+     void on_actionSave_Projected_triggered();
      void on_actionOpen_triggered();
 
      void on_actionClose_triggered();
@@ -112,20 +123,24 @@ protected:
 
 private:
     Ui::MainWindow *ui;
-    QAction *exitAct;
+    QAction *exitAct, *zoomInAct, *zoomOutAct;
 
     QString FileName;
-    QLabel *imageLabel;
+    TImageView *imageView;
     QImage *blockImage;
 
 
     TBlock    *block;
-    PList     *satList;
+    TSatCatalog *satList;
     TStation  *qth;
     TSettings *settings;
     TRig      *rig;
     GPSDialog *gps;
     TSat      *opensat;
+    TJobManager *jobs;
+    TPassDecoder *decoder;
+    TGeoLocation *geoloc;
+    TMapOverlay *overlay;
 
     TrackWidget *trackWidget;
     ImageWidget  *imageWidget;
@@ -0,0 +1,175 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <math.h>
+
+#include "conicalscan.h"
+#include "utils.h"
+
+//---------------------------------------------------------------------------
+TConicalScan::TConicalScan(void)
+{
+    running = false;
+    t0 = 0;
+    radius = 1;
+    period = 10;
+    peak_x = peak_y = 0;
+    index = 0;
+    scans = moves = 0;
+
+    clearSums();
+}
+
+//---------------------------------------------------------------------------
+// a new pass, the peak estimate starts from the prediction
+void TConicalScan::start(double daynum, double _radius, double _period)
+{
+    t0 = daynum;
+    radius = _radius > 0 ? _radius:1;
+    period = _period > 1 ? _period:1;
+    peak_x = peak_y = 0;
+    index = 0;
+    scans = moves = 0;
+    running = true;
+
+    clearSums();
+}
+
+//---------------------------------------------------------------------------
+void TConicalScan::clearSums(void)
+{
+    n = 0;
+    sc = ss = scc = sss = scs = 0;
+    sv = svv = svc = svs = 0;
+}
+
+//---------------------------------------------------------------------------
+double TConicalScan::phase(double daynum) const
+{
+    return 2.0 * M_PI * fmod((daynum - t0) * 86400.0 / period, 1.0);
+}
+
+//---------------------------------------------------------------------------
+int TConicalScan::period_index(double daynum) const
+{
+    return (int) floor((daynum - t0) * 86400.0 / period);
+}
+
+//---------------------------------------------------------------------------
+// az/el to add to the predicted position at daynum
+void TConicalScan::offset(double daynum, double el, double *daz, double *del) const
+{
+    double a, x, y, c;
+
+    *daz = *del = 0;
+
+    if(!running)
+        return;
+
+    a = phase(daynum);
+    x = peak_x + radius * cos(a);
+    y = peak_y + radius * sin(a);
+
+    c = cos(el * DTR);
+    if(c < CS_MIN_COS_EL)
+        c = CS_MIN_COS_EL;
+
+    *daz = x / c;
+    *del = y;
+}
+
+//---------------------------------------------------------------------------
+// signal value received at daynum, returns true when the peak moved
+bool TConicalScan::addSample(double daynum, double value)
+{
+    double a, c, s;
+    bool   moved = false;
+    int    i;
+
+    if(!running)
+        return false;
+
+    i = period_index(daynum);
+    if(i != index) {
+        moved = evaluate();
+        clearSums();
+        index = i;
+    }
+
+    a = phase(daynum);
+    c = cos(a);
+    s = sin(a);
+
+    n++;
+    sc += c;  ss += s;
+    scc += c * c;  sss += s * s;  scs += c * s;
+    sv += value;  svv += value * value;
+    svc += value * c;  svs += value * s;
+
+    return moved;
+}
+
+//---------------------------------------------------------------------------
+// fits the turn, Cramer's rule on the 3x3 normal equations
+bool TConicalScan::evaluate(void)
+{
+    double det, a, b, c, rss, se, g, step;
+
+    if(n < CS_MIN_SAMPLES)
+        return false;
+
+    scans++;
+
+    det = n * (scc * sss - scs * scs) - sc * (sc * sss - scs * ss) + ss * (sc * scs - scc * ss);
+    if(fabs(det) < 1e-9)
+        return false;
+
+    a = (sv * (scc * sss - scs * scs) - sc * (svc * sss - scs * svs) + ss * (svc * scs - scc * svs)) / det;
+    b = (n * (svc * sss - scs * svs) - sv * (sc * sss - scs * ss) + ss * (sc * svs - svc * ss)) / det;
+    c = (n * (scc * svs - svc * scs) - sc * (sc * svs - svc * ss) + sv * (sc * scs - scc * ss)) / det;
+
+    // residual noise and the standard error of the gradient
+    rss = svv - (a * sv + b * svc + c * svs);
+    if(rss < 0)
+        rss = 0;
+
+    se = sqrt(rss / (n > 3 ? (n - 3):1) * 2.0 / n);
+    g = sqrt(b * b + c * c);
+
+    if(g <= CS_SIGNIFICANCE * se || g == 0)
+        return false;
+
+    step = radius / 2.0;
+
+    peak_x += step * b / g;
+    peak_y += step * c / g;
+
+    // stay in the beam of the prediction
+    g = sqrt(peak_x * peak_x + peak_y * peak_y);
+    if(g > CS_MAX_OFFSET) {
+        peak_x *= CS_MAX_OFFSET / g;
+        peak_y *= CS_MAX_OFFSET / g;
+    }
+
+    moves++;
+
+    return true;
+}
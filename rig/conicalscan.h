@@ -0,0 +1,77 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef CONICALSCAN_H
+#define CONICALSCAN_H
+
+#include <QtGlobal>
+
+#define CS_MIN_SAMPLES       6       // per scan to fit the signal gradient
+#define CS_MAX_OFFSET      3.0       // degrees from the predicted position
+#define CS_SIGNIFICANCE    2.0       // gradient / its standard error to move
+#define CS_MIN_COS_EL     0.17       // az offsets are limited above 80 degrees
+
+//---------------------------------------------------------------------------
+/*
+  Conical scan around the predicted position. The antenna circles the
+  estimated peak with the wobble radius, one turn per period. After
+  every turn the signal samples are fitted with a + b cos(phase) +
+  c sin(phase), a significant (b, c) points to the stronger signal and
+  the peak estimate moves half the radius towards it.
+  Offsets are in degrees, cross elevation and elevation, the phase is
+  a function of the trajectory time so the samples and the setpoints
+  agree.
+*/
+class TConicalScan
+{
+public:
+    TConicalScan(void);
+
+    void start(double daynum, double _radius, double _period);
+    void stop(void) { running = false; }
+    bool isRunning(void) const { return running; }
+
+    void offset(double daynum, double el, double *daz, double *del) const;
+    bool addSample(double daynum, double value);
+
+    double peakXel(void) const { return peak_x; }
+    double peakEl(void) const { return peak_y; }
+    int    scans, moves;
+
+protected:
+    double phase(double daynum) const;
+    int    period_index(double daynum) const;
+    bool   evaluate(void);
+    void   clearSums(void);
+
+private:
+    bool   running;
+    double t0, radius, period;
+    double peak_x, peak_y;
+    int    index;
+
+    // least squares sums of the current turn
+    int    n;
+    double sc, ss, scc, sss, scs;
+    double sv, svv, svc, svs;
+};
+
+#endif // CONICALSCAN_H
@@ -50,6 +50,7 @@ TGS232B::TGS232B(TRotor *_rotor)
     current_el = 0;
     speed      = Speed_Middle_1;
     flags      = 0;
+    reply_len  = 0;
 }
 
 //---------------------------------------------------------------------------
@@ -219,8 +220,6 @@ void TGS232B::stop(void)
 //---------------------------------------------------------------------------
 bool TGS232B::readPosition(void)
 {
- int angle;
-
     if(!isCOMOpen())
         return false;
 
@@ -238,14 +237,76 @@ bool TGS232B::readPosition(void)
 
     qDebug("%s", iobuff);
 
-    if(sscanf(iobuff+3, "%d", &angle) != 1) {
-        qDebug("wrong AZ/X reply %s", iobuff);
+    return parsePosition(iobuff);
+}
+
+//---------------------------------------------------------------------------
+// non blocking position read, sends C2 and returns at once
+// the reply is collected with pollPosition
+bool TGS232B::requestPosition(void)
+{
+    if(!isCOMOpen())
+        return false;
+
+    reply_len = 0;
+
+    sprintf(iobuff, "C2\r\n");
+
+    return write_buffer(iobuff);
+}
+
+//---------------------------------------------------------------------------
+// reads only the bytes already received
+// returns 1 when a position reply was parsed, 0 if it is not complete
+// and -1 on error
+int TGS232B::pollPosition(void)
+{
+ char ch;
+
+    if(!isCOMOpen())
+        return -1;
+
+    while(serialPort->bytesAvailable() > 0) {
+        if(!serialPort->getChar(&ch))
+            return -1;
+
+        if(ch == '\r' || ch == '\n') {
+            reply[reply_len] = '\0';
+            reply_len = 0;
+
+            // skip empty lines and anything else than AZ=xxx  EL=xxx
+            if(strncmp(reply, "AZ=", 3) == 0)
+                return parsePosition(reply) ? 1:-1;
+
+            continue;
+        }
+
+        if(reply_len >= (int) sizeof(reply) - 1)
+            reply_len = 0; // garbage, start over
+
+        reply[reply_len++] = ch;
+    }
+
+    return 0;
+}
+
+//---------------------------------------------------------------------------
+// AZ=000  EL=000
+bool TGS232B::parsePosition(const char *buf)
+{
+ int angle;
+
+    if(strlen(buf) < 14)
+        return false;
+
+    if(sscanf(buf+3, "%d", &angle) != 1) {
+        qDebug("wrong AZ/X reply %s", buf);
         return false;
     }
     current_az = angle;
 
-    if (sscanf(iobuff+11, "%d", &angle) != 1) {
-        qDebug("wrong EL/Y reply %s", iobuff);
+    if (sscanf(buf+11, "%d", &angle) != 1) {
+        qDebug("wrong EL/Y reply %s", buf);
         return false;
     }
     current_el = angle;
@@ -61,6 +61,8 @@ public:
     void stop(void);
 
     bool readPosition(void);
+    bool requestPosition(void);
+    int  pollPosition(void);
     unsigned long getRotationTime(double toAz, double toEl);
 
     double current_az, current_el; // in degrees, 0-90 el 0-360 az
@@ -71,12 +73,16 @@ public:
 protected:
     bool write_buffer(const char *buf);
     bool read_buffer(char *buf, unsigned long bytes);
+    bool parsePosition(const char *buf);
 
 private:
     TRotor *rotor;
     QextSerialPort *serialPort;
     char *iobuff;
 
+    char reply[32];
+    int  reply_len;
+
     QDateTime rotate_next;
 };
 
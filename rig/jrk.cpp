@@ -39,6 +39,7 @@ TJRK::TJRK(TRotor *_rotor)
     rotor = _rotor;
 
     flags = 0;
+    feedback_az = feedback_el = 0;
 
     usb = new TUSB;
     az_jrk = new TJrkUSB;
@@ -417,12 +418,10 @@ bool TJRK::readPosition(void)
     if(!isOpen())
         return false;
 
-    double az = az_jrk->readPos();
-    double el = el_jrk->readPos();
+    bool rc1 = !az_jrk->isOpen() || az_jrk->readPos(&feedback_az);
+    bool rc2 = !el_jrk->isOpen() || el_jrk->readPos(&feedback_el);
 
-    qDebug("JRK readPos Az: %g El: %g", az, el);
-
-    return true;
+    return (rc1 && rc2) ? true:false;
 }
 
 //---------------------------------------------------------------------------
@@ -87,6 +87,8 @@ public:
     double  current_az();
     double  current_el();
 
+    double  feedback_az, feedback_el;   // measured by readPosition
+
     int flags;
 
 protected:
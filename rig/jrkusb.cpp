@@ -244,9 +244,15 @@ unsigned short TJrkUSB::toValue(double deg, int mode)
 }
 
 //---------------------------------------------------------------------------
-double TJrkUSB::readPos(void)
+// scaled feedback, where the axis really is
+bool TJrkUSB::readPos(double *deg)
 {
-    return toDegrees(0, 1|2|8);
+    if(!isOpen() || !readVariables())
+        return false;
+
+    *deg = toDegrees(vars.scaledFeedback, 8);
+
+    return true;
 }
 
 //---------------------------------------------------------------------------
@@ -76,7 +76,7 @@ public:
     double  toDegrees(unsigned short t, int mode = 8); // always use lut if present
     unsigned short toValue(double deg, int mode = 1);
     bool    moveTo(double deg, int mode = 1);
-    double  readPos(void);
+    bool    readPos(double *deg);
 
     TUSBDevice *udev(void) { return jrk; }
     jrk_variables vars;
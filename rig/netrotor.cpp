@@ -0,0 +1,442 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <QTcpSocket>
+#include <QThread>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "netrotor.h"
+#include "rotor.h"
+#include "utils.h"
+
+//---------------------------------------------------------------------------
+TNetRotor::TNetRotor(TRotor *_rotor)
+{
+    rotor = _rotor;
+    socket = NULL;
+    want_open = false;
+
+    protocol = NetProto_Rotctld;
+
+    current_az = 0;
+    current_el = 0;
+
+    positions = wait_positions = 0;
+    failures = wait_failures = 0;
+
+    resetPipeline();
+}
+
+//---------------------------------------------------------------------------
+TNetRotor::~TNetRotor(void)
+{
+    close();
+}
+
+//---------------------------------------------------------------------------
+void TNetRotor::resetPipeline(void)
+{
+    req_head = req_count = 0;
+    line_len = 0;
+    get_lines = 0;
+    get_az = 0;
+}
+
+//---------------------------------------------------------------------------
+// the replies are lost or out of step, drops the requests in flight and
+// reconnects at once, a pending position request fails
+void TNetRotor::resync(const char *reason)
+{
+    qDebug("Rotor %s:%d: %s, reconnecting", rotor->host.toStdString().c_str(), rotor->port, reason);
+
+    last_error = reason;
+
+    if(req_count > 0)
+        failures++;
+
+    if(socket)
+        socket->abort();
+
+    resetPipeline();
+    reconnect_time = QTime();
+}
+
+//---------------------------------------------------------------------------
+// connects and reads the position, blocks up to NR_CONNECT_TIMEOUT
+bool TNetRotor::open(void)
+{
+    if(isOpen())
+        return true;
+
+    want_open = true;
+    reconnect_time = QTime();
+    last_error = "";
+
+    connectSocket();
+
+    if(socket && socket->state() != QAbstractSocket::ConnectedState &&
+       !socket->waitForConnected(NR_CONNECT_TIMEOUT))
+    {
+        last_error = socket->errorString();
+        qDebug("Rotor %s:%d: %s", rotor->host.toStdString().c_str(), rotor->port,
+               last_error.toStdString().c_str());
+
+        return false;
+    }
+
+    return readPosition();
+}
+
+//---------------------------------------------------------------------------
+bool TNetRotor::isOpen(void)
+{
+    return want_open && socket && socket->state() == QAbstractSocket::ConnectedState;
+}
+
+//---------------------------------------------------------------------------
+void TNetRotor::close(void)
+{
+    want_open = false;
+
+    // the executor thread has no event loop, a deleteLater() would never
+    // run, the socket is closed after abort() so delete it directly
+    if(socket) {
+        socket->abort();
+        delete socket;
+    }
+
+    socket = NULL;
+    resetPipeline();
+}
+
+//---------------------------------------------------------------------------
+QString TNetRotor::errorString(void)
+{
+    QString str;
+
+    str.sprintf("%s %s:%d\n\n",
+                protocol == NetProto_Rotctld ? "Hamlib rotctld":"GS-232 over TCP",
+                rotor->host.toStdString().c_str(), rotor->port);
+
+    if(!isOpen())
+        str += "Failed to connect: " + last_error;
+    else
+        str += "Failed to read position! " + last_error;
+
+    return str;
+}
+
+//---------------------------------------------------------------------------
+// non blocking, starts a new connection when needed
+bool TNetRotor::connectSocket(void)
+{
+    if(!want_open)
+        return false;
+
+    // sockets can not be used across threads, reconnect in this one
+    if(socket && socket->thread() != QThread::currentThread()) {
+        socket->abort();
+        delete socket;
+        socket = NULL;
+    }
+
+    if(socket == NULL) {
+        socket = new QTcpSocket;
+        reconnect_time = QTime();
+    }
+
+    if(socket->state() == QAbstractSocket::UnconnectedState) {
+        if(reconnect_time.isValid() && reconnect_time.elapsed() < NR_RECONNECT_MS)
+            return false;
+
+        reconnect_time.start();
+        resetPipeline();
+
+        socket->connectToHost(rotor->host, rotor->port);
+    }
+
+    if(socket->state() != QAbstractSocket::ConnectedState)
+        socket->waitForConnected(0);
+
+    return socket->state() == QAbstractSocket::ConnectedState;
+}
+
+//---------------------------------------------------------------------------
+// queues the command, request is the reply it waits for or 0
+bool TNetRotor::send(const char *cmd, int request)
+{
+    qint64 len = strlen(cmd);
+
+    if(request && req_count >= NR_MAX_INFLIGHT)
+        return false;
+
+    if(socket->write(cmd, len) != len) {
+        last_error = socket->errorString();
+        return false;
+    }
+
+    socket->flush();
+
+    if(request) {
+        requests[(req_head + req_count) % NR_MAX_INFLIGHT] = request;
+        sent[(req_head + req_count) % NR_MAX_INFLIGHT].start();
+        req_count++;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void TNetRotor::popRequest(void)
+{
+    if(req_count == 0)
+        return;
+
+    req_head = (req_head + 1) % NR_MAX_INFLIGHT;
+    req_count--;
+    get_lines = 0;
+}
+
+//---------------------------------------------------------------------------
+// reads the replies already received, never waits
+bool TNetRotor::pump(void)
+{
+    char ch;
+
+    if(!connectSocket())
+        return false;
+
+    socket->waitForReadyRead(0);
+
+    while(socket->bytesAvailable() > 0 && socket->getChar(&ch)) {
+        if(ch == '\r' || ch == '\n') {
+            line[line_len] = '\0';
+            if(line_len > 0)
+                parseLine(line);
+
+            line_len = 0;
+            continue;
+        }
+
+        if(line_len >= (NR_LINE_SIZE - 1))
+            line_len = 0; // garbage, start over
+
+        line[line_len++] = ch;
+    }
+
+    // the oldest request is never answered
+    if(req_count > 0 && sent[req_head].elapsed() > NR_REPLY_TIMEOUT)
+        resync("no reply");
+
+    return socket->state() == QAbstractSocket::ConnectedState;
+}
+
+//---------------------------------------------------------------------------
+void TNetRotor::parseLine(const char *buf)
+{
+    int request = req_count ? requests[req_head]:0;
+    int code, angle;
+    double v;
+
+    if(protocol == NetProto_GS232) {
+        // AZ=000  EL=000, nothing else has a reply, ?> is an error
+        if(request != NR_REQ_GET)
+            return;
+
+        if(strncmp(buf, "AZ=", 3) != 0 || strlen(buf) < 14) {
+            last_error.sprintf("GS-232 reply %s", buf);
+            failures++;
+            popRequest();
+            return;
+        }
+
+        if(sscanf(buf+3, "%d", &angle) == 1) {
+            current_az = angle;
+
+            if(sscanf(buf+11, "%d", &angle) == 1) {
+                current_el = angle;
+                positions++;
+            }
+            else
+                failures++;
+        }
+        else
+            failures++;
+
+        popRequest();
+        return;
+    }
+
+    // rotctld, RPRT n ends a set or stop and any failed request
+    if(strncmp(buf, "RPRT", 4) == 0) {
+        code = atoi(buf + 4);
+
+        if(code != 0) {
+            last_error.sprintf("rotctld error %d", code);
+            qDebug("Rotor %s", last_error.toStdString().c_str());
+
+            if(request == NR_REQ_GET)
+                failures++;
+        }
+
+        popRequest();
+        return;
+    }
+
+    // a set or stop is answered by RPRT only
+    if(request != NR_REQ_GET) {
+        resync("unexpected reply");
+        return;
+    }
+
+    if(sscanf(buf, "%lf", &v) != 1) {
+        resync("garbled reply");
+        return;
+    }
+
+    if(get_lines == 0) {
+        get_az = v;
+        get_lines = 1;
+    }
+    else {
+        current_az = get_az;
+        current_el = v;
+        positions++;
+
+        popRequest();
+    }
+}
+
+//---------------------------------------------------------------------------
+bool TNetRotor::moveTo(double az, double el)
+{
+    char cmd[NR_LINE_SIZE];
+    double x, y;
+
+    // read the replies of the previous commands first
+    if(!pump())
+        return false;
+
+    if(protocol == NetProto_GS232) {
+        if(rotor->isXY()) {
+            rotor->AzEltoXY(az, el, &x, &y);
+            az = x;
+            el = y;
+        }
+
+        az = ClipValue(rint(az), 360, 0);
+        el = ClipValue(rint(el), 180, 0);
+
+        if(az == current_az && el == current_el)
+            return true;
+
+        sprintf(cmd, "W%03d %03d\r\n", (int) az, (int) el);
+
+        if(!send(cmd, 0))
+            return false;
+    }
+    else {
+        sprintf(cmd, "P %.2f %.2f\n", az, el);
+
+        if(!send(cmd, NR_REQ_SET))
+            return false;
+    }
+
+    current_az = az;
+    current_el = el;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool TNetRotor::moveToAz(double az)
+{
+    return moveTo(az, current_el);
+}
+
+//---------------------------------------------------------------------------
+bool TNetRotor::moveToEl(double el)
+{
+    return moveTo(current_az, el);
+}
+
+//---------------------------------------------------------------------------
+void TNetRotor::stop(void)
+{
+    if(!pump())
+        return;
+
+    if(protocol == NetProto_GS232)
+        send("S\r\n", 0);
+    else
+        send("S\n", NR_REQ_STOP);
+}
+
+//---------------------------------------------------------------------------
+// non blocking, the reply is collected with pollPosition
+bool TNetRotor::requestPosition(void)
+{
+    if(!pump())
+        return false;
+
+    wait_positions = positions;
+    wait_failures = failures;
+
+    if(protocol == NetProto_GS232)
+        return send("C2\r\n", NR_REQ_GET);
+    else
+        return send("p\n", NR_REQ_GET);
+}
+
+//---------------------------------------------------------------------------
+// returns 1 when a new position was read, 0 if not yet and -1 on error
+int TNetRotor::pollPosition(void)
+{
+    if(!pump())
+        return -1;
+
+    if(positions != wait_positions)
+        return 1;
+
+    return failures != wait_failures ? -1:0;
+}
+
+//---------------------------------------------------------------------------
+bool TNetRotor::readPosition(void)
+{
+    QTime t;
+    int rc;
+
+    if(!requestPosition())
+        return false;
+
+    t.start();
+
+    while((rc = pollPosition()) == 0 && t.elapsed() < NR_REPLY_TIMEOUT)
+        socket->waitForReadyRead(100);
+
+    return rc == 1;
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,118 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef NETROTOR_H
+#define NETROTOR_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QTime>
+
+#define NR_MAX_INFLIGHT        8    // pipelined requests waiting for a reply
+#define NR_CONNECT_TIMEOUT  3000    // milliseconds, open only
+#define NR_REPLY_TIMEOUT    2000    // milliseconds, a request without a reply resyncs
+#define NR_RECONNECT_MS     2000    // wait between reconnect attempts
+#define NR_LINE_SIZE          64
+
+// requests waiting for a reply
+#define NR_REQ_SET             1    // rotctld P, RPRT
+#define NR_REQ_GET             2    // rotctld p, GS-232 C2
+#define NR_REQ_STOP            3    // rotctld S, RPRT
+
+class TRotor;
+class QTcpSocket;
+
+//---------------------------------------------------------------------------
+typedef enum TNetProtocol_t
+{
+    NetProto_GS232 = 0,     // raw Yaesu GS-232 over a TCP serial server
+    NetProto_Rotctld        // Hamlib rotctld
+} TNetProtocol;
+
+//---------------------------------------------------------------------------
+/*
+  TCP rotor transport, commands are written without waiting for the
+  previous reply (up to NR_MAX_INFLIGHT) and the replies are matched
+  in order when they are read. Nothing blocks except open and
+  readPosition. A lost connection is reconnected on the next command.
+  A request without a reply in NR_REPLY_TIMEOUT or a reply which does
+  not match the oldest request means the replies are out of step, the
+  connection is then dropped with the requests in flight and made again.
+  The socket belongs to the thread using it, it is recreated when the
+  rotor is driven from another thread.
+*/
+class TNetRotor
+{
+public:
+    TNetRotor(TRotor *_rotor);
+    ~TNetRotor(void);
+
+    TNetProtocol protocol;
+
+    bool open(void);
+    bool isOpen(void);
+    void close(void);
+    QString errorString(void);
+
+    bool moveTo(double az, double el);
+    bool moveToAz(double az);
+    bool moveToEl(double el);
+    void stop(void);
+
+    bool readPosition(void);
+    bool requestPosition(void);
+    int  pollPosition(void);
+
+    double current_az, current_el;
+
+protected:
+    bool connectSocket(void);
+    bool send(const char *cmd, int request);
+    bool pump(void);
+    void parseLine(const char *buf);
+    void popRequest(void);
+    void resetPipeline(void);
+    void resync(const char *reason);
+
+private:
+    TRotor     *rotor;
+    QTcpSocket *socket;
+    bool       want_open;
+    QTime      reconnect_time;
+
+    // requests in flight, FIFO
+    int   requests[NR_MAX_INFLIGHT];
+    QTime sent[NR_MAX_INFLIGHT];
+    int   req_head, req_count;
+
+    char line[NR_LINE_SIZE];
+    int  line_len;
+
+    double  get_az;
+    int     get_lines;      // rotctld replies az and el on separate lines
+    quint32 positions;      // position replies parsed
+    quint32 failures;       // failed position requests
+    quint32 wait_positions, wait_failures; // counts when requestPosition was called
+
+    QString last_error;
+};
+
+#endif // NETROTOR_H
@@ -70,7 +70,6 @@ TRig::TRig(void)
 
   rotor = new TRotor(this);
 
-#if 0
 #if defined(Q_OS_UNIX)
 
   oakHandle = -1;
@@ -78,7 +77,6 @@ TRig::TRig(void)
   oakEl = 0;
   oak_flags = 0;
 
-#endif
 #endif
 }
 
@@ -87,12 +85,10 @@ TRig::~TRig(void)
 {
     delete rotor;
 
-#if 0
 #if defined(Q_OS_UNIX)
 
     closeOak();
 
-#endif
 #endif
 }
 
@@ -102,7 +98,7 @@ void TRig::writeSettings(QSettings *reg)
     reg->beginGroup("Rig");
 
       reg->setValue("Flags", flags);
-      // reg->setValue("OakDevice", oak_device);
+      reg->setValue("OakDevice", oak_device);
 
       reg->beginGroup("Downconverter");
         reg->setValue("LBandLO", dc_lo_freq[DC_LO_L_BAND]);
@@ -129,7 +125,7 @@ void TRig::readSettings(QSettings *reg)
     reg->beginGroup("Rig");
 
       flags      = reg->value("Flags", 0).toInt();
-      // oak_device = reg->value("OakDevice", QString("/dev/hiddev0")).toString();
+      oak_device = reg->value("OakDevice", QString("/dev/hiddev0")).toString();
 
       reg->beginGroup("Downconverter");
         dc_lo_freq[DC_LO_L_BAND] = reg->value("LBandLO", 1557).toDouble();
@@ -191,7 +187,6 @@ void TRig::passthresholds(bool on)
 //  Toradex Oak USB azimuth/elevation sensor
 //
 //---------------------------------------------------------------------------
-#if 0
 #if defined(Q_OS_UNIX)
 bool TRig::isOakOpen(void)
 {
@@ -267,7 +262,6 @@ void TRig::closeOak(void)
 bool TRig::readAzEl(void)
 {
  EOakStatus status;
- double prevEl, prevAz;
 
  std::vector<int> values;
 
@@ -287,9 +281,6 @@ bool TRig::readAzEl(void)
    else if(values.size() < 4)
        return false;
 
-   prevEl = oakEl;
-   prevAz = oakAz;
-
 
    oakEl = oakRadToDeg(values[2], oakChannelInfo[0]);
    oakAz = oakRadToDeg(values[3], oakChannelInfo[1]);
@@ -309,10 +300,6 @@ bool TRig::readAzEl(void)
    if(oakEl > 90)
        oakEl = 180.0 - oakEl;
 
-   qDebug(" ");
-   qDebug("El Degrees: %f delta: %+f", oakEl, prevEl - oakEl);
-   qDebug("Az Degrees: %f delta: %+f", oakAz, prevAz - oakAz);
-
  return true;
 }
 
@@ -343,5 +330,4 @@ bool TRig::checkOak(EOakStatus status)
 //---------------------------------------------------------------------------
 
 #endif // #if defined(Q_OS_UNIX)
-#endif
 
@@ -87,6 +87,7 @@ public:
 
     // Oak USB
     QString oak_device;
+    bool oakEnabled(void) { return (flags & R_OAK_ENABLE) ? true:false; }
 
     // satellite recording thresholds
     PassThresholdType_t threshold;
@@ -95,7 +96,6 @@ public:
     // rotor
     TRotor *rotor;
 
-#if 0
 #if defined(Q_OS_UNIX)
 
     bool isOakOpen(void);
@@ -107,19 +107,16 @@ public:
     int    oak_flags;
 
 #endif
-#endif
 
 
 protected:
 
-#if 0
 #if defined(Q_OS_UNIX)
 
     bool   checkOak(EOakStatus status);
     double oakRadToDeg(double rad, ChannelInfo& chanInfo);
 
 #endif
-#endif
 
 private:
 
@@ -26,6 +26,9 @@
 #include "rig.h"
 #include "rotor.h"
 #include "utils.h"
+#include "netrotor.h"
+#include "rotorsim.h"
+#include "signalmonitor.h"
 #include "qextserialport.h"
 
 #define SER_IO_BUFF_SIZE 128
@@ -46,6 +49,8 @@ TRotor::TRotor(TRig *_rig)
     spid    = new TAlphaSpid(this);
     jrk     = new TJRK(this);
     monster = new TMonstrum(this);
+    net     = new TNetRotor(this);
+    sim     = new TRotorSim();
 
     parkAz = 0;
     parkEl = 90;
@@ -54,10 +59,16 @@ TRotor::TRotor(TRig *_rig)
     el_max = 90;  el_min = 0;
     az_speed = 20;
     el_speed = 20;
+    lead_ms  = 250;
+    track_rate = 4;
+    feedback_rate = 1;
 
     wobble_radius = 1;
+    wobble_period = 10;
+    signal_port = SM_DEFAULT_PORT;
 
     commtype = Comm_Default;
+    simulate = false;
     flags = 0;
 }
 
@@ -71,6 +82,8 @@ TRotor::~TRotor(void)
     delete spid;
     delete jrk;
     delete monster;
+    delete net;
+    delete sim;
 
     delete serialPort;
     delete serialPort_2;
@@ -92,6 +105,7 @@ void TRotor::writeSettings(QSettings *reg)
       reg->setValue("CommType", commtype);
       reg->setValue("Host", host);
       reg->setValue("Port", port);
+      reg->setValue("Simulate", simulate);
 
       reg->setValue("Park", parkingEnabled());
       reg->setValue("ParkAz", parkAz);
@@ -104,8 +118,13 @@ void TRotor::writeSettings(QSettings *reg)
 
       reg->setValue("AzSpeed", az_speed);
       reg->setValue("ElSpeed", el_speed);
+      reg->setValue("Lead", lead_ms);
+      reg->setValue("TrackRate", track_rate);
+      reg->setValue("FeedbackRate", feedback_rate);
 
       reg->setValue("WobbleRadius", wobble_radius);
+      reg->setValue("WobblePeriod", wobble_period);
+      reg->setValue("SignalPort", signal_port);
 
 
       stepper->writeSettings(reg);
@@ -128,6 +147,7 @@ void TRotor::readSettings(QSettings *reg)
       commtype = (TCommType) reg->value("CommType", 0).toInt();
       host = reg->value("Host", "192.168.1.10").toString();
       port = reg->value("Port", 1234).toInt();
+      simulate = reg->value("Simulate", false).toBool();
 
       parkingEnabled(reg->value("Park", 0).toBool());
       parkAz = reg->value("ParkAz", 0).toDouble();
@@ -140,8 +160,13 @@ void TRotor::readSettings(QSettings *reg)
 
       az_speed = reg->value("AzSpeed", 1).toInt();
       el_speed = reg->value("ElSpeed", 1).toInt();
+      lead_ms = reg->value("Lead", 250).toInt();
+      track_rate = reg->value("TrackRate", 4).toDouble();
+      feedback_rate = reg->value("FeedbackRate", 1).toDouble();
 
       wobble_radius = reg->value("WobbleRadius", 1).toDouble();
+      wobble_period = reg->value("WobblePeriod", 10).toDouble();
+      signal_port = reg->value("SignalPort", SM_DEFAULT_PORT).toInt();
 
       stepper->readSettings(reg);
       gs232b->readSettings(reg);
@@ -155,6 +180,11 @@ void TRotor::readSettings(QSettings *reg)
 //---------------------------------------------------------------------------
 QString TRotor::getErrorString(void)
 {
+    if(commtype == Comm_Network && rotor_type != RotorType_GS232B)
+        return "Network: only the Yaesu GS-232b protocol is supported over TCP, use Hamlib rotctld for " + getRotorName();
+    if(isNetwork())
+        return net->errorString();
+
     switch(rotor_type)
     {
     case RotorType_Stepper:  return stepper->errorString();
@@ -210,6 +240,18 @@ void TRotor::parkingEnabled(bool park)
 //---------------------------------------------------------------------------
 bool TRotor::openPort(void)
 {
+    if(simulate)
+        return openSimulator();
+
+    if(isNetwork()) {
+        if(commtype == Comm_Network && rotor_type != RotorType_GS232B)
+            return false;
+
+        net->protocol = commtype == Comm_Rotctld ? NetProto_Rotctld:NetProto_GS232;
+
+        return net->open();
+    }
+
     switch(rotor_type)
     {
     case RotorType_Stepper:  return stepper->openLPT();
@@ -231,11 +273,77 @@ void TRotor::closePort(void)
     spid->closeCOM();
     jrk->close();
     monster->closeCOM();
+    net->close();
+    sim->stop();
+}
+
+//---------------------------------------------------------------------------
+// starts the emulator and opens the driver on its pseudo terminal,
+// the network rotor must have 127.0.0.1 as the host
+bool TRotor::openSimulator(void)
+{
+    TSimProto proto;
+    QString   saved;
+    bool      rc;
+
+    if(!TRotorSim::protocolFor(this, &proto)) {
+        qDebug("Rotor simulator: %s can not be emulated", getRotorName().toStdString().c_str());
+        return false;
+    }
+
+    if(isNetwork()) {
+        if(!sim->startTcp(proto, this, port))
+            return false;
+
+        net->protocol = commtype == Comm_Rotctld ? NetProto_Rotctld:NetProto_GS232;
+
+        return net->open();
+    }
+
+    if(!sim->startPty(proto, this)) {
+        qDebug("Rotor simulator: %s", sim->errorString().toStdString().c_str());
+        return false;
+    }
+
+    switch(rotor_type)
+    {
+    case RotorType_GS232B:
+        saved = gs232b->deviceId;
+        gs232b->deviceId = sim->deviceName();
+        rc = gs232b->openCOM();
+        gs232b->deviceId = saved;
+        break;
+
+    case RotorType_SPID:
+        saved = spid->deviceId;
+        spid->deviceId = sim->deviceName();
+        rc = spid->openCOM();
+        spid->deviceId = saved;
+        break;
+
+    case RotorType_Monstrum:
+        saved = monster->deviceId;
+        monster->deviceId = sim->deviceName();
+        rc = monster->openCOM();
+        monster->deviceId = saved;
+        break;
+
+    default:
+        rc = false;
+    }
+
+    if(!rc)
+        sim->stop();
+
+    return rc;
 }
 
 //---------------------------------------------------------------------------
 bool TRotor::isPortOpen(void)
 {
+    if(isNetwork())
+        return net->isOpen();
+
     switch(rotor_type)
     {
     case RotorType_Stepper:  return stepper->isLPTOpen();
@@ -283,24 +391,24 @@ void TRotor::turnElOnlyWhenZenith(bool enable)
 }
 
 //---------------------------------------------------------------------------
-void TRotor::setCCWFlag(double aos_az, double los_az, double sat_max_el)
+// the mount flags of a pass, the rotor flags are not changed
+int TRotor::mountFlags(double aos_az, double los_az, double sat_max_el)
 {
     double delta = fabs(aos_az - los_az);
-
-    flags &= ~(R_ROTOR_CCW | R_ROTOR_ZENITH_PASS);
+    int    mount = 0;
 
 #if 1
     if(turnElOnlyWhenZenith() && sat_max_el > 87) {
         // minimize azimuth turning and turn elevation 180
         // recalculation of azimuth and elevation is done in the track-thread
-        flags |= R_ROTOR_ZENITH_PASS;
+        mount |= R_ROTOR_ZENITH_PASS;
 
         qDebug("rotor ZENITH_PASS flag set: turn elevation downto max elevation and less in azimuth");
     }
     else {
         // check if it will cross the north pole 0 <- 360 meridian counter clock wise
         if(!isXY() && el_max > 90 && delta > 185) {
-            flags |= R_ROTOR_CCW;
+            mount |= R_ROTOR_CCW;
 
             qDebug("rotor CCW flag set: 180 - elevation, 180 + azimuth");
         }
@@ -308,11 +416,22 @@ void TRotor::setCCWFlag(double aos_az, double los_az, double sat_max_el)
 #else
     // check if it will cross the north pole 0 <- 360 meridian counter clock wise
     if(!isXY() && el_max > 90 && delta > 185) {
-        flags |= R_ROTOR_CCW;
+        mount |= R_ROTOR_CCW;
 
         qDebug("rotor CCW flag set: 180 - elevation, 180 + azimuth");
     }
 #endif
+
+    return mount;
+}
+
+//---------------------------------------------------------------------------
+// R_ROTOR_CCW and R_ROTOR_ZENITH_PASS, moveTo reads them, so only the
+// thread which moves the rotor may set them, see TRotorExecutor
+void TRotor::setMountFlags(int mount)
+{
+    flags &= ~(R_ROTOR_CCW | R_ROTOR_ZENITH_PASS);
+    flags |= mount & (R_ROTOR_CCW | R_ROTOR_ZENITH_PASS);
 }
 
 //---------------------------------------------------------------------------
@@ -378,6 +497,9 @@ bool TRotor::moveTo(double az, double el)
 
     AzEltoCCW(az, el, &raz, &rel);
 
+    if(isNetwork())
+        return net->moveTo(raz, rel);
+
     switch(rotor_type)
     {
     case RotorType_Stepper:  return stepper->moveTo(raz, rel);
@@ -397,6 +519,9 @@ bool TRotor::moveToAz(double az)
     if(az < az_min || az > az_max)
         return false;
 
+    if(isNetwork())
+        return net->moveToAz(az);
+
     switch(rotor_type)
     {
     case RotorType_Stepper:  return stepper->moveToAz(az);
@@ -416,6 +541,9 @@ bool TRotor::moveToEl(double el)
     if(el < el_min || el > el_max)
         return false;
 
+    if(isNetwork())
+        return net->moveToEl(el);
+
     switch(rotor_type)
     {
     case RotorType_Stepper:  return stepper->moveToEl(el);
@@ -432,6 +560,11 @@ bool TRotor::moveToEl(double el)
 //---------------------------------------------------------------------------
 void TRotor::stopMotor(void)
 {
+    if(isNetwork()) {
+        net->stop();
+        return;
+    }
+
     switch(rotor_type)
     {
     case RotorType_GS232B:   gs232b->stop(); break;
@@ -447,6 +580,9 @@ void TRotor::stopMotor(void)
 //---------------------------------------------------------------------------
 bool TRotor::readPosition(void)
 {
+    if(isNetwork())
+        return net->readPosition();
+
     switch(rotor_type)
     {
     case RotorType_Stepper:  return true;
@@ -460,9 +596,58 @@ bool TRotor::readPosition(void)
     }
 }
 
+//---------------------------------------------------------------------------
+// true if the position can be read without waiting for the reply
+bool TRotor::hasAsyncPosition(void)
+{
+    return isNetwork() || rotor_type == RotorType_GS232B;
+}
+
+//---------------------------------------------------------------------------
+// non blocking position read, see hasAsyncPosition
+bool TRotor::requestPosition(void)
+{
+    if(isNetwork())
+        return net->requestPosition();
+    else if(rotor_type == RotorType_GS232B)
+        return gs232b->requestPosition();
+    else
+        return false;
+}
+
+//---------------------------------------------------------------------------
+// 1 = position read, 0 = waiting for the reply, -1 = error
+int TRotor::pollPosition(void)
+{
+    if(isNetwork())
+        return net->pollPosition();
+    else if(rotor_type == RotorType_GS232B)
+        return gs232b->pollPosition();
+    else
+        return -1;
+}
+
+//---------------------------------------------------------------------------
+// rotor axis angles of the last successful readPosition or pollPosition,
+// the Jrk keeps the feedback apart from the target position
+void TRotor::getMeasuredPosition(double *az, double *el)
+{
+    if(!isNetwork() && rotor_type == RotorType_JRK) {
+        *az = jrk->feedback_az;
+        *el = jrk->feedback_el;
+    }
+    else {
+        *az = getAzimuth();
+        *el = getElevation();
+    }
+}
+
 //---------------------------------------------------------------------------
 double TRotor::getAzimuth(void)
 {
+    if(isNetwork())
+        return net->current_az;
+
     switch(rotor_type)
     {
     case RotorType_Stepper: return stepper->current_az;
@@ -479,6 +664,9 @@ double TRotor::getAzimuth(void)
 //---------------------------------------------------------------------------
 double TRotor::getElevation(void)
 {
+    if(isNetwork())
+        return net->current_el;
+
     switch(rotor_type)
     {        
     case RotorType_Stepper: return stepper->current_el;
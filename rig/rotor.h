@@ -46,6 +46,8 @@ class TGS232B;
 class TAlphaSpid;
 class TJRK;
 class TMonstrum;
+class TNetRotor;
+class TRotorSim;
 
 class QextSerialPort;
 
@@ -64,7 +66,8 @@ typedef enum TRotorType_t
 typedef enum TCommType_t
 {
     Comm_Default,
-    Comm_Network
+    Comm_Network,       // rotor protocol over TCP, GS-232 only
+    Comm_Rotctld        // Hamlib rotctld
 } TCommType;
 
 //---------------------------------------------------------------------------
@@ -85,13 +88,20 @@ public:
     TAlphaSpid *spid;
     TJRK       *jrk;
     TMonstrum  *monster;
+    TNetRotor  *net;
+    TRotorSim  *sim;
 
     double      az_max, az_min, el_max, el_min;
     int         az_speed, el_speed;
+    int         lead_ms;        // command latency, the trajectory is sampled this far ahead
+    double      track_rate;     // trajectory setpoints per second
+    double      feedback_rate;  // position reads per second while tracking, 0 = open loop
 
     TCommType  commtype;
     QString    host;
     int        port;
+    bool       isNetwork(void) { return commtype != Comm_Default; }
+    bool       simulate;       // the driver talks to TRotorSim instead of the device
 
     QextSerialPort *serialPort;
     QextSerialPort *serialPort_2;
@@ -116,7 +126,8 @@ public:
     void AzEltoXY(double az, double el, double *x, double *y);
     void XYtoAzEl(double X, double Y, double *az, double *el);
 
-    void setCCWFlag(double aos_az, double los_az, double sat_maz_el);
+    int  mountFlags(double aos_az, double los_az, double sat_max_el);
+    void setMountFlags(int mount);
     bool isCCW(void);
 
 
@@ -140,6 +151,8 @@ public:
     void   setElevation(double el);
 
     double wobble_radius;
+    double wobble_period;   // seconds per conical scan turn
+    int    signal_port;     // udp port of the signal quality, see TSignalMonitor
     void wobbleEnable(bool enable);
     bool wobbleEnable(void) { return ((flags & R_ROTOR_WOBBLE) ? true:false); }
     void wobble(void);
@@ -149,11 +162,18 @@ public:
     bool isZenithPass(void) { return ((flags & R_ROTOR_ZENITH_PASS) ? true:false); }
 
     bool readPosition(void);
+    void getMeasuredPosition(double *az, double *el);
+    bool hasAsyncPosition(void);
+    bool requestPosition(void);
+    int  pollPosition(void);
     unsigned long getRotationTime(double toAz, double toEl);
 
     int  flags;
     char *iobuff;
 
+protected:
+    bool openSimulator(void);
+
 private:
 
 };
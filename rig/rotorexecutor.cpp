@@ -0,0 +1,668 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <QMutexLocker>
+#include <QSettings>
+#include <limits.h>
+#include <string.h>
+#include <math.h>
+
+#include "rotorexecutor.h"
+#include "rotorplanner.h"
+#include "signalmonitor.h"
+#include "rig.h"
+#include "utils.h"
+
+//---------------------------------------------------------------------------
+TRotorExecutor::TRotorExecutor(TRotor *_rotor, QObject *parent) : QThread(parent)
+{
+    rotor = _rotor;
+
+    pending = 0;
+    pending_move = false;
+    pending_az = 0;
+    pending_el = 0;
+    pending_mount = 0;
+    poll_ms = 0;
+
+    trajectory = new TRotorPlanner;
+    signal = new TSignalMonitor;
+    follow = false;
+    restart_stream = false;
+
+    memset(&stream_stats, 0, sizeof(TTickStats));
+    stream_rate = 0;
+
+    memset(&pos, 0, sizeof(TRotorPosition));
+    memset(&pstats, 0, sizeof(TPointingStats));
+
+    reply_wait = false;
+    reply_daynum = 0;
+    errors = 0;
+    oak = false;
+}
+
+//---------------------------------------------------------------------------
+TRotorExecutor::~TRotorExecutor(void)
+{
+    stop();
+    wait();
+
+    delete trajectory;
+    delete signal;
+}
+
+//---------------------------------------------------------------------------
+void TRotorExecutor::stop(void)
+{
+    QMutexLocker locker(&mutex);
+
+    if(!isRunning())
+        return;
+
+    pending |= RE_CMD_QUIT;
+    cond.wakeOne();
+}
+
+//---------------------------------------------------------------------------
+bool TRotorExecutor::post(int cmd)
+{
+    QMutexLocker locker(&mutex);
+
+    if(!isRunning())
+        return false;
+
+    // stopping cancels the pending move and the trajectory
+    if(cmd & RE_CMD_STOP) {
+        pending_move = false;
+        follow = false;
+    }
+
+    pending |= cmd;
+    cond.wakeOne();
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// returns at once, a move which is not yet executed is replaced
+bool TRotorExecutor::moveTo(double az, double el)
+{
+    QMutexLocker locker(&mutex);
+
+    if(!isRunning())
+        return false;
+
+    if(pending_move)
+        pos.dropped++;
+
+    pending &= ~RE_CMD_STOP;
+    pending_move = true;
+    pending_az = az;
+    pending_el = el;
+
+    cond.wakeOne();
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool TRotorExecutor::park(void)
+{
+    if(!rotor->parkingEnabled())
+        return false;
+
+    return moveTo(rotor->parkAz, rotor->parkEl);
+}
+
+//---------------------------------------------------------------------------
+bool TRotorExecutor::stopMotor(void)
+{
+    return post(RE_CMD_STOP);
+}
+
+//---------------------------------------------------------------------------
+bool TRotorExecutor::readPosition(void)
+{
+    return post(RE_CMD_READPOS);
+}
+
+//---------------------------------------------------------------------------
+bool TRotorExecutor::reinit(void)
+{
+    return post(RE_CMD_REINIT);
+}
+
+//---------------------------------------------------------------------------
+bool TRotorExecutor::startMotor(void)
+{
+    return post(RE_CMD_START);
+}
+
+//---------------------------------------------------------------------------
+// R_ROTOR_CCW and R_ROTOR_ZENITH_PASS, applied before the next move
+bool TRotorExecutor::setMountFlags(int mount)
+{
+    QMutexLocker locker(&mutex);
+
+    if(!isRunning())
+        return false;
+
+    pending_mount = mount;
+    pending |= RE_CMD_MOUNT;
+    cond.wakeOne();
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// the trajectory is copied, the planner can be reused by the caller
+bool TRotorExecutor::followTrajectory(const TRotorPlanner *planner)
+{
+    QMutexLocker locker(&mutex);
+
+    if(!isRunning() || !trajectory->copy(planner))
+        return false;
+
+    follow = true;
+    restart_stream = true;
+    pending_move = false;
+    memset(&pstats, 0, sizeof(TPointingStats));
+    cond.wakeOne();
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void TRotorExecutor::stopTrajectory(void)
+{
+    QMutexLocker locker(&mutex);
+
+    follow = false;
+}
+
+//---------------------------------------------------------------------------
+TTickStats TRotorExecutor::streamStats(void)
+{
+    QMutexLocker locker(&mutex);
+
+    return stream_stats;
+}
+
+//---------------------------------------------------------------------------
+QString TRotorExecutor::streamStatsString(void)
+{
+    QMutexLocker locker(&mutex);
+
+    return TTickScheduler::statsString(stream_stats, stream_rate);
+}
+
+//---------------------------------------------------------------------------
+TPointingStats TRotorExecutor::pointingStats(void)
+{
+    QMutexLocker locker(&mutex);
+
+    return pstats;
+}
+
+//---------------------------------------------------------------------------
+QString TRotorExecutor::pointingStatsString(void)
+{
+    TPointingStats ps = pointingStats();
+    QString str;
+
+    if(ps.samples == 0)
+        return "no position feedback";
+
+    str.sprintf("%u samples, pointing error max %.2f mean %.2f rms %.2f deg, %u over 1 deg, correction Az %+.2f El %+.2f",
+                ps.samples, ps.max_error, ps.sum / ps.samples, sqrt(ps.sum2 / ps.samples),
+                ps.over_1deg, ps.corr_az, ps.corr_el);
+
+    if(ps.scans > 0)
+        str += QString().sprintf(", conical scan %d turns, peak Xel %+.2f El %+.2f",
+                                 ps.scans, ps.peak_xel, ps.peak_el);
+
+    return str;
+}
+
+//---------------------------------------------------------------------------
+// pass statistics next to the recording, see TSat::SavePassinfo
+void TRotorExecutor::writePointingStats(QSettings *reg)
+{
+    TPointingStats ps = pointingStats();
+
+    reg->beginGroup("Pointing");
+      reg->setValue("Samples", ps.samples);
+      reg->setValue("OakSamples", ps.oak_samples);
+      reg->setValue("MaxError", ps.max_error);
+      reg->setValue("MeanError", ps.samples ? (ps.sum / ps.samples):0.0);
+      reg->setValue("RmsError", ps.samples ? sqrt(ps.sum2 / ps.samples):0.0);
+      reg->setValue("Over1Deg", ps.over_1deg);
+      reg->setValue("AzCorrection", ps.corr_az);
+      reg->setValue("ElCorrection", ps.corr_el);
+      reg->setValue("FeedbackRate", rotor->feedback_rate);
+      reg->setValue("ScanTurns", ps.scans);
+      reg->setValue("ScanMoves", ps.scan_moves);
+      reg->setValue("PeakXel", ps.peak_xel);
+      reg->setValue("PeakEl", ps.peak_el);
+    reg->endGroup();
+}
+
+//---------------------------------------------------------------------------
+// read the position every msec milliseconds, 0 = only when requested
+void TRotorExecutor::setPollInterval(int msec)
+{
+    QMutexLocker locker(&mutex);
+
+    poll_ms = msec < 0 ? 0:msec;
+    cond.wakeOne();
+}
+
+//---------------------------------------------------------------------------
+// consistent copy of the last published position
+TRotorPosition TRotorExecutor::position(void)
+{
+    QMutexLocker locker(&mutex);
+
+    return pos;
+}
+
+//---------------------------------------------------------------------------
+void TRotorExecutor::publish(bool measured, bool busy)
+{
+    double az, el;
+
+    // the rotor drivers keep the last commanded or read position
+    az = rotor->getAzimuth();
+    el = rotor->getElevation();
+
+    QMutexLocker locker(&mutex);
+
+    pos.az = az;
+    pos.el = el;
+    pos.measured = measured;
+    pos.busy = busy;
+    pos.errors = errors;
+    pos.updates++;
+}
+
+//---------------------------------------------------------------------------
+// position read interval, mutex locked, the feedback rate applies while following
+long TRotorExecutor::pollInterval(void)
+{
+    long ms, fb_ms;
+
+    ms = poll_ms;
+
+    if(follow && rotor->feedback_rate > 0) {
+        fb_ms = (long) (1000.0 / rotor->feedback_rate);
+        if(ms <= 0 || fb_ms < ms)
+            ms = fb_ms;
+    }
+
+    // the intervals are simulated time, the poll timer is not
+    if(ms > 0 && TTickScheduler::isSimulated())
+        ms = qMax(1L, (long) (ms / TTickScheduler::timeScale()));
+
+    return ms;
+}
+
+//---------------------------------------------------------------------------
+// over the zenith is az + 180 and 180 - el
+static void toSky(double *az, double *el)
+{
+    if(*el > 90) {
+        *el = 180.0 - *el;
+        *az += 180.0;
+    }
+
+    if(*az >= 360)
+        *az -= 360.0;
+    else if(*az < 0)
+        *az += 360.0;
+}
+
+//---------------------------------------------------------------------------
+// compares a measured position with the trajectory at the time it was read,
+// rotor axis angles or the antenna direction from the Oak
+void TRotorExecutor::feedback(double daynum, double az, double el, bool from_oak)
+{
+    double taz, tel, eaz, eel, c, err;
+
+    QMutexLocker locker(&mutex);
+
+    if(!follow || !trajectory->setpoint(daynum, &taz, &tel))
+        return;
+
+    toSky(&taz, &tel);
+    if(!from_oak)
+        toSky(&az, &el);
+
+    // the scan offset is intended, not a pointing error
+    scanOffset(daynum, tel, &eaz, &eel);
+    taz += eaz;
+    tel += eel;
+
+    c = sin(el * DTR) * sin(tel * DTR) +
+        cos(el * DTR) * cos(tel * DTR) * cos((az - taz) * DTR);
+    err = acos(ClipValue(c, 1.0, -1.0)) * RTD;
+
+    pstats.samples++;
+    if(from_oak)
+        pstats.oak_samples++;
+    if(err > 1.0)
+        pstats.over_1deg++;
+    if(err > pstats.max_error)
+        pstats.max_error = err;
+
+    pstats.sum += err;
+    pstats.sum2 += err * err;
+
+    // X-Y mounts stay open loop, az/el is singular at their horizon
+    if(rotor->isXY() || err > RE_FB_WINDOW)
+        return;
+
+    eaz = taz - az;
+    if(eaz > 180)
+        eaz -= 360.0;
+    else if(eaz < -180)
+        eaz += 360.0;
+
+    eel = tel - el;
+
+    if(tel < RE_FB_ZENITH)
+        pstats.corr_az = ClipValue(pstats.corr_az + RE_FB_GAIN * eaz, RE_FB_MAX_CORR, -RE_FB_MAX_CORR);
+
+    pstats.corr_el = ClipValue(pstats.corr_el + RE_FB_GAIN * eel, RE_FB_MAX_CORR, -RE_FB_MAX_CORR);
+}
+
+//---------------------------------------------------------------------------
+// conical scan around the prediction, mutex locked, only with a live signal
+void TRotorExecutor::scanOffset(double daynum, double el, double *daz, double *del)
+{
+    *daz = *del = 0;
+
+    if(scan.isRunning() && signal->isActive())
+        scan.offset(daynum, el, daz, del);
+}
+
+//---------------------------------------------------------------------------
+// adds the correction and the scan to a trajectory setpoint, mutex locked
+void TRotorExecutor::correct(double daynum, double *az, double *el)
+{
+    double daz, del;
+    bool   flip;
+
+    flip = *el > 90;
+    toSky(az, el);
+
+    scanOffset(daynum, *el, &daz, &del);
+
+    *az += pstats.corr_az + daz;
+    *el += pstats.corr_el + del;
+
+    if(flip) {
+        *el = 180.0 - *el;
+        *az -= 180.0;
+    }
+
+    if(*az >= 360)
+        *az -= 360.0;
+    else if(*az < 0)
+        *az += 360.0;
+}
+
+//---------------------------------------------------------------------------
+void TRotorExecutor::run()
+{
+    QTime  poll_time;
+    double az, el, daynum;
+    bool   move, ticked;
+    int    cmd, rc, mount;
+    long   wait_ms, stream_ms, interval;
+
+    mutex.lock();
+    pending = 0;
+    pending_move = false;
+    pos.busy = false;
+    mutex.unlock();
+
+    reply_wait = false;
+    poll_time.start();
+
+#if defined(Q_OS_UNIX)
+    oak = rotor->rig->oakEnabled() && rotor->rig->openOak();
+#endif
+
+    for(;;) {
+        mutex.lock();
+
+        if(restart_stream) {
+            restart_stream = false;
+            stream.setRate(rotor->track_rate);
+            stream.start();
+            stream_rate = stream.getRate();
+
+            // a conical scan for every pass when the wobble is enabled
+            scan.stop();
+            signal->reset();
+
+            if(!rotor->wobbleEnable())
+                signal->close();
+            else if(signal->isOpen() || signal->open(rotor->signal_port))
+                scan.start(stream.daynum(), rotor->wobble_radius, rotor->wobble_period);
+        }
+
+        if(!pending && !pending_move) {
+            interval = pollInterval();
+
+            if(reply_wait)
+                wait_ms = RE_TICK_MS;
+            else if(interval > 0)
+                wait_ms = qMax(interval - poll_time.elapsed(), 0L);
+            else
+                wait_ms = -1;
+
+            if(follow) {
+                stream_ms = (long) ((stream.remaining() + 999) / 1000);
+                if(wait_ms < 0 || wait_ms > stream_ms)
+                    wait_ms = stream_ms;
+            }
+
+            if(wait_ms != 0)
+                cond.wait(&mutex, wait_ms < 0 ? ULONG_MAX:(unsigned long) wait_ms);
+        }
+
+        cmd  = pending;
+        move = pending_move;
+        az   = pending_az;
+        el   = pending_el;
+        mount = pending_mount;
+
+        pending = 0;
+        pending_move = false;
+
+        // next setpoint of the trajectory, a posted move overrides it
+        ticked = false;
+        if(follow && !move && !(cmd & RE_CMD_STOP) && stream.isDue()) {
+            stream.tick();
+            ticked = true;
+
+            daynum = stream.daynum() + rotor->lead_ms / 86400000.0;
+            move = trajectory->setpoint(daynum, &az, &el);
+            if(move)
+                correct(daynum, &az, &el);
+        }
+
+        interval = pollInterval();
+        if(interval > 0 && poll_time.elapsed() >= interval) {
+            cmd |= RE_CMD_READPOS;
+            poll_time.restart();
+        }
+
+        if(cmd || move)
+            pos.busy = true;
+
+        mutex.unlock();
+
+        if(cmd & RE_CMD_QUIT)
+            break;
+
+        if(cmd & RE_CMD_MOUNT)
+            rotor->setMountFlags(mount);
+
+        execute(cmd, move, az, el);
+
+        // the rotor i/o is part of the tick
+        if(ticked) {
+            stream.done();
+
+            mutex.lock();
+            stream_stats = stream.getStats();
+            mutex.unlock();
+        }
+
+        readSignal();
+
+        // collect the reply of a non blocking position read
+        if(reply_wait) {
+            rc = rotor->pollPosition();
+
+            if(rc != 0 || reply_time.elapsed() > RE_REPLY_TIMEOUT) {
+                if(rc != 1)
+                    errors++;
+                else if(!oak) {
+                    rotor->getMeasuredPosition(&az, &el);
+                    feedback(reply_daynum, az, el, false);
+                }
+
+                reply_wait = false;
+                publish(rc == 1, false);
+            }
+        }
+    }
+
+    mutex.lock();
+    pos.busy = false;
+    mutex.unlock();
+
+#if defined(Q_OS_UNIX)
+    if(oak)
+        rotor->rig->closeOak();
+#endif
+    oak = false;
+
+    signal->close();
+}
+
+//---------------------------------------------------------------------------
+// feeds the signal quality to the conical scan, executor thread only
+void TRotorExecutor::readSignal(void)
+{
+    double values[SM_MAX_SAMPLES], daynum;
+    int    i, n;
+
+    if(!signal->isOpen())
+        return;
+
+    n = signal->read(values, SM_MAX_SAMPLES);
+    if(n <= 0)
+        return;
+
+    daynum = stream.daynum();
+
+    QMutexLocker locker(&mutex);
+
+    if(!follow || !scan.isRunning())
+        return;
+
+    for(i=0; i<n; i++)
+        scan.addSample(daynum, values[i]);
+
+    pstats.peak_xel = scan.peakXel();
+    pstats.peak_el = scan.peakEl();
+    pstats.scans = scan.scans;
+    pstats.scan_moves = scan.moves;
+}
+
+//---------------------------------------------------------------------------
+// executor thread only, this is where the caller used to block
+void TRotorExecutor::execute(int cmd, bool move, double az, double el)
+{
+    bool   jrk = rotor->rotor_type == RotorType_JRK;
+    bool   measured = false;
+    double daynum, maz, mel;
+
+    if(!cmd && !move)
+        return;
+
+    if(jrk && (cmd & RE_CMD_REINIT))
+        rotor->jrk->check_and_reinit();
+
+    if(cmd & RE_CMD_STOP)
+        rotor->stopMotor();
+
+    // try to prevent Jrk from latching error: Maximum current exceeded
+    if(jrk && (cmd & RE_CMD_START))
+        rotor->jrk->start();
+
+    if(move)
+        rotor->moveTo(az, el);
+
+    if(cmd & RE_CMD_READPOS) {
+        // the trajectory time of the measurement
+        daynum = stream.daynum();
+
+#if defined(Q_OS_UNIX)
+        // the inclinometer sees the antenna, it replaces the rotor feedback
+        if(oak && rotor->rig->readAzEl())
+            feedback(daynum, rotor->rig->oakAz, rotor->rig->oakEl, true);
+#endif
+
+        if(rotor->hasAsyncPosition()) {
+            // GS-232 replies take ~300 ms, collect it in the run loop
+            if(!reply_wait) {
+                if(rotor->requestPosition()) {
+                    reply_wait = true;
+                    reply_time.start();
+                    reply_daynum = daynum;
+                }
+                else
+                    errors++;
+            }
+        }
+        else if(rotor->readPosition()) {
+            // the stepper has no encoder
+            measured = rotor->rotor_type != RotorType_Stepper;
+
+            if(measured && !oak) {
+                rotor->getMeasuredPosition(&maz, &mel);
+                feedback(daynum, maz, mel, false);
+            }
+        }
+        else
+            errors++;
+    }
+
+    publish(measured, false);
+}
+
+//---------------------------------------------------------------------------
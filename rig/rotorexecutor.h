@@ -0,0 +1,173 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef ROTOREXECUTOR_H
+#define ROTOREXECUTOR_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QTime>
+
+#include "tickscheduler.h"
+#include "conicalscan.h"
+
+#define RE_CMD_STOP          1       // stop the motors, cancels a pending move
+#define RE_CMD_READPOS       2       // read the rotor position
+#define RE_CMD_REINIT        4       // check the connection and reinit (Jrk)
+#define RE_CMD_START         8       // power up the motors before a long move (Jrk)
+#define RE_CMD_QUIT         16
+#define RE_CMD_MOUNT        32       // set the mount flags of the pass
+
+#define RE_TICK_MS          20       // serial reply poll interval
+#define RE_REPLY_TIMEOUT  1500       // milliseconds to wait for a position reply
+
+#define RE_FB_GAIN         0.3       // part of the pointing error corrected per sample
+#define RE_FB_WINDOW       5.0       // degrees, larger errors are slewing, not a bias
+#define RE_FB_MAX_CORR     3.0       // degrees, correction limit per axis
+#define RE_FB_ZENITH      80.0       // no azimuth correction above this elevation
+
+class QSettings;
+class TRotor;
+class TRotorPlanner;
+class TSignalMonitor;
+
+//---------------------------------------------------------------------------
+typedef struct TRotorPosition_t
+{
+    double az, el;          // last known rotor position in degrees
+    bool   measured;        // read from the rotor, otherwise the commanded position
+    bool   busy;            // a command is being executed
+    quint32 updates;        // incremented on every publish
+    quint32 dropped;        // moves replaced by a newer one before execution
+    quint32 errors;         // failed commands and reply timeouts
+} TRotorPosition;
+
+//---------------------------------------------------------------------------
+typedef struct TPointingStats_t
+{
+    quint32 samples;        // measured positions compared with the trajectory
+    quint32 oak_samples;    // of which from the Oak inclinometer
+    quint32 over_1deg;      // samples with more than 1 degree error
+    double  max_error;      // degrees between the antenna and the satellite
+    double  sum, sum2;
+    double  corr_az, corr_el;   // correction added to the setpoints
+    double  peak_xel, peak_el;  // conical scan peak from the prediction
+    int     scans, scan_moves;
+} TPointingStats;
+
+//---------------------------------------------------------------------------
+/*
+  Executes the rotor commands in its own thread so the caller never waits
+  for the rotor. Moves go to a single slot mailbox, a newer move replaces
+  the pending one (latest wins). Stop, position read and the Jrk commands
+  are flags which are executed before the pending move. The mount flags
+  of a pass (CCW, zenith) are posted the same way, the rotor reads them
+  when it moves so only the executor thread sets them.
+  When following a trajectory the setpoint at now + TRotor::lead_ms is
+  sent at TRotor::track_rate on monotonic deadlines, independent of
+  the caller.
+  The position is published as one snapshot, see position().
+  While following, the position is read at TRotor::feedback_rate from
+  the rotor or the Oak inclinometer and compared with the trajectory.
+  A slowly integrated az/el correction removes the steady pointing
+  error, e.g. backlash and lag, the errors are kept in pointingStats().
+  With the rotor wobble enabled and a live signal quality the setpoints
+  are modulated by a conical scan which steers to the signal peak.
+*/
+class TRotorExecutor : public QThread
+{
+public:
+    TRotorExecutor(TRotor *_rotor, QObject *parent=0);
+    ~TRotorExecutor(void);
+
+    void stop(void);
+
+    bool moveTo(double az, double el);
+    bool park(void);
+    bool stopMotor(void);
+    bool readPosition(void);
+    bool reinit(void);
+    bool startMotor(void);
+    bool setMountFlags(int mount);
+
+    bool followTrajectory(const TRotorPlanner *planner);
+    void stopTrajectory(void);
+
+    void setPollInterval(int msec);
+    TRotorPosition position(void);
+
+    TTickStats streamStats(void);
+    QString    streamStatsString(void);
+
+    TPointingStats pointingStats(void);
+    QString        pointingStatsString(void);
+    void           writePointingStats(QSettings *reg);
+
+protected:
+    void run();
+
+    bool post(int cmd);
+    void execute(int cmd, bool move, double az, double el);
+    void publish(bool measured, bool busy);
+    void feedback(double daynum, double az, double el, bool oak);
+    void correct(double daynum, double *az, double *el);
+    void scanOffset(double daynum, double el, double *daz, double *del);
+    void readSignal(void);
+    long pollInterval(void);
+
+private:
+    TRotor *rotor;
+
+    QMutex         mutex;
+    QWaitCondition cond;
+
+    // mailbox, protected by mutex
+    int    pending;
+    bool   pending_move;
+    double pending_az, pending_el;
+    int    pending_mount;
+    int    poll_ms;
+
+    // own copy of the trajectory, protected by mutex
+    TRotorPlanner *trajectory;
+    bool           follow, restart_stream;
+
+    // copy of the stream scheduler statistics, protected by mutex
+    TTickStats stream_stats;
+    double     stream_rate;
+
+    // published position and pointing errors, protected by mutex
+    TRotorPosition pos;
+    TPointingStats pstats;
+
+    // executor thread only
+    bool    reply_wait;
+    QTime   reply_time;
+    TTickScheduler stream;
+    TSignalMonitor *signal;
+    TConicalScan   scan;        // protected by mutex
+    quint32 errors;
+    double  reply_daynum;   // when the pending position was requested
+    bool    oak;
+};
+
+#endif // ROTOREXECUTOR_H
@@ -0,0 +1,329 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "rotorplanner.h"
+#include "rotor.h"
+#include "Satellite.h"
+#include "utils.h"
+
+//---------------------------------------------------------------------------
+TRotorPlanner::TRotorPlanner(void)
+{
+    points = NULL;
+    num_points = max_points = 0;
+
+    mode = MountMode_Normal;
+    tca = 0;
+    max_error = 0;
+}
+
+//---------------------------------------------------------------------------
+TRotorPlanner::~TRotorPlanner(void)
+{
+    if(points)
+        free(points);
+}
+
+//---------------------------------------------------------------------------
+void TRotorPlanner::clear(void)
+{
+    num_points = 0;
+
+    mode = MountMode_Normal;
+    tca = 0;
+    max_error = 0;
+}
+
+//---------------------------------------------------------------------------
+bool TRotorPlanner::alloc(int count)
+{
+    TRotorSetpoint *p;
+
+    if(count <= max_points)
+        return true;
+
+    p = (TRotorSetpoint *) realloc(points, count * sizeof(TRotorSetpoint));
+    if(p == NULL)
+        return false;
+
+    points = p;
+    max_points = count;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool TRotorPlanner::copy(const TRotorPlanner *src)
+{
+    clear();
+
+    if(!src || !src->isValid() || !alloc(src->num_points))
+        return false;
+
+    memcpy(points, src->points, src->num_points * sizeof(TRotorSetpoint));
+    num_points = src->num_points;
+
+    mode = src->mode;
+    tca = src->tca;
+    max_error = src->max_error;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// aos and los are daynums, the satellite position is restored afterwards
+bool TRotorPlanner::plan(TSat *sat, TRotor *rotor, double aos, double los)
+{
+    TMountMode modes[3];
+    double step = RP_STEP_SEC / 86400.0;
+    double saved, max_el, err;
+    int    i, count, num_modes;
+
+    clear();
+
+    if(!sat || !rotor || los <= aos)
+        return false;
+
+    count = (int) ceil((los - aos) / step) + 1;
+    if(count < 2 || count > RP_MAX_POINTS || !alloc(count))
+        return false;
+
+    saved = sat->daynum;
+    max_el = -90;
+
+    for(i=0; i<count; i++) {
+        sat->daynum = i == (count - 1) ? los:(aos + i * step);
+        sat->Calc();
+
+        points[i].daynum = sat->daynum;
+        points[i].az = sat->sat_azi;
+        points[i].el = sat->sat_ele;
+
+        if(sat->sat_ele > max_el) {
+            max_el = sat->sat_ele;
+            tca = sat->daynum;
+        }
+    }
+
+    num_points = count;
+
+    sat->daynum = saved;
+    sat->Calc();
+
+    // mount modes this rotor can do
+    num_modes = 0;
+    if(rotor->isXY())
+        modes[num_modes++] = MountMode_XY;
+    else {
+        modes[num_modes++] = MountMode_Normal;
+
+        if(rotor->el_max > 90)
+            modes[num_modes++] = MountMode_Flip;
+        if(rotor->turnElOnlyWhenZenith())
+            modes[num_modes++] = MountMode_Zenith;
+    }
+
+    max_error = -1;
+    for(i=0; i<num_modes; i++) {
+        err = simulate(modes[i], rotor);
+
+        if(max_error < 0 || err < (max_error - RP_TIE_DEG)) {
+            mode = modes[i];
+            max_error = err;
+        }
+    }
+
+    qDebug("rotor planner: %d points, %s mount, max pointing error %.2f deg",
+           num_points, getModeName().toStdString().c_str(), max_error);
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// TRotor::moveTo input at daynum, times outside the pass are clamped
+bool TRotorPlanner::setpoint(double daynum, double *az, double *el) const
+{
+    if(!isValid())
+        return false;
+
+    interpolate(daynum, az, el);
+    toMoveTo(mode, daynum, az, el);
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+int TRotorPlanner::getRotorFlags(void) const
+{
+    switch(mode)
+    {
+    case MountMode_Flip:   return R_ROTOR_CCW;
+    case MountMode_Zenith: return R_ROTOR_ZENITH_PASS;
+
+    default:
+        return 0;
+    }
+}
+
+//---------------------------------------------------------------------------
+QString TRotorPlanner::getModeName(void) const
+{
+    switch(mode)
+    {
+    case MountMode_Normal: return "normal";
+    case MountMode_Flip:   return "flip";
+    case MountMode_Zenith: return "zenith flip";
+    case MountMode_XY:     return "X-Y";
+
+    default:
+        return "unknown";
+    }
+}
+
+//---------------------------------------------------------------------------
+void TRotorPlanner::interpolate(double daynum, double *az, double *el) const
+{
+    double f, d;
+    int    i;
+
+    if(daynum <= points[0].daynum) {
+        *az = points[0].az;
+        *el = points[0].el;
+        return;
+    }
+
+    if(daynum >= points[num_points - 1].daynum) {
+        *az = points[num_points - 1].az;
+        *el = points[num_points - 1].el;
+        return;
+    }
+
+    // points are equally spaced except the last one
+    i = (int) ((daynum - points[0].daynum) * 86400.0 / RP_STEP_SEC);
+    i = i < 0 ? 0:(i > (num_points - 2) ? (num_points - 2):i);
+
+    f = (daynum - points[i].daynum) / (points[i+1].daynum - points[i].daynum);
+
+    // shortest way over the 0 -> 360 meridian
+    d = points[i+1].az - points[i].az;
+    if(d > 180)
+        d -= 360.0;
+    else if(d < -180)
+        d += 360.0;
+
+    *az = points[i].az + f * d;
+    if(*az < 0)
+        *az += 360.0;
+    else if(*az >= 360)
+        *az -= 360.0;
+
+    *el = points[i].el + f * (points[i+1].el - points[i].el);
+}
+
+//---------------------------------------------------------------------------
+// the flip mode is done by TRotor::moveTo with the R_ROTOR_CCW flag,
+// the zenith mode is turned here as the track thread used to do
+void TRotorPlanner::toMoveTo(TMountMode m, double daynum, double *az, double *el) const
+{
+    if(m != MountMode_Zenith || daynum < tca)
+        return;
+
+    *el = 180.0 - *el;
+    *az = *az - 180.0;
+
+    if(*az < 0)
+        *az += 360.0;
+}
+
+//---------------------------------------------------------------------------
+// rotor axis angles as the drivers will get them
+void TRotorPlanner::toAxes(TMountMode m, TRotor *rotor, double daynum, double az, double el, double *x, double *y) const
+{
+    if(m == MountMode_XY) {
+        rotor->AzEltoXY(az, el, x, y);
+        return;
+    }
+
+    if(m == MountMode_Flip || (m == MountMode_Zenith && daynum >= tca)) {
+        az += 180.0;
+        el = 180.0 - el;
+    }
+
+    if(az >= 360)
+        az -= 360.0;
+
+    *x = ClipValue(az, rotor->az_max, rotor->az_min);
+    *y = ClipValue(el, rotor->el_max, rotor->el_min);
+}
+
+//---------------------------------------------------------------------------
+// follows the trajectory with the rotor speeds (ms per degree), the antenna
+// is at the AOS position when it starts, returns the worst pointing error
+double TRotorPlanner::simulate(TMountMode m, TRotor *rotor) const
+{
+    double az_rate, el_rate, dt, x, y, tx, ty, paz, pel, c, err, max_err;
+    int    i;
+
+    az_rate = rotor->az_speed > 0 ? (1000.0 / rotor->az_speed):1000.0;
+    el_rate = rotor->el_speed > 0 ? (1000.0 / rotor->el_speed):1000.0;
+
+    toAxes(m, rotor, points[0].daynum, points[0].az, points[0].el, &x, &y);
+    max_err = 0;
+
+    for(i=1; i<num_points; i++) {
+        dt = (points[i].daynum - points[i-1].daynum) * 86400.0;
+
+        toAxes(m, rotor, points[i].daynum, points[i].az, points[i].el, &tx, &ty);
+
+        x += ClipValue(tx - x, az_rate * dt, -az_rate * dt);
+        y += ClipValue(ty - y, el_rate * dt, -el_rate * dt);
+
+        if(m == MountMode_XY) {
+            err = sqrt((tx - x) * (tx - x) + (ty - y) * (ty - y));
+        }
+        else {
+            // where the antenna points to
+            paz = x;
+            pel = y;
+            if(pel > 90) {
+                pel = 180.0 - pel;
+                paz += 180.0;
+            }
+
+            // angular distance to the satellite
+            c = sin(pel * DTR) * sin(points[i].el * DTR) +
+                cos(pel * DTR) * cos(points[i].el * DTR) * cos((paz - points[i].az) * DTR);
+
+            err = acos(ClipValue(c, 1.0, -1.0)) * RTD;
+        }
+
+        if(err > max_err)
+            max_err = err;
+    }
+
+    return max_err;
+}
+
+//---------------------------------------------------------------------------
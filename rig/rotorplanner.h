@@ -0,0 +1,96 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef ROTORPLANNER_H
+#define ROTORPLANNER_H
+
+#include <QtGlobal>
+#include <QString>
+
+#define RP_STEP_SEC         0.5      // trajectory resolution in seconds
+#define RP_MAX_POINTS       14400    // 2 hours
+#define RP_TIE_DEG          0.1      // prefer the simpler mount mode within this error
+
+class TRotor;
+class TSat;
+
+//---------------------------------------------------------------------------
+typedef enum TMountMode_t
+{
+    MountMode_Normal = 0,   // az 0-360, el 0-90
+    MountMode_Flip,         // az + 180, 180 - el for the whole pass (R_ROTOR_CCW)
+    MountMode_Zenith,       // normal until TCA, flipped after (R_ROTOR_ZENITH_PASS)
+    MountMode_XY            // X-Y mount, converted by the rotor driver
+} TMountMode;
+
+//---------------------------------------------------------------------------
+typedef struct TRotorSetpoint_t
+{
+    double daynum;
+    double az, el;      // satellite azimuth and elevation
+} TRotorSetpoint;
+
+//---------------------------------------------------------------------------
+/*
+  Precomputes the whole pass with SGP4 at RP_STEP_SEC, simulates each
+  usable mount mode with the rotor az/el speeds and keeps the mode with
+  the smallest worst case pointing error.
+  setpoint() returns the TRotor::moveTo input for any time of the pass,
+  the caller adds the latency lead (TRotor::lead_ms) to the time.
+*/
+class TRotorPlanner
+{
+public:
+    TRotorPlanner(void);
+    ~TRotorPlanner(void);
+
+    bool plan(TSat *sat, TRotor *rotor, double aos, double los);
+    bool copy(const TRotorPlanner *src);
+    void clear(void);
+    bool isValid(void) const { return num_points > 1; }
+
+    bool setpoint(double daynum, double *az, double *el) const;
+
+    TMountMode getMode(void) const { return mode; }
+    int        getRotorFlags(void) const;
+    QString    getModeName(void) const;
+    double     getMaxError(void) const { return max_error; }
+
+    double startTime(void) const { return isValid() ? points[0].daynum:0; }
+    double endTime(void) const { return isValid() ? points[num_points - 1].daynum:0; }
+
+protected:
+    bool   alloc(int count);
+    void   interpolate(double daynum, double *az, double *el) const;
+    void   toMoveTo(TMountMode m, double daynum, double *az, double *el) const;
+    void   toAxes(TMountMode m, TRotor *rotor, double daynum, double az, double el, double *x, double *y) const;
+    double simulate(TMountMode m, TRotor *rotor) const;
+
+private:
+    TRotorSetpoint *points;
+    int            num_points, max_points;
+
+    TMountMode mode;
+    double     tca;
+    double     max_error;
+};
+
+#endif // ROTORPLANNER_H
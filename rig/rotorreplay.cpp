@@ -0,0 +1,158 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <string.h>
+#include <math.h>
+
+#include "rotorreplay.h"
+#include "rotorplanner.h"
+#include "rotor.h"
+#include "Satellite.h"
+#include "utils.h"
+
+//---------------------------------------------------------------------------
+// the satellite position is restored afterwards
+bool TRotorReplay::run(TSat *sat, TRotor *rotor, const TRotorPlanner *planner, TReplayResult *res)
+{
+    double step, lead, start, end, s, daynum, saved;
+    double az, el, x, y;
+
+    clear(res);
+
+    if(!sat || !rotor || !planner || !planner->isValid())
+        return false;
+
+    step = 1.0 / (rotor->track_rate > 0 ? rotor->track_rate:4.0);
+    lead = rotor->lead_ms / 1000.0;
+    start = planner->startTime();
+    end = (planner->endTime() - start) * 86400.0;
+
+    saved = sat->daynum;
+
+    // the antenna waits at the AOS position
+    planner->setpoint(start, &az, &el);
+    toAxes(rotor, az, el, &x, &y);
+    model.reset(x, y, 0);
+
+    for(s=0; s<=end; s+=step) {
+        daynum = start + s / 86400.0;
+
+        model.advance(s);
+
+        sat->daynum = daynum;
+        sat->Calc();
+
+        add(res, error(rotor, model.antennaAz(), model.antennaEl(), sat->sat_azi, sat->sat_ele), step);
+
+        planner->setpoint(daynum + lead / 86400.0, &az, &el);
+        toAxes(rotor, az, el, &x, &y);
+        model.command(x, y, s);
+    }
+
+    sat->daynum = saved;
+    sat->Calc();
+
+    finish(res);
+
+    return res->ticks > 0;
+}
+
+//---------------------------------------------------------------------------
+void TRotorReplay::clear(TReplayResult *res)
+{
+    memset(res, 0, sizeof(TReplayResult));
+}
+
+//---------------------------------------------------------------------------
+// one pointing error, step seconds since the previous one
+void TRotorReplay::add(TReplayResult *res, double err, double step)
+{
+    if(err > res->max_error)
+        res->max_error = err;
+    if(err > 1.0)
+        res->over_1deg += step;
+
+    res->sum += err;
+    res->sum2 += err * err;
+    res->ticks++;
+}
+
+//---------------------------------------------------------------------------
+void TRotorReplay::finish(TReplayResult *res)
+{
+    if(res->ticks > 0) {
+        res->mean_error = res->sum / res->ticks;
+        res->rms_error = sqrt(res->sum2 / res->ticks);
+    }
+}
+
+//---------------------------------------------------------------------------
+// degrees between the antenna at the axis angles and the satellite
+double TRotorReplay::error(TRotor *rotor, double x, double y, double sat_az, double sat_el)
+{
+    double az, el, c;
+
+    toAzEl(rotor, x, y, &az, &el);
+
+    c = sin(el * DTR) * sin(sat_el * DTR) +
+        cos(el * DTR) * cos(sat_el * DTR) * cos((az - sat_az) * DTR);
+
+    return acos(ClipValue(c, 1.0, -1.0)) * RTD;
+}
+
+//---------------------------------------------------------------------------
+QString TRotorReplay::resultString(const TReplayResult *res)
+{
+    QString str;
+
+    str.sprintf("%d ticks, pointing error max %.2f mean %.2f rms %.2f deg, %.1f s over 1 deg",
+                res->ticks, res->max_error, res->mean_error, res->rms_error, res->over_1deg);
+
+    return str;
+}
+
+//---------------------------------------------------------------------------
+// TRotor::moveTo input to the axis angles the driver sends
+void TRotorReplay::toAxes(TRotor *rotor, double az, double el, double *x, double *y)
+{
+    if(rotor->isXY())
+        rotor->AzEltoXY(az, el, x, y);
+    else
+        rotor->AzEltoCCW(az, el, x, y);
+}
+
+//---------------------------------------------------------------------------
+// where the antenna points to
+void TRotorReplay::toAzEl(TRotor *rotor, double x, double y, double *az, double *el)
+{
+    if(rotor->isXY()) {
+        rotor->XYtoAzEl(x, y, az, el);
+        return;
+    }
+
+    *az = x;
+    *el = y;
+
+    if(*el > 90) {
+        *el = 180.0 - *el;
+        *az += 180.0;
+    }
+}
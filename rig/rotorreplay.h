@@ -0,0 +1,73 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef ROTORREPLAY_H
+#define ROTORREPLAY_H
+
+#include <QString>
+
+#include "rotorsim.h"
+
+class TRotor;
+class TRotorPlanner;
+class TSat;
+
+//---------------------------------------------------------------------------
+typedef struct TReplayResult_t
+{
+    double max_error;       // degrees between the antenna and the satellite
+    double mean_error;
+    double rms_error;
+    double over_1deg;       // seconds with more than 1 degree error
+    int    ticks;
+    double sum, sum2;
+} TReplayResult;
+
+//---------------------------------------------------------------------------
+/*
+  Flies a planned pass through the rotor model faster than real time.
+  The setpoints are sent as TRotorExecutor does, at TRotor::track_rate
+  and TRotor::lead_ms ahead, and the antenna of the model is compared
+  with the SGP4 position of the satellite on every tick.
+  Call model.setup() and adjust the model before run().
+  The static functions collect the same statistics from TRotorSim when
+  the tracker flies a pass on the simulated clock.
+*/
+class TRotorReplay
+{
+public:
+    TRotorReplay(void) { }
+
+    bool run(TSat *sat, TRotor *rotor, const TRotorPlanner *planner, TReplayResult *res);
+
+    static void    clear(TReplayResult *res);
+    static void    add(TReplayResult *res, double err, double step);
+    static void    finish(TReplayResult *res);
+    static QString resultString(const TReplayResult *res);
+
+    static double  error(TRotor *rotor, double x, double y, double sat_az, double sat_el);
+    static void    toAxes(TRotor *rotor, double az, double el, double *x, double *y);
+    static void    toAzEl(TRotor *rotor, double x, double y, double *az, double *el);
+
+    TRotorModel model;
+};
+
+#endif // ROTORREPLAY_H
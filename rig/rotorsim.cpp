@@ -0,0 +1,744 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QMutexLocker>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#endif
+
+#include "rotorsim.h"
+#include "tickscheduler.h"
+#include "utils.h"
+
+//---------------------------------------------------------------------------
+TRotorModel::TRotorModel(void)
+{
+    rate[0] = rate[1] = 6;
+    backlash[0] = backlash[1] = 0.5;
+    min[0] = 0; max[0] = 360;
+    min[1] = 0; max[1] = 90;
+    latency = 0.25;
+    resolution = 0.1;
+
+    reset(0, 0, 0);
+}
+
+//---------------------------------------------------------------------------
+// rates and limits from the rotor settings, the resolution of the protocol
+void TRotorModel::setup(TRotor *rotor)
+{
+    rate[0] = rotor->az_speed > 0 ? (1000.0 / rotor->az_speed):1000.0;
+    rate[1] = rotor->el_speed > 0 ? (1000.0 / rotor->el_speed):1000.0;
+
+    if(rotor->isXY()) {
+        min[0] = min[1] = 0;
+        max[0] = max[1] = 180;
+    }
+    else {
+        min[0] = rotor->az_min; max[0] = rotor->az_max;
+        min[1] = rotor->el_min; max[1] = rotor->el_max;
+    }
+
+    switch(rotor->rotor_type)
+    {
+    case RotorType_GS232B:   resolution = 1.0; break;
+    case RotorType_SPID:     resolution = 0.5; break;
+    case RotorType_Monstrum: resolution = 0.01; break;
+
+    default:
+        resolution = 0.1;
+    }
+}
+
+//---------------------------------------------------------------------------
+void TRotorModel::reset(double az, double el, double t)
+{
+    motor[0] = ant[0] = target[0] = ClipValue(az, max[0], min[0]);
+    motor[1] = ant[1] = target[1] = ClipValue(el, max[1], min[1]);
+
+    q_head = q_count = 0;
+    now = t;
+}
+
+//---------------------------------------------------------------------------
+// the command is executed latency seconds after t
+void TRotorModel::command(double az, double el, double t)
+{
+    TQueued *q;
+
+    advance(t);
+
+    if(q_count >= RS_MAX_QUEUE) {
+        // drop the oldest, the device input buffer overflows
+        q_head = (q_head + 1) % RS_MAX_QUEUE;
+        q_count--;
+    }
+
+    if(resolution > 0) {
+        az = floor(az / resolution + 0.5) * resolution;
+        el = floor(el / resolution + 0.5) * resolution;
+    }
+
+    q = &queue[(q_head + q_count) % RS_MAX_QUEUE];
+    q->t = t + latency;
+    q->pos[0] = ClipValue(az, max[0], min[0]);
+    q->pos[1] = ClipValue(el, max[1], min[1]);
+    q->stop = false;
+
+    q_count++;
+}
+
+//---------------------------------------------------------------------------
+// a stop is not delayed and cancels the waiting commands
+void TRotorModel::stop(double t)
+{
+    advance(t);
+
+    q_head = q_count = 0;
+    target[0] = motor[0];
+    target[1] = motor[1];
+}
+
+//---------------------------------------------------------------------------
+void TRotorModel::advance(double t)
+{
+    TQueued *q;
+
+    while(q_count > 0 && queue[q_head].t <= t) {
+        q = &queue[q_head];
+
+        move(q->t - now);
+        if(q->t > now)
+            now = q->t;
+
+        target[0] = q->pos[0];
+        target[1] = q->pos[1];
+
+        q_head = (q_head + 1) % RS_MAX_QUEUE;
+        q_count--;
+    }
+
+    move(t - now);
+    if(t > now)
+        now = t;
+}
+
+//---------------------------------------------------------------------------
+void TRotorModel::move(double dt)
+{
+    double step, half;
+    int    i;
+
+    if(dt <= 0)
+        return;
+
+    for(i=0; i<2; i++) {
+        step = rate[i] * dt;
+        motor[i] += ClipValue(target[i] - motor[i], step, -step);
+
+        // the antenna stays until the motor has turned through the dead band
+        half = backlash[i] / 2.0;
+        if(motor[i] - ant[i] > half)
+            ant[i] = motor[i] - half;
+        else if(ant[i] - motor[i] > half)
+            ant[i] = motor[i] + half;
+    }
+}
+
+//---------------------------------------------------------------------------
+double TRotorModel::reportedAz(void) const
+{
+    if(resolution <= 0)
+        return motor[0];
+
+    return floor(motor[0] / resolution + 0.5) * resolution;
+}
+
+//---------------------------------------------------------------------------
+double TRotorModel::reportedEl(void) const
+{
+    if(resolution <= 0)
+        return motor[1];
+
+    return floor(motor[1] / resolution + 0.5) * resolution;
+}
+
+//---------------------------------------------------------------------------
+bool TRotorModel::isBusy(void) const
+{
+    return q_count > 0 ||
+           fabs(target[0] - motor[0]) > 1e-6 ||
+           fabs(target[1] - motor[1]) > 1e-6;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TRotorSim::TRotorSim(QObject *parent) :
+    QThread(parent)
+{
+    proto = SimProto_GS232;
+    quit = false;
+    reply_ms = 50;
+
+    pty_fd = -1;
+    tcp_port = 0;
+    server = NULL;
+    client = NULL;
+
+    in_len = out_len = 0;
+    out_time = 0;
+
+    spid_ph = spid_pv = 2;
+}
+
+//---------------------------------------------------------------------------
+TRotorSim::~TRotorSim(void)
+{
+    stop();
+}
+
+//---------------------------------------------------------------------------
+bool TRotorSim::protocolFor(TRotor *rotor, TSimProto *proto)
+{
+    if(rotor->commtype == Comm_Rotctld) {
+        *proto = SimProto_Rotctld;
+        return true;
+    }
+
+    // only GS-232 goes over plain TCP
+    if(rotor->isNetwork() && rotor->rotor_type != RotorType_GS232B)
+        return false;
+
+    switch(rotor->rotor_type)
+    {
+    case RotorType_GS232B:   *proto = SimProto_GS232; return true;
+    case RotorType_SPID:     *proto = SimProto_SPID; return true;
+    case RotorType_Monstrum: *proto = SimProto_Monstrum; return true;
+
+    default:
+        return false; // Jrk and stepper, TRotorModel only
+    }
+}
+
+//---------------------------------------------------------------------------
+bool TRotorSim::setup(TSimProto _proto, TRotor *rotor)
+{
+    double x, y;
+
+    stop();
+
+    proto = _proto;
+    quit = false;
+    in_len = out_len = 0;
+    error = "";
+
+    model.setup(rotor);
+
+    // start from the park position
+    if(rotor->isXY()) {
+        rotor->AzEltoXY(rotor->parkAz, rotor->parkEl, &x, &y);
+        model.reset(x, y, 0);
+    }
+    else
+        model.reset(rotor->parkAz, rotor->parkEl, 0);
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// the driver opens deviceName() as its serial port
+bool TRotorSim::startPty(TSimProto _proto, TRotor *rotor)
+{
+    setup(_proto, rotor);
+
+#if defined Q_OS_UNIX
+    struct termios tio;
+    int    fd;
+
+    pty_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if(pty_fd < 0 || grantpt(pty_fd) != 0 || unlockpt(pty_fd) != 0) {
+        error = "Failed to create a pseudo terminal";
+        stop();
+        return false;
+    }
+
+    device = ptsname(pty_fd);
+
+    // raw mode, no echo or line editing on the slave side
+    fd = open(ptsname(pty_fd), O_RDWR | O_NOCTTY);
+    if(fd >= 0) {
+        if(tcgetattr(fd, &tio) == 0) {
+            cfmakeraw(&tio);
+            tcsetattr(fd, TCSANOW, &tio);
+        }
+        close(fd);
+    }
+
+    fcntl(pty_fd, F_SETFL, fcntl(pty_fd, F_GETFL) | O_NONBLOCK);
+
+    qDebug("Rotor simulator: %s", device.toStdString().c_str());
+
+    start();
+
+    return true;
+#else
+    error = "Pseudo terminals are not supported on this platform";
+    return false;
+#endif
+}
+
+//---------------------------------------------------------------------------
+// listens on the local host, the network rotor must connect to 127.0.0.1
+bool TRotorSim::startTcp(TSimProto _proto, TRotor *rotor, int port)
+{
+    setup(_proto, rotor);
+
+    tcp_port = port;
+    device.sprintf("127.0.0.1:%d", port);
+
+    start();
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void TRotorSim::stop(void)
+{
+    if(isRunning()) {
+        quit = true;
+        wait();
+    }
+
+#if defined Q_OS_UNIX
+    if(pty_fd >= 0)
+        close(pty_fd);
+#endif
+
+    pty_fd = -1;
+    tcp_port = 0;
+}
+
+//---------------------------------------------------------------------------
+void TRotorSim::getPosition(double *az, double *el)
+{
+    QMutexLocker locker(&mutex);
+
+    *az = model.reportedAz();
+    *el = model.reportedEl();
+}
+
+//---------------------------------------------------------------------------
+// axis angles of the antenna behind the backlash, not what is reported
+void TRotorSim::getAntenna(double *x, double *y)
+{
+    QMutexLocker locker(&mutex);
+
+    *x = model.antennaAz();
+    *y = model.antennaEl();
+}
+
+//---------------------------------------------------------------------------
+// simulated seconds when the clock is
+double TRotorSim::seconds(void)
+{
+    return TTickScheduler::nsecsElapsed(timer) * TTickScheduler::timeScale() / 1.0e9;
+}
+
+//---------------------------------------------------------------------------
+void TRotorSim::run(void)
+{
+    char buf[256];
+    int  n;
+
+    timer.start();
+
+    if(tcp_port > 0) {
+        server = new QTcpServer();
+        if(!server->listen(QHostAddress::LocalHost, tcp_port)) {
+            error = "Failed to listen: " + server->errorString();
+            qDebug("Rotor simulator: %s", error.toStdString().c_str());
+
+            delete server;
+            server = NULL;
+            return;
+        }
+    }
+
+    while(!quit) {
+        mutex.lock();
+
+        model.advance(seconds());
+        flushReplies();
+
+#if defined Q_OS_UNIX
+        if(pty_fd >= 0) {
+            // EIO while the driver has the slave closed
+            n = ::read(pty_fd, buf, sizeof(buf));
+            if(n > 0)
+                process(buf, n);
+        }
+#endif
+
+        if(server) {
+            if(client == NULL && server->waitForNewConnection(0)) {
+                client = server->nextPendingConnection();
+                in_len = out_len = 0;
+            }
+
+            if(client) {
+                if(client->state() != QAbstractSocket::ConnectedState) {
+                    delete client;
+                    client = NULL;
+                }
+                else if(client->waitForReadyRead(0) || client->bytesAvailable() > 0) {
+                    QByteArray data = client->readAll();
+                    process(data.constData(), data.size());
+                }
+            }
+        }
+
+        mutex.unlock();
+
+        msleep(qMax(1, (int) (RS_POLL_MS / TTickScheduler::timeScale())));
+    }
+
+    if(client) {
+        client->close();
+        delete client;
+        client = NULL;
+    }
+
+    if(server) {
+        server->close();
+        delete server;
+        server = NULL;
+    }
+}
+
+//---------------------------------------------------------------------------
+// splits the input to lines or binary packets
+void TRotorSim::process(const char *buf, int len)
+{
+    char ch;
+    int  i;
+
+    for(i=0; i<len; i++) {
+        ch = buf[i];
+
+        switch(proto)
+        {
+        case SimProto_GS232:
+        case SimProto_Rotctld:
+            if(ch == '\r' || ch == '\n') {
+                if(in_len > 0) {
+                    in[in_len] = '\0';
+                    processLine(in);
+                }
+
+                in_len = 0;
+                continue;
+            }
+
+            if(in_len >= RS_MAX_LINE - 1)
+                in_len = 0; // garbage, start over
+
+            in[in_len++] = ch;
+            break;
+
+        case SimProto_SPID:
+            if(in_len == 0 && ch != 0x57)
+                continue; // wait for the start byte
+
+            in[in_len++] = ch;
+            if(in_len == 13) {
+                processPacket();
+                in_len = 0;
+            }
+            break;
+
+        case SimProto_Monstrum:
+            if(in_len == 0 && ch != 0x53)
+                continue; // wait for S
+
+            in[in_len++] = ch;
+
+            if(in_len >= 2 && (in[1] < 4 || in[1] > 16)) {
+                in_len = 0; // bad length
+                continue;
+            }
+
+            if(in_len >= 2 && in_len == in[1]) {
+                processPacket();
+                in_len = 0;
+            }
+            break;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+void TRotorSim::processLine(const char *line)
+{
+    const char *args;
+    char   str[RS_MAX_LINE], cmd;
+    double t, az, el;
+    int    i_az, i_el, n;
+
+    t = seconds();
+    model.advance(t);
+
+    if(proto == SimProto_Rotctld) {
+        cmd = line[0];
+        args = line + 1;
+
+        // long command names
+        if(strncmp(line, "\\set_pos", 8) == 0) {
+            cmd = 'P';
+            args = line + 8;
+        }
+        else if(strcmp(line, "\\get_pos") == 0)
+            cmd = 'p';
+        else if(strcmp(line, "\\stop") == 0)
+            cmd = 'S';
+
+        switch(cmd)
+        {
+        case 'P':
+            if(sscanf(args, "%lf %lf", &az, &el) != 2 ||
+               az < model.min[0] || az > model.max[0] ||
+               el < model.min[1] || el > model.max[1]) {
+                reply("RPRT -1\n", 8);
+                return;
+            }
+
+            model.command(az, el, t);
+            reply("RPRT 0\n", 7);
+            return;
+
+        case 'p':
+            n = sprintf(str, "%.6f\n%.6f\n", model.reportedAz(), model.reportedEl());
+            reply(str, n);
+            return;
+
+        case 'S':
+            model.stop(t);
+            reply("RPRT 0\n", 7);
+            return;
+
+        case '_':
+            reply("Rotor simulator\n", 16);
+            return;
+
+        default:
+            reply("RPRT -4\n", 8);
+            return;
+        }
+    }
+
+    // GS-232, the W command must have exactly three digits per axis
+    if(line[0] == 'W') {
+        if(strlen(line) != 8 || line[4] != ' ' ||
+           sscanf(line + 1, "%3d %3d", &i_az, &i_el) != 2) {
+            reply("?>\r\n", 4);
+            return;
+        }
+
+        model.command(i_az, i_el, t);
+    }
+    else if(strcmp(line, "C2") == 0) {
+        n = sprintf(str, "AZ=%03d  EL=%03d\r\n",
+                    (int) floor(model.reportedAz() + 0.5), (int) floor(model.reportedEl() + 0.5));
+        reply(str, n);
+    }
+    else if(strcmp(line, "C") == 0) {
+        n = sprintf(str, "AZ=%03d\r\n", (int) floor(model.reportedAz() + 0.5));
+        reply(str, n);
+    }
+    else if(strcmp(line, "B") == 0) {
+        n = sprintf(str, "EL=%03d\r\n", (int) floor(model.reportedEl() + 0.5));
+        reply(str, n);
+    }
+    else if(strcmp(line, "S") == 0)
+        model.stop(t);
+    else if(line[0] == 'X' && line[1] >= '1' && line[1] <= '4' && line[2] == '\0')
+        ; // speed, the model uses the configured rate
+    else
+        reply("?>\r\n", 4);
+}
+
+//---------------------------------------------------------------------------
+void TRotorSim::processPacket(void)
+{
+    unsigned char *p = (unsigned char *) in;
+    char   str[RS_MAX_LINE];
+    double t, az, el, x, y;
+    int    u_az, u_el;
+
+    t = seconds();
+    model.advance(t);
+
+    if(proto == SimProto_SPID) {
+        switch(p[11])
+        {
+        case 0x2F: // set, digits are ascii, no reply
+            if(p[5] == 0 || p[10] == 0)
+                return;
+
+            spid_ph = p[5];
+            spid_pv = p[10];
+
+            u_az = (p[1] - '0') * 1000 + (p[2] - '0') * 100 + (p[3] - '0') * 10 + (p[4] - '0');
+            u_el = (p[6] - '0') * 1000 + (p[7] - '0') * 100 + (p[8] - '0') * 10 + (p[9] - '0');
+
+            model.command(((double) u_az) / spid_ph - 360.0, ((double) u_el) / spid_pv - 360.0, t);
+            return;
+
+        case 0x0F: // stop, answers with the position
+            model.stop(t);
+            break;
+
+        case 0x1F: // status
+            break;
+
+        default:
+            return;
+        }
+
+        // binary digits, hundreds to tenths of a degree + 360
+        u_az = (int) floor((model.reportedAz() + 360.0) * 10.0 + 0.5);
+        u_el = (int) floor((model.reportedEl() + 360.0) * 10.0 + 0.5);
+
+        str[ 0] = 0x57;
+        str[ 1] = u_az / 1000;
+        str[ 2] = (u_az % 1000) / 100;
+        str[ 3] = (u_az % 100) / 10;
+        str[ 4] = u_az % 10;
+        str[ 5] = spid_ph;
+        str[ 6] = u_el / 1000;
+        str[ 7] = (u_el % 1000) / 100;
+        str[ 8] = (u_el % 100) / 10;
+        str[ 9] = u_el % 10;
+        str[10] = spid_pv;
+        str[11] = 0x20;
+
+        reply(str, 12);
+        return;
+    }
+
+    // Monstrum
+    switch(p[2])
+    {
+    case 0x01: // move to X Y, hundredths of a degree
+        if(in[1] != 16 || p[3] != 'X' || p[9] != 'Y')
+            return;
+
+        memcpy(str, in + 4, 5); str[5] = '\0';
+        x = atof(str) / 100.0;
+        memcpy(str, in + 10, 5); str[5] = '\0';
+        y = atof(str) / 100.0;
+
+        model.command(x, y, t);
+        break;
+
+    case 0x02: // stop
+        model.stop(t);
+        break;
+
+    case 0x03: // position
+        str[0] = 0x53;
+        str[1] = 0x10;
+        str[2] = 0x03;
+        str[3] = 'X';
+        sprintf(str + 4, "%05.0f", model.reportedAz() * 100.0);
+        str[9] = 'Y';
+        sprintf(str + 10, "%05.0f", model.reportedEl() * 100.0);
+        str[15] = 'P';
+
+        reply(str, 16);
+        break;
+
+    case 0x08: // status
+        az = model.reportedAz();
+        el = model.reportedEl();
+
+        str[0] = 0x53;
+        str[1] = 0x0B;
+        str[2] = 0x08;
+        str[3] = az <= model.min[0] ? '1':'0';
+        str[4] = az >= model.max[0] ? '1':'0';
+        str[5] = el <= model.min[1] ? '1':'0';
+        str[6] = el >= model.max[1] ? '1':'0';
+        str[7] = 0; // error code
+        str[8] = 0; // warning code
+        str[9] = model.isBusy() ? '0':'1';
+        str[10] = 'P';
+
+        reply(str, 11);
+        break;
+
+    default: // 0x06 enable
+        break;
+    }
+
+}
+
+//---------------------------------------------------------------------------
+// replies are sent after reply_ms as the real devices do
+void TRotorSim::reply(const char *buf, int len)
+{
+    if(out_len + len > (int) sizeof(out))
+        return; // the driver does not read, drop
+
+    if(out_len == 0)
+        out_time = seconds() + reply_ms / 1000.0;
+
+    memcpy(out + out_len, buf, len);
+    out_len += len;
+}
+
+//---------------------------------------------------------------------------
+void TRotorSim::flushReplies(void)
+{
+    if(out_len == 0 || seconds() < out_time)
+        return;
+
+#if defined Q_OS_UNIX
+    if(pty_fd >= 0 && ::write(pty_fd, out, out_len) < 0)
+        qDebug("Rotor simulator: write failed");
+#endif
+
+    if(client) {
+        client->write(out, out_len);
+        client->flush();
+    }
+
+    out_len = 0;
+}
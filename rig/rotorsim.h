@@ -0,0 +1,169 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef ROTORSIM_H
+#define ROTORSIM_H
+
+#include <QThread>
+#include <QMutex>
+#include <QString>
+#include <QElapsedTimer>
+
+#include "rotor.h"
+
+#define RS_MAX_QUEUE        32       // commands waiting for the latency
+#define RS_POLL_MS          10       // emulator i/o poll interval
+#define RS_MAX_LINE         64
+
+#define RS_SIM_SPEED      10.0       // -rotorsim default, times faster than real time
+#define RS_SIM_LEAD        120       // seconds before AOS the simulated clock starts
+
+class QTcpServer;
+class QTcpSocket;
+
+//---------------------------------------------------------------------------
+/*
+  Mechanical model of a two axis rotor, the axes are az/el or X/Y.
+  A command starts to move the motors after the latency, the motors turn
+  with a constant rate and the antenna follows them through the backlash
+  dead band. The reported position is the motor side quantized to the
+  resolution, as most rotors measure it there and hide the backlash.
+  Times are in seconds, angles in degrees.
+*/
+class TRotorModel
+{
+public:
+    TRotorModel(void);
+
+    void setup(TRotor *rotor);
+    void reset(double az, double el, double t);
+
+    void command(double az, double el, double t);
+    void stop(double t);
+    void advance(double t);
+
+    double reportedAz(void) const;
+    double reportedEl(void) const;
+    double antennaAz(void) const { return ant[0]; }
+    double antennaEl(void) const { return ant[1]; }
+    bool   isBusy(void) const;
+
+    double rate[2];         // degrees per second
+    double backlash[2];     // dead band width in degrees
+    double min[2], max[2];  // axis limits
+    double latency;         // seconds from command to motion
+    double resolution;      // command and reported position step
+
+protected:
+    void move(double dt);
+
+private:
+    typedef struct {
+        double t;
+        double pos[2];
+        bool   stop;
+    } TQueued;
+
+    TQueued queue[RS_MAX_QUEUE];
+    int     q_head, q_count;
+
+    double  motor[2], ant[2], target[2];
+    double  now;
+};
+
+//---------------------------------------------------------------------------
+typedef enum TSimProto_t
+{
+    SimProto_GS232 = 0,
+    SimProto_SPID,
+    SimProto_Monstrum,
+    SimProto_Rotctld
+} TSimProto;
+
+//---------------------------------------------------------------------------
+/*
+  Rotor emulator for testing the drivers without hardware.
+  Speaks the GS-232, SPID Rot2Prog, Monstrum and rotctld protocols on a
+  pseudo terminal (Unix only), the slave device name is given by
+  deviceName() and is opened by the driver as its serial port, or on a
+  TCP port for the network rotor. The Jrk and the stepper can not be
+  emulated this way, they have only the in process TRotorModel.
+  Reply delay and the protocol quirks of the real devices are emulated,
+  e.g. GS-232 answers "?>" to a malformed command and SPID to the 0.5
+  degree steps only.
+  The model follows the simulated clock of TTickScheduler, so a pass can
+  be flown faster than real time, see MainWindow::simulatePass.
+*/
+class TRotorSim : public QThread
+{
+public:
+    TRotorSim(QObject *parent=0);
+    ~TRotorSim(void);
+
+    bool startPty(TSimProto proto, TRotor *rotor);
+    bool startTcp(TSimProto proto, TRotor *rotor, int port);
+    void stop(void);
+
+    static bool protocolFor(TRotor *rotor, TSimProto *proto);
+
+    QString deviceName(void) const { return device; }
+    QString errorString(void) const { return error; }
+
+    void   getPosition(double *az, double *el);
+    void   getAntenna(double *x, double *y);
+    int    reply_ms;        // emulated processing delay of a reply
+
+protected:
+    void run(void);
+    bool setup(TSimProto proto, TRotor *rotor);
+    void process(const char *buf, int len);
+    void processLine(const char *line);
+    void processPacket(void);
+    void reply(const char *buf, int len);
+    void flushReplies(void);
+    double seconds(void);
+
+private:
+    TRotorModel model;
+    TSimProto   proto;
+    QMutex      mutex;
+    volatile bool quit;
+
+    int         pty_fd;
+    int         tcp_port;
+    QTcpServer  *server;
+    QTcpSocket  *client;
+
+    QString     device;
+    QString     error;
+
+    char        in[RS_MAX_LINE];
+    int         in_len;
+
+    char        out[RS_MAX_LINE * 4];
+    int         out_len;
+    double      out_time;
+
+    QElapsedTimer timer;
+    int         spid_ph, spid_pv;
+};
+
+#endif // ROTORSIM_H
@@ -0,0 +1,197 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <QUdpSocket>
+#include <QHostAddress>
+#include <QMutexLocker>
+#include <stdio.h>
+#include <string.h>
+
+#include "signalmonitor.h"
+
+//---------------------------------------------------------------------------
+TSignalMonitor::TSignalMonitor(void)
+{
+    socket = NULL;
+    count = 0;
+    best = SignalMetric_None;
+}
+
+//---------------------------------------------------------------------------
+TSignalMonitor::~TSignalMonitor(void)
+{
+    close();
+}
+
+//---------------------------------------------------------------------------
+// the socket belongs to the calling thread, read() must be called from it
+bool TSignalMonitor::open(int port)
+{
+    close();
+
+    if(port <= 0)
+        return false;
+
+    socket = new QUdpSocket();
+    if(!socket->bind(QHostAddress::LocalHost, port)) {
+        qDebug("Signal monitor: failed to bind udp port %d: %s",
+               port, socket->errorString().toStdString().c_str());
+
+        delete socket;
+        socket = NULL;
+
+        return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void TSignalMonitor::close(void)
+{
+    if(socket) {
+        socket->close();
+        delete socket;
+        socket = NULL;
+    }
+}
+
+//---------------------------------------------------------------------------
+// a new pass
+void TSignalMonitor::reset(void)
+{
+    QMutexLocker locker(&mutex);
+
+    count = 0;
+    best = SignalMetric_None;
+    last_sample.invalidate();
+}
+
+//---------------------------------------------------------------------------
+bool TSignalMonitor::isActive(void)
+{
+    QMutexLocker locker(&mutex);
+
+    return last_sample.isValid() && last_sample.elapsed() < SM_TIMEOUT_MS;
+}
+
+//---------------------------------------------------------------------------
+TSignalMetric TSignalMonitor::metric(void)
+{
+    QMutexLocker locker(&mutex);
+
+    return best;
+}
+
+//---------------------------------------------------------------------------
+// any thread
+void TSignalMonitor::post(TSignalMetric m, double value)
+{
+    QMutexLocker locker(&mutex);
+
+    if(m < best)
+        return;
+
+    // a better metric, the older values are not comparable
+    if(m > best) {
+        best = m;
+        count = 0;
+    }
+
+    if(count >= SM_MAX_SAMPLES) {
+        memmove(queue, queue + 1, (SM_MAX_SAMPLES - 1) * sizeof(double));
+        count--;
+    }
+
+    queue[count++] = value;
+    last_sample.start();
+}
+
+//---------------------------------------------------------------------------
+void TSignalMonitor::postRS(int frames, int corrected, int failed)
+{
+    if(frames > 0)
+        post(SignalMetric_RS, rsQuality(frames, corrected, failed));
+}
+
+//---------------------------------------------------------------------------
+// a failed frame counts as all symbols wrong
+double TSignalMonitor::rsQuality(int frames, int corrected, int failed)
+{
+    double q;
+
+    if(frames <= 0)
+        return 0;
+
+    q = 1.0 - ((double) corrected + (double) failed * SM_RS_SYMBOLS) / ((double) frames * SM_RS_SYMBOLS);
+
+    return q < 0 ? 0:q;
+}
+
+//---------------------------------------------------------------------------
+// receives the datagrams and returns the values in arrival order
+int TSignalMonitor::read(double *values, int max_values)
+{
+    char   buf[512], *line, *next;
+    qint64 len;
+    int    n;
+
+    while(socket && socket->hasPendingDatagrams()) {
+        len = socket->readDatagram(buf, sizeof(buf) - 1);
+        if(len <= 0)
+            break;
+
+        buf[len] = '\0';
+
+        for(line=buf; line && *line; line=next) {
+            next = strpbrk(line, "\r\n");
+            if(next)
+                *next++ = '\0';
+
+            parse(line);
+        }
+    }
+
+    QMutexLocker locker(&mutex);
+
+    n = count < max_values ? count:max_values;
+    memcpy(values, queue, n * sizeof(double));
+
+    count -= n;
+    if(count > 0)
+        memmove(queue, queue + n, count * sizeof(double));
+
+    return n;
+}
+
+//---------------------------------------------------------------------------
+void TSignalMonitor::parse(const char *line)
+{
+    double v;
+    int    frames, corrected, failed;
+
+    if(sscanf(line, "snr %lf", &v) == 1)
+        post(SignalMetric_SNR, v);
+    else if(sscanf(line, "lock %lf", &v) == 1)
+        post(SignalMetric_Lock, v);
+    else if(sscanf(line, "rs %d %d %d", &frames, &corrected, &failed) == 3)
+        postRS(frames, corrected, failed);
+}
@@ -0,0 +1,91 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef SIGNALMONITOR_H
+#define SIGNALMONITOR_H
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QElapsedTimer>
+
+#define SM_DEFAULT_PORT     4545     // udp port on the local host
+#define SM_MAX_SAMPLES      64       // posted values waiting to be read
+#define SM_TIMEOUT_MS       5000     // signal is lost without samples
+#define SM_RS_SYMBOLS       64       // correctable symbols per CADU, RS(255,223) interleave 4
+
+class QUdpSocket;
+
+//---------------------------------------------------------------------------
+typedef enum TSignalMetric_t
+{
+    SignalMetric_None = 0,
+    SignalMetric_Lock,      // frame sync lock rate 0...1
+    SignalMetric_RS,        // Reed-Solomon quality 0...1
+    SignalMetric_SNR        // dB
+} TSignalMetric;
+
+//---------------------------------------------------------------------------
+/*
+  Live signal quality for the conical scan. The rx process sends text
+  datagrams to the local udp port, one value per line:
+
+      snr <dB>
+      lock <sync lock rate 0...1>
+      rs <frames> <corrected symbols> <failed frames>
+
+  In process decoders call post() or postRS() instead. Only the best
+  metric seen is used, SNR before RS before lock, the scan needs a
+  value which is higher when the antenna points better.
+*/
+class TSignalMonitor
+{
+public:
+    TSignalMonitor(void);
+    ~TSignalMonitor(void);
+
+    bool open(int port);
+    void close(void);
+    bool isOpen(void) const { return socket != NULL; }
+
+    void reset(void);
+    bool isActive(void);
+    TSignalMetric metric(void);
+
+    void post(TSignalMetric m, double value);
+    void postRS(int frames, int corrected, int failed);
+    int  read(double *values, int max_values);
+
+    static double rsQuality(int frames, int corrected, int failed);
+
+protected:
+    void parse(const char *line);
+
+private:
+    QUdpSocket    *socket;
+    QMutex        mutex;
+    QElapsedTimer last_sample;
+
+    double        queue[SM_MAX_SAMPLES];
+    int           count;
+    TSignalMetric best;
+};
+
+#endif // SIGNALMONITOR_H
@@ -35,6 +35,7 @@
 
 #include "mainwindow.h"
 #include "plist.h"
+#include "satcatalog.h"
 #include "Satellite.h"
 #include "satutil.h"
 #include "settings.h"
@@ -46,7 +47,7 @@ ActiveSatDialog::ActiveSatDialog(QWidget *parent) :
     m_ui(new Ui::ActiveSatDialog)
 {
  QListWidgetItem *item;
- PList *list;
+ TSatCatalog *list;
  TSat  *sat, *sat2;
  int i;
 
@@ -58,7 +59,7 @@ ActiveSatDialog::ActiveSatDialog(QWidget *parent) :
     mw = (MainWindow *) parent;
     list = mw->getSatList();
 
-    satList = new PList;
+    satList = new TSatCatalog;
     m_ui->satListWidget->setSortingEnabled(false);
 
     for(i=0; i<list->Count; i++) {
@@ -181,6 +182,7 @@ void ActiveSatDialog::on_satListWidget_itemClicked(QListWidgetItem* item)
 
     // Post RX-Script
     m_ui->enablePostProcScriptCb->setChecked(script->postproc_srcrip_enable());
+    m_ui->decodePassCb->setChecked(script->decode_enable());
     m_ui->postprocScriptEd->setText(script->postproc_script());
 
     sl = script->postproc_script_args();
@@ -232,6 +234,7 @@ void ActiveSatDialog::on_applyButton_clicked()
 
     // Post RX-Script
     script->postproc_srcrip_enable(m_ui->enablePostProcScriptCb->isChecked());
+    script->decode_enable(m_ui->decodePassCb->isChecked());
     script->postproc_script(m_ui->postprocScriptEd->text());
     script->postproc_script_args(getArguments(m_ui->postprocScriptArgEd));
 }
@@ -277,7 +280,7 @@ void ActiveSatDialog::on_satListWidget_itemChanged(QListWidgetItem* item)
 //---------------------------------------------------------------------------
 void ActiveSatDialog::on_buttonBox_accepted()
 {
- PList *list;
+ TSatCatalog *list;
  TSat  *sat, *sat2;
  int i;
 
@@ -298,7 +301,7 @@ void ActiveSatDialog::on_buttonBox_accepted()
 void ActiveSatDialog::keyPressEvent(QKeyEvent *event)
 {
  QListWidgetItem *item;
- PList *list;
+ TSatCatalog *list;
  TSat *sat;
 
   if(event->key() != Qt::Key_Delete) {
@@ -34,7 +34,7 @@ class QStringList;
 class QString;
 class QProcess;
 class MainWindow;
-class PList;
+class TSatCatalog;
 class TSat;
 class TextWindow;
 
@@ -61,7 +61,7 @@ protected:
 private:
     Ui::ActiveSatDialog *m_ui;
     MainWindow *mw;
-    PList *satList;
+    TSatCatalog *satList;
     int flags;
 
     TextWindow *terminal;
@@ -0,0 +1,405 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QMap>
+#include <QtAlgorithms>
+#include <QDebug>
+#include <string.h>
+#include <stdlib.h>
+
+#include "tlearchive.h"
+
+//---------------------------------------------------------------------------
+static bool entryLessThan(const TTLEIndexEntry &e1, const TTLEIndexEntry &e2)
+{
+ return e1.daynum < e2.daynum;
+}
+
+//---------------------------------------------------------------------------
+TTLEArchive::TTLEArchive(const QString &_dir)
+{
+    dir = _dir;
+}
+
+//---------------------------------------------------------------------------
+QString TTLEArchive::dataFile(long catnum) const
+{
+ QString str;
+
+ return dir + "/" + str.sprintf("%05ld.tle", catnum);
+}
+
+//---------------------------------------------------------------------------
+QString TTLEArchive::indexFile(long catnum) const
+{
+ QString str;
+
+ return dir + "/" + str.sprintf("%05ld.idx", catnum);
+}
+
+//---------------------------------------------------------------------------
+// returns false if the set is invalid, already archived or can't be written
+bool TTLEArchive::add(const char *name, const char *line1, const char *line2)
+{
+ QVector<TTLERecord> recs;
+ TTLERecord rec;
+
+    if(name == NULL || line1 == NULL || line2 == NULL ||
+       !validLines(QByteArray(line1), QByteArray(line2)))
+        return false;
+
+    memset(&rec, 0, sizeof(rec));
+    strncpy(rec.name, name, TLE_NAMELEN);
+    memcpy(rec.line1, line1, TLE_LINELEN);
+    memcpy(rec.line2, line2, TLE_LINELEN);
+    rec.catnum = strtol(QByteArray(line1 + 2, 5).constData(), NULL, 10);
+    rec.epoch  = TTLELoader::epochKey(rec.line1);
+
+    recs.append(rec);
+
+ return merge(rec.catnum, recs) > 0;
+}
+
+//---------------------------------------------------------------------------
+// imports all element sets of a TLE file or a historical dump, each index is
+// written once per file. Returns the number of new sets or -1 on errors.
+int TTLEArchive::importFile(const QString &filename)
+{
+ QMap<long, QVector<TTLERecord> > sats;
+ QMap<long, QVector<TTLERecord> >::const_iterator it;
+ TTLELoader loader;
+ int i, rc, count = 0;
+
+    if(loader.load(filename, false, true) < 0)
+        return -1;
+
+    const QVector<TTLERecord> &recs = loader.records();
+    for(i=0; i<recs.size(); i++)
+        sats[recs.at(i).catnum].append(recs.at(i));
+
+    for(it=sats.constBegin(); it!=sats.constEnd(); ++it) {
+        rc = merge(it.key(), it.value());
+        if(rc < 0)
+            return -1;
+        count += rc;
+    }
+
+ return count;
+}
+
+//---------------------------------------------------------------------------
+// the element set with the epoch closest to daynum
+bool TTLEArchive::find(long catnum, double daynum, TTLERecord *rec)
+{
+ QVector<TTLEIndexEntry> index;
+ const TTLEIndexEntry *entry;
+ TTLEIndexHeader hdr;
+ uchar  *data = NULL;
+ qint64 offset;
+ int    i, count;
+
+    if(!QFile::exists(dataFile(catnum)))
+        return false;
+
+    QFile file(indexFile(catnum));
+    if(file.open(QIODevice::ReadOnly) &&
+       file.read((char *) &hdr, sizeof(hdr)) == (qint64) sizeof(hdr) &&
+       validIndex(catnum, hdr, file.size()))
+        data = file.map(0, file.size());
+
+    if(data) {
+        entry = (const TTLEIndexEntry *) (data + sizeof(hdr));
+        count = hdr.count;
+    }
+    else {
+        file.close();
+        if(!rebuildIndex(catnum, &index))
+            return false;
+        entry = index.constData();
+        count = index.size();
+    }
+
+    if(count == 0) {
+        if(data)
+            file.unmap(data);
+        return false;
+    }
+
+    i = lowerBound(entry, count, daynum);
+    if(i >= count || (i > 0 && daynum - entry[i-1].daynum < entry[i].daynum - daynum))
+        i--;
+
+    offset = entry[i].offset;
+
+    if(data)
+        file.unmap(data);
+
+ return readRecord(catnum, offset, rec);
+}
+
+//---------------------------------------------------------------------------
+// appends the sets not archived yet, returns the number of sets added or -1
+int TTLEArchive::merge(long catnum, const QVector<TTLERecord> &recs)
+{
+ QVector<TTLEIndexEntry> index, cand;
+ TTLEIndexEntry entry;
+ QByteArray bytes;
+ qint64 offset;
+ bool   sorted = true;
+ int    i, k, count, added = 0;
+
+    if(!QDir().mkpath(dir)) {
+        qDebug("TTLEArchive: failed to create %s", dir.toStdString().c_str());
+        return -1;
+    }
+
+    if(!readIndex(catnum, &index))
+        return -1;
+
+    // sorted by epoch so that duplicates in recs are next to each other
+    for(i=0; i<recs.size(); i++) {
+        entry.daynum = TTLELoader::epochDaynum(recs.at(i).line1);
+        entry.offset = i;
+        cand.append(entry);
+    }
+    qSort(cand.begin(), cand.end(), entryLessThan);
+
+    QFile file(dataFile(catnum));
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug("TTLEArchive: failed to open %s", file.fileName().toStdString().c_str());
+        return -1;
+    }
+
+    offset = file.size();
+    count  = index.size();
+
+    for(i=0; i<cand.size(); i++) {
+        if(i > 0 && cand.at(i).daynum == cand.at(i-1).daynum)
+            continue;
+
+        entry.daynum = cand.at(i).daynum;
+        k = lowerBound(index.constData(), count, entry.daynum);
+        if(k < count && index.at(k).daynum == entry.daynum)
+            continue;
+
+        const TTLERecord &rec = recs.at((int) cand.at(i).offset);
+        bytes = rec.name;
+        bytes.append('\n').append(rec.line1).append('\n').append(rec.line2).append('\n');
+        if(file.write(bytes) != bytes.size()) {
+            qDebug("TTLEArchive: failed to write %s", file.fileName().toStdString().c_str());
+            break;
+        }
+
+        if(!index.isEmpty() && entry.daynum < index.last().daynum)
+            sorted = false;
+
+        entry.offset = offset;
+        offset += bytes.size();
+
+        index.append(entry);
+        added++;
+    }
+
+    file.close();
+
+    if(added == 0)
+        return 0;
+
+    if(!sorted)
+        qSort(index.begin(), index.end(), entryLessThan);
+
+    // on a short write the sizes differ and the next reader rebuilds the index
+    if(!writeIndex(catnum, index, offset))
+        return -1;
+
+ return added;
+}
+
+//---------------------------------------------------------------------------
+bool TTLEArchive::validIndex(long catnum, const TTLEIndexHeader &hdr, qint64 size)
+{
+ QFileInfo fi(dataFile(catnum));
+
+ return hdr.magic == TLE_ARCHIVE_MAGIC && hdr.version == TLE_ARCHIVE_VERSION &&
+        hdr.entry_size == sizeof(TTLEIndexEntry) &&
+        hdr.data_size == fi.size() &&
+        size == (qint64) (sizeof(hdr) + (qint64) hdr.count * sizeof(TTLEIndexEntry));
+}
+
+//---------------------------------------------------------------------------
+bool TTLEArchive::readIndex(long catnum, QVector<TTLEIndexEntry> *index)
+{
+ TTLEIndexHeader hdr;
+ qint64 bytes;
+
+    index->clear();
+
+    if(!QFile::exists(dataFile(catnum)))
+        return true;
+
+    QFile file(indexFile(catnum));
+    if(file.open(QIODevice::ReadOnly) &&
+       file.read((char *) &hdr, sizeof(hdr)) == (qint64) sizeof(hdr) &&
+       validIndex(catnum, hdr, file.size())) {
+        index->resize(hdr.count);
+        bytes = (qint64) hdr.count * sizeof(TTLEIndexEntry);
+        if(bytes == 0 || file.read((char *) index->data(), bytes) == bytes)
+            return true;
+    }
+
+    file.close();
+
+ return rebuildIndex(catnum, index);
+}
+
+//---------------------------------------------------------------------------
+// scans the data file, the offset of an entry is the one of its name line
+bool TTLEArchive::rebuildIndex(long catnum, QVector<TTLEIndexEntry> *index)
+{
+ TTLEIndexEntry entry;
+ QByteArray line[3];
+ qint64 pos[3] = { 0, 0, 0 };
+ int    n = 0;
+
+    index->clear();
+
+    QFile file(dataFile(catnum));
+    if(!file.open(QIODevice::ReadOnly)) {
+        qDebug("TTLEArchive: failed to open %s", file.fileName().toStdString().c_str());
+        return false;
+    }
+
+    while(!file.atEnd()) {
+        pos[0]  = pos[1];  pos[1]  = pos[2];  pos[2] = file.pos();
+        line[0] = line[1]; line[1] = line[2]; line[2] = file.readLine().trimmed();
+
+        if(++n < 3 || !validLines(line[1], line[2]))
+            continue;
+
+        entry.daynum = TTLELoader::epochDaynum(line[1].constData());
+        entry.offset = pos[0];
+        index->append(entry);
+
+        n = 0;
+    }
+
+    qSort(index->begin(), index->end(), entryLessThan);
+
+    qDebug("TTLEArchive: rebuilt %s, %d element sets",
+           indexFile(catnum).toStdString().c_str(), index->size());
+
+ return writeIndex(catnum, *index, file.size());
+}
+
+//---------------------------------------------------------------------------
+// written to a temporary file first so that a reader never sees a partial index
+bool TTLEArchive::writeIndex(long catnum, const QVector<TTLEIndexEntry> &index, qint64 data_size)
+{
+ TTLEIndexHeader hdr;
+ QString indexfile = indexFile(catnum);
+ QString tmpfile = indexfile + ".tmp";
+ qint64  bytes;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic      = TLE_ARCHIVE_MAGIC;
+    hdr.version    = TLE_ARCHIVE_VERSION;
+    hdr.entry_size = sizeof(TTLEIndexEntry);
+    hdr.count      = index.size();
+    hdr.data_size  = data_size;
+
+    bytes = (qint64) index.size() * sizeof(TTLEIndexEntry);
+
+    QFile file(tmpfile);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug("TTLEArchive: failed to create %s", tmpfile.toStdString().c_str());
+        return false;
+    }
+
+    if(file.write((const char *) &hdr, sizeof(hdr)) != (qint64) sizeof(hdr) ||
+       file.write((const char *) index.constData(), bytes) != bytes) {
+        file.close();
+        QFile::remove(tmpfile);
+        return false;
+    }
+
+    file.close();
+
+    QFile::remove(indexfile);
+
+ return QFile::rename(tmpfile, indexfile);
+}
+
+//---------------------------------------------------------------------------
+bool TTLEArchive::readRecord(long catnum, qint64 offset, TTLERecord *rec)
+{
+ QByteArray name, line1, line2;
+
+    QFile file(dataFile(catnum));
+    if(!file.open(QIODevice::ReadOnly) || !file.seek(offset))
+        return false;
+
+    name  = file.readLine().trimmed();
+    line1 = file.readLine().trimmed();
+    line2 = file.readLine().trimmed();
+
+    if(!validLines(line1, line2))
+        return false;
+
+    memset(rec, 0, sizeof(TTLERecord));
+    strncpy(rec->name, name.constData(), TLE_NAMELEN);
+    memcpy(rec->line1, line1.constData(), TLE_LINELEN);
+    memcpy(rec->line2, line2.constData(), TLE_LINELEN);
+    rec->catnum = catnum;
+    rec->epoch  = TTLELoader::epochKey(rec->line1);
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// first entry with an epoch not before daynum, count if there is none
+int TTLEArchive::lowerBound(const TTLEIndexEntry *index, int count, double daynum)
+{
+ int lo = 0, hi = count, mid;
+
+    while(lo < hi) {
+        mid = (lo + hi) / 2;
+        if(index[mid].daynum < daynum)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+ return lo;
+}
+
+//---------------------------------------------------------------------------
+bool TTLEArchive::validLines(const QByteArray &line1, const QByteArray &line2)
+{
+ return line1.size() >= TLE_LINELEN && line2.size() >= TLE_LINELEN &&
+        line1.startsWith("1 ") && line2.startsWith("2 ") &&
+        memcmp(line1.constData() + 2, line2.constData() + 2, 5) == 0 &&
+        TTLELoader::checksum(line1.constData()) && TTLELoader::checksum(line2.constData());
+}
+
+//---------------------------------------------------------------------------
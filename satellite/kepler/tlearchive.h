@@ -0,0 +1,85 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef TLEARCHIVE_H
+#define TLEARCHIVE_H
+
+#include <QString>
+#include <QVector>
+
+#include "tleloader.h"
+
+#define TLE_ARCHIVE_MAGIC   0x49454c54 // "TLEI"
+#define TLE_ARCHIVE_VERSION 1
+
+//---------------------------------------------------------------------------
+typedef struct
+{
+    double daynum;  // epoch, see TTLELoader::epochDaynum()
+    qint64 offset;  // of the name line in the data file
+} TTLEIndexEntry;
+
+typedef struct
+{
+    quint32 magic;
+    quint32 version;
+    quint32 entry_size;
+    quint32 count;
+    qint64  data_size;
+} TTLEIndexHeader;
+
+//---------------------------------------------------------------------------
+// Archive of historical element sets.
+// Each catalog number has an append only <dir>/<catnum>.tle with three line
+// sets and a binary <dir>/<catnum>.idx of the epochs sorted in time, the
+// index is rebuilt whenever it is missing or does not match the data file.
+// find() returns the set with the epoch closest to a given time, the index
+// is memory mapped and searched binary.
+class TTLEArchive
+{
+public:
+    TTLEArchive(const QString &_dir);
+
+    bool add(const char *name, const char *line1, const char *line2);
+    int  importFile(const QString &filename);
+    bool find(long catnum, double daynum, TTLERecord *rec);
+
+    const QString &getDir(void) const { return dir; }
+
+protected:
+    int  merge(long catnum, const QVector<TTLERecord> &recs);
+    bool readIndex(long catnum, QVector<TTLEIndexEntry> *index);
+    bool rebuildIndex(long catnum, QVector<TTLEIndexEntry> *index);
+    bool writeIndex(long catnum, const QVector<TTLEIndexEntry> &index, qint64 data_size);
+    bool validIndex(long catnum, const TTLEIndexHeader &hdr, qint64 size);
+    bool readRecord(long catnum, qint64 offset, TTLERecord *rec);
+
+    QString dataFile(long catnum) const;
+    QString indexFile(long catnum) const;
+
+    static int  lowerBound(const TTLEIndexEntry *index, int count, double daynum);
+    static bool validLines(const QByteArray &line1, const QByteArray &line2);
+
+private:
+    QString dir;
+};
+
+#endif // TLEARCHIVE_H
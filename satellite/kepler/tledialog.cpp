@@ -33,11 +33,13 @@
 #include "Satellite.h"
 #include "satutil.h"
 #include "plist.h"
+#include "satcatalog.h"
 #include "station.h"
+#include "tlearchive.h"
 
 
 //---------------------------------------------------------------------------
-tledialog::tledialog(PList *list, TStation *_qth, QWidget *parent) :
+tledialog::tledialog(TSatCatalog *list, TStation *_qth, QWidget *parent) :
     QDialog(parent),
     m_ui(new Ui::tledialog)
 {
@@ -48,7 +50,7 @@ tledialog::tledialog(PList *list, TStation *_qth, QWidget *parent) :
     http = new QHttp(this);
     connect(http, SIGNAL(done(bool)), this, SLOT(saveTLE()));
 
-    satList = new PList;
+    satList = new TSatCatalog;
     satListptr = list;
     qth = _qth;
 
@@ -155,20 +157,14 @@ void tledialog::saveTLE()
 //---------------------------------------------------------------------------
 int tledialog::readTLE(const QString &filename)
 {
- FILE *fp;
  int count;
 
-    fp = fopen(filename.toStdString().c_str(), "r");
-    if(!fp) {
+    count = ReadTLEFile(filename, satList);
+    if(count < 0) {
        QMessageBox::critical(this, "Failed to open TLE file!", filename);
        return 0;
     }
-
-    count = ReadTLE(fp, satList);
-
-    fclose(fp);
-
-    if(count <= 0) {
+    else if(count == 0) {
        QMessageBox::critical(this, "No valid satellites found in TLE file!", filename);
 
        return 0;
@@ -196,6 +192,39 @@ void tledialog::on_fileBtn_clicked()
      addToListWidget();
 }
 
+//---------------------------------------------------------------------------
+void tledialog::on_archiveBtn_clicked()
+{
+ TTLEArchive archive(tlearcpath);
+ QString str;
+ int i, rc, count=0;
+
+  QStringList files = QFileDialog::getOpenFileNames(
+                          this,
+                          "Select one or more historical TLE files to archive",
+                          tlearcpath,
+                          "TLE Files (*.txt *.tle);;Any File (*.*)");
+
+  if(files.count() == 0)
+     return;
+
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+
+  for(i=0; i<files.count(); i++) {
+     rc = archive.importFile(files.at(i));
+     if(rc < 0) {
+        QApplication::restoreOverrideCursor();
+        QMessageBox::critical(this, "Failed to archive TLE file!", files.at(i));
+        return;
+     }
+     count += rc;
+  }
+
+  QApplication::restoreOverrideCursor();
+
+  QMessageBox::information(this, "TLE Archive", str.sprintf("%d new element sets archived", count));
+}
+
 //---------------------------------------------------------------------------
 void tledialog::addToListWidget(void)
 {
@@ -285,11 +314,14 @@ void tledialog::updateSatTLE()
             satListptr->Add(sat);
         }
         else {
-            // archivate previous TLE
-            if(strcmp(newsat->line1, sat->line1))
+            // archivate previous and new TLE
+            if(strcmp(newsat->line1, sat->line1)) {
+                archivate(sat);
                 archivate(newsat);
+            }
 
             sat->TLEKepCheck(newsat->name, newsat->line1, newsat->line2);
+            satListptr->reindex(sat);
         }
 
         sat->AssignObsInfo(qth);
@@ -302,34 +334,12 @@ void tledialog::updateSatTLE()
 }
 
 //---------------------------------------------------------------------------
+// element sets already in the archive are skipped by their epoch
 void tledialog::archivate(TSat *sat)
 {
-    QString str, file;
-    FILE    *fp;
-
-    str = sat->name;
-    str.replace(" ", "-");
-    file = tlearcpath + "/" + str + ".tle";
+ TTLEArchive archive(tlearcpath);
 
-    if((fp = fopen(file.toStdString().c_str(), "r"))) {
-        while(fgets(sat->tmpstr, TLE_LINELEN, fp)) {
-            // check if line 1 is found
-            if(*sat->tmpstr == '1' && !strcmp(sat->tmpstr, sat->line1)) {
-                fclose(fp);
-
-                return;
-            }
-        }
-        fclose(fp);
-    }
-
-    if((fp = fopen(file.toStdString().c_str(), "a"))) {
-        fprintf(fp, "%s\n", sat->name);
-        fprintf(fp, "%s\n", sat->line1);
-        fprintf(fp, "%s\n", sat->line2);
-
-        fclose(fp);
-    }
+    archive.add(sat->name, sat->line1, sat->line2);
 }
 
 //---------------------------------------------------------------------------
@@ -34,14 +34,14 @@ class QDropEvent;
 class QHttp;
 class QListWidget;
 class QString;
-class PList;
+class TSatCatalog;
 class TStation;
 class TSat;
 
 class tledialog : public QDialog {
     Q_OBJECT
 public:
-    tledialog(PList *list, TStation *_qth, QWidget *parent = 0);
+    tledialog(TSatCatalog *list, TStation *_qth, QWidget *parent = 0);
     ~tledialog();
 
     void updateSatTLE(void);
@@ -57,7 +57,7 @@ protected:
 private:
     Ui::tledialog *m_ui;
     QHttp *http;
-    PList *satList, *satListptr;
+    TSatCatalog *satList, *satListptr;
     TStation *qth;
     QString tlepath, tlearcpath;
 
@@ -66,6 +66,7 @@ private slots:
     void on_buttonBox_accepted();
     void on_addButton_clicked();
     void on_fileBtn_clicked();
+    void on_archiveBtn_clicked();
     void on_downloadBtn_clicked();
     void saveTLE();
 };
@@ -0,0 +1,363 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QHash>
+#include <QDebug>
+#include <string.h>
+
+#include "tleloader.h"
+
+#define TLE_SET_BYTES 165 // typical size of a three line element set
+
+static const double pow10_tab[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+};
+
+//---------------------------------------------------------------------------
+// fixed column integer, blanks are skipped
+static long parseLong(const char *s, int len)
+{
+ long v = 0;
+ int  i;
+
+    for(i=0; i<len; i++)
+        if(s[i] >= '0' && s[i] <= '9')
+            v = v*10 + (s[i] - '0');
+
+ return v;
+}
+
+//---------------------------------------------------------------------------
+// fixed column unsigned decimal such as the epoch "ddd.dddddddd"
+static double parseDecimal(const char *s, int len)
+{
+ qint64 v = 0;
+ int    i, decimals = -1;
+
+    for(i=0; i<len; i++) {
+        if(s[i] >= '0' && s[i] <= '9') {
+            v = v*10 + (s[i] - '0');
+            if(decimals >= 0)
+                decimals++;
+        }
+        else if(s[i] == '.')
+            decimals = 0;
+    }
+
+    if(decimals <= 0)
+        return (double) v;
+
+ return (double) v / pow10_tab[decimals < 15 ? decimals:15];
+}
+
+//---------------------------------------------------------------------------
+TTLELoader::TTLELoader(void)
+{
+    cached = false;
+}
+
+//---------------------------------------------------------------------------
+// returns the number of element sets or -1 if the file can't be read
+int TTLELoader::load(const QString &filename, bool use_cache, bool all_sets)
+{
+ QFileInfo fi(filename);
+ QString   cachefile;
+ qint64    size, mtime;
+ uchar     *data;
+
+    recs.clear();
+    cached = false;
+
+    if(!fi.exists())
+        return -1;
+
+    size  = fi.size();
+    mtime = fi.lastModified().toTime_t();
+    cachefile = cacheFile(filename);
+
+    if(all_sets)
+        use_cache = false; // the cache holds the newest sets only
+
+    if(use_cache && readCache(cachefile, size, mtime)) {
+        cached = true;
+        return recs.size();
+    }
+
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly)) {
+        qDebug("TTLELoader: failed to open %s", filename.toStdString().c_str());
+        return -1;
+    }
+
+    if(size > 0) {
+        data = file.map(0, size);
+        if(data) {
+            parse((const char *) data, size, all_sets);
+            file.unmap(data);
+        }
+        else {
+            QByteArray array = file.readAll();
+            parse(array.constData(), array.size(), all_sets);
+        }
+    }
+
+    file.close();
+
+    if(use_cache && recs.size() > 0)
+        writeCache(cachefile, size, mtime);
+
+ return recs.size();
+}
+
+//---------------------------------------------------------------------------
+int TTLELoader::parse(const char *data, qint64 size, bool all_sets)
+{
+ QHash<QString, int> names;
+ const char *p, *eol, *end;
+ const char *line[3] = { NULL, NULL, NULL };
+ int        len[3] = { 0, 0, 0 };
+ int        n = 0, index;
+ TTLERecord rec;
+
+    end = data + size;
+    recs.reserve((int) (size / TLE_SET_BYTES) + 1);
+
+    for(p=data; p<end; p=eol+1) {
+        eol = (const char *) memchr(p, '\n', end - p);
+        if(eol == NULL)
+            eol = end;
+
+        line[0] = line[1]; len[0] = len[1];
+        line[1] = line[2]; len[1] = len[2];
+        line[2] = p;       len[2] = eol - p;
+        if(len[2] > 0 && p[len[2]-1] == '\r')
+            len[2]--;
+
+        if(++n < (all_sets ? 2:3))
+            continue;
+
+        // line 1 and line 2
+        if(len[1] < TLE_LINELEN || len[2] < TLE_LINELEN ||
+           line[1][0] != '1' || line[1][1] != ' ' ||
+           line[2][0] != '2' || line[2][1] != ' ')
+            continue;
+        if(memcmp(line[1] + 2, line[2] + 2, 5))
+            continue;
+        if(!checksum(line[1]) || !checksum(line[2]))
+            continue;
+
+        // the name line, historical dumps have none so the catalog number is used
+        memset(&rec, 0, sizeof(rec));
+        if(n < 3 || len[0] < 2 || *line[0] == '#' || !fixName(line[0], len[0], rec.name)) {
+            if(!all_sets)
+                continue;
+            memcpy(rec.name, line[1] + 2, 5);
+            rec.name[5] = '\0';
+        }
+
+        memcpy(rec.line1, line[1], TLE_LINELEN);
+        memcpy(rec.line2, line[2], TLE_LINELEN);
+        rec.line1[TLE_LINELEN] = '\0';
+        rec.line2[TLE_LINELEN] = '\0';
+        rec.catnum = parseLong(rec.line1 + 2, 5);
+        rec.epoch  = epochKey(rec.line1);
+
+        n = 0; // line 2 is not the name of the next set
+
+        if(all_sets) {
+            recs.append(rec);
+            continue;
+        }
+
+        index = names.value(rec.name, -1);
+        if(index < 0) {
+            names.insert(rec.name, recs.size());
+            recs.append(rec);
+        }
+        else if(rec.epoch > recs.at(index).epoch)
+            recs[index] = rec;
+    }
+
+ return recs.size();
+}
+
+//---------------------------------------------------------------------------
+// the checksum is the sum of all digits modulo 10 with a minus sign as 1
+bool TTLELoader::checksum(const char *line)
+{
+ unsigned sum = 0;
+ int      i;
+ unsigned char c;
+
+    if(line[68] < '0' || line[68] > '9')
+        return false;
+
+    for(i=0; i<68; i++) {
+        c = (unsigned char) line[i] - '0';
+        sum += (c <= 9 ? c:0) + (line[i] == '-');
+    }
+
+ return (sum % 10) == (unsigned) (line[68] - '0');
+}
+
+//---------------------------------------------------------------------------
+double TTLELoader::epochKey(const char *line1)
+{
+ return epochKey((int) parseLong(line1 + 18, 2), parseDecimal(line1 + 20, 12));
+}
+
+//---------------------------------------------------------------------------
+// two digit TLE years, 57..99 is 1957..1999
+double TTLELoader::epochKey(int year, double refepoch)
+{
+ return 1000.0 * (year < 57 ? year + 100:year) + refepoch;
+}
+
+//---------------------------------------------------------------------------
+// days since 31 Dec 1979 00:00 UTC like TSat::daynum, unlike epochKey() this
+// is continuous across years so epochs of different years can be subtracted
+double TTLELoader::epochDaynum(const char *line1)
+{
+ int year = (int) parseLong(line1 + 18, 2);
+
+    year += year < 57 ? 2000:1900;
+
+ return QDate(1980, 1, 1).daysTo(QDate(year, 1, 1)) + parseDecimal(line1 + 20, 12);
+}
+
+//---------------------------------------------------------------------------
+// same result as TSat::FixName(), the [*] part and trailing blanks are removed
+bool TTLELoader::fixName(const char *src, int len, char *dst)
+{
+ int i;
+
+    while(len > 0 && *src == '[') {
+        src++;
+        len--;
+    }
+
+    for(i=0; i<len && src[i] != '['; i++) ;
+    len = i;
+
+    while(len > 0 && (src[len-1] == ' ' || src[len-1] == '\t' || src[len-1] == '\r'))
+        len--;
+
+    if(len > TLE_NAMELEN)
+        len = TLE_NAMELEN;
+
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+
+ return len > 0;
+}
+
+//---------------------------------------------------------------------------
+QString TTLELoader::cacheFile(const QString &filename)
+{
+ QFileInfo fi(filename);
+
+ return fi.absolutePath() + "/" + TLE_CACHE_DIR + "/" + fi.fileName() + ".bin";
+}
+
+//---------------------------------------------------------------------------
+bool TTLELoader::readCache(const QString &cachefile, qint64 size, qint64 mtime)
+{
+ TTLECacheHeader hdr;
+ uchar  *data;
+ qint64 bytes;
+
+    QFile file(cachefile);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    bytes = file.size();
+    if(bytes < (qint64) sizeof(hdr) ||
+       file.read((char *) &hdr, sizeof(hdr)) != (qint64) sizeof(hdr))
+        return false;
+
+    if(hdr.magic != TLE_CACHE_MAGIC || hdr.version != TLE_CACHE_VERSION ||
+       hdr.record_size != sizeof(TTLERecord) ||
+       hdr.source_size != size || hdr.source_mtime != mtime ||
+       bytes != (qint64) (sizeof(hdr) + (qint64) hdr.count * sizeof(TTLERecord)))
+        return false;
+
+    recs.resize(hdr.count);
+    if(hdr.count == 0)
+        return true;
+
+    data = file.map(sizeof(hdr), bytes - sizeof(hdr));
+    if(data) {
+        memcpy(recs.data(), data, bytes - sizeof(hdr));
+        file.unmap(data);
+    }
+    else if(file.read((char *) recs.data(), bytes - sizeof(hdr)) != bytes - (qint64) sizeof(hdr)) {
+        recs.clear();
+        return false;
+    }
+
+ return true;
+}
+
+//---------------------------------------------------------------------------
+// written to a temporary file first so that a reader never sees a partial cache
+bool TTLELoader::writeCache(const QString &cachefile, qint64 size, qint64 mtime)
+{
+ TTLECacheHeader hdr;
+ QString tmpfile = cachefile + ".tmp";
+ qint64  bytes;
+
+    if(!QDir().mkpath(QFileInfo(cachefile).absolutePath()))
+        return false;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic        = TLE_CACHE_MAGIC;
+    hdr.version      = TLE_CACHE_VERSION;
+    hdr.record_size  = sizeof(TTLERecord);
+    hdr.count        = recs.size();
+    hdr.source_size  = size;
+    hdr.source_mtime = mtime;
+
+    bytes = (qint64) recs.size() * sizeof(TTLERecord);
+
+    QFile file(tmpfile);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug("TTLELoader: failed to create %s", tmpfile.toStdString().c_str());
+        return false;
+    }
+
+    if(file.write((const char *) &hdr, sizeof(hdr)) != (qint64) sizeof(hdr) ||
+       file.write((const char *) recs.constData(), bytes) != bytes) {
+        file.close();
+        QFile::remove(tmpfile);
+        return false;
+    }
+
+    file.close();
+
+    QFile::remove(cachefile);
+
+ return QFile::rename(tmpfile, cachefile);
+}
@@ -0,0 +1,92 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef TLELOADER_H
+#define TLELOADER_H
+
+#include <QString>
+#include <QVector>
+
+#include "Satellite.h"
+
+#define TLE_CACHE_DIR     ".cache"
+#define TLE_CACHE_MAGIC   0x43454c54 // "TLEC"
+#define TLE_CACHE_VERSION 1
+
+//---------------------------------------------------------------------------
+// One validated element set, fixed size so that it can be cached as is
+typedef struct
+{
+    char   name[TLE_NAMELEN+1];
+    char   line1[TLE_LINELEN+1];
+    char   line2[TLE_LINELEN+1];
+    long   catnum;
+    double epoch;   // 1000 * (years since 1900) + day of year, see epochKey()
+} TTLERecord;
+
+typedef struct
+{
+    quint32 magic;
+    quint32 version;
+    quint32 record_size;
+    quint32 count;
+    qint64  source_size;
+    qint64  source_mtime;
+} TTLECacheHeader;
+
+//---------------------------------------------------------------------------
+// Bulk TLE file reader.
+// The file is memory mapped and parsed in place, lines are checked with
+// the TLE checksum and only the newest element set of each name is kept.
+// With all_sets every element set is returned in file order, this also
+// accepts the two line sets of historical dumps which have no name line.
+// The result is written to <dir>/.cache/<file>.bin and reused as long as
+// the size and modification time of the TLE file are unchanged.
+class TTLELoader
+{
+public:
+    TTLELoader(void);
+
+    int  load(const QString &filename, bool use_cache=true, bool all_sets=false);
+
+    const QVector<TTLERecord> &records(void) const { return recs; }
+    int  count(void) const { return recs.size(); }
+    bool fromCache(void) const { return cached; }
+
+    static bool   checksum(const char *line);
+    static double epochKey(const char *line1);
+    static double epochKey(int year, double refepoch);
+    static double epochDaynum(const char *line1);
+
+protected:
+    int  parse(const char *data, qint64 size, bool all_sets);
+    bool readCache(const QString &cachefile, qint64 size, qint64 mtime);
+    bool writeCache(const QString &cachefile, qint64 size, qint64 mtime);
+
+    static QString cacheFile(const QString &filename);
+    static bool    fixName(const char *src, int len, char *dst);
+
+private:
+    QVector<TTLERecord> recs;
+    bool cached;
+};
+
+#endif // TLELOADER_H
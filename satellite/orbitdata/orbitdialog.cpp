@@ -25,10 +25,11 @@
 #include "Satellite.h"
 #include "satutil.h"
 #include "plist.h"
+#include "satcatalog.h"
 
 
 //---------------------------------------------------------------------------
-orbitdialog::orbitdialog(PList *_satList, QWidget *parent) :
+orbitdialog::orbitdialog(TSatCatalog *_satList, QWidget *parent) :
     QDialog(parent),
     m_ui(new Ui::orbitdialog)
 {
@@ -28,12 +28,12 @@ namespace Ui {
     class orbitdialog;
 }
 //---------------------------------------------------------------------------
-class PList;
+class TSatCatalog;
 //---------------------------------------------------------------------------
 class orbitdialog : public QDialog {
     Q_OBJECT
 public:
-    orbitdialog(PList *_satList, QWidget *parent = 0);
+    orbitdialog(TSatCatalog *_satList, QWidget *parent = 0);
     ~orbitdialog();
 
 protected:
@@ -41,7 +41,7 @@ protected:
 
 private:
     Ui::orbitdialog *m_ui;
-    PList *satList;
+    TSatCatalog *satList;
 
 private slots:
     void on_satListWidget_itemSelectionChanged();
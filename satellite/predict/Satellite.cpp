@@ -1076,7 +1076,8 @@ int TSat::GetRecDuration(void)
 }
 
 //---------------------------------------------------------------------------
-bool TSat::SavePassinfo(void)
+// the pass info ini next to the recording
+QString TSat::PassinfoFile(void)
 {
     QString file;
 
@@ -1085,12 +1086,22 @@ bool TSat::SavePassinfo(void)
         file = sat_scripts->baseband_filename();
 
     if(file.isEmpty())
-        return false;
+        return "";
 
     QFileInfo fi(file);
-    QString   inifile = fi.absolutePath() + "/" + fi.baseName() + ".ini";
 
-    fi.setFile(inifile);
+    return fi.absolutePath() + "/" + fi.baseName() + ".ini";
+}
+
+//---------------------------------------------------------------------------
+bool TSat::SavePassinfo(void)
+{
+    QString inifile = PassinfoFile();
+
+    if(inifile.isEmpty())
+        return false;
+
+    QFileInfo fi(inifile);
     if(fi.exists())
         if(!QFile::remove(inifile))
             return false;
@@ -1370,6 +1381,33 @@ void TSat::Calc(void)
      strcpy(ephem, "SGP4");
 }
 
+//---------------------------------------------------------------------------
+// satellite state only, without the observer and sun of Calc()
+// pos in km and vel in km/s are ECI (TEME), gmst is the Greenwich sidereal angle in radians
+void TSat::CalcECI(double dnum, double *pos, double *vel, double *gmst)
+{
+ vector_t p = {0,0,0,0};
+ vector_t v = {0,0,0,0};
+ double   jd, ts;
+
+  if(!isFlagSet(INITIALIZED_FLAG))
+     PreCalc();
+
+  jd = dnum+2444238.5;
+  ts = (jd-Julian_Date_of_Epoch(tle.epoch))*xmnpda;
+
+  if(isFlagSet(DEEP_SPACE_EPHEM_FLAG))
+     SDP4(ts, &tle, &p, &v);
+  else
+     SGP4(ts, &tle, &p, &v);
+
+  Convert_Sat_State(&p, &v);
+
+  pos[0] = p.x; pos[1] = p.y; pos[2] = p.z;
+  vel[0] = v.x; vel[1] = v.y; vel[2] = v.z;
+  *gmst  = ThetaG_JD(jd);
+}
+
 //---------------------------------------------------------------------------
 double TSat::FindLOS(void)
 {
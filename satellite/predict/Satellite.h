@@ -136,6 +136,7 @@ class TSat
 
    bool CanCalc(const double stationlat, double dnum, int mode=0);
    void Calc(void);
+   void CalcECI(double dnum, double *pos, double *vel, double *gmst);
    bool CalcAll(double dn, int mode=0);
    bool CheckThresholds(TRig *rig);
    bool CheckIsInSunLight(TSettings *setting);
@@ -182,6 +183,7 @@ class TSat
    int    GetRecDuration(void);
 
    bool   SavePassinfo(void);
+   QString PassinfoFile(void);
    bool   ReadPassinfo(QString hrptfile);
 
    void   SatellitePasses(TRig *rig, QTableWidget *grid, QDateTime utc, int mode=0);
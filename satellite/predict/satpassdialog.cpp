@@ -29,6 +29,7 @@
 
 #include "mainwindow.h"
 #include "plist.h"
+#include "satcatalog.h"
 #include "Satellite.h"
 #include "satutil.h"
 #include "utils.h"
@@ -38,7 +39,7 @@
 #define AOS_COL_NR 2
 
 //---------------------------------------------------------------------------
-satpassdialog::satpassdialog(PList *_satList, QWidget *parent) :
+satpassdialog::satpassdialog(TSatCatalog *_satList, QWidget *parent) :
     QDialog(parent),
     m_ui(new Ui::satpassdialog)
 {
@@ -45,13 +45,13 @@ class Obj_t
 class QListWidgetItem;
 class QDateTime;
 class MainWindow;
-class PList;
+class TSatCatalog;
 
 //---------------------------------------------------------------------------
 class satpassdialog : public QDialog {
     Q_OBJECT
 public:
-    satpassdialog(PList *_satList, QWidget *parent = 0);
+    satpassdialog(TSatCatalog *_satList, QWidget *parent = 0);
     ~satpassdialog();
 
 protected:
@@ -62,7 +62,7 @@ protected:
 
 private:
     Ui::satpassdialog *m_ui;
-    PList *satList;
+    TSatCatalog *satList;
     MainWindow *mw;
 
 private slots:
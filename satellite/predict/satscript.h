@@ -34,6 +34,7 @@
 #define SS_ENABLE_POSTPROC_SCRIPT       2
 #define SS_ENABLE_DC                    4
 #define SS_SAT_ACTIVE                   8
+#define SS_ENABLE_DECODE               16   // decode in process instead of the post rx script
 
 //---------------------------------------------------------------------------
 class QSettings;
@@ -77,6 +78,9 @@ public:
     QStringList  postproc_default_script_args(void) const;
     QString      get_postproc_command(bool *error, int mode=0);
 
+    bool         decode_enable(void)                     { return flag(SS_ENABLE_DECODE); }
+    void         decode_enable(bool enable)              { flag(SS_ENABLE_DECODE, enable); }
+
     QString      frames_filename(void) const { return _frames_filename; }
     QString      baseband_filename(void) const { return _baseband_filename; }
 
@@ -22,7 +22,10 @@
 #include <stdlib.h>
 #include <memory.h>
 #include <QSettings>
+#include <QCoreApplication>
+#include <QFileInfo>
 
+#include "config.h"
 #include "utils.h"
 #include "rgbconf.h"
 #include "ndvi.h"
@@ -155,11 +158,25 @@ int TNDVI::lutIndex(double ndvi_value, int lut_width)
     double delta = _max_ndvi - _min_ndvi;
     int value;
 
-    value = (int) rint(width * (ndvi_value + delta/2.0) / delta);
+    value = (int) rint(width * (ndvi_value - _min_ndvi) / delta);
 
     return (int) ClipValue(value, width, 0);
 }
 
+//---------------------------------------------------------------------------
+// relative LUT filenames are relative to the conf directory
+QString TNDVI::lutFilePath(void) const
+{
+    if(_lut.isEmpty())
+        return _lut;
+
+    QFileInfo fi(_lut);
+    if(fi.isRelative())
+        return QCoreApplication::applicationDirPath() + "/" + PATH_CONF + "/" + _lut;
+    else
+        return _lut;
+}
+
 //---------------------------------------------------------------------------
 bool TNDVI::isValid(double ndvi_value)
 {
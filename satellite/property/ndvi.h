@@ -39,6 +39,7 @@ public:
     QString name(void) const { return _name; }
     QString lut(void) const { return _lut; }
     void    lut(const QString& filename) { _lut = filename; }
+    QString lutFilePath(void) const;
     int     lutIndex(double ndvi_value, int lut_width);
 
     void    minValue(double vi);
@@ -0,0 +1,303 @@
+/*
+    POES-USRP, a software for recording and decoding POES high resolution weather satellite images.
+    Copyright (C) 2009-2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <stdlib.h>
+#include <QImage>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+
+#include "plist.h"
+#include "ndvi.h"
+#include "ndvilut.h"
+
+//---------------------------------------------------------------------------
+// each table is 4 MB, keep only a few of them around
+#define NDVI_LUT_CACHE_SIZE 4
+
+//---------------------------------------------------------------------------
+class TNDVILUTCacheItem
+{
+public:
+    TNDVILUTCacheItem(TNDVILUT *lut_) { lut = lut_; refs = 0; }
+    ~TNDVILUTCacheItem(void) { delete lut; }
+
+    TNDVILUT *lut;
+    int refs;
+};
+
+static PList  lut_cache;
+static QMutex lut_cache_mutex;
+
+//---------------------------------------------------------------------------
+TNDVILUT::TNDVILUT(void)
+{
+    _table = NULL;
+    _palette = NULL;
+    _palette_size = 0;
+}
+
+//---------------------------------------------------------------------------
+TNDVILUT::~TNDVILUT(void)
+{
+    if(_table)
+        free(_table);
+
+    if(_palette)
+        free(_palette);
+}
+
+//---------------------------------------------------------------------------
+// palette is either an image (colour scale, left to right or bottom to top)
+// or a text file with "index R G B" lines
+bool TNDVILUT::loadPalette(const QString& filename)
+{
+    QFileInfo fi(filename);
+    int i, n;
+
+    if(_palette)
+        free(_palette);
+    _palette = NULL;
+    _palette_size = 0;
+
+    if(filename.isEmpty() || !fi.exists())
+        return false;
+
+    if(fi.suffix().toLower() == "txt") {
+        QFile file(filename);
+        QStringList sl;
+        quint32 *pal;
+        int r, g, b;
+
+        if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+            return false;
+
+        pal = (quint32 *) malloc(256 * sizeof(quint32));
+        if(pal == NULL)
+            return false;
+
+        n = 0;
+        while(!file.atEnd() && n < 256) {
+            sl = QString(file.readLine()).simplified().split(' ');
+            if(sl.count() != 4)
+                continue;
+
+            bool ok[4];
+            i = sl.at(0).toInt(&ok[0]);
+            r = sl.at(1).toInt(&ok[1]);
+            g = sl.at(2).toInt(&ok[2]);
+            b = sl.at(3).toInt(&ok[3]);
+            if(!(ok[0] && ok[1] && ok[2] && ok[3]) || i != n)
+                continue;
+
+            pal[n++] = qRgb(r, g, b);
+        }
+
+        if(n < 2) {
+            free(pal);
+            return false;
+        }
+
+        _palette = pal;
+        _palette_size = n;
+    }
+    else {
+        QImage image(filename);
+
+        if(image.isNull())
+            return false;
+
+        image = image.convertToFormat(QImage::Format_RGB32);
+        n = image.width() >= image.height() ? image.width():image.height();
+
+        _palette = (quint32 *) malloc(n * sizeof(quint32));
+        if(_palette == NULL)
+            return false;
+
+        if(image.width() >= image.height()) {
+            const QRgb *line = (const QRgb *) image.constScanLine(image.height() / 2);
+            for(i=0; i<n; i++)
+                _palette[i] = line[i];
+        }
+        else {
+            for(i=0; i<n; i++)
+                _palette[i] = image.pixel(image.width() / 2, n - i - 1);
+        }
+
+        _palette_size = n;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// calculates the whole NIR x VIS table, 1024 * 1024 entries
+bool TNDVILUT::create(TNDVI *ndvi)
+{
+    quint32 *entry, rgb;
+    quint16 g;
+    double  vi;
+    int     nir, vis;
+
+    if(ndvi == NULL)
+        return false;
+
+    if(_table == NULL) {
+        _table = (quint32 *) malloc(NDVI_LUT_SIZE * NDVI_LUT_SIZE * sizeof(quint32));
+        if(_table == NULL) {
+            qDebug("Failed to allocate NDVI LUT %s:%d", __FILE__, __LINE__);
+            return false;
+        }
+    }
+
+    _key = configKey(ndvi);
+    loadPalette(ndvi->lutFilePath());
+
+    entry = _table;
+    for(nir=0; nir<NDVI_LUT_SIZE; nir++) {
+        for(vis=0; vis<NDVI_LUT_SIZE; vis++) {
+            vi = ndvi->ndvi(nir, vis);
+
+            if(!ndvi->isValid(vi))
+                rgb = 0;
+            else if(_palette_size > 0)
+                rgb = _palette[ndvi->lutIndex(vi, _palette_size)] | 0xff000000;
+            else {
+                g = ndvi->toColor_16(vi);
+                rgb = qRgb(nir >> 2, g >> 2, vis >> 2);
+            }
+
+            *entry++ = rgb;
+        }
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+QString TNDVILUT::configKey(TNDVI *ndvi)
+{
+    QString filename = ndvi->lutFilePath();
+    QString modified;
+
+    if(!filename.isEmpty()) {
+        QFileInfo fi(filename);
+        if(fi.exists())
+            modified = fi.lastModified().toString(Qt::ISODate);
+    }
+
+    return QString("%1|%2|%3|%4")
+            .arg(filename)
+            .arg(modified)
+            .arg(ndvi->minValue(), 0, 'g', 10)
+            .arg(ndvi->maxValue(), 0, 'g', 10);
+}
+
+//---------------------------------------------------------------------------
+// returns a cached table, call release when done with it
+TNDVILUT *TNDVILUT::get(TNDVI *ndvi)
+{
+    TNDVILUTCacheItem *item;
+    TNDVILUT *lut;
+    QString key;
+    int i;
+
+    if(ndvi == NULL)
+        return NULL;
+
+    QMutexLocker locker(&lut_cache_mutex);
+
+    key = configKey(ndvi);
+
+    for(i=0; i<lut_cache.Count; i++) {
+        item = (TNDVILUTCacheItem *) lut_cache.ItemAt(i);
+        if(item->lut->key() == key) {
+            item->refs++;
+            return item->lut;
+        }
+    }
+
+    // drop unused tables, oldest first
+    for(i=0; i<lut_cache.Count && lut_cache.Count >= NDVI_LUT_CACHE_SIZE; ) {
+        item = (TNDVILUTCacheItem *) lut_cache.ItemAt(i);
+        if(item->refs <= 0) {
+            lut_cache.Delete(item);
+            delete item;
+        }
+        else
+            i++;
+    }
+
+    lut = new TNDVILUT;
+    if(!lut->create(ndvi)) {
+        delete lut;
+        return NULL;
+    }
+
+    item = new TNDVILUTCacheItem(lut);
+    item->refs = 1;
+    lut_cache.Add(item);
+
+    return lut;
+}
+
+//---------------------------------------------------------------------------
+void TNDVILUT::release(TNDVILUT *lut)
+{
+    TNDVILUTCacheItem *item;
+    int i;
+
+    if(lut == NULL)
+        return;
+
+    QMutexLocker locker(&lut_cache_mutex);
+
+    for(i=0; i<lut_cache.Count; i++) {
+        item = (TNDVILUTCacheItem *) lut_cache.ItemAt(i);
+        if(item->lut == lut) {
+            item->refs--;
+            break;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+// removes all unused tables
+void TNDVILUT::flush(void)
+{
+    TNDVILUTCacheItem *item;
+    int i;
+
+    QMutexLocker locker(&lut_cache_mutex);
+
+    for(i=0; i<lut_cache.Count; ) {
+        item = (TNDVILUTCacheItem *) lut_cache.ItemAt(i);
+        if(item->refs <= 0) {
+            lut_cache.Delete(item);
+            delete item;
+        }
+        else
+            i++;
+    }
+}
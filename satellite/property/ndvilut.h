@@ -0,0 +1,65 @@
+/*
+    POES-USRP, a software for recording and decoding POES high resolution weather satellite images.
+    Copyright (C) 2009-2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef NDVILUT_H
+#define NDVILUT_H
+
+#include <QtGlobal>
+#include <QString>
+
+//---------------------------------------------------------------------------
+#define NDVI_LUT_BITS   10
+#define NDVI_LUT_SIZE   (1 << NDVI_LUT_BITS)   // 1024 10 bit NIR or VIS values
+
+class TNDVI;
+
+//---------------------------------------------------------------------------
+// precalculated 10 bit NIR x VIS -> RGB table of a NDVI configuration
+// an entry with zero alpha means that the NDVI value is out of range
+class TNDVILUT
+{
+public:
+    TNDVILUT(void);
+    ~TNDVILUT(void);
+
+    bool    create(TNDVI *ndvi);
+    QString key(void) const { return _key; }
+    bool    hasPalette(void) const { return _palette_size > 0; }
+
+    quint32 lookup(quint16 nir, quint16 vis) const
+        { return _table[((nir & 0x03ff) << NDVI_LUT_BITS) | (vis & 0x03ff)]; }
+
+    static TNDVILUT *get(TNDVI *ndvi);
+    static void      release(TNDVILUT *lut);
+    static QString   configKey(TNDVI *ndvi);
+    static void      flush(void);
+
+protected:
+    bool loadPalette(const QString& filename);
+
+private:
+    QString  _key;
+    quint32 *_table;
+    quint32 *_palette;
+    int      _palette_size;
+};
+
+#endif // NDVILUT_H
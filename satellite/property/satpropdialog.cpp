@@ -25,6 +25,7 @@
 #include "satpropdialog.h"
 #include "ui_satpropdialog.h"
 #include "plist.h"
+#include "satcatalog.h"
 #include "Satellite.h"
 #include "satutil.h"
 #include "satprop.h"
@@ -32,7 +33,7 @@
 #include "eviconfdialog.h"
 
 //---------------------------------------------------------------------------
-SatPropDialog::SatPropDialog(PList *satList, QWidget *parent) :
+SatPropDialog::SatPropDialog(TSatCatalog *satList, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::SatPropDialog)
 {
@@ -32,7 +32,7 @@ namespace Ui {
 
 class QListWidget;
 class QComboBox;
-class PList;
+class TSatCatalog;
 class TSat;
 class TRGBConf;
 class TNDVI;
@@ -43,7 +43,7 @@ class SatPropDialog : public QDialog
     Q_OBJECT
 
 public:
-    explicit SatPropDialog(PList *satList, QWidget *parent = 0);
+    explicit SatPropDialog(TSatCatalog *satList, QWidget *parent = 0);
     ~SatPropDialog();
 
 protected:
@@ -81,7 +81,7 @@ private slots:
 private:
     Ui::SatPropDialog *ui;
 
-    PList *satlist;
+    TSatCatalog *satlist;
     TSat  *selsat;
 };
 
@@ -0,0 +1,156 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include "satcatalog.h"
+#include "Satellite.h"
+
+//---------------------------------------------------------------------------
+TSatCatalog::TSatCatalog(void) : PList()
+{
+}
+
+//---------------------------------------------------------------------------
+TSatCatalog::~TSatCatalog(void)
+{
+}
+
+//---------------------------------------------------------------------------
+int TSatCatalog::Add(void *item, int mode)
+{
+ TSat *sat = (TSat *) item;
+ int  count = Count;
+
+    if(PList::Add(item, mode) > count) {
+        if(keys.contains(sat))
+            keys[sat].listed++;
+        else
+            addKeys(sat);
+    }
+
+ return Count;
+}
+
+//---------------------------------------------------------------------------
+int TSatCatalog::Delete(void *item)
+{
+ TSat *sat = (TSat *) item;
+ int  rc = PList::Delete(item);
+
+    if(rc >= 0 && keys.contains(sat) && --keys[sat].listed <= 0)
+        removeKeys(sat);
+
+ return rc;
+}
+
+//---------------------------------------------------------------------------
+void TSatCatalog::Flush(void)
+{
+    PList::Flush();
+
+    by_name.clear();
+    by_catnum.clear();
+    keys.clear();
+}
+
+//---------------------------------------------------------------------------
+TSat *TSatCatalog::find(const QString &name) const
+{
+ QHash<QString, QList<TSat *> >::const_iterator it;
+
+    if(name.isEmpty())
+        return NULL;
+
+    it = by_name.constFind(name);
+
+ return it == by_name.constEnd() ? NULL:it.value().first();
+}
+
+//---------------------------------------------------------------------------
+TSat *TSatCatalog::findCatnum(long catnum) const
+{
+ QHash<long, QList<TSat *> >::const_iterator it = by_catnum.constFind(catnum);
+
+ return it == by_catnum.constEnd() ? NULL:it.value().first();
+}
+
+//---------------------------------------------------------------------------
+void TSatCatalog::reindex(TSat *sat)
+{
+ int listed;
+
+    if(sat == NULL || !keys.contains(sat))
+        return;
+
+    listed = keys.value(sat).listed;
+
+    removeKeys(sat);
+    addKeys(sat);
+
+    keys[sat].listed = listed;
+}
+
+//---------------------------------------------------------------------------
+// the oldest satellite owns a key, later duplicates take it over in order
+void TSatCatalog::addKeys(TSat *sat)
+{
+ TSatKeys key;
+
+    if(keys.contains(sat))
+        return;
+
+    key.name = QString(sat->name);
+    key.catnum = sat->catnum;
+    key.listed = 1;
+
+    keys.insert(sat, key);
+
+    if(!key.name.isEmpty())
+        by_name[key.name].append(sat);
+    if(key.catnum > 0)
+        by_catnum[key.catnum].append(sat);
+}
+
+//---------------------------------------------------------------------------
+void TSatCatalog::removeKeys(TSat *sat)
+{
+ QHash<QString, QList<TSat *> >::iterator n;
+ QHash<long, QList<TSat *> >::iterator c;
+ TSatKeys key;
+
+    if(!keys.contains(sat))
+        return;
+
+    key = keys.take(sat);
+
+    n = by_name.find(key.name);
+    if(n != by_name.end()) {
+        n.value().removeOne(sat);
+        if(n.value().isEmpty())
+            by_name.erase(n);
+    }
+
+    c = by_catnum.find(key.catnum);
+    if(c != by_catnum.end()) {
+        c.value().removeOne(sat);
+        if(c.value().isEmpty())
+            by_catnum.erase(c);
+    }
+}
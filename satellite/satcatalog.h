@@ -0,0 +1,73 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef SATCATALOG_H
+#define SATCATALOG_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include "plist.h"
+
+class TSat;
+
+//---------------------------------------------------------------------------
+// Satellite list indexed by name and NORAD catalog number.
+// Items are owned TSat pointers which stay valid while they are listed,
+// iteration order is the insertion order as with PList.
+// If the name or catnum of a listed satellite changes, call reindex().
+// A key has the satellites with it in insertion order, the first owns it,
+// so a delete only touches the satellites with the same keys.
+class TSatCatalog : public PList
+{
+public:
+    TSatCatalog(void);
+    ~TSatCatalog(void);
+
+    using PList::Delete;
+
+    int  Add(void *item, int mode=0);
+    int  Delete(void *item);
+    void Flush(void);
+
+    TSat *find(const QString &name) const;
+    TSat *findCatnum(long catnum) const;
+
+    void reindex(TSat *sat);
+
+protected:
+    void addKeys(TSat *sat);
+    void removeKeys(TSat *sat);
+
+private:
+    typedef struct {
+        QString name;       // the keys a satellite is indexed with
+        long    catnum;
+        int     listed;     // times the pointer is in the list
+    } TSatKeys;
+
+    QHash<QString, QList<TSat *> > by_name;
+    QHash<long, QList<TSat *> >    by_catnum;
+    QHash<TSat *, TSatKeys>        keys;
+};
+
+#endif // SATCATALOG_H
@@ -26,9 +26,11 @@
 #include "Satellite.h"
 #include "satutil.h"
 #include "plist.h"
+#include "satcatalog.h"
+#include "tleloader.h"
 
 //---------------------------------------------------------------------------
-int ReadTLE(FILE *fp, PList *list)
+int ReadTLE(FILE *fp, TSatCatalog *list)
 {
  TSat *tmpsat, *sat;
  char *name, *line1, *line2;
@@ -64,8 +66,11 @@ int ReadTLE(FILE *fp, PList *list)
 
      sat = getSat(list, tmpsat->name);
      if(sat) {
-         if(tmpsat->GetKeplerIssuedDateTime() > sat->GetKeplerIssuedDateTime())
+         if(TTLELoader::epochKey(tmpsat->year, tmpsat->refepoch) >
+            TTLELoader::epochKey(sat->year, sat->refepoch)) {
            sat->TLEKepCheck(tmpsat->name, tmpsat->line1, tmpsat->line2);
+           list->reindex(sat);
+         }
      }
      else
         list->Add(new TSat(tmpsat));
@@ -82,36 +87,72 @@ int ReadTLE(FILE *fp, PList *list)
 }
 
 //---------------------------------------------------------------------------
-TSat *getSat(PList *list, const QString &name)
+// returns the number of element sets in the file or -1 if it can't be read
+int ReadTLEFile(const QString &filename, TSatCatalog *list)
 {
- TSat *sat, *rc = NULL;
- int i;
+ TTLELoader loader;
+ TSat *sat;
+ char name[TLE_NAMELEN+1];
+ int  i, count;
 
- if(list == NULL || name.isEmpty())
-     return NULL;
+  if(list == NULL)
+      return 0;
+
+  count = loader.load(filename);
+  if(count <= 0)
+      return count;
+
+  const QVector<TTLERecord> &recs = loader.records();
 
- for(i=0; i<list->Count && rc == NULL; i++) {
-    sat = (TSat *) list->ItemAt(i);
-    if(sat->name == name)
-        rc = sat;
- }
+  for(i=0; i<count; i++) {
+     const TTLERecord &rec = recs.at(i);
 
- return rc;
+     strcpy(name, rec.name); // FixName() modifies the name
+
+     sat = list->find(rec.name);
+     if(sat) {
+        if(rec.epoch > TTLELoader::epochKey(sat->year, sat->refepoch)) {
+           sat->TLEKepCheck(name, (char *) rec.line1, (char *) rec.line2);
+           list->reindex(sat);
+        }
+
+        continue;
+     }
+
+     sat = new TSat;
+     if(sat->TLEKepCheck(name, (char *) rec.line1, (char *) rec.line2))
+        list->Add(sat);
+     else
+        delete sat;
+  }
+
+ return count;
+}
+
+//---------------------------------------------------------------------------
+TSat *getSat(TSatCatalog *list, const QString &name)
+{
+ if(list == NULL)
+     return NULL;
+
+ return list->find(name);
 }
 
 //---------------------------------------------------------------------------
 // flags&1 = delete list
+// one Flush() instead of a Delete() per satellite, it also clears the
+// indexes of a TSatCatalog
 void clearSatList(PList *list, int flags)
 {
- TSat *sat;
+ int i;
 
   if(list == NULL)
       return;
 
-  while((sat = (TSat *)list->Last())) {
-      list->Delete(sat);
-      delete sat;
-  }
+  for(i=0; i<list->Count; i++)
+      delete (TSat *) list->ItemAt(i);
+
+  list->Flush();
 
   if(flags&1) {
       delete list;
@@ -26,9 +26,11 @@
 
 class QString;
 class PList;
+class TSatCatalog;
 
-int  ReadTLE(FILE *fp, PList *list);
-TSat *getSat(PList *list, const QString &name);
+int  ReadTLE(FILE *fp, TSatCatalog *list);
+int  ReadTLEFile(const QString &filename, TSatCatalog *list);
+TSat *getSat(TSatCatalog *list, const QString &name);
 
 void clearSatList(PList *list, int flags=0);
 
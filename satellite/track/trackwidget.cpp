@@ -29,6 +29,7 @@
 #include "Satellite.h"
 #include "settings.h"
 #include "plist.h"
+#include "satcatalog.h"
 
 //---------------------------------------------------------------------------
 TrackWidget::TrackWidget(QWidget *parent) :
@@ -177,6 +178,23 @@ void TrackWidget::startThread(void)
            thread->start(QThread::IdlePriority);
 }
 
+//---------------------------------------------------------------------------
+// -rotorsim, the next pass without the dock, the application quits at LOS
+bool TrackWidget::startSimulation(void)
+{
+    stopThread();
+
+    m_ui->satcomboBox->setCurrentIndex(0);
+
+    if(!getNextSatellite())
+        return false;
+
+    connect(thread, SIGNAL(finished()), qApp, SLOT(quit()));
+    thread->start();
+
+    return true;
+}
+
 //---------------------------------------------------------------------------
 void TrackWidget::stopThread(void)
 {
@@ -206,7 +224,8 @@ void TrackWidget::on_satcomboBox_currentIndexChanged(int index)
 void TrackWidget::updateSatCb(void)
 {
  QString str;
- PList *list, *list2;
+ TSatCatalog *list;
+ PList *list2;
  TSat  *sat;
  int   i, index;
 
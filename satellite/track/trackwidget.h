@@ -50,6 +50,7 @@ public:
 
     void updateSatCb(void);
     void restartThread(void);
+    bool startSimulation(void);
 
 
 protected:
@@ -21,8 +21,8 @@
 //---------------------------------------------------------------------------
 #include <QLabel>
 #include <QWidget>
-#include <QProcess>
 #include <QDateTime>
+#include <QSettings>
 #include <math.h>
 #include <stdio.h>
 
@@ -32,6 +32,12 @@
 #include "mainwindow.h"
 #include "Satellite.h"
 #include "rig.h"
+#include "rotorexecutor.h"
+#include "rotorplanner.h"
+#include "rotorsim.h"
+#include "tickscheduler.h"
+#include "jobmanager.h"
+#include "passdecoder.h"
 
 //#define _DEBUG_FP_ /* todo: remove this when not debugging */
 const int  TRACKER_SPEED = 500; // milliseconds
@@ -42,13 +48,17 @@ TrackThread::TrackThread(QObject *parent) : QThread(parent)
     tw  = (TrackWidget *) parent;
     mw  = (MainWindow *) tw->parent();
     rig = mw->getRig();
+    rotor = new TRotorExecutor(rig->rotor);
+    planner = new TRotorPlanner;
+    ticker = new TTickScheduler(1000.0 / TRACKER_SPEED);
 
     sat = NULL;
     debug_fp = NULL;
 
-    rx_proc      = new QProcess(this);
-    post_rx_proc = new QProcess(this);
-    proc_que     = new QStringList;
+    // rx and post rx scripts are run by the job manager of the gui thread
+    jobs   = mw->getJobManager();
+    rx_job = 0;
+    mount_flags = 0;
 
     satLabel = tw->getSatLabel();
     connect(this, SIGNAL(setSatLabelColor(const QString &)),
@@ -80,12 +90,9 @@ TrackThread::TrackThread(QObject *parent) : QThread(parent)
 //---------------------------------------------------------------------------
 TrackThread::~TrackThread()
 {
-    stopProcess(rx_proc);
-    stopProcess(post_rx_proc);
-
-    delete rx_proc;
-    delete post_rx_proc;
-    delete proc_que;
+    delete rotor;
+    delete planner;
+    delete ticker;
 
     if(debug_fp)
         fclose(debug_fp);
@@ -106,7 +113,7 @@ void TrackThread::run()
     int          sat_state; // 0 = init, 1 = tracking, 2 = LOS, 3 = idle, 4 = reinit
     int          rotor_state;
     unsigned int rig_modes, loop_index;
-    double       r_az, r_el;
+    double       r_az, r_el, x, y;
 
     /*
 
@@ -129,6 +136,7 @@ void TrackThread::run()
                                 &128 = recording is inited and enabled
                                 &256 = rx script executed
                                 &512 = rx script inited
+                               &1024 = rotor follows the planned trajectory
 
      */
 
@@ -136,17 +144,16 @@ void TrackThread::run()
     QDateTime  now, r_init_dt;
     QString    cl_down = "color:rgb(0, 170, 255);";
     QString    cl_up   = "color:yellow;";
-    QString    cl_style, proc_cmd, dt_str;
+    QString    cl_style, proc_cmd, dt_str, stats_str;
     bool       script_error;
     // long       l1, l2;
-    double     v1, v2, post_proc_start_time;
+    double     v1, v2;
     int        trackIndex;
 
     flags = 0;
     sat_state = 0;
     rotor_state = 0;
     loop_index = 0;
-    post_proc_start_time = 0;
 
     // init rig & rotor static modes
     rig_modes = 0;
@@ -156,6 +163,18 @@ void TrackThread::run()
     rig_modes |= rig->autorecord() ? 4:0;
     rig_modes |= rig->passthresholds() ? 8:0;
 
+    // all rotor i/o is done in the executor thread from now on,
+    // the tracking loop only posts the latest wanted position
+    if(rig_modes & 1)
+        rotor->start();
+
+    TRotorReplay::clear(&sim_res);
+
+    if(TTickScheduler::isSimulated() && !(rig_modes & 1)) {
+        qDebug("Rotor simulation: the emulated rotor could not be opened");
+        flags |= TF_STOP;
+    }
+
 #ifdef _DEBUG_FP_
 
     if(debug_fp)
@@ -177,11 +196,16 @@ void TrackThread::run()
     if(sat && debug_fp)
         fprintf(debug_fp,"%s max elevation:%.2f\n\n", sat->name, sat->sat_max_ele);
 
+    // fixed rate on monotonic deadlines, a slow loop does not shift the next ones
+    ticker->start();
+
     while(!(flags & TF_STOP)) {
 
+        ticker->tick();
+
         now = QDateTime::currentDateTime();                
         dt_str = now.toString("dddd, d MMMM yyyy, hh:mm:ss");
-        emit(setTimeLabelText(dt_str));
+        emit(setTimeLabelText(dt_str + stats_str));
 
         if(!sat) {
             if(!(sat = tw->getNextSatellite())) {
@@ -191,22 +215,8 @@ void TrackThread::run()
             }
         }
 
-        sat->Track();
-
-        // check every now and then if the post rx process can be stopped and deque
-        if((loop_index % 20) == 0 && procRunning(post_rx_proc)) {
-            v1 = (sat->daynum - post_proc_start_time) * 1440;
-            if(v1 > 20) // it has been running over 20 mins, stop it!
-                stopProcess(post_rx_proc);
-
-            if(proc_que->count() && !procRunning(post_rx_proc)) {
-                proc_cmd = proc_que->first();
-                proc_que->removeFirst();
-
-                post_rx_proc->start(proc_cmd);
-                post_proc_start_time = sat->daynum;
-            }
-        }
+        sat->daynum = ticker->daynum();
+        sat->Calc();
 
         if(rig_modes & 1) {
             // tracking the sun or moon
@@ -247,7 +257,7 @@ void TrackThread::run()
                         v2 = (v1 - sat->daynum) * 1440;
                         if(v2 > 15) {
                             if(!(rig_modes & 64)) {
-                                rig->rotor->park();
+                                rotor->park();
                                 rig_modes |= 64;
                             }
                         }
@@ -280,7 +290,7 @@ void TrackThread::run()
 
                     // power off motors ?
                     if(v2 > 1 && now.secsTo(r_init_dt) <= -60) {
-                        rig->rotor->stopMotor();
+                        rotor->stopMotor();
                         rotor_state = 0;
                     }
                 }
@@ -295,9 +305,21 @@ void TrackThread::run()
                 r_az = sat->sat_azi;
                 r_el = sat->sat_ele;
 
-                // swing the antenna
-                if(rig_modes & 1) {
-                    if(rig->rotor->isZenithPass()) {
+                // swing the antenna, the executor streams the planned pass
+                if((rig_modes & 1) && planner->isValid()) {
+                    if(!(rig_modes & 1024) && rotor->followTrajectory(planner))
+                        rig_modes |= 1024;
+
+                    // -rotorsim, where the emulated antenna really points to
+                    if(TTickScheduler::isSimulated() && (rig_modes & 1024)) {
+                        rig->rotor->sim->getAntenna(&x, &y);
+                        TRotorReplay::add(&sim_res,
+                                          TRotorReplay::error(rig->rotor, x, y, sat->sat_azi, sat->sat_ele),
+                                          1.0 / ticker->getRate());
+                    }
+                }
+                else if(rig_modes & 1) {
+                    if(mount_flags & R_ROTOR_ZENITH_PASS) {
                         // turn elevation >90 degrees on zenith pass
                         if(v1 >= 0.0) { // receding
                             r_el = 180.0 - sat->sat_ele;
@@ -317,10 +339,10 @@ void TrackThread::run()
                 // start the rx script
                 if((rig_modes & 128) && !(rig_modes & 512) && sat->CanStartRecording(rig)) {
 
-                    stopProcess(rx_proc); // kill it if it is alive!
+                    jobs->cancel(rx_job); // kill it if it is alive!
                     proc_cmd = sat->sat_scripts->get_rx_command(sat->name, sat->getDownlinkFreq(rig), &script_error);
                     if(!script_error) {
-                        rx_proc->start(proc_cmd);
+                        rx_job = jobs->submit(QString(sat->name) + " rx", proc_cmd, JP_REALTIME, 0, 0);
                         sat->SavePassinfo();
                         rig_modes |= 256;
                     }
@@ -346,7 +368,7 @@ void TrackThread::run()
 
                     v2 = 0;
                     if(rig_modes & 1)
-                        v2 = (rig->rotor->isCCW() || rig->rotor->isZenithPass()) ? (180.0 - rig->rotor->el_max):rig->rotor->el_min;
+                        v2 = (mount_flags & (R_ROTOR_CCW | R_ROTOR_ZENITH_PASS)) ? (180.0 - rig->rotor->el_max):rig->rotor->el_min;
 
                     if(sat->sat_ele <= v2)
                         sat_state = 2;
@@ -357,25 +379,47 @@ void TrackThread::run()
 
         case 2: // satellite receded below LOS, post RX process and start to deinitialize
             {
-                rig->rotor->stopMotor();
+                rotor->stopMotor();
+
+                if(rig_modes & 1024) {
+                    qDebug("Rotor trajectory: %s", rotor->streamStatsString().toStdString().c_str());
+                    qDebug("Rotor pointing: %s", rotor->pointingStatsString().toStdString().c_str());
+
+                    // pointing errors of the pass next to the recording
+                    if(rig_modes & 256) {
+                        QString inifile = sat->PassinfoFile();
+                        if(!inifile.isEmpty()) {
+                            QSettings reg(inifile, QSettings::IniFormat);
+                            rotor->writePointingStats(&reg);
+                        }
+                    }
+                }
+                qDebug("Tracker: %s", TTickScheduler::statsString(ticker->getStats(), ticker->getRate()).toStdString().c_str());
+
+                // one pass is flown, the application quits when the thread has finished
+                if(TTickScheduler::isSimulated()) {
+                    TRotorReplay::finish(&sim_res);
+                    qDebug("Rotor simulation: antenna %s", TRotorReplay::resultString(&sim_res).toStdString().c_str());
+
+                    flags |= TF_STOP;
+                }
 
                 if(rig_modes & 256) {
-                    stopProcess(rx_proc); // dont check its pid, user might have killed it...
+                    // asynchronous, the rx job is killed in the thread of the job manager
+                    jobs->cancel(rx_job); // user might have killed it already
 
-                    if(sat->sat_scripts->postproc_srcrip_enable()) {
+                    // the frames are decoded in process when the rx job has exited
+                    if(sat->sat_scripts->decode_enable())
+                        mw->getPassDecoder()->add(sat, rx_job);
+                    else if(sat->sat_scripts->postproc_srcrip_enable()) {
                         proc_cmd = sat->sat_scripts->get_postproc_command(&script_error);
 
-                        if(!script_error) {
-                            if(!procRunning(post_rx_proc)) {
-                                post_rx_proc->start(proc_cmd);
-                                post_proc_start_time = sat->daynum;
-                            }
-                            else {
-                                qDebug("Queuing: %s", sat->GetImageText(256).toStdString().c_str());
-
-                                proc_que->append(proc_cmd);
-                            }
-                        }
+                        // started when the rx job has exited and has closed the frames,
+                        // queued behind the other passes when the pool is full,
+                        // killed when it runs over JM_DEFAULT_TIMEOUT
+                        if(!script_error)
+                            jobs->submit(QString(sat->name) + " post rx", proc_cmd, JP_POSTPROC,
+                                         JM_DEFAULT_TIMEOUT, 1, rx_job);
                         else {
                             // make sure it wont be tested again until user corrects errors
                             sat->sat_scripts->rx_srcrip_enable(false);
@@ -417,7 +461,7 @@ void TrackThread::run()
                 v1 = 0;
 
                 if(rig_modes & 1)
-                    v1 = (rig->rotor->isCCW() || rig->rotor->isZenithPass()) ? (180.0 - rig->rotor->el_max):rig->rotor->el_min;
+                    v1 = (mount_flags & (R_ROTOR_CCW | R_ROTOR_ZENITH_PASS)) ? (180.0 - rig->rotor->el_max):rig->rotor->el_min;
 
                 sat_state = sat->sat_ele > v1 ? 3:4;
             }
@@ -459,7 +503,7 @@ void TrackThread::run()
         cl_style = sat->sat_ele > 0 ? cl_up:cl_down;
         if(satLabel->styleSheet() != cl_style)
             emit(setSatLabelColor(cl_style));
-        emit(setSatLabelText(sat->GetTrackStr(rig, rx_proc->pid() ? 1:0)));
+        emit(setSatLabelText(sat->GetTrackStr(rig, jobs->isRunning(rx_job) ? 1:0)));
 
 
         // update sun- and moon position every 10 sec
@@ -477,17 +521,40 @@ void TrackThread::run()
             if(moonLabel->styleSheet() != cl_style)
                 emit(setMoonLabelColor(cl_style));
             emit(setMoonLabelText(sat->GetMoonPos()));
+
+            // timing of the rotor setpoints while following a pass
+            if(rig_modes & 1024) {
+                TTickStats ts = rotor->streamStats();
+                TPointingStats ps = rotor->pointingStats();
+
+                stats_str.sprintf("   [rotor %.1f Hz, jitter %.1f/%.1f ms, %u overruns",
+                                  rig->rotor->track_rate,
+                                  ts.ticks ? (ts.late_sum / 1000.0 / ts.ticks):0.0,
+                                  ts.late_max / 1000.0, ts.overruns);
+
+                if(ps.samples > 0)
+                    stats_str += QString().sprintf(", error %.1f/%.1f deg", ps.sum / ps.samples, ps.max_error);
+
+                stats_str += "]";
+            }
+            else
+                stats_str = "";
         }
 
         loop_index++;
-        msleep(TRACKER_SPEED);
+
+        ticker->done();
+        usleep((unsigned long) ticker->remaining());
     }
 
     flags |= TF_STOP;
 
     // stop the rx script so it wont fill the disk
     // let the post rx script run
-    stopProcess(rx_proc);
+    jobs->cancel(rx_job);
+
+    rotor->stop();
+    rotor->wait();
 
     if(debug_fp)
         fclose(debug_fp);
@@ -497,45 +564,26 @@ void TrackThread::run()
   exit();
 }
 
-//---------------------------------------------------------------------------
-void TrackThread::stopProcess(QProcess *proc)
-{
-    if(proc->pid()) {
-        proc->kill();
-        proc->waitForFinished();
-
-        QDateTime now(QDateTime::currentDateTime());
-
-        qDebug("Process stopped @ %s, %s:%d",
-               now.toString().toStdString().c_str(),
-               __FILE__, __LINE__);
-    }
-}
-
-//---------------------------------------------------------------------------
-// notice: it can also be in error state
-bool TrackThread::procRunning(QProcess *proc)
-{
-    return proc->pid() ? true:false;
-}
-
 //---------------------------------------------------------------------------
 void TrackThread::initRotor(TRig *rig, TSat *sat)
 {
     double aos_az, los_az, aos_el, sat_az, sat_el;
-    double el, v;
+    double aos, los, el, v;
 
     qDebug("init rotor: %s", sat->name);
 
-    rig->rotor->flags &= ~(R_ROTOR_CCW | R_ROTOR_ZENITH_PASS);
+    planner->clear();
+
+    // the executor applies the flags before the moves posted after them
+    mount_flags = 0;
+    rotor->setMountFlags(mount_flags);
 
     // current satellite position
     sat_az = sat->sat_azi;
     sat_el = sat->sat_ele;
 
     // TODO: rotor status should be checked here, is the connection still valid, USB disconnected, etc?
-    if(rig->rotor->rotor_type == RotorType_JRK)
-       rig->rotor->jrk->check_and_reinit();
+    rotor->reinit();
 
     int i = tw->trackIndex();
 
@@ -551,15 +599,16 @@ void TrackThread::initRotor(TRig *rig, TSat *sat)
             sat_el = sat->moon_ele;
         }
 
-        rig->rotor->moveTo(sat_az, sat_el);
+        rotor->moveTo(sat_az, sat_el);
         return;
     }
 
 
-    rig->rotor->readPosition();
+    rotor->readPosition();
 
     // AOS satellite position
-    sat->daynum = rig->passthresholds() ? sat->rec_aostime:sat->aostime;
+    aos = rig->passthresholds() ? sat->rec_aostime:sat->aostime;
+    sat->daynum = aos;
     sat->Calc();
     aos_az = sat->sat_azi;
     aos_el = sat->sat_ele;
@@ -568,7 +617,8 @@ void TrackThread::initRotor(TRig *rig, TSat *sat)
     sat_aos_azi = aos_az;
 
     // LOS satellite position
-    sat->daynum = rig->passthresholds() ? sat->rec_lostime:sat->lostime;
+    los = rig->passthresholds() ? sat->rec_lostime:sat->lostime;
+    sat->daynum = los;
     sat->Calc();
     los_az = sat->sat_azi;
 
@@ -578,14 +628,19 @@ void TrackThread::initRotor(TRig *rig, TSat *sat)
             return; // wait for next pass, it will happen soon
     }
 
-    rig->rotor->setCCWFlag(aos_az, los_az, sat->sat_max_ele);
+    // choose the mount mode from the whole pass, the old rule is the fallback
+    if(planner->plan(sat, rig->rotor, aos, los))
+        mount_flags = planner->getRotorFlags();
+    else
+        mount_flags = rig->rotor->mountFlags(aos_az, los_az, sat->sat_max_ele);
+
+    rotor->setMountFlags(mount_flags);
 
     // try to prevent Jrk from latching error: Maximum current exceeded, when moving a long distance
-    if(rig->rotor->rotor_type == RotorType_JRK)
-        rig->rotor->jrk->start();
+    rotor->startMotor();
 
     // calculate AOS satellite position at rotor limit
-    el = rig->rotor->isCCW() ? (180.0 - rig->rotor->el_max):rig->rotor->el_min;
+    el = (mount_flags & R_ROTOR_CCW) ? (180.0 - rig->rotor->el_max):rig->rotor->el_min;
 
     if(sat_el < el) {
         if(sat->FindAOSElevation(el)) {
@@ -596,7 +651,7 @@ void TrackThread::initRotor(TRig *rig, TSat *sat)
 
     qDebug("init rotor: move to Az: %.3f El: %.03f", sat_az, sat_el);
 
-    rig->rotor->moveTo(sat_az, sat_el);
+    rotor->moveTo(sat_az, sat_el);
 
     sat->Track();
 }
@@ -605,7 +660,7 @@ void TrackThread::initRotor(TRig *rig, TSat *sat)
 void TrackThread::moveTo(double az, double el)
 {
 #if 1 // todo: enable this when not debugging
-    if(!rig->rotor->moveTo(az, el))
+    if(!rotor->moveTo(az, el))
         return;
 #endif
 
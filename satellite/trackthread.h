@@ -25,17 +25,21 @@
 #include <QThread>
 #include <QDateTimeEdit>
 #include <stdio.h>
+
+#include "rotorreplay.h"
 //---------------------------------------------------------------------------
 #define     TF_STOP     1
 
 class QLabel;
-class QProcess;
 class QDateTime;
-class QStringList;
 class MainWindow;
 class TSat;
 class TRig;
 class TrackWidget;
+class TRotorExecutor;
+class TRotorPlanner;
+class TTickScheduler;
+class TJobManager;
 
 //---------------------------------------------------------------------------
 class TrackThread : public QThread
@@ -59,9 +63,6 @@ signals:
     void setMoonLabelText(const QString &cl);
 
 protected:
-    void stopProcess(QProcess *proc);
-    bool procRunning(QProcess *proc);
-
     void initRotor(TRig *rig, TSat *sat);
     void moveTo(double az, double el);
 
@@ -70,8 +71,13 @@ private:
     MainWindow  *mw;
     TRig        *rig;
     TSat        *sat;
-    QProcess    *rx_proc, *post_rx_proc;
-    QStringList *proc_que;
+    TRotorExecutor *rotor;
+    TRotorPlanner  *planner;
+    TTickScheduler *ticker;
+    TJobManager *jobs;
+    int         rx_job;
+    int         mount_flags;    // tracker copy, the executor owns rig->rotor->flags
+    TReplayResult sim_res;      // -rotorsim, the emulated antenna against the satellite
 
     QLabel *satLabel, *timeLabel, *sunLabel, *moonLabel;
 
@@ -0,0 +1,698 @@
+/*
+    HRPT-Decoder, a software for processing POES high resolution weather satellite imagery.
+    Copyright (C) 2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+
+
+//---------------------------------------------------------------------------
+#include <QFileInfo>
+#include <QDir>
+#include <QRunnable>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "cadusplitter.h"
+#include "cadu.h"
+
+//---------------------------------------------------------------------------
+TCADUWriter::TCADUWriter(const QString& filename_)
+{
+    _filename = filename_;
+
+    fp = NULL;
+    buf = NULL;
+
+    file_len = bytes_written = 0;
+}
+
+//---------------------------------------------------------------------------
+TCADUWriter::~TCADUWriter(void)
+{
+    close();
+}
+
+//---------------------------------------------------------------------------
+bool TCADUWriter::open(void)
+{
+    close();
+
+    fp = fopen(_filename.toStdString().c_str(), "wb");
+    if(fp == NULL) {
+        qDebug("Error: Failed to create file %s", _filename.toStdString().c_str());
+        return false;
+    }
+
+    // large buffer, we are writing small packets to many files in parallel
+    buf = (char *) malloc(CS_WRITE_BUF_SIZE);
+    if(buf)
+        setvbuf(fp, buf, _IOFBF, CS_WRITE_BUF_SIZE);
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void TCADUWriter::close(void)
+{
+    if(fp)
+        fclose(fp);
+
+    if(buf)
+        free(buf);
+
+    fp = NULL;
+    buf = NULL;
+}
+
+//---------------------------------------------------------------------------
+bool TCADUWriter::write(const void *data, size_t size)
+{
+    if(fp == NULL)
+        return false;
+
+    return fwrite(data, 1, size, fp) == size;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TCADUBatch::TCADUBatch(void)
+{
+    data = NULL;
+    address = NULL;
+    rs_errors = NULL;
+    payload_size = 0;
+    count = size = 0;
+}
+
+//---------------------------------------------------------------------------
+TCADUBatch::~TCADUBatch(void)
+{
+    if(data)
+        free(data);
+    if(address)
+        free(address);
+    if(rs_errors)
+        free(rs_errors);
+}
+
+//---------------------------------------------------------------------------
+bool TCADUBatch::alloc(int size_, size_t payload_size_)
+{
+    size = size_;
+    payload_size = payload_size_;
+    count = 0;
+
+    data = (unsigned char *) malloc(size * payload_size);
+    address = (qint64 *) malloc(size * sizeof(qint64));
+    rs_errors = (int *) malloc(size * sizeof(int));
+
+    return data != NULL && address != NULL && rs_errors != NULL;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+// derandomizes and RS decodes packets [first, last) of a batch
+class TCADUDecodeJob : public QRunnable
+{
+public:
+    TCADUDecodeJob(TCADU *cadu_, TCADUBatch *batch_, int first_, int last_)
+    {
+        cadu = cadu_;
+        batch = batch_;
+        first = first_;
+        last = last_;
+    }
+
+    void run()
+    {
+        for(int i=first; i<last; i++)
+            cadu->decode_buffer(batch->packet(i), &batch->rs_errors[i]);
+    }
+
+private:
+    TCADU      *cadu;
+    TCADUBatch *batch;
+    int        first, last;
+};
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TCADUSplitter::TCADUSplitter(QObject *parent) :
+    QThread(parent)
+{
+    cadu = new TCADU;
+    logfile = NULL;
+    fp = NULL;
+    rbuf = NULL;
+    flags = 0;
+    cancelled = 0;
+
+    for(int i=0; i<CS_NUM_VCIDS; i++)
+        writers[i] = NULL;
+
+    cadus = fill_cadus = rs_failed = rs_corrected = 0;
+    sync_errors = lrit_images = files_written = 0;
+}
+
+//---------------------------------------------------------------------------
+TCADUSplitter::~TCADUSplitter(void)
+{
+    cancel();
+    wait();
+
+    closeAll();
+
+    delete cadu;
+}
+
+//---------------------------------------------------------------------------
+void TCADUSplitter::setDecoding(bool derandomize, bool rs_decode)
+{
+    cadu->derandomize(derandomize);
+    cadu->reed_solomon(rs_decode);
+}
+
+//---------------------------------------------------------------------------
+void TCADUSplitter::addRoute(int vcid, const QString& filename)
+{
+    if(vcid < 0 || vcid >= CS_NUM_VCIDS)
+        return;
+
+    routes[vcid] = filename;
+}
+
+//---------------------------------------------------------------------------
+void TCADUSplitter::setLRITOutput(const QString& path, const QString& logfile_)
+{
+    lrit_path = path;
+
+    if(logfile)
+        delete logfile;
+    logfile = logfile_.isEmpty() ? NULL:new TCADUWriter(logfile_);
+}
+
+//---------------------------------------------------------------------------
+bool TCADUSplitter::openInput(void)
+{
+    fp = fopen(infile.toStdString().c_str(), "rb");
+    if(fp == NULL) {
+        qDebug("Error: Failed to open file %s", infile.toStdString().c_str());
+        return false;
+    }
+
+    // ftell is 32 bit on some platforms
+    filesize = QFileInfo(infile).size();
+
+    rbuf = (unsigned char *) malloc(CS_READ_SIZE);
+    rpos = rlen = 0;
+    rbase = 0;
+
+    return rbuf != NULL;
+}
+
+//---------------------------------------------------------------------------
+void TCADUSplitter::closeAll(void)
+{
+    for(int i=0; i<CS_NUM_VCIDS; i++) {
+        if(writers[i])
+            delete writers[i];
+        writers[i] = NULL;
+    }
+
+    if(logfile)
+        logfile->close();
+
+    if(fp)
+        fclose(fp);
+    fp = NULL;
+
+    if(rbuf)
+        free(rbuf);
+    rbuf = NULL;
+}
+
+//---------------------------------------------------------------------------
+// makes sure there are at least bytes unread bytes in the read buffer
+bool TCADUSplitter::fill(size_t bytes)
+{
+    size_t len;
+
+    if(rlen - rpos >= bytes)
+        return true;
+
+    len = rlen - rpos;
+    if(len > 0)
+        memmove(rbuf, rbuf + rpos, len);
+
+    rbase += rpos;
+    rpos = 0;
+    rlen = len + fread(rbuf + len, 1, CS_READ_SIZE - len, fp);
+
+    return rlen >= bytes;
+}
+
+//---------------------------------------------------------------------------
+// reads the next CADU, the sync is normally found where the previous
+// packet ended, search byte by byte only after a slip
+bool TCADUSplitter::readCADU(unsigned char *payload, qint64 *address)
+{
+    const size_t cadu_size = CADU_SYNC_SIZE + CADU_PACKET_SIZE;
+    unsigned char *p, *end;
+    bool slipped = false;
+
+    while(fill(cadu_size)) {
+        p = rbuf + rpos;
+        if(memcmp(p, CADU_SYNC, CADU_SYNC_SIZE) == 0) {
+            if(slipped)
+                sync_errors++;
+
+            memcpy(payload, p + CADU_SYNC_SIZE, CADU_PACKET_SIZE);
+            *address = rbase + rpos + CADU_SYNC_SIZE;
+            rpos += cadu_size;
+
+            return true;
+        }
+
+        slipped = true;
+
+        // search the next candidate in the buffered data
+        end = rbuf + rlen - CADU_SYNC_SIZE + 1;
+        p = (unsigned char *) memchr(p + 1, CADU_SYNC[0], end - p - 1);
+        if(p == NULL)
+            rpos = rlen - CADU_SYNC_SIZE + 1;
+        else
+            rpos = p - rbuf;
+    }
+
+    return false;
+}
+
+//---------------------------------------------------------------------------
+int TCADUSplitter::readBatch(TCADUBatch *batch)
+{
+    batch->count = 0;
+
+    while(batch->count < batch->size && !cancelled) {
+        if(!readCADU(batch->packet(batch->count), &batch->address[batch->count]))
+            break;
+
+        batch->count++;
+    }
+
+    return batch->count;
+}
+
+//---------------------------------------------------------------------------
+// splits the batch to one job per pool thread, does not wait
+void TCADUSplitter::decodeBatch(TCADUBatch *batch)
+{
+    int i, jobs, slice;
+
+    if(!cadu->derandomize() && !cadu->reed_solomon()) {
+        memset(batch->rs_errors, 0, batch->count * sizeof(int));
+        return;
+    }
+
+    jobs = pool.maxThreadCount();
+    if(jobs < 1)
+        jobs = 1;
+
+    slice = (batch->count + jobs - 1) / jobs;
+
+    for(i=0; i<batch->count; i+=slice)
+        pool.start(new TCADUDecodeJob(cadu, batch, i, qMin(i + slice, batch->count)));
+}
+
+//---------------------------------------------------------------------------
+// routes the decoded packets in file order
+void TCADUSplitter::routeBatch(TCADUBatch *batch)
+{
+    unsigned char *vcdu;
+    quint8 vcid;
+
+    for(int i=0; i<batch->count; i++) {
+        cadus++;
+
+        if(batch->rs_errors[i] < 0) {
+            rs_failed++;
+            continue;
+        }
+
+        rs_corrected += batch->rs_errors[i];
+
+        vcdu = batch->packet(i);
+        vcid = vcdu[1] & 0x3f;
+        if(vcid == CS_FILL_VCID) {
+            fill_cadus++;
+            continue;
+        }
+
+        if(flags & CS_LRIT)
+            routeLRIT(vcid, vcdu, batch->address[i]);
+        else
+            routeVCDU(vcid, vcdu);
+    }
+}
+
+//---------------------------------------------------------------------------
+void TCADUSplitter::run()
+{
+    TCADUBatch batches[2];
+    qint64 percent, last_percent = -1;
+    int cur = 0;
+
+    cancelled = 0;
+    cadus = fill_cadus = rs_failed = rs_corrected = 0;
+    sync_errors = lrit_images = files_written = 0;
+
+    if(!openInput() || filesize <= 0 ||
+       !cadu->init_buffers(CADU_PACKET_SIZE) ||
+       !batches[0].alloc(CS_BATCH_SIZE, CADU_PACKET_SIZE) ||
+       !batches[1].alloc(CS_BATCH_SIZE, CADU_PACKET_SIZE))
+    {
+        closeAll();
+        return;
+    }
+
+    if(logfile)
+        logfile->open();
+
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+
+    readBatch(&batches[cur]);
+
+    while(batches[cur].count > 0 && !cancelled) {
+        decodeBatch(&batches[cur]);
+
+        // read the next batch while the pool decodes this one
+        readBatch(&batches[cur ^ 1]);
+
+        pool.waitForDone();
+        routeBatch(&batches[cur]);
+
+        percent = (rbase + rpos) * 100 / filesize;
+        if(percent != last_percent) {
+            last_percent = percent;
+            emit progress((int) percent);
+        }
+
+        cur ^= 1;
+    }
+
+    pool.waitForDone();
+    closeAll();
+
+    qDebug("CADU splitter: %ld CADU's, %ld fill, %ld sync errors, %ld RS corrected symbols, %ld RS failed, %ld files written",
+           cadus, fill_cadus, sync_errors, rs_corrected, rs_failed, files_written);
+}
+
+//---------------------------------------------------------------------------
+// AHRPT, write the sync and the decoded VCDU to the file of the VCID
+void TCADUSplitter::routeVCDU(quint8 vcid, unsigned char *vcdu)
+{
+    TCADUWriter *w = writers[vcid];
+
+    if(w == NULL) {
+        if(routes[vcid].isEmpty())
+            return;
+
+        w = new TCADUWriter(routes[vcid]);
+        writers[vcid] = w;
+
+        if(w->open())
+            files_written++;
+    }
+
+    if(!w->isOpen())
+        return;
+
+    w->write(CADU_SYNC, CADU_SYNC_SIZE);
+    w->write(vcdu, CADU_PACKET_SIZE);
+}
+
+//---------------------------------------------------------------------------
+// LRIT/HRIT, reassemble the files of each VCID
+void TCADUSplitter::routeLRIT(quint8 vcid, unsigned char *vcdu, qint64 address)
+{
+    TCADUWriter *w = writers[vcid];
+    unsigned char *m_pdu, *cp_pdu, *s_pdu;
+    quint16 apid, hdr_ptr, hdr_len, size;
+    quint32 all_hdr_len;
+    quint64 data_len, left;
+    QString name;
+    char txt[256];
+    int i;
+
+    m_pdu = vcdu + 0x06;
+
+    /*
+        M_PDU packet zone (CP_PDU) does not contain a header if
+        first header pointer is 2047 (0x07ff). It contains data from a
+        previous packet
+    */
+    hdr_ptr = ((m_pdu[0] << 8) | m_pdu[1]) & 0x07ff;
+    if(hdr_ptr >= 0x0374)
+        hdr_ptr = 0;
+
+    cp_pdu = m_pdu + 0x02 + hdr_ptr;
+    apid = ((cp_pdu[0] & 0x07) << 8) | cp_pdu[1];
+
+    if(apid == 0) {
+        // it is an MSGi application process id, close the previous file
+        if(w)
+            delete w;
+        writers[vcid] = w = NULL;
+
+        // read the primary header
+        s_pdu = cp_pdu + 0x06 + 0x0a;
+        hdr_len = (s_pdu[1] << 8) | s_pdu[2];
+        all_hdr_len = (s_pdu[4] << 24) | (s_pdu[5] << 16) | (s_pdu[6] << 8) | s_pdu[7];
+
+        data_len = 0;
+        for(i=8; i<16; i++)
+            data_len = (data_len << 8) | s_pdu[i];
+        data_len >>= 3; // in bytes
+
+        if(hdr_len == 0 || all_hdr_len == 0 || data_len == 0)
+            return;
+
+        // primary header is 16 bytes
+        if(s_pdu[0] != 0x00 || s_pdu[3] != 0x00 || hdr_len != 0x10)
+            return;
+
+        // the primary header must be within this packet zone
+        if(hdr_ptr > 884 - 16)
+            return;
+
+        lrit_images++;
+
+        sprintf(txt, "============================================================\n"
+                     "vcdu address: 0x%08llx vcid: %d, header pointer: 0x%04x, data length: %d\n"
+                     "header length: %d, size of all headers: %d",
+                (unsigned long long) address, (int) vcid, hdr_ptr, (int) data_len,
+                hdr_len, all_hdr_len);
+        log(txt);
+        lritHeaderLog(s_pdu + hdr_len);
+
+        name = lritAnnotation(s_pdu + hdr_len);
+        if(name.isEmpty())
+            return;
+
+        w = new TCADUWriter(QDir(lrit_path).filePath(name + ".lrit"));
+        writers[vcid] = w;
+        if(!w->open())
+            return;
+
+        files_written++;
+
+        // write this packet starting from the primary header until packet end
+        // m_pdu packet zone is 884 bytes, primary header is 16 bytes
+        // the 2 byte crc follows the file, writing no more than file_len drops it
+        w->file_len = (quint64) all_hdr_len + data_len;
+        left = w->file_len;
+        size = 884 - hdr_ptr - 16;
+    }
+    else if(w && w->isOpen()) {
+        // data starts at byte 8 from vcdu packet and is 884 bytes, m_pdu packet zone (cp_pdu)
+        s_pdu = cp_pdu;
+        left = w->file_len - w->bytes_written;
+        size = 884;
+    }
+    else
+        return;
+
+    if(left < size)
+        size = (quint16) left;
+
+    w->write(s_pdu, size);
+    w->bytes_written += size;
+
+    if(w->bytes_written >= w->file_len) {
+        delete w;
+        writers[vcid] = NULL;
+    }
+}
+
+//---------------------------------------------------------------------------
+// returns the file name from the annotation header or an empty string
+// if the header is missing, bogus or the file is encrypted
+QString TCADUSplitter::lritAnnotation(unsigned char *hdr)
+{
+    quint16 hdr_len, address, max_address;
+    char    buff[256];
+    int     i;
+
+    // the *hdr points now at the first secondary header
+    // VCDU            6 primary header
+    // M_PDU           2 header
+    // primary header 16
+    // max address is 884 - 16
+
+    address = 0x18;
+    max_address = 0x0364;
+
+    while(address < max_address) {
+        hdr_len = (hdr[1] << 8) | hdr[2];
+
+        address += hdr_len;
+        if(hdr_len == 0 || address > max_address || hdr[0] < 1)
+            break;
+
+        if(hdr[0] == 4 && hdr_len == 64) {
+            memcpy(buff, hdr + 3, hdr_len - 3);
+            buff[hdr_len - 3] = '\0';
+
+            for(i=0; i<(signed) strlen(buff); i++) {
+                if(buff[i] == '-' || buff[i] == '_')
+                    continue;
+                if(!isalnum(buff[i]) || !isprint(buff[i]))
+                    return ""; // bogus annotation
+            }
+
+            if(buff[hdr_len - 4] == 'E')
+                return ""; // encrypted, skip
+
+            return QString(buff);
+        }
+
+        hdr += hdr_len;
+    }
+
+    return "";
+}
+
+//---------------------------------------------------------------------------
+void TCADUSplitter::lritHeaderLog(unsigned char *hdr)
+{
+    quint16 hdr_len, address, max_address;
+    quint32 u32_1, u32_2;
+    char    txt[1024];
+    char    buff[256];
+
+    if(logfile == NULL || !logfile->isOpen())
+        return;
+
+    address = 0x18;
+    max_address = 0x0364;
+
+    while(address < max_address) {
+        hdr_len = (hdr[1] << 8) | hdr[2];
+
+        address += hdr_len;
+        if(hdr_len == 0 || address > max_address)
+            return;
+
+        sprintf(txt, "\nHeader type #%d, header length: %d", hdr[0], hdr_len);
+        log(txt);
+
+        switch(hdr[0]) {
+        case 1:
+            sprintf(txt, "Image structure\nbits per pixel: %d\ncolumns: %d rows: %d\ncompression type: %d (0=none, 1=lossless, 2=lossy)",
+                    hdr[3],
+                    (hdr[4] << 8) | hdr[5], (hdr[6] << 8) | hdr[7],
+                    hdr[8]);
+            break;
+        case 2:
+            sprintf(txt, "Image Navigation");
+            break;
+        case 3:
+            sprintf(txt, "Image Data Function");
+            break;
+        case 4:
+            if(hdr_len == 64) {
+                memcpy(buff, hdr + 3, hdr_len - 3);
+                buff[hdr_len - 3] = '\0';
+
+                for(int i=0; i<(signed) strlen(buff); i++) {
+                    if(buff[i] == '-' || buff[i] == '_')
+                        continue;
+                    if(!isalnum(buff[i]) || !isprint(buff[i]))
+                        buff[i] = '?';
+                }
+
+                sprintf(txt, "Annotation\n%s%s", buff, buff[hdr_len - 4] == 'E' ? "\nEncrypted":" ");
+            }
+            else
+                strcpy(txt, "Annotation\nErroneus annotation lenght");
+            break;
+        case 5:
+            sprintf(txt, "Time Stamp");
+            break;
+        case 6:
+            sprintf(txt, "Ancillary Text");
+            break;
+        case 7:
+            u32_1 = (hdr[4] << 24) | (hdr[5] << 16) | (hdr[6] << 8) | hdr[7]; // high byte
+            u32_2 = (hdr[8] << 24) | (hdr[9] << 16) | (hdr[10] << 8) | hdr[11]; // low byte
+            sprintf(txt, "Key Header\nkey no: %d Seed for PN enctyption (64 bits): hi32 0x%08x low32 0x%08x",
+                    hdr[3],
+                    u32_1, u32_2);
+            break;
+        case 128:
+            sprintf(txt, "Segment Identification\nimage id: %d\nchannel id: %d\nsegment sequence no: %d\nstart sequence no: %d\nend sequence no: %d\ndata format: %d (0=none, 1=JPEG, 2=T.4 coded 3=Wavelet)",
+                    (hdr[3] << 8) | hdr[4],
+                     hdr[5] & 0xff,
+                    (hdr[6] << 8) | hdr[7],
+                    (hdr[8] << 8) | hdr[9],
+                    (hdr[10] << 8) | hdr[11],
+                     hdr[12] & 0xff);
+            break;
+        case 130:
+            sprintf(txt, "Image Segment Line Quality");
+            break;
+
+        default:
+            sprintf(txt, "Unknown header");
+        }
+
+        log(txt);
+        hdr += hdr_len;
+    }
+}
+
+//---------------------------------------------------------------------------
+void TCADUSplitter::log(const char *txt)
+{
+    if(logfile == NULL || !logfile->isOpen())
+        return;
+
+    logfile->write(txt, strlen(txt));
+    logfile->write("\n", 1);
+}
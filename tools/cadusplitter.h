@@ -0,0 +1,151 @@
+/*
+    HRPT-Decoder, a software for processing POES high resolution weather satellite imagery.
+    Copyright (C) 2010,2011 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+
+
+//---------------------------------------------------------------------------
+
+#ifndef CADUSPLITTER_H
+#define CADUSPLITTER_H
+
+#include <QThread>
+#include <QThreadPool>
+#include <QString>
+#include <stdio.h>
+
+//---------------------------------------------------------------------------
+#define CS_ALL_VCIDS        1   // each VCID to its own file
+#define CS_LRIT             2   // reassemble LRIT/HRIT files from the M_PDU's
+
+#define CS_NUM_VCIDS        64
+#define CS_FILL_VCID        63
+#define CS_BATCH_SIZE       4096        // CADU's per batch, ~4 MB
+#define CS_READ_SIZE        (1 << 20)   // input chunk size in bytes
+#define CS_WRITE_BUF_SIZE   (1 << 20)   // output buffer per file
+
+class TCADU;
+
+//---------------------------------------------------------------------------
+// buffered output file
+class TCADUWriter
+{
+public:
+    TCADUWriter(const QString& filename_);
+    ~TCADUWriter(void);
+
+    bool open(void);
+    bool isOpen(void) { return fp != NULL; }
+    void close(void);
+    bool write(const void *data, size_t size);
+
+    QString filename(void) const { return _filename; }
+
+    // LRIT/HRIT file being reassembled, file_len = all headers + data
+    quint64 file_len, bytes_written;
+
+private:
+    QString _filename;
+    FILE    *fp;
+    char    *buf;
+};
+
+//---------------------------------------------------------------------------
+// a batch of CADU's, read in one go and decoded on the worker pool
+class TCADUBatch
+{
+public:
+    TCADUBatch(void);
+    ~TCADUBatch(void);
+
+    bool alloc(int size, size_t payload_size_);
+
+    unsigned char *packet(int index) { return data + index * payload_size; }
+
+    unsigned char *data;
+    qint64 *address;  // file offsets, 64 bit for dumps over 2 GB
+    int    *rs_errors;
+    size_t payload_size;
+    int    count, size;
+};
+
+//---------------------------------------------------------------------------
+class TCADUSplitter : public QThread
+{
+    Q_OBJECT
+
+public:
+    TCADUSplitter(QObject *parent = 0);
+    ~TCADUSplitter(void);
+
+    void setInputFile(const QString& filename) { infile = filename; }
+    void setFlags(int flags_) { flags = flags_; }
+    void setDecoding(bool derandomize, bool rs_decode);
+    void addRoute(int vcid, const QString& filename);
+    void setLRITOutput(const QString& path, const QString& logfile = "");
+
+    void cancel(void) { cancelled = 1; }
+    bool isCancelled(void) { return cancelled != 0; }
+
+    void run();
+
+    // statistics
+    long cadus, fill_cadus, rs_failed, rs_corrected;
+    long sync_errors, lrit_images, files_written;
+
+signals:
+    void progress(int percent);
+
+protected:
+    bool openInput(void);
+    void closeAll(void);
+
+    bool fill(size_t bytes);
+    bool readCADU(unsigned char *payload, qint64 *address);
+    int  readBatch(TCADUBatch *batch);
+    void decodeBatch(TCADUBatch *batch);
+    void routeBatch(TCADUBatch *batch);
+
+    void routeVCDU(quint8 vcid, unsigned char *vcdu);
+    void routeLRIT(quint8 vcid, unsigned char *vcdu, qint64 address);
+
+    QString lritAnnotation(unsigned char *hdr);
+    void    lritHeaderLog(unsigned char *hdr);
+    void    log(const char *txt);
+
+private:
+    QString infile, lrit_path;
+    QString routes[CS_NUM_VCIDS];
+
+    TCADU       *cadu;
+    TCADUWriter *writers[CS_NUM_VCIDS];
+    TCADUWriter *logfile;
+    QThreadPool pool;
+
+    FILE    *fp;
+    qint64  filesize;
+    unsigned char *rbuf;
+    size_t  rpos, rlen;
+    qint64  rbase;
+
+    volatile int cancelled;
+    int flags;
+};
+
+#endif // CADUSPLITTER_H
@@ -25,12 +25,13 @@
 #define CADUSPLITTERDIALOG_H
 
 #include <QDialog>
+#include <QTime>
 
 namespace Ui {
     class CADUSplitterDialog;
 }
 
-class TCADU;
+class TCADUSplitter;
 //---------------------------------------------------------------------------
 class CADUSplitterDialog : public QDialog
 {
@@ -42,20 +43,20 @@ public:
 
 private:
     Ui::CADUSplitterDialog *ui;
-    TCADU *cadu;
-    FILE  *infp, *outfp;
+    TCADUSplitter *splitter;
+    QTime         elapsed;
 
 protected:
     QString changePrefix(QString filename, bool ahrpt);
     QString getAHRPTPrefix(void);
+    int     getAHRPTVCID(void);
 
-    bool    openFiles(bool ahrpt);
-    void    closeFiles(void);
-    void    lrit_msg_header_decoder_debug(unsigned char *hdr, FILE *debug_fp);
-    void    lrit_secondary_header_decoder(unsigned char *hdr);
-    void    print_debug(char *buf, FILE *dfp);
+    bool    startSplitter(bool ahrpt);
+    void    enableControls(bool enable);
 
 private slots:
+    void splitterFinished();
+    void on_cancelBtn_clicked();
     void on_genGOESdataBtn_clicked();
     void on_genAHRPTDataBtn_clicked();
     void on_ahrptVCIDCB_currentIndexChanged(int index);
@@ -36,6 +36,7 @@
 #include "gps.h"
 #include "gauge.h"
 #include "utils.h"
+#include "tickscheduler.h"
 
 //#define DEBUG_GPS
 
@@ -67,12 +68,9 @@ TGPS::TGPS(QWidget *gaugeWidget) : QWidget(gaugeWidget)
 
     gpsbuf = (char *) malloc(GPS_BUF_SIZE + 1);
 
-    supportedNMEAsentences = new QStringList;
-    supportedNMEAsentences->append("$GPGGA");
-    supportedNMEAsentences->append("$GPGSA");
-    supportedNMEAsentences->append("$GPRMC");
-
-    nmea = new QStringList;
+    // arrival times of the messages
+    mono.start();
+    parser.setBaudRate(baudValue(BAUD4800));
 
     if(gaugeWidget)
         gauge = new TGauge(Azimuth_GaugeType, gaugeWidget);
@@ -96,9 +94,6 @@ TGPS::~TGPS(void)
 
     if(gauge)
         delete gauge;
-
-    delete nmea;
-    delete supportedNMEAsentences;
 }
 
 //---------------------------------------------------------------------------
@@ -115,6 +110,9 @@ void TGPS::reset(void)
     satcount = 0;
     sysdifftime = 0;
 
+    parser.reset();
+    clock.reset();
+
     if(gauge)
         gauge->setValue(0);
 
@@ -147,6 +145,7 @@ void TGPS::baudRate(BaudRateType rate)
     if(rate != port->baudRate()) {
         close();
         port->setBaudRate(rate);
+        parser.setBaudRate(baudValue(rate));
     }
 }
 
@@ -225,6 +224,9 @@ void TGPS::close(void)
     if(gps_timer)
         gps_timer->stop();
 
+    // the offset is not followed any more
+    TTickScheduler::setClockCorrection(0);
+
     if(!(flags & GPS_F_READ)) {
         port->close();
         flags = 0;
@@ -261,8 +263,14 @@ void TGPS::close(void)
 
 
 //---------------------------------------------------------------------------
+// the bytes are parsed as they come, a message may span reads
 void TGPS::onDataAvailable(void)
 {
+    TGPSEpoch epoch;
+    qint64    rx_ns;
+    double    sys_utc;
+    int       read, msgs;
+
     if(flags & GPS_F_CLOSE) {
         close();
         return;
@@ -273,214 +281,99 @@ void TGPS::onDataAvailable(void)
 
     flags |= GPS_F_READ;
 
-    rxtime_utc = QDateTime::currentDateTime().toUTC();
+    msgs = 0;
 
-    int avail = port->bytesAvailable();
-    if(avail > 0) {
-        int read, i=0;
-        while(true) {
-            // replace 0x0d 0x0a with NULL
-            read = port->readLine(gpsbuf, GPS_BUF_SIZE) - 2;
-
-            if(read > 0) {
-                gpsbuf[read] = '\0';
-                if(parseNMEA(read))
-                    i++;
-                else
-                    break;
-            }
-            else
-                break;
-        }
-
-#if defined(DEBUG_GPS)
-        if(i > 0)
-            qDebug("%d NEMA sentences parsed\n", i);
-#endif
+    while(!(flags & GPS_F_CLOSE) && port->bytesAvailable() > 0) {
+        read = port->read(gpsbuf, GPS_BUF_SIZE);
+        if(read <= 0)
+            break;
 
-        if(i)
-            emit(NMEAParsed());
-    }
+        // both clocks at the read, the last byte has just arrived
+        rx_ns = TTickScheduler::nsecsElapsed(mono);
+        sys_utc = TGPSClock::systemUTC();
 
-    flags &= ~GPS_F_READ;
+        msgs |= parser.feed(gpsbuf, read, rx_ns);
 
-    if(flags & GPS_F_CLOSE) {
-        close();
+        if(parser.takeEpoch(&epoch))
+            clock.addSample(sys_utc - (rx_ns - epoch.rx_ns) / 1.0e9, epoch.sec_of_day);
     }
-}
-
-//---------------------------------------------------------------------------
-bool TGPS::parseNMEA(qint64 bytes_read)
-{
-    if(*gpsbuf != '$' || bytes_read < 10 || (flags & GPS_F_CLOSE))
-        return false;
-
-#if defined(DEBUG_GPS)
-    qDebug("%s", gpsbuf);
-#endif
-
-    nmea->clear();
-    *nmea = QString(gpsbuf).split(',');
-
-    if(!nmea->count())
-        return false;
-
-    QString type = nmea->at(0);
-    int sentenceIndex = supportedNMEAsentences->indexOf(type);
 
-    switch(sentenceIndex) {
-    case 0: return parseGGA(nmea);
-    case 1: return parseGSA(nmea);
-    case 2: return parseRMC(nmea);
+    if(msgs) {
+        update(msgs);
 
-    default:
-        {
 #if defined(DEBUG_GPS)
-            qDebug("Unsupported NMEA sentence: %s\n", type.toStdString().c_str());
+        qDebug("GPS messages 0x%02x, %u parsed, %u checksum errors", msgs,
+               parser.messages(), parser.checksumErrors());
 #endif
 
-            return false;
-        }
+        emit(NMEAParsed());
     }
 
-    return true;
-}
-
-//---------------------------------------------------------------------------
-// http://www.gpsinformation.org/dale/nmea.htm
-// GGA - essential fix data which provide 3D location and accuracy data
-// $GPGGA,222823.927,6309.5108,N,02133.5627,E,1,06,1.8,8.9,M,22.6,M,0.0,0000*78
-/*
-                  Fix quality: 0 = invalid
-                               1 = GPS fix (SPS)
-                               2 = DGPS fix
-                               3 = PPS fix
-                               4 = Real Time Kinematic
-                               5 = Float RTK
-                               6 = estimated (dead reckoning) (2.3 feature)
-                               7 = Manual input mode
-                               8 = Simulation mode
-  Regarding "height of geoid (mean sea level) above WGS84 ellipsoid"
-  see http://www.esri.com/news/arcuser/0703/geoid1of3.html
-*/
-bool TGPS::parseGGA(QStringList *nmea)
-{
-    if(nmea->count() < 13)
-        return false;
-
-    parseUTC(nmea->at(1));
-    parsePos(&lat, nmea->at(2), nmea->at(3));
-    parsePos(&lon, nmea->at(4), nmea->at(5));
-
-    int fix_type = nmea->at(6).toInt();
-    satcount = nmea->at(7).toInt();
-    valid = (satcount == 0 || fix_type == 0) ? false:true;
-
-    alt = nmea->at(9).toDouble();
-    geo_alt = nmea->at(11).toDouble(); // Height of geoid (mean sea level) above WGS84 ellipsoid
-
-#if defined(DEBUG_GPS)
-    qDebug("NMEA GGA [%s:%d]", __FILE__, __LINE__);
-    qDebug("Fix quality: %d, %s", fix_type, valid ? "Valid":"Void");
-    qDebug("Satellites in view: %d", satcount);
-    qDebug("GPS %s UTC", utc.toStdString().c_str());
-    qDebug("SYS %s UTC", rxtime_utc.toString("hh:mm:ss.zzz").toStdString().c_str());
-    qDebug("Diff %+.3f sec", sysdifftime);
-    qDebug("%.4f%c %.4f%c", lat, lat < 0 ? 'S':'N', lon, lon < 0 ? 'W':'E');
-    qDebug("Altitude: %.1f M", alt);
-    qDebug("Height of geoid: %.1f M", geo_alt);
-    qDebug("\n");
-#endif
+    flags &= ~GPS_F_READ;
 
-    return true;
+    if(flags & GPS_F_CLOSE) {
+        close();
+    }
 }
 
 //---------------------------------------------------------------------------
-// Satellite status. Check only fix status
-// $GPGSA,A,3,08,18,19,07,15,28,,,,,,,3.9,1.8,3.3*31
-bool TGPS::parseGSA(QStringList *nmea)
+void TGPS::update(int msgs)
 {
-    if(nmea->count() < 4)
-        return false;
-
-    /*
-    3D fix - values include:
-            1 = no fix
-            2 = 2D fix
-            3 = 3D fix
-   */
-
-    int fix_type = nmea->at(2).toInt();
-    valid = fix_type == 1 ? false:true;
-
-#if defined(DEBUG_GPS)
-    qDebug("NMEA GSA [%s:%d]", __FILE__, __LINE__);
-    qDebug("3D Fix: %d, %s", fix_type, valid ? "Valid":"Void");
-    qDebug("\n");
-#endif
+    const TGPSFix& fix = parser.fix();
 
-    return true;
-}
+    valid    = fix.valid;
+    satcount = fix.sats;
+    lat      = fix.lat;
+    lon      = fix.lon;
+    alt      = fix.alt;
+    geo_alt  = fix.geo_alt;
+    speed    = fix.speed;   // in knots
+    azimuth  = fix.course;
+    mag_var  = fix.mag_var;
 
-//---------------------------------------------------------------------------
-// The Recommended Minimum
-// $GPRMC,222823.927,A,6309.5108,N,02133.5627,E,0.37,18.56,271210,,*38
-bool TGPS::parseRMC(QStringList *nmea)
-{
-    if(nmea->count() < 12)
-        return false;
+    rxtime_utc = QDateTime::currentDateTime().toUTC();
 
-    parseUTC(nmea->at(1));
-    valid = nmea->at(2) == "V" ? false:true;
+    if(fix.has_time) {
+        gps_time = QTime(fix.hour, fix.min, 0).addMSecs((int) floor(fix.sec * 1000.0 + 0.5));
+        utc = gps_time.toString("hh:mm:ss.zzz");
+    }
 
-    parsePos(&lat, nmea->at(3), nmea->at(4));
-    parsePos(&lon, nmea->at(5), nmea->at(6));
+    if(clock.isValid()) {
+        sysdifftime = clock.offset();
 
-    speed    = nmea->at(7).toDouble(); // in knots
-    azimuth  = nmea->at(8).toDouble();
-    mag_var  = nmea->at(10).toDouble();
-    mag_var *= nmea->at(11) == "W" ? -1:1;
+        // the tracker follows GPS time instead of the system clock, the
+        // clock holds resolved times only and keeps its offset without a fix
+        TTickScheduler::setClockCorrection(-sysdifftime);
+    }
+    else if(fix.has_time)
+        sysdifftime = gps_time.msecsTo(rxtime_utc.time()) / 1000.0;
 
-    if(gauge)
+    if(gauge && (msgs & (GPS_MSG_RMC | GPS_MSG_NAV_PVT)))
         gauge->setValue(azimuth);
 
 #if defined(DEBUG_GPS)
-    qDebug("NMEA RMC [%s:%d]", __FILE__, __LINE__);
-    qDebug("%s", valid ? "Valid":"Void");
+    qDebug("%s, %d satellites, fix type %d", valid ? "Valid":"Void", satcount, fix.fix_type);
     qDebug("GPS %s UTC", utc.toStdString().c_str());
-    qDebug("SYS %s UTC", rxtime_utc.toString("hh:mm:ss.zzz").toStdString().c_str());
-    qDebug("Diff %+.3f sec", sysdifftime);
+    qDebug("Diff %+.4f sec, jitter %.1f ms", sysdifftime, clock.jitter() * 1000.0);
     qDebug("%.4f%c %.4f%c", lat, lat < 0 ? 'S':'N', lon, lon < 0 ? 'W':'E');
-    qDebug("Speed: %.1f kt", speed);
-    qDebug("Cource: %.1f degrees", azimuth);
-    qDebug("Magnetic variation: %.1f%c", mag_var, mag_var < 0 ? 'W':'E');
-    qDebug("\n");
+    qDebug("Altitude: %.1f M, height of geoid: %.1f M", alt, geo_alt);
 #endif
-
-    return true;
 }
 
 //---------------------------------------------------------------------------
-void TGPS::parseUTC(QString str)
+int TGPS::baudValue(BaudRateType rate)
 {
-    if(str.length() < 6)
-        return;
-
-    utc = str;
-    utc.insert(2, ":");
-    utc.insert(5, ":");
-
-    gps_time = QTime::fromString(utc, "hh:mm:ss.zzz");
-
-    rxtime_utc = QDateTime::currentDateTime().toUTC();
-
-    QTime rx_time = rxtime_utc.time();
-    sysdifftime = gps_time.msecsTo(rx_time) / 1000.0;
-
-#if 0
-    QString str_time = gps_time.toString("hh:mm:ss.zzz");
-    qDebug("GPS time:", str_time.toStdString().c_str());
-#endif
+    switch(rate)
+    {
+    case BAUD2400:   return 2400;
+    case BAUD4800:   return 4800;
+    case BAUD9600:   return 9600;
+    case BAUD19200:  return 19200;
+    case BAUD38400:  return 38400;
+    case BAUD57600:  return 57600;
+    case BAUD115200: return 115200;
+    default:         return 0;       // byte times are not known
+    }
 }
 
 //---------------------------------------------------------------------------
@@ -505,7 +398,10 @@ QString TGPS::timediff(void)
 {
     QString str;
 
-    str.sprintf("%+.3f sec", valid ? sysdifftime:0);
+    if(valid && clock.isValid())
+        str.sprintf("%+.4f sec, jitter %.1f ms", sysdifftime, clock.jitter() * 1000.0);
+    else
+        str.sprintf("%+.3f sec", valid ? sysdifftime:0);
 
     return str;
 }
@@ -632,33 +528,5 @@ QString TGPS::magnetic(void)
 }
 
 //---------------------------------------------------------------------------
-//  4807.038,N  Latitude 48 deg 07.038' N
-// 01131.000,E  Longitude 11 deg 31.000' E
-// convert position to decimal degrees
-void TGPS::parsePos(double *pos, QString str_pos, QString sign)
-{
-    if(str_pos.length() < 8)
-        return;
-
-    int i;
-    if(sign == "N" || sign == "S")
-        i = 2;
-    else
-        i = 3;
-
-    QString deg_str = str_pos.left(i);
-    QString min_str =  str_pos.right(str_pos.length() - i);
-
-    double degrees = deg_str.toDouble();
-    double minutes = min_str.toDouble();
-
-    *pos = degrees + minutes / 60.0;
-    *pos *= (sign == "S" || sign == "W") ? -1:1;
-
-    // qDebug("degs:%s mins:%s pos:%.4f", deg_str.toStdString().c_str(), min_str.toStdString().c_str(), *pos);
-}
-
-
-//---------------------------------------------------------------------------
 
 
@@ -27,11 +27,12 @@
 #include <QObject>
 #include <QWidget>
 #include <QDateTime>
+#include <QElapsedTimer>
 
 #include "qextserialport.h"
+#include "gpsparser.h"
 
 class QString;
-class QStringList;
 class QDateTime;
 class QTime;
 class QTimer;
@@ -60,7 +61,11 @@ public:
     FlowType flowControl(void) const;
     QString  ioError(void) const;
 
-    // Decoded NMEA data
+    // receiver output latency, the constant part of the clock offset samples
+    void    latency(double seconds) { clock.setLatency(seconds); }
+    double  latency(void) const     { return clock.getLatency(); }
+
+    // Decoded NMEA and UBX data
     bool    isValid(void)       {return valid; }
     QString quality(void) const { return valid ? "Valid":"Void"; }
     QString time(bool local = false);
@@ -80,17 +85,16 @@ public:
     uint      rxtime_t(void) const;
     QDateTime getrxtime(bool localtime = false);
 
+    // system clock ahead of GPS time, seconds
+    bool    clockValid(void) const   { return clock.isValid(); }
+    double  clockOffset(void) const  { return clock.offset(); }
+    double  clockJitter(void) const  { return clock.jitter(); }
+
 protected:
     void reset(void);
+    void update(int msgs);
 
-    bool parseNMEA(qint64 bytes_read);
-
-    bool parseGGA(QStringList *nmea);
-    bool parseGSA(QStringList *nmea);
-    bool parseRMC(QStringList *nmea);
-
-    void parseUTC(QString str);
-    void parsePos(double *pos, QString str_pos, QString sign);
+    static int baudValue(BaudRateType rate);
 
 signals:
     void NMEAParsed();
@@ -103,13 +107,14 @@ private:
     char *gpsbuf;
     int  flags;
 
-    QStringList *supportedNMEAsentences;
-    QStringList *nmea;
+    TGPSParser    parser;
+    TGPSClock     clock;
+    QElapsedTimer mono;
 
     TGauge *gauge;
     QTimer *gps_timer;
 
-    // parsed NMEA data
+    // parsed data
     QDateTime rxtime_utc;
     QTime     gps_time;
     QString   utc;
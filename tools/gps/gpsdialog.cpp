@@ -92,6 +92,7 @@ void GPSDialog::writeSettings(void)
       reg.setValue("Baudrate", ui->baudrateCb->currentIndex());
       reg.setValue("Flowcontrol", ui->flowControlCb->currentIndex());
       reg.setValue("UTCTime", ui->utcTimeCb->isChecked());
+      reg.setValue("Latency", gps->latency() * 1000.0); // ms
 
     reg.endGroup();
 }
@@ -114,6 +115,7 @@ void GPSDialog::readSettings(void)
       ui->baudrateCb->setCurrentIndex(reg.value("Baudrate", 1).toInt());
       ui->flowControlCb->setCurrentIndex(reg.value("Flowcontrol", 0).toInt());
       ui->utcTimeCb->setChecked(reg.value("UTCTime", 0).toBool());
+      gps->latency(reg.value("Latency", 0).toDouble() / 1000.0);
 
     reg.endGroup();
 }
@@ -0,0 +1,668 @@
+/*
+    HRPT-Decoder, a software for processing POES high resolution weather satellite imagery.
+    Copyright (C) 2010 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+
+//---------------------------------------------------------------------------
+#include <QtGlobal>
+#include <string.h>
+#include <math.h>
+
+#if defined Q_OS_UNIX
+#include <sys/time.h>
+#else
+#include <QDateTime>
+#endif
+
+#include "gpsparser.h"
+
+// parser states
+#define GPS_S_IDLE          0
+#define GPS_S_NMEA          1
+#define GPS_S_UBX_SYNC      2   // 0xb5 seen, 0x62 expected
+#define GPS_S_UBX_HEAD      3   // class, id and length
+#define GPS_S_UBX_BODY      4   // payload and checksum
+#define GPS_S_UBX_SKIP      5   // too long to keep
+
+//---------------------------------------------------------------------------
+// locale independent, the fields are not terminated
+static double parseNumber(const char *p, int n, bool *ok)
+{
+    double v = 0, scale = 1;
+    bool   neg = false, frac = false, digits = false;
+    int    i;
+
+    for(i=0; i<n; i++) {
+        if(i == 0 && (p[i] == '-' || p[i] == '+')) {
+            neg = p[i] == '-';
+            continue;
+        }
+
+        if(p[i] == '.' && !frac) {
+            frac = true;
+            continue;
+        }
+
+        if(p[i] < '0' || p[i] > '9')
+            break;
+
+        digits = true;
+
+        if(frac) {
+            scale /= 10.0;
+            v += (p[i] - '0') * scale;
+        }
+        else
+            v = v * 10.0 + (p[i] - '0');
+    }
+
+    if(ok)
+        *ok = digits;
+
+    return neg ? -v:v;
+}
+
+//---------------------------------------------------------------------------
+static int hexValue(char c)
+{
+    if(c >= '0' && c <= '9')
+        return c - '0';
+    if(c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if(c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+
+    return -1;
+}
+
+//---------------------------------------------------------------------------
+// two digit number, -1 if not digits
+static int parse2(const char *p)
+{
+    if(p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9')
+        return -1;
+
+    return (p[0] - '0') * 10 + (p[1] - '0');
+}
+
+//---------------------------------------------------------------------------
+TGPSParser::TGPSParser(void)
+{
+    byte_ns = 0;
+
+    reset();
+}
+
+//---------------------------------------------------------------------------
+void TGPSParser::reset(void)
+{
+    state = GPS_S_IDLE;
+    len = ubx_len = 0;
+    fields = 0;
+
+    msg_ns = burst_ns = 0;
+    last_ns = -((qint64) GPS_BURST_GAP_MS * 1000000) - 1;
+    epoch_open = epoch_ready = false;
+    memset(&epoch, 0, sizeof(epoch));
+
+    memset(&_fix, 0, sizeof(_fix));
+
+    msg_count = cksum_errors = 0;
+}
+
+//---------------------------------------------------------------------------
+// start, 8 data and stop bit
+void TGPSParser::setBaudRate(int baud)
+{
+    byte_ns = baud > 0 ? (qint64) (10.0e9 / baud):0;
+}
+
+//---------------------------------------------------------------------------
+// rx_ns is the monotonic time of the read, when the last byte had arrived
+int TGPSParser::feed(const char *data, int count, qint64 rx_ns)
+{
+    int i, msgs = 0;
+
+    for(i=0; i<count; i++)
+        msgs |= byte((quint8) data[i], rx_ns - (qint64) (count - 1 - i) * byte_ns);
+
+    return msgs;
+}
+
+//---------------------------------------------------------------------------
+bool TGPSParser::takeEpoch(TGPSEpoch *epoch_)
+{
+    if(!epoch_ready)
+        return false;
+
+    *epoch_ = epoch;
+    epoch_ready = false;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+int TGPSParser::byte(quint8 c, qint64 t_ns)
+{
+    // the first byte after an idle line
+    if(t_ns - last_ns > (qint64) GPS_BURST_GAP_MS * 1000000) {
+        burst_ns = t_ns;
+        epoch_open = true;
+    }
+
+    if(t_ns > last_ns)
+        last_ns = t_ns;
+
+    switch(state) {
+    case GPS_S_NMEA:
+        if(c == '\n') {
+            state = GPS_S_IDLE;
+            buf[len] = '\0';
+
+            return parseNMEA();
+        }
+
+        if(c == '\r')
+            return 0;
+
+        if(c != '$' && c >= 0x20 && c < 0x7f && len < GPS_MAX_NMEA) {
+            buf[len++] = c;
+            return 0;
+        }
+
+        // garbage or a new start
+        state = GPS_S_IDLE;
+        break;
+
+    case GPS_S_UBX_SYNC:
+        if(c == 0x62) {
+            state = GPS_S_UBX_HEAD;
+            len = 0;
+
+            return 0;
+        }
+
+        state = GPS_S_IDLE;
+        break;
+
+    case GPS_S_UBX_HEAD:
+        buf[len++] = c;
+
+        if(len == 4) {
+            ubx_len = u2(buf + 2);
+            state = ubx_len > GPS_MAX_UBX ? GPS_S_UBX_SKIP:GPS_S_UBX_BODY;
+        }
+        return 0;
+
+    case GPS_S_UBX_BODY:
+        buf[len++] = c;
+
+        if(len == ubx_len + 6) {
+            state = GPS_S_IDLE;
+
+            return parseUBX();
+        }
+        return 0;
+
+    case GPS_S_UBX_SKIP:
+        if(++len == ubx_len + 6)
+            state = GPS_S_IDLE;
+        return 0;
+
+    default:
+        break;
+    }
+
+    if(c == '$') {
+        state = GPS_S_NMEA;
+        buf[0] = c;
+        len = 1;
+        msg_ns = t_ns;
+    }
+    else if(c == 0xb5) {
+        state = GPS_S_UBX_SYNC;
+        msg_ns = t_ns;
+    }
+
+    return 0;
+}
+
+//---------------------------------------------------------------------------
+// $GPGGA,222823.927,6309.5108,N,02133.5627,E,1,06,1.8,8.9,M,22.6,M,0.0,0000*78
+int TGPSParser::parseNMEA(void)
+{
+    const char *s = (const char *) buf;
+    const char *star;
+    quint8 sum = 0;
+    int    end, start, i, rc;
+
+    star = strchr(s, '*');
+    end = star ? (int) (star - s):len;
+
+    for(i=1; i<end; i++)
+        sum ^= buf[i];
+
+    if(star) {
+        if(len - end < 3 || hexValue(star[1]) < 0 || hexValue(star[2]) < 0 ||
+           hexValue(star[1]) * 16 + hexValue(star[2]) != sum) {
+            cksum_errors++;
+            return 0;
+        }
+    }
+
+    fields = 0;
+    for(i=1, start=1; i<=end && fields < GPS_MAX_FIELDS; i++) {
+        if(i == end || s[i] == ',') {
+            field[fields] = s + start;
+            field_len[fields] = i - start;
+            fields++;
+
+            start = i + 1;
+        }
+    }
+
+    // talker and the sentence, proprietary ones are longer
+    if(fields < 2 || field_len[0] != 5)
+        return 0;
+
+    _fix.rx_ns = msg_ns;
+
+    s = field[0] + 2;
+    rc = 0;
+
+    if(!strncmp(s, "GGA", 3))
+        rc = parseGGA() ? GPS_MSG_GGA:0;
+    else if(!strncmp(s, "GSA", 3))
+        rc = parseGSA() ? GPS_MSG_GSA:0;
+    else if(!strncmp(s, "RMC", 3))
+        rc = parseRMC() ? GPS_MSG_RMC:0;
+    else if(!strncmp(s, "ZDA", 3))
+        rc = parseZDA() ? GPS_MSG_ZDA:0;
+
+    if(rc)
+        msg_count++;
+
+    return rc;
+}
+
+//---------------------------------------------------------------------------
+double TGPSParser::fieldDouble(int index, bool *ok) const
+{
+    if(index >= fields) {
+        if(ok)
+            *ok = false;
+
+        return 0;
+    }
+
+    return parseNumber(field[index], field_len[index], ok);
+}
+
+//---------------------------------------------------------------------------
+int TGPSParser::fieldInt(int index) const
+{
+    return (int) fieldDouble(index);
+}
+
+//---------------------------------------------------------------------------
+char TGPSParser::fieldChar(int index) const
+{
+    return (index < fields && field_len[index] > 0) ? field[index][0]:'\0';
+}
+
+//---------------------------------------------------------------------------
+// hhmmss.sss, resolved is true if the receiver has a valid time
+void TGPSParser::parseTime(int index, bool resolved)
+{
+    const char *p;
+    int  h, m;
+    bool ok;
+
+    if(index >= fields || field_len[index] < 6)
+        return;
+
+    p = field[index];
+    h = parse2(p);
+    m = parse2(p + 2);
+
+    _fix.sec = parseNumber(p + 4, field_len[index] - 4, &ok);
+    if(h < 0 || m < 0 || !ok)
+        return;
+
+    _fix.hour = h;
+    _fix.min = m;
+    _fix.has_time = true;
+
+    if(resolved)
+        timeParsed();
+}
+
+//---------------------------------------------------------------------------
+//  4807.038,N  Latitude 48 deg 07.038' N
+// 01131.000,E  Longitude 11 deg 31.000' E
+void TGPSParser::parsePos(double *pos, int index, int degree_digits)
+{
+    const char *p;
+    double deg, min;
+    bool   ok1, ok2;
+    char   sign;
+
+    if(index + 1 >= fields || field_len[index] < degree_digits + 2)
+        return;
+
+    p = field[index];
+    deg = parseNumber(p, degree_digits, &ok1);
+    min = parseNumber(p + degree_digits, field_len[index] - degree_digits, &ok2);
+    if(!ok1 || !ok2)
+        return;
+
+    sign = fieldChar(index + 1);
+
+    *pos = deg + min / 60.0;
+    *pos *= (sign == 'S' || sign == 'W') ? -1:1;
+}
+
+//---------------------------------------------------------------------------
+// the first time of a burst is the epoch
+void TGPSParser::timeParsed(void)
+{
+    if(!epoch_open)
+        return;
+
+    epoch.rx_ns = burst_ns;
+    epoch.sec_of_day = _fix.hour * 3600.0 + _fix.min * 60.0 + _fix.sec;
+
+    epoch_open = false;
+    epoch_ready = true;
+}
+
+//---------------------------------------------------------------------------
+// GGA - essential fix data which provide 3D location and accuracy data
+// fix quality 0 = invalid, 1 = GPS, 2 = DGPS, 3 = PPS, 4 = RTK, 5 = float RTK,
+// 6 = dead reckoning, 7 = manual, 8 = simulation
+bool TGPSParser::parseGGA(void)
+{
+    if(fields < 12)
+        return false;
+
+    _fix.fix_type = fieldInt(6);
+    _fix.sats = fieldInt(7);
+    _fix.valid = _fix.sats > 0 && _fix.fix_type > 0;
+
+    // no fix, dead reckoning, manual and simulation are not GPS time
+    parseTime(1, _fix.valid && _fix.fix_type <= 5);
+    parsePos(&_fix.lat, 2, 2);
+    parsePos(&_fix.lon, 4, 3);
+
+    _fix.hdop = fieldDouble(8);
+    _fix.alt = fieldDouble(9);
+    _fix.geo_alt = fieldDouble(11);   // height of geoid (MSL) above WGS84 ellipsoid
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// satellite status, 1 = no fix, 2 = 2D, 3 = 3D
+// $GPGSA,A,3,08,18,19,07,15,28,,,,,,,3.9,1.8,3.3*31
+bool TGPSParser::parseGSA(void)
+{
+    if(fields < 3)
+        return false;
+
+    _fix.fix_type = fieldInt(2);
+    _fix.valid = _fix.fix_type >= 2;
+
+    if(fields >= 18) {
+        _fix.pdop = fieldDouble(15);
+        _fix.hdop = fieldDouble(16);
+        _fix.vdop = fieldDouble(17);
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// the recommended minimum
+// $GPRMC,222823.927,A,6309.5108,N,02133.5627,E,0.37,18.56,271210,,*38
+bool TGPSParser::parseRMC(void)
+{
+    const char *p;
+    int d, m, y;
+
+    if(fields < 10)
+        return false;
+
+    _fix.valid = fieldChar(2) == 'A';
+    parseTime(1, _fix.valid);
+
+    parsePos(&_fix.lat, 3, 2);
+    parsePos(&_fix.lon, 5, 3);
+
+    _fix.speed = fieldDouble(7);
+    _fix.course = fieldDouble(8);
+
+    // ddmmyy
+    if(field_len[9] == 6) {
+        p = field[9];
+        d = parse2(p);
+        m = parse2(p + 2);
+        y = parse2(p + 4);
+
+        if(d > 0 && m > 0 && y >= 0) {
+            _fix.day = d;
+            _fix.month = m;
+            _fix.year = y + (y < 80 ? 2000:1900);
+            _fix.has_date = true;
+        }
+    }
+
+    if(fields >= 12) {
+        _fix.mag_var = fieldDouble(10);
+        _fix.mag_var *= fieldChar(11) == 'W' ? -1:1;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// time and date
+// $GPZDA,201530.00,04,07,2002,00,00*60
+bool TGPSParser::parseZDA(void)
+{
+    int d, m, y;
+
+    if(fields < 5)
+        return false;
+
+    // ZDA has no status, the RTC time is sent before a fix
+    parseTime(1, _fix.valid);
+
+    d = fieldInt(2);
+    m = fieldInt(3);
+    y = fieldInt(4);
+
+    if(d > 0 && m > 0 && y > 0) {
+        _fix.day = d;
+        _fix.month = m;
+        _fix.year = y;
+        _fix.has_date = true;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// sync 0xb5 0x62, class, id, length (le), payload, 8 bit fletcher checksum
+int TGPSParser::parseUBX(void)
+{
+    quint8 ck_a = 0, ck_b = 0;
+    int    i, rc;
+
+    for(i=0; i<ubx_len + 4; i++) {
+        ck_a += buf[i];
+        ck_b += ck_a;
+    }
+
+    if(ck_a != buf[ubx_len + 4] || ck_b != buf[ubx_len + 5]) {
+        cksum_errors++;
+        return 0;
+    }
+
+    _fix.rx_ns = msg_ns;
+    rc = 0;
+
+    if(buf[0] == 0x01 && buf[1] == 0x07 && ubx_len >= 92)
+        rc = parseNavPVT(buf + 4) ? GPS_MSG_NAV_PVT:0;
+
+    if(rc)
+        msg_count++;
+
+    return rc;
+}
+
+//---------------------------------------------------------------------------
+// NAV-PVT, navigation position velocity time solution
+bool TGPSParser::parseNavPVT(const quint8 *p)
+{
+    // valid date
+    if(p[11] & 1) {
+        _fix.year = u2(p + 4);
+        _fix.month = p[6];
+        _fix.day = p[7];
+        _fix.has_date = true;
+    }
+
+    // valid time, the nanoseconds may be negative
+    if(p[11] & 2) {
+        _fix.hour = p[8];
+        _fix.min = p[9];
+        _fix.sec = p[10] + i4(p + 16) * 1.0e-9;
+        _fix.has_time = true;
+
+        // the leap seconds and the UTC offset are known too
+        if(p[11] & 4)
+            timeParsed();
+    }
+
+    // 2D, 3D or GNSS + dead reckoning with the fix ok flag
+    _fix.fix_type = p[20];
+    _fix.valid = (p[21] & 1) && p[20] >= 2 && p[20] <= 4;
+    _fix.sats = p[23];
+
+    _fix.lon = i4(p + 24) * 1.0e-7;
+    _fix.lat = i4(p + 28) * 1.0e-7;
+    _fix.alt = i4(p + 36) / 1000.0;
+    _fix.geo_alt = (i4(p + 32) - i4(p + 36)) / 1000.0;
+
+    _fix.speed = i4(p + 60) / 1000.0 * 3600.0 / 1852.0;
+    _fix.course = i4(p + 64) * 1.0e-5;
+    _fix.pdop = u2(p + 76) * 0.01;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TGPSClock::TGPSClock(void)
+{
+    latency = 0;
+
+    reset();
+}
+
+//---------------------------------------------------------------------------
+void TGPSClock::reset(void)
+{
+    count = index = 0;
+}
+
+//---------------------------------------------------------------------------
+// sys_utc is the system time at the start of the epoch burst
+void TGPSClock::addSample(double sys_utc, double sec_of_day)
+{
+    samples[index] = sys_utc - nearestUTC(sys_utc, sec_of_day);
+
+    index = (index + 1) % GPS_CLOCK_WINDOW;
+    if(count < GPS_CLOCK_WINDOW)
+        count++;
+}
+
+//---------------------------------------------------------------------------
+double TGPSClock::offset(void) const
+{
+    double v;
+    int    i;
+
+    if(count == 0)
+        return 0;
+
+    v = samples[0];
+    for(i=1; i<count; i++)
+        if(samples[i] < v)
+            v = samples[i];
+
+    return v - latency;
+}
+
+//---------------------------------------------------------------------------
+double TGPSClock::jitter(void) const
+{
+    double lo, hi;
+    int    i;
+
+    if(count == 0)
+        return 0;
+
+    lo = hi = samples[0];
+    for(i=1; i<count; i++) {
+        lo = qMin(lo, samples[i]);
+        hi = qMax(hi, samples[i]);
+    }
+
+    return hi - lo;
+}
+
+//---------------------------------------------------------------------------
+// seconds since 1970-01-01 UTC
+double TGPSClock::systemUTC(void)
+{
+#if defined Q_OS_UNIX
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return tv.tv_sec + tv.tv_usec / 1.0e6;
+#else
+    return QDateTime::currentMSecsSinceEpoch() / 1000.0;
+#endif
+}
+
+//---------------------------------------------------------------------------
+// the day is taken from the system clock, it must be within 12 hours
+double TGPSClock::nearestUTC(double near_utc, double sec_of_day)
+{
+    double t = floor(near_utc / 86400.0) * 86400.0 + sec_of_day;
+
+    if(t - near_utc > 43200.0)
+        t -= 86400.0;
+    else if(near_utc - t > 43200.0)
+        t += 86400.0;
+
+    return t;
+}
@@ -0,0 +1,179 @@
+/*
+    HRPT-Decoder, a software for processing POES high resolution weather satellite imagery.
+    Copyright (C) 2010 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+
+//---------------------------------------------------------------------------
+
+#ifndef GPSPARSER_H
+#define GPSPARSER_H
+
+#include <QtGlobal>
+
+//---------------------------------------------------------------------------
+#define GPS_MAX_NMEA        120     // longer than the 82 of the standard
+#define GPS_MAX_UBX         256     // largest UBX payload kept, NAV-PVT is 92
+#define GPS_MAX_FIELDS       24
+#define GPS_BURST_GAP_MS     50     // idle line between the output epochs
+
+#define GPS_CLOCK_WINDOW     16     // epochs in the clock offset estimate
+#define GPS_CLOCK_MIN         4     // epochs before the offset is used
+
+// messages parsed by feed()
+#define GPS_MSG_GGA           1
+#define GPS_MSG_GSA           2
+#define GPS_MSG_RMC           4
+#define GPS_MSG_ZDA           8
+#define GPS_MSG_NAV_PVT      16
+
+//---------------------------------------------------------------------------
+typedef struct TGPSFix_t
+{
+    bool    valid;
+    int     fix_type;           // GGA quality, GSA mode or UBX fix type
+    int     sats;
+
+    double  lat, lon;           // degrees, south and west negative
+    double  alt, geo_alt;       // m above MSL, geoid above WGS84
+    double  speed, course;      // knots, degrees
+    double  mag_var;            // degrees, west negative
+    double  pdop, hdop, vdop;
+
+    bool    has_time, has_date;
+    int     year, month, day;
+    int     hour, min;
+    double  sec;
+
+    qint64  rx_ns;              // monotonic arrival of the first byte
+} TGPSFix;
+
+//---------------------------------------------------------------------------
+// start of the output of a navigation epoch
+typedef struct TGPSEpoch_t
+{
+    qint64 rx_ns;               // monotonic arrival of the first byte of the burst
+    double sec_of_day;          // UTC of the epoch
+} TGPSEpoch;
+
+//---------------------------------------------------------------------------
+/*
+  Streaming NMEA 0183 and u-blox UBX parser. The bytes are fed as they
+  are read, any split of the messages is fine, and nothing is allocated.
+  NMEA GGA, GSA, RMC and ZDA from any talker and UBX NAV-PVT.
+  A NMEA checksum is checked when present, UBX always.
+
+  The arrival of every byte is estimated from the monotonic time of the
+  read and the byte time of the baud rate. The first byte after an idle
+  line starts the output of an epoch, its arrival and the UTC of the
+  first timed message are returned by takeEpoch(). Only a resolved time
+  is an epoch, the time of a GGA with a fix, a RMC with status A, a ZDA
+  after a valid fix or a NAV-PVT with validTime and fullyResolved. A
+  receiver without a fix outputs the time of its RTC.
+*/
+class TGPSParser
+{
+public:
+    TGPSParser(void);
+
+    void reset(void);
+    void setBaudRate(int baud);
+
+    int  feed(const char *data, int len, qint64 rx_ns);
+    bool takeEpoch(TGPSEpoch *epoch_);
+
+    const TGPSFix& fix(void) const { return _fix; }
+
+    quint32 messages(void) const { return msg_count; }
+    quint32 checksumErrors(void) const { return cksum_errors; }
+
+protected:
+    int  byte(quint8 c, qint64 t_ns);
+
+    int  parseNMEA(void);
+    bool parseGGA(void);
+    bool parseGSA(void);
+    bool parseRMC(void);
+    bool parseZDA(void);
+    void parseTime(int index, bool resolved);
+    void parsePos(double *pos, int index, int degree_digits);
+
+    int  parseUBX(void);
+    bool parseNavPVT(const quint8 *p);
+
+    void timeParsed(void);
+
+    double  fieldDouble(int index, bool *ok = NULL) const;
+    int     fieldInt(int index) const;
+    char    fieldChar(int index) const;
+
+    static quint16 u2(const quint8 *p) { return p[0] | (p[1] << 8); }
+    static quint32 u4(const quint8 *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((quint32) p[3] << 24); }
+    static qint32  i4(const quint8 *p) { return (qint32) u4(p); }
+
+private:
+    int     state;
+    quint8  buf[GPS_MAX_UBX + 8];
+    int     len, ubx_len;
+
+    const char *field[GPS_MAX_FIELDS];
+    int     field_len[GPS_MAX_FIELDS];
+    int     fields;
+
+    qint64  byte_ns, msg_ns, last_ns, burst_ns;
+    bool    epoch_open, epoch_ready;
+    TGPSEpoch epoch;
+
+    TGPSFix _fix;
+
+    quint32 msg_count, cksum_errors;
+};
+
+//---------------------------------------------------------------------------
+/*
+  Offset of the system clock from GPS time. A sample is the system time
+  at the start of an epoch burst less the UTC of the epoch, i.e. the
+  offset plus the output latency of the receiver and the serial line.
+  The latency varies upwards only, so the lowest sample of the window is
+  the best estimate, the constant part is set with setLatency().
+*/
+class TGPSClock
+{
+public:
+    TGPSClock(void);
+
+    void   reset(void);
+    void   setLatency(double seconds) { latency = seconds; }
+    double getLatency(void) const { return latency; }
+
+    void   addSample(double sys_utc, double sec_of_day);
+
+    bool   isValid(void) const { return count >= GPS_CLOCK_MIN; }
+    double offset(void) const;  // seconds the system clock is ahead
+    double jitter(void) const;  // peak to peak of the window
+
+    static double systemUTC(void);
+    static double nearestUTC(double near_utc, double sec_of_day);
+
+private:
+    double samples[GPS_CLOCK_WINDOW];
+    int    count, index;
+    double latency;
+};
+
+#endif // GPSPARSER_H
@@ -0,0 +1,647 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <QThread>
+#include <QSettings>
+#include <QMutexLocker>
+#include <QMetaObject>
+#include <stdio.h>
+#include <string.h>
+
+#if defined Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+#include "jobmanager.h"
+
+//---------------------------------------------------------------------------
+TJob::TJob(void)
+{
+    id = after = 0;
+    priority = JP_POSTPROC;
+    timeout_s = JM_DEFAULT_TIMEOUT;
+    retries = attempts = 0;
+    state = JobState_Queued;
+    exit_code = 0;
+    cancel = timed_out = false;
+
+    cpu_s = 0;
+    read_bytes = write_bytes = 0;
+
+    proc = NULL;
+}
+
+//---------------------------------------------------------------------------
+QString TJob::stateString(void) const
+{
+    switch(state)
+    {
+    case JobState_Queued:    return "queued";
+    case JobState_Waiting:   return "waiting for retry";
+    case JobState_Running:   return "running";
+    case JobState_Done:      return "done";
+    case JobState_Failed:    return "failed";
+    case JobState_Cancelled: return "cancelled";
+
+    default:
+        return "unknown";
+    }
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+// recursive, QProcess may emit error() inside start()
+TJobManager::TJobManager(QObject *parent) :
+    QObject(parent),
+    mutex(QMutex::Recursive)
+{
+    max_jobs = 0;
+    last_id = 0;
+
+    timer.setInterval(JM_HOUSEKEEPING_MS);
+    connect(&timer, SIGNAL(timeout()), this, SLOT(housekeeping()));
+}
+
+//---------------------------------------------------------------------------
+// the running jobs are saved as queued and run again at the next start
+TJobManager::~TJobManager(void)
+{
+    TJob *job;
+    int  i;
+
+    timer.stop();
+
+    save();
+
+    for(i=0; i<jobs.count(); i++) {
+        job = jobs.at(i);
+
+        if(job->proc) {
+            job->proc->disconnect(this);
+            job->proc->kill();
+            job->proc->waitForFinished(3000);
+
+            delete job->proc;
+        }
+
+        delete job;
+    }
+}
+
+//---------------------------------------------------------------------------
+void TJobManager::writeSettings(QSettings *reg)
+{
+    reg->beginGroup("Jobs");
+      reg->setValue("MaxParallel", max_jobs);
+    reg->endGroup();
+}
+
+//---------------------------------------------------------------------------
+void TJobManager::readSettings(QSettings *reg)
+{
+    reg->beginGroup("Jobs");
+      setMaxJobs(reg->value("MaxParallel", 0).toInt());
+    reg->endGroup();
+}
+
+//---------------------------------------------------------------------------
+int TJobManager::maxJobs(void)
+{
+    QMutexLocker locker(&mutex);
+
+    if(max_jobs > 0)
+        return max_jobs;
+
+    return QThread::idealThreadCount() > 0 ? QThread::idealThreadCount():1;
+}
+
+//---------------------------------------------------------------------------
+// 0 = one per core
+void TJobManager::setMaxJobs(int count)
+{
+    QMutexLocker locker(&mutex);
+
+    max_jobs = count < 0 ? 0:count;
+    post();
+}
+
+//---------------------------------------------------------------------------
+// any thread, returns the job id
+// after is the id of a job which must exit first, 0 = none
+int TJobManager::submit(const QString &name, const QString &command,
+                        int priority, int timeout_s, int retries, int after)
+{
+    QMutexLocker locker(&mutex);
+    TJob *job;
+
+    job = new TJob;
+    job->id = ++last_id;
+    job->name = name;
+    job->command = command;
+    job->priority = priority;
+    job->timeout_s = timeout_s;
+    job->retries = retries;
+    job->after = after;
+    job->submitted = QDateTime::currentDateTime();
+
+    jobs.append(job);
+
+    if(after > 0)
+        qDebug("Job %d queued after job %d: %s", job->id, after, command.toStdString().c_str());
+    else
+        qDebug("Job %d queued: %s", job->id, command.toStdString().c_str());
+
+    save();
+    post();
+
+    return job->id;
+}
+
+//---------------------------------------------------------------------------
+// any thread, a running job is killed
+void TJobManager::cancel(int id)
+{
+    QMutexLocker locker(&mutex);
+    TJob *job;
+
+    job = find(id);
+    if(!job || !job->isActive())
+        return;
+
+    job->cancel = true;
+
+    if(job->state != JobState_Running) {
+        job->state = JobState_Cancelled;
+        job->finished = QDateTime::currentDateTime();
+        save();
+
+        // nobody else finishes it, the jobs after it can start
+        emit jobFinished(job->id, false);
+    }
+
+    post();
+}
+
+//---------------------------------------------------------------------------
+bool TJobManager::isActive(int id)
+{
+    QMutexLocker locker(&mutex);
+    TJob *job = find(id);
+
+    return job && job->isActive();
+}
+
+//---------------------------------------------------------------------------
+bool TJobManager::isRunning(int id)
+{
+    QMutexLocker locker(&mutex);
+    TJob *job = find(id);
+
+    return job && job->state == JobState_Running;
+}
+
+//---------------------------------------------------------------------------
+int TJobManager::runningCount(void)
+{
+    QMutexLocker locker(&mutex);
+    int i, n = 0;
+
+    for(i=0; i<jobs.count(); i++)
+        if(jobs.at(i)->state == JobState_Running)
+            n++;
+
+    return n;
+}
+
+//---------------------------------------------------------------------------
+int TJobManager::queuedCount(void)
+{
+    QMutexLocker locker(&mutex);
+    int i, n = 0;
+
+    for(i=0; i<jobs.count(); i++)
+        if(jobs.at(i)->state == JobState_Queued || jobs.at(i)->state == JobState_Waiting)
+            n++;
+
+    return n;
+}
+
+//---------------------------------------------------------------------------
+QString TJobManager::statusString(void)
+{
+    QMutexLocker locker(&mutex);
+    QString str, line;
+    TJob    *job;
+    int     i;
+
+    str.sprintf("%d running, %d queued, %d parallel\n", runningCount(), queuedCount(), maxJobs());
+
+    for(i=0; i<jobs.count(); i++) {
+        job = jobs.at(i);
+
+        line.sprintf("#%d %s: %s, attempt %d, cpu %.1f s, read %lld kB, written %lld kB\n",
+                     job->id, job->name.toStdString().c_str(), job->stateString().toStdString().c_str(),
+                     job->attempts, job->cpu_s,
+                     (long long) (job->read_bytes / 1024), (long long) (job->write_bytes / 1024));
+        str += line;
+    }
+
+    return str;
+}
+
+//---------------------------------------------------------------------------
+// the scheduling is always done in the thread of the manager
+void TJobManager::post(void)
+{
+    QMetaObject::invokeMethod(this, "schedule", Qt::QueuedConnection);
+}
+
+//---------------------------------------------------------------------------
+TJob *TJobManager::find(int id)
+{
+    int i;
+
+    for(i=0; i<jobs.count(); i++)
+        if(jobs.at(i)->id == id)
+            return jobs.at(i);
+
+    return NULL;
+}
+
+//---------------------------------------------------------------------------
+TJob *TJobManager::find(QProcess *proc)
+{
+    int i;
+
+    for(i=0; i<jobs.count(); i++)
+        if(jobs.at(i)->proc == proc)
+            return jobs.at(i);
+
+    return NULL;
+}
+
+//---------------------------------------------------------------------------
+// highest priority, the newest within a priority
+// a job waits while the job it was submitted after is active,
+// finish() schedules again when that one exits
+TJob *TJobManager::next(bool realtime)
+{
+    TJob *job, *dep, *best = NULL;
+    int  i;
+
+    for(i=0; i<jobs.count(); i++) {
+        job = jobs.at(i);
+
+        if(job->state != JobState_Queued || (realtime && job->priority < JP_REALTIME))
+            continue;
+
+        if(job->after > 0 && (dep = find(job->after)) != NULL && dep->isActive())
+            continue;
+
+        if(!best || job->priority > best->priority ||
+           (job->priority == best->priority && job->id > best->id))
+            best = job;
+    }
+
+    return best;
+}
+
+//---------------------------------------------------------------------------
+void TJobManager::schedule(void)
+{
+    QMutexLocker locker(&mutex);
+    QDateTime now = QDateTime::currentDateTime();
+    TJob *job;
+    int  i, running, waiting;
+
+    running = waiting = 0;
+
+    for(i=0; i<jobs.count(); i++) {
+        job = jobs.at(i);
+
+        if(job->state == JobState_Running) {
+            // finished() follows the kill
+            if(job->cancel && job->proc)
+                job->proc->kill();
+
+            running++;
+        }
+        else if(job->state == JobState_Waiting) {
+            if(job->retry_at <= now)
+                job->state = JobState_Queued;
+            else
+                waiting++;
+        }
+    }
+
+    while((job = next(true)) != NULL) {
+        start(job);
+        running++;
+    }
+
+    while(running < maxJobs() && (job = next(false)) != NULL) {
+        start(job);
+        running++;
+    }
+
+    if(running > 0 || waiting > 0) {
+        if(!timer.isActive())
+            timer.start();
+    }
+    else
+        timer.stop();
+}
+
+//---------------------------------------------------------------------------
+void TJobManager::start(TJob *job)
+{
+    job->proc = new QProcess(this);
+
+    connect(job->proc, SIGNAL(finished(int, QProcess::ExitStatus)),
+            this, SLOT(processFinished(int, QProcess::ExitStatus)));
+    connect(job->proc, SIGNAL(error(QProcess::ProcessError)),
+            this, SLOT(processError(QProcess::ProcessError)));
+
+    job->state = JobState_Running;
+    job->attempts++;
+    job->started = QDateTime::currentDateTime();
+    job->timed_out = false;
+    job->cpu_s = 0;
+    job->read_bytes = job->write_bytes = 0;
+
+    qDebug("Job %d started: %s", job->id, job->command.toStdString().c_str());
+
+    save();
+
+    job->proc->start(job->command);
+}
+
+//---------------------------------------------------------------------------
+void TJobManager::processFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    QMutexLocker locker(&mutex);
+    TJob *job;
+
+    job = find((QProcess *) sender());
+    if(!job)
+        return;
+
+    job->exit_code = exitCode;
+
+    finish(job, exitStatus == QProcess::NormalExit && exitCode == 0);
+}
+
+//---------------------------------------------------------------------------
+// finished() is not emitted when the process did not start
+void TJobManager::processError(QProcess::ProcessError error)
+{
+    QMutexLocker locker(&mutex);
+    TJob *job;
+
+    if(error != QProcess::FailedToStart)
+        return;
+
+    job = find((QProcess *) sender());
+    if(!job)
+        return;
+
+    job->exit_code = -1;
+
+    finish(job, false);
+}
+
+//---------------------------------------------------------------------------
+void TJobManager::finish(TJob *job, bool ok)
+{
+    QDateTime now = QDateTime::currentDateTime();
+    int  i, count;
+
+    job->proc->disconnect(this);
+    job->proc->deleteLater();
+    job->proc = NULL;
+
+    job->finished = now;
+
+    if(ok)
+        job->state = JobState_Done;
+    else if(job->cancel)
+        job->state = JobState_Cancelled;
+    else if(!job->timed_out && job->attempts <= job->retries) {
+        job->state = JobState_Waiting;
+        job->retry_at = now.addSecs(JM_RETRY_DELAY);
+    }
+    else
+        job->state = JobState_Failed;
+
+    qDebug("Job %d %s, exit code %d, %d s, cpu %.1f s, read %lld kB, written %lld kB",
+           job->id, job->stateString().toStdString().c_str(), job->exit_code,
+           job->started.secsTo(now), job->cpu_s,
+           (long long) (job->read_bytes / 1024), (long long) (job->write_bytes / 1024));
+
+    if(job->state != JobState_Waiting)
+        emit jobFinished(job->id, ok);
+
+    // forget the oldest finished jobs, never the one just finished
+    count = 0;
+    for(i=jobs.count()-1; i>=0; i--) {
+        if(jobs.at(i) == job || jobs.at(i)->isActive())
+            continue;
+
+        if(++count > JM_KEEP_FINISHED)
+            delete jobs.takeAt(i);
+    }
+
+    save();
+    post();
+}
+
+//---------------------------------------------------------------------------
+void TJobManager::housekeeping(void)
+{
+    QMutexLocker locker(&mutex);
+    QDateTime now = QDateTime::currentDateTime();
+    TJob *job;
+    int  i;
+
+    for(i=0; i<jobs.count(); i++) {
+        job = jobs.at(i);
+
+        if(job->state != JobState_Running || !job->proc)
+            continue;
+
+        account(job);
+
+        if(job->timeout_s > 0 && !job->timed_out && job->started.secsTo(now) > job->timeout_s) {
+            qDebug("Job %d: running over %d s, stopping it", job->id, job->timeout_s);
+
+            job->timed_out = true;
+            job->proc->kill();
+        }
+    }
+
+    // retries which are due
+    schedule();
+}
+
+//---------------------------------------------------------------------------
+// cpu and disk i/o from /proc, the last sample before the exit is kept
+void TJobManager::account(TJob *job)
+{
+#if defined Q_OS_LINUX
+    char   path[64], buf[1024], *p;
+    unsigned long utime, stime;
+    long   cutime, cstime;
+    long long value;
+    FILE   *fp;
+    int    pid;
+
+    pid = (int) job->proc->pid();
+    if(pid <= 0)
+        return;
+
+    sprintf(path, "/proc/%d/stat", pid);
+    if((fp = fopen(path, "r")) != NULL) {
+        // the command name may have spaces, the fields start after it
+        if(fgets(buf, sizeof(buf), fp) && (p = strrchr(buf, ')')) != NULL &&
+           sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %ld %ld",
+                  &utime, &stime, &cutime, &cstime) == 4)
+            job->cpu_s = (double) (utime + stime + cutime + cstime) / sysconf(_SC_CLK_TCK);
+
+        fclose(fp);
+    }
+
+    sprintf(path, "/proc/%d/io", pid);
+    if((fp = fopen(path, "r")) != NULL) {
+        while(fgets(buf, sizeof(buf), fp)) {
+            if(sscanf(buf, "read_bytes: %lld", &value) == 1)
+                job->read_bytes = value;
+            else if(sscanf(buf, "write_bytes: %lld", &value) == 1)
+                job->write_bytes = value;
+        }
+
+        fclose(fp);
+    }
+#else
+    Q_UNUSED(job);
+#endif
+}
+
+//---------------------------------------------------------------------------
+void TJobManager::save(void)
+{
+    QString str;
+    TJob    *job;
+    int     i, n;
+
+    if(state_file.isEmpty())
+        return;
+
+    QSettings reg(state_file, QSettings::IniFormat);
+
+    reg.clear();
+    reg.setValue("Jobs/LastId", last_id);
+
+    for(i=0, n=0; i<jobs.count(); i++) {
+        job = jobs.at(i);
+
+        str.sprintf("Job_%d", ++n);
+
+        reg.beginGroup(str);
+          reg.setValue("Id", job->id);
+          reg.setValue("Name", job->name);
+          reg.setValue("Command", job->command);
+          reg.setValue("Priority", job->priority);
+          reg.setValue("Timeout", job->timeout_s);
+          reg.setValue("Retries", job->retries);
+          reg.setValue("After", job->after);
+          reg.setValue("Attempts", job->attempts);
+          // a running job is run again after a restart
+          reg.setValue("State", (int) (job->state == JobState_Running ? JobState_Queued:job->state));
+          reg.setValue("ExitCode", job->exit_code);
+          reg.setValue("Submitted", job->submitted);
+          reg.setValue("Started", job->started);
+          reg.setValue("Finished", job->finished);
+          reg.setValue("Cpu", job->cpu_s);
+          reg.setValue("ReadBytes", job->read_bytes);
+          reg.setValue("WriteBytes", job->write_bytes);
+        reg.endGroup();
+    }
+}
+
+//---------------------------------------------------------------------------
+bool TJobManager::restore(void)
+{
+    QMutexLocker locker(&mutex);
+    QString str;
+    TJob    *job;
+    int     i;
+
+    if(state_file.isEmpty())
+        return false;
+
+    QSettings reg(state_file, QSettings::IniFormat);
+
+    last_id = reg.value("Jobs/LastId", 0).toInt();
+
+    for(i=1; ; i++) {
+        str.sprintf("Job_%d", i);
+
+        reg.beginGroup(str);
+
+        if(!reg.contains("Id")) {
+            reg.endGroup();
+            break;
+        }
+
+        job = new TJob;
+        job->id = reg.value("Id", 0).toInt();
+        job->name = reg.value("Name", "").toString();
+        job->command = reg.value("Command", "").toString();
+        job->priority = reg.value("Priority", JP_POSTPROC).toInt();
+        job->timeout_s = reg.value("Timeout", JM_DEFAULT_TIMEOUT).toInt();
+        job->retries = reg.value("Retries", 1).toInt();
+        job->after = reg.value("After", 0).toInt();
+        job->attempts = reg.value("Attempts", 0).toInt();
+        job->state = (TJobState) reg.value("State", JobState_Queued).toInt();
+        job->exit_code = reg.value("ExitCode", 0).toInt();
+        job->submitted = reg.value("Submitted").toDateTime();
+        job->started = reg.value("Started").toDateTime();
+        job->finished = reg.value("Finished").toDateTime();
+        job->cpu_s = reg.value("Cpu", 0).toDouble();
+        job->read_bytes = reg.value("ReadBytes", 0).toLongLong();
+        job->write_bytes = reg.value("WriteBytes", 0).toLongLong();
+
+        reg.endGroup();
+
+        // a realtime job (rx) is useless after the pass
+        if(job->isActive() && job->priority >= JP_REALTIME)
+            job->state = JobState_Cancelled;
+
+        if(job->id > last_id)
+            last_id = job->id;
+
+        jobs.append(job);
+    }
+
+    post();
+
+    return true;
+}
@@ -0,0 +1,151 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef JOBMANAGER_H
+#define JOBMANAGER_H
+
+#include <QObject>
+#include <QProcess>
+#include <QDateTime>
+#include <QMutex>
+#include <QTimer>
+#include <QList>
+#include <QString>
+
+#define JM_DEFAULT_TIMEOUT    1200     // seconds, 0 = no limit
+#define JM_RETRY_DELAY          30     // seconds before a failed job is run again
+#define JM_HOUSEKEEPING_MS    2000     // accounting and timeouts of the running jobs
+#define JM_KEEP_FINISHED        50     // finished jobs kept in the state file
+
+#define JP_POSTPROC              0     // post processing, the newest pass first
+#define JP_REALTIME            100     // started at once, not limited by the pool (rx)
+
+class QSettings;
+
+//---------------------------------------------------------------------------
+typedef enum TJobState_t
+{
+    JobState_Queued = 0,
+    JobState_Waiting,       // failed, waiting for the retry
+    JobState_Running,
+    JobState_Done,
+    JobState_Failed,
+    JobState_Cancelled
+} TJobState;
+
+//---------------------------------------------------------------------------
+class TJob
+{
+public:
+    TJob(void);
+
+    bool isActive(void) const { return state <= JobState_Running; }
+    QString stateString(void) const;
+
+    int       id, after;      // after: the job waits until that job has exited
+    QString   name, command;
+    int       priority;
+    int       timeout_s;
+    int       retries, attempts;
+    TJobState state;
+    int       exit_code;
+    bool      cancel, timed_out;
+
+    QDateTime submitted, started, finished, retry_at;
+
+    // last /proc sample, the children the job has waited for are included in the cpu time
+    double    cpu_s;
+    qint64    read_bytes, write_bytes;
+
+    QProcess  *proc;
+};
+
+//---------------------------------------------------------------------------
+/*
+  Runs the rx and post processing commands of the tracker.
+  Lives in the GUI thread, the processes are started and reaped there
+  from the QProcess signals, submit() and cancel() can be called from
+  any thread. At most maxJobs() jobs run in parallel, the default is
+  one per core, JP_REALTIME jobs start at once. Higher priority first,
+  the newest job first within a priority. A job submitted after another
+  one is not started before that job has exited.
+  A failed job is run again after JM_RETRY_DELAY seconds up to its
+  retries, a job which runs over its timeout is killed.
+  The active jobs are saved to the state file on every change and
+  restored at start up, a job interrupted by an exit is run again.
+*/
+class TJobManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    TJobManager(QObject *parent = 0);
+    ~TJobManager(void);
+
+    void writeSettings(QSettings *reg);
+    void readSettings(QSettings *reg);
+
+    void setStateFile(const QString &file) { state_file = file; }
+    bool restore(void);
+
+    int  submit(const QString &name, const QString &command,
+                int priority = JP_POSTPROC, int timeout_s = JM_DEFAULT_TIMEOUT, int retries = 1,
+                int after = 0);
+    void cancel(int id);
+    bool isActive(int id);
+    bool isRunning(int id);
+
+    int  maxJobs(void);
+    void setMaxJobs(int count);
+
+    int  runningCount(void);
+    int  queuedCount(void);
+    QString statusString(void);
+
+signals:
+    void jobFinished(int id, bool ok);
+
+protected slots:
+    void schedule(void);
+    void housekeeping(void);
+    void processFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void processError(QProcess::ProcessError error);
+
+protected:
+    TJob *find(int id);
+    TJob *find(QProcess *proc);
+    TJob *next(bool realtime);
+    void  start(TJob *job);
+    void  finish(TJob *job, bool ok);
+    void  account(TJob *job);
+    void  save(void);
+    void  post(void);
+
+private:
+    QMutex        mutex;
+    QList<TJob *> jobs;
+    QTimer        timer;
+    QString       state_file;
+    int           max_jobs;     // 0 = one per core
+    int           last_id;
+};
+
+#endif // JOBMANAGER_H
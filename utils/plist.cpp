@@ -21,169 +21,115 @@
 //---------------------------------------------------------------------------
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "plist.h"
 
-//---------------------------------------------------------------------------
-
-DUMMY::DUMMY()
-{
- Owner=NULL;
- next=NULL;
- Obj=NULL;
-}
+#define PLIST_MIN_CAPACITY 16
 
 //---------------------------------------------------------------------------
-DUMMY::~DUMMY()
+PList::PList()
 {
+  Count=0;
+  Capacity=0;
+  Items=NULL;
 }
 
 //---------------------------------------------------------------------------
-DUMMY::DUMMY(void *owner, void *obj)
-{
-  Owner=(PList *)owner;
-  next=NULL;
-  if(Owner->Items) next=Owner->Items;
-  Obj=obj;
-  Owner->Items=this;
-  Owner->Count+=1;
-}
-//---------------------------------------------------------------------------
-//---------------------------------------------------------------------------
-//---------------------------------------------------------------------------
-//---------------------------------------------------------------------------
-//---------------------------------------------------------------------------
-//---------------------------------------------------------------------------
-//---------------------------------------------------------------------------
-//---------------------------------------------------------------------------
-//---------------------------------------------------------------------------
-//---------------------------------------------------------------------------
-PList::PList()
+PList::~PList()
 {
   Count=0;
-  Items=NULL;
+  if(Items)
+     free(Items);
 }
 
 //---------------------------------------------------------------------------
-PList::~PList()
+bool PList::Grow(int size)
 {
-  Flush();
+ void **p;
+ int  cap;
+
+  if(size <= Capacity)
+     return true;
+
+  cap = Capacity < PLIST_MIN_CAPACITY ? PLIST_MIN_CAPACITY:Capacity;
+  while(cap < size)
+     cap *= 2;
+
+  p = (void **) realloc(Items, cap * sizeof(void *));
+  if(p == NULL)
+     return false;
+
+  Items=p;
+  Capacity=cap;
+
+ return true;
 }
 
 //---------------------------------------------------------------------------
 int PList::Add(void *item, int mode)
 {
    mode = mode;
-   new DUMMY(this, item);
+   if(!Grow(Count + 1))
+      return Count;
+
+   Items[Count++]=item;
 
  return Count;
 }
 
 //---------------------------------------------------------------------------
+// returns the count before removal or -1 if item is not in the list
 int PList::Delete(void *item)
 {
- DUMMY *c, *prev;
- int   i=-1;
-
-  c=prev=Items;
-  while(c) {
-     if(c->Obj==item) {
-        if(c==Items) Items=c->next;
-        else         prev->next=c->next; 
-        delete c;
-        i=Count--;
-        break; }
-     prev=c;
-     c=c->next; }
-
- if(!Count || !Items)
-    Items=NULL;
-
- return i;
+ int i=IndexOf(item);
+
+  if(i < 0)
+     return -1;
+
+  if(i < Count-1)
+     memmove(Items + i, Items + i + 1, (Count - i - 1) * sizeof(void *));
+
+ return Count--;
 }
 
 //---------------------------------------------------------------------------
 void PList::Flush(void)
 {
- DUMMY *c, *c2;
-
-  c=Items;
-  while(c) {
-     c2=c->next;
-     Delete(c->Obj);
-     c=c2; }
-
   Count=0;
-  Items=NULL;
 }
 
 //---------------------------------------------------------------------------
 int PList::Delete(int index)
 {
- DUMMY *c;
- int i=Count-1;
-
-  if(!Count || index<0 || index>i)
+  if(index<0 || index>=Count)
      return -1;
 
-  for(c=Items; c; c=c->next, i--)
-     if(i==index)
-        return(Delete(c->Obj));
-
- return(-1);
+ return(Delete(Items[index]));
 }
 
 //---------------------------------------------------------------------------
+// searches from the newest item, a pointer is usually removed shortly after it was added
 int PList::IndexOf(void *item)
 {
- DUMMY *c;
- int index=Count-1;
+ int index;
 
-  for(c=Items; c; c=c->next, index--)
-     if(c->Obj==item)
+  for(index=Count-1; index>=0; index--)
+     if(Items[index]==item)
         return index;
 
  return(-1);
 }
 
 //---------------------------------------------------------------------------
-void *PList::ItemAt(int index)
-{
- DUMMY *c;
- int i=Count-1;
-
-  if(!Count || index<0 || index>i)
-     return NULL;
-
-  for(c=Items; c; c=c->next, i--)
-     if(i==index)
-        return c->Obj;
-
- return NULL;
-}
-
-//---------------------------------------------------------------------------
-void *PList::SetItem(void *item, int index) // zero based
+// replaces the item at index (zero based) and returns the previous one
+void *PList::SetItem(void *item, int index)
 {
  void *c = ItemAt(index);
 
   if(c)
-     c = item;
-     
- return c;
-}
+     Items[index] = item;
 
-//---------------------------------------------------------------------------
-void *PList::First(void)
-{
- return ItemAt(0);
-}
-
-//---------------------------------------------------------------------------
-void *PList::Last(void)
-{
-  if(!Count)
-     return NULL;
-  else
-     return ItemAt(Count-1);
+ return c;
 }
 
@@ -22,38 +22,32 @@
 #ifndef PListH
 #define PListH
 
-//---------------------------------------------------------------------------
-class DUMMY {
-   public:
-      DUMMY();
-      ~DUMMY();
-      DUMMY(void *owner, void *obj);
-
-      class PList *Owner;
-      DUMMY *next;
-      void  *Obj;
-};
+#include <stddef.h>
 
 //---------------------------------------------------------------------------
+// Pointer list with contiguous storage, index 0 is the oldest item.
+// ItemAt() is O(1), Add() is amortized O(1) and Delete() moves the tail.
 class PList {
    public:
       PList();
-      ~PList();
-      int    Add(void *item, int mode=0);
+      virtual ~PList();
+      virtual int  Add(void *item, int mode=0);
       void   *SetItem(void *item, int index);
-      int    Delete(void *item);
+      virtual int  Delete(void *item);
       int    Delete(int index);
-      void   Flush(void);
+      virtual void Flush(void);
 
       int    IndexOf(void *item);
-      void   *ItemAt(int index);
-      void   *First(void);
-      void   *Last(void);
+      void   *ItemAt(int index) { return (index < 0 || index >= Count) ? NULL:Items[index]; }
+      void   *First(void) { return ItemAt(0); }
+      void   *Last(void) { return ItemAt(Count-1); }
 
-      class  DUMMY *Items;
+      void   **Items;
       int    Count;
 
    protected:
+      bool   Grow(int size);
 
+      int    Capacity;
 };
 #endif
@@ -0,0 +1,277 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#include <QDateTime>
+#include <QAtomicInt>
+#include <string.h>
+#include <math.h>
+
+#include "tickscheduler.h"
+#include "utils.h"
+
+// microseconds, shared by all schedulers
+static QAtomicInt clock_correction_us(0);
+
+// simulated clock, 0 = real time
+static double        sim_speed = 0;
+static double        sim_daynum = 0;
+static QElapsedTimer sim_timer;
+
+//---------------------------------------------------------------------------
+TTickScheduler::TTickScheduler(double hz)
+{
+    rate = 0;
+    period_ns = 0;
+    deadline_ns = tick_ns = 0;
+    base_daynum = 0;
+    base_ns = resync_ns = 0;
+
+    setRate(hz);
+    resetStats();
+}
+
+//---------------------------------------------------------------------------
+void TTickScheduler::setRate(double hz)
+{
+    rate = hz < 0.1 ? 0.1:(hz > 1000 ? 1000:hz);
+    period_ns = (qint64) (1.0e9 / rate);
+}
+
+//---------------------------------------------------------------------------
+void TTickScheduler::resetStats(void)
+{
+    memset(&stats, 0, sizeof(TTickStats));
+}
+
+//---------------------------------------------------------------------------
+// the first tick is due now
+void TTickScheduler::start(void)
+{
+    timer.start();
+
+    deadline_ns = tick_ns = 0;
+    resetStats();
+    rebase();
+}
+
+//---------------------------------------------------------------------------
+// real microseconds to the next deadline
+qint64 TTickScheduler::remaining(void)
+{
+    qint64 ns = deadline_ns - now();
+
+    if(sim_speed > 0)
+        ns = (qint64) (ns / sim_speed);
+
+    return ns > 0 ? (ns + 999) / 1000:0;
+}
+
+//---------------------------------------------------------------------------
+// woken up, record how late it is
+void TTickScheduler::tick(void)
+{
+    qint64 late;
+
+    tick_ns = now();
+    late = (tick_ns - deadline_ns) / 1000;
+    if(late < 0)
+        late = 0;
+
+    stats.ticks++;
+    stats.late_sum += late;
+    if(late > stats.late_max)
+        stats.late_max = late;
+
+    addHist(stats.late_hist, late);
+}
+
+//---------------------------------------------------------------------------
+// work done, the next deadline is one period after the previous one
+void TTickScheduler::done(void)
+{
+    qint64 t = now();
+    qint64 work = (t - tick_ns) / 1000;
+    qint64 missed;
+
+    stats.work_sum += work;
+    if(work > stats.work_max)
+        stats.work_max = work;
+
+    addHist(stats.work_hist, work);
+
+    deadline_ns += period_ns;
+
+    // skip the deadlines which are already gone instead of bursting
+    if(deadline_ns <= t) {
+        missed = (t - deadline_ns) / period_ns + 1;
+        stats.overruns += (quint32) missed;
+        deadline_ns += missed * period_ns;
+    }
+}
+
+//---------------------------------------------------------------------------
+// nanoseconds since start(), simulated when the clock is
+qint64 TTickScheduler::now(void)
+{
+    if(sim_speed > 0)
+        return (qint64) (nsecsElapsed(timer) * sim_speed);
+
+    return nsecsElapsed(timer);
+}
+
+//---------------------------------------------------------------------------
+qint64 TTickScheduler::nsecsElapsed(const QElapsedTimer& t)
+{
+#if QT_VERSION < 0x040800
+    return t.elapsed() * 1000000;
+#else
+    return t.nsecsElapsed();
+#endif
+}
+
+//---------------------------------------------------------------------------
+void TTickScheduler::rebase(void)
+{
+    base_daynum = utcDaynum();
+    base_ns = resync_ns = now();
+}
+
+//---------------------------------------------------------------------------
+// no QDateTime conversion per call, follows UTC if the clock is set
+double TTickScheduler::daynum(void)
+{
+    qint64 t = now();
+    double dn = base_daynum + (t - base_ns) / 86400.0e9;
+    double utc;
+
+    if((t - resync_ns) >= ((qint64) TS_RESYNC_MS) * 1000000) {
+        resync_ns = t;
+        utc = utcDaynum();
+
+        if(fabs(utc - dn) * 86400.0 > TS_RESYNC_DRIFT) {
+            rebase();
+            dn = base_daynum;
+        }
+    }
+
+    if(sim_speed > 0)
+        return dn;
+
+    return dn + clockCorrection() / 86400.0;
+}
+
+//---------------------------------------------------------------------------
+void TTickScheduler::setClockCorrection(double seconds)
+{
+    clock_correction_us = (int) qBound(-2.0e9, seconds * 1.0e6, 2.0e9);
+}
+
+//---------------------------------------------------------------------------
+double TTickScheduler::clockCorrection(void)
+{
+    return ((int) clock_correction_us) / 1.0e6;
+}
+
+//---------------------------------------------------------------------------
+// the simulated clock starts at start_daynum now
+void TTickScheduler::setSimulation(double start_daynum, double speed)
+{
+    sim_daynum = start_daynum;
+    sim_speed = speed > 0 ? speed:0;
+    sim_timer.start();
+}
+
+//---------------------------------------------------------------------------
+bool TTickScheduler::isSimulated(void)
+{
+    return sim_speed > 0;
+}
+
+//---------------------------------------------------------------------------
+double TTickScheduler::timeScale(void)
+{
+    return sim_speed > 0 ? sim_speed:1.0;
+}
+
+//---------------------------------------------------------------------------
+// the UTC daynum of the system clock or the simulated clock
+double TTickScheduler::utcDaynum(void)
+{
+    if(sim_speed > 0)
+        return sim_daynum + nsecsElapsed(sim_timer) * sim_speed / 86400.0e9;
+
+    return GetStartTime(QDateTime::currentDateTime().toUTC(), 1);
+}
+
+//---------------------------------------------------------------------------
+void TTickScheduler::addHist(quint32 *hist, qint64 usec)
+{
+    qint64 limit = 250;
+    int i;
+
+    for(i=0; i<(TS_HIST_BINS - 1) && usec >= limit; i++)
+        limit <<= 1;
+
+    hist[i]++;
+}
+
+//---------------------------------------------------------------------------
+// upper bin limit in microseconds, -1 if it is in the last bin
+qint64 TTickScheduler::percentile(const quint32 *hist, quint32 count, double p)
+{
+    quint32 sum = 0;
+    int i;
+
+    for(i=0; i<TS_HIST_BINS; i++) {
+        sum += hist[i];
+
+        if(sum >= p * count)
+            return i < (TS_HIST_BINS - 1) ? (((qint64) 250) << i):-1;
+    }
+
+    return -1;
+}
+
+//---------------------------------------------------------------------------
+QString TTickScheduler::statsString(const TTickStats& s, double hz)
+{
+    QString str, p99;
+    qint64 p;
+
+    if(s.ticks == 0)
+        return str.sprintf("%.1f Hz, no ticks", hz);
+
+    p = percentile(s.late_hist, s.ticks, 0.99);
+    if(p < 0)
+        p99 = "> " + QString::number((((qint64) 250) << (TS_HIST_BINS - 2)) / 1000) + " ms";
+    else
+        p99 = "< " + QString::number(p / 1000.0) + " ms";
+
+    str.sprintf("%.1f Hz, %u ticks, %u overruns, jitter mean %.2f ms max %.2f ms 99%% %s, work mean %.2f ms max %.2f ms",
+                hz, s.ticks, s.overruns,
+                s.late_sum / 1000.0 / s.ticks, s.late_max / 1000.0,
+                p99.toStdString().c_str(),
+                s.work_sum / 1000.0 / s.ticks, s.work_max / 1000.0);
+
+    return str;
+}
+
+//---------------------------------------------------------------------------
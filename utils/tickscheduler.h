@@ -0,0 +1,113 @@
+/*
+    HRPT-Decoder, a software for processing NOAA-POES high resolution weather satellite images.
+    Copyright (C) 2009 Free Software Foundation, Inc.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: <postmaster@poes-weather.com>
+    Web: <http://www.poes-weather.com>
+*/
+//---------------------------------------------------------------------------
+#ifndef TICKSCHEDULER_H
+#define TICKSCHEDULER_H
+
+#include <QtGlobal>
+#include <QElapsedTimer>
+#include <QString>
+
+#define TS_HIST_BINS        12      // bin i < 250 us * 2^i, the last one is the rest
+#define TS_RESYNC_MS     60000      // compare the monotonic daynum to UTC this often
+#define TS_RESYNC_DRIFT    0.5      // seconds, rebase the daynum if it drifted more
+
+//---------------------------------------------------------------------------
+typedef struct TTickStats_t
+{
+    quint32 ticks;
+    quint32 overruns;               // deadlines missed by a whole period
+    qint64  late_sum, late_max;     // wake up latency in microseconds
+    qint64  work_sum, work_max;     // time spent in the tick in microseconds
+    quint32 late_hist[TS_HIST_BINS];
+    quint32 work_hist[TS_HIST_BINS];
+} TTickStats;
+
+//---------------------------------------------------------------------------
+/*
+  Fixed rate ticks on absolute deadlines of the monotonic clock, a slow
+  tick does not shift the following ones and the rate does not drift.
+
+    sched.start();
+    while(running) {
+        sched.tick();
+        ... work ...
+        sched.done();
+        usleep(sched.remaining());
+    }
+
+  daynum() is the UTC daynum advanced with the monotonic clock, plus
+  the clock correction set from the GPS receiver.
+  setSimulation() replaces UTC with a simulated clock which runs speed
+  times faster than real time, for all schedulers and TRotorSim. The
+  deadlines are in simulated time, remaining() is real time to sleep.
+*/
+class TTickScheduler
+{
+public:
+    TTickScheduler(double hz=2);
+
+    void   setRate(double hz);
+    double getRate(void) const { return rate; }
+
+    void   start(void);
+    qint64 remaining(void);
+    bool   isDue(void) { return remaining() <= 0; }
+    void   tick(void);
+    void   done(void);
+
+    double daynum(void);
+
+    // seconds to add to the system clock, any thread
+    static void   setClockCorrection(double seconds);
+    static double clockCorrection(void);
+
+    // before any scheduler is started, the GPS correction is ignored
+    static void   setSimulation(double start_daynum, double speed);
+    static bool   isSimulated(void);
+    static double timeScale(void);      // simulated seconds per real second
+    static double utcDaynum(void);
+
+    // QElapsedTimer::nsecsElapsed() is Qt 4.8, before it ms resolution
+    static qint64 nsecsElapsed(const QElapsedTimer& t);
+
+    const TTickStats& getStats(void) const { return stats; }
+    void  resetStats(void);
+    static QString statsString(const TTickStats& s, double hz);
+
+protected:
+    qint64 now(void);
+    void   rebase(void);
+    static void addHist(quint32 *hist, qint64 usec);
+    static qint64 percentile(const quint32 *hist, quint32 count, double p);
+
+private:
+    QElapsedTimer timer;
+    double rate;
+    qint64 period_ns, deadline_ns, tick_ns;
+
+    double base_daynum;
+    qint64 base_ns, resync_ns;
+
+    TTickStats stats;
+};
+
+#endif // TICKSCHEDULER_H